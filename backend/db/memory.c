@@ -17,29 +17,1599 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+/**
+ * \file
+ *
+ * A DB backend that keeps all entries in memory, which is useful for ephemeral metadata.
+ *
+ * Every schema is stored in a table of its own, which stores each column in a separate array.
+ * Indexes are kept in a hash table for exact matches and in an ordered sequence for ranges of their first column.
+ * Selectors are evaluated for every candidate row after the candidates have been narrowed down using the indexes.
+ * Every table has its own lock, so queries run concurrently and only modifications of the same table contend.
+ * Modifications take effect immediately, batches are not atomic.
+ **/
+
 #include <julea-config.h>
 
-#include <glib.h>
-#include <gmodule.h>
+#include <glib.h>
+#include <gmodule.h>
+
+#include <string.h>
+
+#include <julea.h>
+#include <julea-db.h>
+
+#include "jbson.c"
+
+struct JMemoryColumn
+{
+	gchar* name;
+	JDBType type;
+
+	/**
+	 * The column's values, one JDBTypeValue per row.
+	 * Strings and blobs are owned by the column.
+	 */
+	GArray* values;
+
+	/**
+	 * Whether the column has a value, one gboolean per row.
+	 */
+	GArray* set;
+};
+
+typedef struct JMemoryColumn JMemoryColumn;
+
+struct JMemoryIndex
+{
+	/**
+	 * The positions and types of the indexed columns.
+	 */
+	guint* columns;
+	JDBType* types;
+	guint column_count;
+
+	/**
+	 * Contains all entries, used for selectors that compare all indexed columns for equality.
+	 */
+	GHashTable* hash;
+
+	/**
+	 * Contains all entries ordered by their values, used for selectors on the first indexed column.
+	 * The sequence owns the entries.
+	 */
+	GSequence* sequence;
+};
+
+typedef struct JMemoryIndex JMemoryIndex;
+
+/**
+ * The rows that have the same values in the indexed columns.
+ * Entries are also used as search keys, which do not own their values.
+ */
+struct JMemoryIndexEntry
+{
+	JMemoryIndex const* index;
+
+	/**
+	 * The rows, NULL for search keys.
+	 */
+	GArray* rows;
+	GSequenceIter* iter;
+
+	/**
+	 * The number of values, search keys can have fewer values than the index has columns.
+	 */
+	guint length;
+
+	/**
+	 * Orders search keys before (-1) or after (1) entries with equal values.
+	 */
+	gint bias;
+
+	JDBTypeValue values[];
+};
+
+typedef struct JMemoryIndexEntry JMemoryIndexEntry;
+
+struct JMemoryTable
+{
+	gint ref_count;
+
+	/**
+	 * Protects the rows and the indexes.
+	 * Queries only require a reader lock.
+	 * The columns and indexes themselves do not change after the table has been created.
+	 */
+	GRWLock lock;
+
+	GPtrArray* columns;
+
+	/**
+	 * Maps column names to their positions plus one.
+	 */
+	GHashTable* positions;
+
+	GPtrArray* indexes;
+
+	/**
+	 * The ID of each row, one guint32 per row, 0 if the row has been deleted.
+	 * Rows of deleted entries are reused, their IDs are not.
+	 */
+	GArray* rows;
+
+	/**
+	 * Maps IDs to their rows plus one.
+	 */
+	GHashTable* ids;
+
+	/**
+	 * The rows of deleted entries that can be reused.
+	 */
+	GArray* free_rows;
+
+	/**
+	 * The most recently assigned ID.
+	 */
+	guint32 last_id;
+};
+
+typedef struct JMemoryTable JMemoryTable;
+
+/**
+ * A parsed selector.
+ */
+struct JMemoryCondition
+{
+	/**
+	 * The child conditions combined using mode, NULL for comparisons.
+	 */
+	GPtrArray* children;
+	JDBSelectorMode mode;
+
+	/**
+	 * The position of the compared column, -1 for the ID.
+	 */
+	gint column;
+	JDBType type;
+	JDBSelectorOperator operator;
+
+	/**
+	 * The value to compare with, strings and blobs point into the selector.
+	 */
+	JDBTypeValue value;
+};
+
+typedef struct JMemoryCondition JMemoryCondition;
+
+/**
+ * A value of a metadata document.
+ */
+struct JMemoryField
+{
+	guint column;
+
+	/**
+	 * The value, strings and blobs point into the document.
+	 */
+	JDBTypeValue value;
+};
+
+typedef struct JMemoryField JMemoryField;
+
+struct JMemoryIterator
+{
+	/**
+	 * The matching entries, which are copied when the query is executed.
+	 */
+	GPtrArray* entries;
+	guint position;
+};
+
+typedef struct JMemoryIterator JMemoryIterator;
+
+struct JMemoryBatch
+{
+	gchar* namespace;
+};
+
+typedef struct JMemoryBatch JMemoryBatch;
+
+/**
+ * Maps namespaces to hash tables, which map names to tables.
+ */
+static GHashTable* backend_namespaces = NULL;
+
+/**
+ * Protects backend_namespaces, the tables have their own locks.
+ */
+static GRWLock backend_namespaces_lock;
+
+static gint
+backend_value_compare(JDBType type, JDBTypeValue const* a, JDBTypeValue const* b)
+{
+	gint ret = 0;
+
+	switch (type)
+	{
+		case J_DB_TYPE_SINT32:
+			ret = (a->val_sint32 > b->val_sint32) - (a->val_sint32 < b->val_sint32);
+			break;
+		case J_DB_TYPE_ID:
+		case J_DB_TYPE_UINT32:
+			ret = (a->val_uint32 > b->val_uint32) - (a->val_uint32 < b->val_uint32);
+			break;
+		case J_DB_TYPE_FLOAT32:
+			ret = (a->val_float32 > b->val_float32) - (a->val_float32 < b->val_float32);
+			break;
+		case J_DB_TYPE_SINT64:
+			ret = (a->val_sint64 > b->val_sint64) - (a->val_sint64 < b->val_sint64);
+			break;
+		case J_DB_TYPE_UINT64:
+			ret = (a->val_uint64 > b->val_uint64) - (a->val_uint64 < b->val_uint64);
+			break;
+		case J_DB_TYPE_FLOAT64:
+			ret = (a->val_float64 > b->val_float64) - (a->val_float64 < b->val_float64);
+			break;
+		case J_DB_TYPE_STRING:
+			ret = g_strcmp0(a->val_string, b->val_string);
+			break;
+		case J_DB_TYPE_BLOB:
+			if (a->val_blob != NULL && b->val_blob != NULL)
+			{
+				ret = memcmp(a->val_blob, b->val_blob, MIN(a->val_blob_length, b->val_blob_length));
+			}
+
+			if (ret == 0)
+			{
+				ret = (a->val_blob_length > b->val_blob_length) - (a->val_blob_length < b->val_blob_length);
+			}
+
+			break;
+		default:
+			g_assert_not_reached();
+	}
+
+	return ret;
+}
+
+static guint
+backend_value_hash(JDBType type, JDBTypeValue const* value)
+{
+	guint hash = 0;
+	gdouble value_float;
+
+	switch (type)
+	{
+		case J_DB_TYPE_SINT32:
+		case J_DB_TYPE_ID:
+		case J_DB_TYPE_UINT32:
+			hash = value->val_uint32;
+			break;
+		case J_DB_TYPE_SINT64:
+		case J_DB_TYPE_UINT64:
+			hash = g_int64_hash(&(value->val_sint64));
+			break;
+		case J_DB_TYPE_FLOAT32:
+		case J_DB_TYPE_FLOAT64:
+			value_float = (type == J_DB_TYPE_FLOAT32) ? value->val_float32 : value->val_float64;
+
+			// -0.0 and 0.0 are equal but have different representations
+			if (value_float == 0.0)
+			{
+				value_float = 0.0;
+			}
+
+			hash = g_double_hash(&value_float);
+			break;
+		case J_DB_TYPE_STRING:
+			hash = g_str_hash(value->val_string);
+			break;
+		case J_DB_TYPE_BLOB:
+			hash = 5381;
+
+			for (guint32 i = 0; i < value->val_blob_length; i++)
+			{
+				hash = (hash << 5) + hash + (guchar)value->val_blob[i];
+			}
+
+			break;
+		default:
+			g_assert_not_reached();
+	}
+
+	return hash;
+}
+
+static void
+backend_value_copy(JDBType type, JDBTypeValue* value, JDBTypeValue const* source)
+{
+	*value = *source;
+
+	if (type == J_DB_TYPE_STRING)
+	{
+		value->val_string = g_strdup(source->val_string);
+	}
+	else if (type == J_DB_TYPE_BLOB)
+	{
+		value->val_blob = g_memdup(source->val_blob, source->val_blob_length);
+	}
+}
+
+static void
+backend_value_clear(JDBType type, JDBTypeValue* value)
+{
+	if (type == J_DB_TYPE_STRING)
+	{
+		g_free((gpointer)value->val_string);
+	}
+	else if (type == J_DB_TYPE_BLOB)
+	{
+		g_free((gpointer)value->val_blob);
+	}
+
+	memset(value, 0, sizeof(*value));
+}
+
+static JMemoryIndexEntry*
+backend_index_entry_new(JMemoryIndex const* index, guint length, gint bias)
+{
+	JMemoryIndexEntry* entry;
+
+	entry = g_malloc0(sizeof(JMemoryIndexEntry) + length * sizeof(JDBTypeValue));
+	entry->index = index;
+	entry->rows = NULL;
+	entry->iter = NULL;
+	entry->length = length;
+	entry->bias = bias;
+
+	return entry;
+}
+
+static void
+backend_index_entry_free(gpointer data)
+{
+	JMemoryIndexEntry* entry = data;
+
+	for (guint i = 0; i < entry->length; i++)
+	{
+		backend_value_clear(entry->index->types[i], &(entry->values[i]));
+	}
+
+	g_array_unref(entry->rows);
+	g_free(entry);
+}
+
+/**
+ * Compares the values both entries have, entries with equal values are ordered using their bias.
+ */
+static gint
+backend_index_entry_compare(gconstpointer a, gconstpointer b, gpointer data)
+{
+	JMemoryIndexEntry const* entry_a = a;
+	JMemoryIndexEntry const* entry_b = b;
+	JMemoryIndex const* index = data;
+	guint length;
+
+	length = MIN(entry_a->length, entry_b->length);
+
+	for (guint i = 0; i < length; i++)
+	{
+		gint ret;
+
+		ret = backend_value_compare(index->types[i], &(entry_a->values[i]), &(entry_b->values[i]));
+
+		if (ret != 0)
+		{
+			return ret;
+		}
+	}
+
+	return entry_a->bias - entry_b->bias;
+}
+
+static guint
+backend_index_entry_hash(gconstpointer key)
+{
+	JMemoryIndexEntry const* entry = key;
+	guint hash = 0;
+
+	for (guint i = 0; i < entry->length; i++)
+	{
+		hash = (hash * 31) + backend_value_hash(entry->index->types[i], &(entry->values[i]));
+	}
+
+	return hash;
+}
+
+static gboolean
+backend_index_entry_equal(gconstpointer a, gconstpointer b)
+{
+	JMemoryIndexEntry const* entry_a = a;
+	JMemoryIndexEntry const* entry_b = b;
+
+	if (entry_a->length != entry_b->length)
+	{
+		return FALSE;
+	}
+
+	for (guint i = 0; i < entry_a->length; i++)
+	{
+		if (backend_value_compare(entry_a->index->types[i], &(entry_a->values[i]), &(entry_b->values[i])) != 0)
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static JMemoryIndex*
+backend_index_new(guint column_count)
+{
+	JMemoryIndex* index;
+
+	index = g_slice_new(JMemoryIndex);
+	index->columns = g_new(guint, column_count);
+	index->types = g_new(JDBType, column_count);
+	index->column_count = column_count;
+	index->hash = g_hash_table_new(backend_index_entry_hash, backend_index_entry_equal);
+	index->sequence = g_sequence_new(backend_index_entry_free);
+
+	return index;
+}
+
+static void
+backend_index_free(gpointer data)
+{
+	JMemoryIndex* index = data;
+
+	// The sequence owns the entries
+	g_hash_table_unref(index->hash);
+	g_sequence_free(index->sequence);
+
+	g_free(index->columns);
+	g_free(index->types);
+	g_slice_free(JMemoryIndex, index);
+}
+
+static void
+backend_column_free(gpointer data)
+{
+	JMemoryColumn* column = data;
+
+	for (guint i = 0; i < column->values->len; i++)
+	{
+		if (g_array_index(column->set, gboolean, i))
+		{
+			backend_value_clear(column->type, &g_array_index(column->values, JDBTypeValue, i));
+		}
+	}
+
+	g_array_unref(column->values);
+	g_array_unref(column->set);
+	g_free(column->name);
+	g_slice_free(JMemoryColumn, column);
+}
+
+static void
+backend_table_unref(gpointer data)
+{
+	JMemoryTable* table = data;
+
+	if (g_atomic_int_dec_and_test(&(table->ref_count)))
+	{
+		g_ptr_array_unref(table->indexes);
+		g_ptr_array_unref(table->columns);
+		g_hash_table_unref(table->positions);
+		g_array_unref(table->rows);
+		g_hash_table_unref(table->ids);
+		g_array_unref(table->free_rows);
+		g_rw_lock_clear(&(table->lock));
+		g_slice_free(JMemoryTable, table);
+	}
+}
+
+/**
+ * Creates a table for a schema.
+ * The schema contains the types of all columns and the indexes in _index, which is an array of arrays of column names.
+ */
+static JMemoryTable*
+backend_table_new(bson_t const* schema, GError** error)
+{
+	JMemoryTable* table;
+	bson_iter_t iter;
+	gboolean has_next;
+
+	table = g_slice_new(JMemoryTable);
+	table->ref_count = 1;
+	g_rw_lock_init(&(table->lock));
+	table->columns = g_ptr_array_new_with_free_func(backend_column_free);
+	table->positions = g_hash_table_new(g_str_hash, g_str_equal);
+	table->indexes = g_ptr_array_new_with_free_func(backend_index_free);
+	table->rows = g_array_new(FALSE, FALSE, sizeof(guint32));
+	table->ids = g_hash_table_new(NULL, NULL);
+	table->free_rows = g_array_new(FALSE, FALSE, sizeof(guint32));
+	table->last_id = 0;
+
+	if (G_UNLIKELY(!j_bson_iter_init(&iter, schema, error)))
+	{
+		goto _error;
+	}
+
+	while (TRUE)
+	{
+		JMemoryColumn* column;
+		JDBTypeValue value;
+		gchar const* key;
+
+		if (G_UNLIKELY(!j_bson_iter_next(&iter, &has_next, error)))
+		{
+			goto _error;
+		}
+
+		if (!has_next)
+		{
+			break;
+		}
+
+		key = j_bson_iter_key(&iter, error);
+
+		if (G_UNLIKELY(key == NULL))
+		{
+			goto _error;
+		}
+
+		// The ID is not stored in a column
+		if (g_strcmp0(key, "_index") == 0 || g_strcmp0(key, "_id") == 0)
+		{
+			continue;
+		}
+
+		if (G_UNLIKELY(!j_bson_iter_value(&iter, J_DB_TYPE_UINT32, &value, error)))
+		{
+			goto _error;
+		}
+
+		if (G_UNLIKELY(value.val_uint32 > J_DB_TYPE_ID))
+		{
+			g_set_error_literal(error, J_BACKEND_DB_ERROR, J_BACKEND_DB_ERROR_DB_TYPE_INVALID, "db type invalid");
+			goto _error;
+		}
+
+		column = g_slice_new(JMemoryColumn);
+		column->name = g_strdup(key);
+		column->type = (value.val_uint32 == J_DB_TYPE_ID) ? J_DB_TYPE_UINT32 : value.val_uint32;
+		column->values = g_array_new(FALSE, FALSE, sizeof(JDBTypeValue));
+		column->set = g_array_new(FALSE, FALSE, sizeof(gboolean));
+
+		g_ptr_array_add(table->columns, column);
+		g_hash_table_insert(table->positions, column->name, GUINT_TO_POINTER(table->columns->len));
+	}
+
+	if (G_UNLIKELY(table->columns->len == 0))
+	{
+		g_set_error_literal(error, J_BACKEND_DB_ERROR, J_BACKEND_DB_ERROR_SCHEMA_EMPTY, "schema empty");
+		goto _error;
+	}
+
+	if (G_UNLIKELY(!j_bson_iter_init(&iter, schema, error)))
+	{
+		goto _error;
+	}
+
+	if (bson_iter_find(&iter, "_index"))
+	{
+		bson_iter_t iter_index;
+
+		if (G_UNLIKELY(!j_bson_iter_recurse_array(&iter, &iter_index, error)))
+		{
+			goto _error;
+		}
+
+		while (TRUE)
+		{
+			g_autoptr(GArray) positions = NULL;
+			JMemoryIndex* index;
+			bson_iter_t iter_name;
+
+			if (G_UNLIKELY(!j_bson_iter_next(&iter_index, &has_next, error)))
+			{
+				goto _error;
+			}
+
+			if (!has_next)
+			{
+				break;
+			}
+
+			if (G_UNLIKELY(!j_bson_iter_recurse_array(&iter_index, &iter_name, error)))
+			{
+				goto _error;
+			}
+
+			positions = g_array_new(FALSE, FALSE, sizeof(guint));
+
+			while (TRUE)
+			{
+				JDBTypeValue value;
+				guint position;
+
+				if (G_UNLIKELY(!j_bson_iter_next(&iter_name, &has_next, error)))
+				{
+					goto _error;
+				}
+
+				if (!has_next)
+				{
+					break;
+				}
+
+				if (G_UNLIKELY(!j_bson_iter_value(&iter_name, J_DB_TYPE_STRING, &value, error)))
+				{
+					goto _error;
+				}
+
+				position = GPOINTER_TO_UINT(g_hash_table_lookup(table->positions, value.val_string));
+
+				if (G_UNLIKELY(position == 0))
+				{
+					g_set_error_literal(error, J_BACKEND_DB_ERROR, J_BACKEND_DB_ERROR_VARIABLE_NOT_FOUND, "variable not found");
+					goto _error;
+				}
+
+				position--;
+				g_array_append_val(positions, position);
+			}
+
+			if (positions->len == 0)
+			{
+				continue;
+			}
+
+			index = backend_index_new(positions->len);
+
+			for (guint i = 0; i < positions->len; i++)
+			{
+				JMemoryColumn* column;
+
+				index->columns[i] = g_array_index(positions, guint, i);
+				column = g_ptr_array_index(table->columns, index->columns[i]);
+				index->types[i] = column->type;
+			}
+
+			g_ptr_array_add(table->indexes, index);
+		}
+	}
+
+	return table;
+
+_error:
+	backend_table_unref(table);
+
+	return NULL;
+}
+
+/**
+ * Returns a new reference to a table, NULL if it does not exist.
+ */
+static JMemoryTable*
+backend_table_get(gchar const* namespace, gchar const* name)
+{
+	GHashTable* tables;
+	JMemoryTable* table = NULL;
+
+	g_rw_lock_reader_lock(&backend_namespaces_lock);
+
+	if ((tables = g_hash_table_lookup(backend_namespaces, namespace)) != NULL)
+	{
+		table = g_hash_table_lookup(tables, name);
+	}
+
+	if (table != NULL)
+	{
+		g_atomic_int_inc(&(table->ref_count));
+	}
+
+	g_rw_lock_reader_unlock(&backend_namespaces_lock);
+
+	return table;
+}
+
+static gboolean
+backend_table_is_set(JMemoryTable* table, guint column, guint32 row)
+{
+	JMemoryColumn* column_ = g_ptr_array_index(table->columns, column);
+
+	return g_array_index(column_->set, gboolean, row);
+}
+
+static JDBTypeValue*
+backend_table_value(JMemoryTable* table, guint column, guint32 row)
+{
+	JMemoryColumn* column_ = g_ptr_array_index(table->columns, column);
+
+	return &g_array_index(column_->values, JDBTypeValue, row);
+}
+
+/**
+ * Fills a search key with the values of a row.
+ * Returns FALSE if one of the indexed columns does not have a value, such rows are not indexed.
+ */
+static gboolean
+backend_index_key_from_row(JMemoryTable* table, JMemoryIndex const* index, guint32 row, JMemoryIndexEntry* key)
+{
+	for (guint i = 0; i < index->column_count; i++)
+	{
+		if (!backend_table_is_set(table, index->columns[i], row))
+		{
+			return FALSE;
+		}
+
+		key->values[i] = *backend_table_value(table, index->columns[i], row);
+	}
+
+	return TRUE;
+}
+
+static void
+backend_index_add(JMemoryTable* table, JMemoryIndex* index, guint32 row)
+{
+	JMemoryIndexEntry* key;
+	JMemoryIndexEntry* entry;
+
+	key = backend_index_entry_new(index, index->column_count, 0);
+
+	if (!backend_index_key_from_row(table, index, row, key))
+	{
+		g_free(key);
+		return;
+	}
+
+	if ((entry = g_hash_table_lookup(index->hash, key)) == NULL)
+	{
+		entry = backend_index_entry_new(index, index->column_count, 0);
+		entry->rows = g_array_new(FALSE, FALSE, sizeof(guint32));
+
+		for (guint i = 0; i < index->column_count; i++)
+		{
+			backend_value_copy(index->types[i], &(entry->values[i]), &(key->values[i]));
+		}
+
+		entry->iter = g_sequence_insert_sorted(index->sequence, entry, backend_index_entry_compare, index);
+		g_hash_table_add(index->hash, entry);
+	}
+
+	g_array_append_val(entry->rows, row);
+
+	g_free(key);
+}
+
+static void
+backend_index_remove(JMemoryTable* table, JMemoryIndex* index, guint32 row)
+{
+	JMemoryIndexEntry* key;
+	JMemoryIndexEntry* entry;
+
+	key = backend_index_entry_new(index, index->column_count, 0);
+
+	if (backend_index_key_from_row(table, index, row, key) && (entry = g_hash_table_lookup(index->hash, key)) != NULL)
+	{
+		for (guint i = 0; i < entry->rows->len; i++)
+		{
+			if (g_array_index(entry->rows, guint32, i) == row)
+			{
+				g_array_remove_index_fast(entry->rows, i);
+				break;
+			}
+		}
+
+		if (entry->rows->len == 0)
+		{
+			g_hash_table_remove(index->hash, entry);
+			g_sequence_remove(entry->iter);
+		}
+	}
+
+	g_free(key);
+}
+
+static gboolean
+backend_index_contains(JMemoryIndex const* index, GArray* fields)
+{
+	for (guint i = 0; i < index->column_count; i++)
+	{
+		for (guint j = 0; j < fields->len; j++)
+		{
+			if (index->columns[i] == g_array_index(fields, JMemoryField, j).column)
+			{
+				return TRUE;
+			}
+		}
+	}
+
+	return FALSE;
+}
+
+/**
+ * Returns the row of an ID, G_MAXUINT32 if there is no such row.
+ */
+static guint32
+backend_table_row(JMemoryTable* table, guint32 id)
+{
+	guint32 row;
+
+	row = GPOINTER_TO_UINT(g_hash_table_lookup(table->ids, GUINT_TO_POINTER(id)));
+
+	return (row > 0) ? row - 1 : G_MAXUINT32;
+}
+
+/**
+ * Returns an empty row with a new ID, reusing the row of a deleted entry if possible.
+ */
+static guint32
+backend_table_append(JMemoryTable* table)
+{
+	guint32 row;
+
+	if (table->free_rows->len > 0)
+	{
+		// Deleted rows have already been cleared by backend_table_remove()
+		row = g_array_index(table->free_rows, guint32, table->free_rows->len - 1);
+		g_array_set_size(table->free_rows, table->free_rows->len - 1);
+	}
+	else
+	{
+		gboolean set = FALSE;
+		guint32 id = 0;
+		JDBTypeValue value;
+
+		memset(&value, 0, sizeof(value));
+
+		for (guint i = 0; i < table->columns->len; i++)
+		{
+			JMemoryColumn* column = g_ptr_array_index(table->columns, i);
+
+			g_array_append_val(column->values, value);
+			g_array_append_val(column->set, set);
+		}
+
+		g_array_append_val(table->rows, id);
+		row = table->rows->len - 1;
+	}
+
+	table->last_id++;
+	g_array_index(table->rows, guint32, row) = table->last_id;
+	g_hash_table_insert(table->ids, GUINT_TO_POINTER(table->last_id), GUINT_TO_POINTER(row + 1));
+
+	return row;
+}
+
+static void
+backend_table_set(JMemoryTable* table, guint32 row, GArray* fields)
+{
+	for (guint i = 0; i < fields->len; i++)
+	{
+		JMemoryField* field = &g_array_index(fields, JMemoryField, i);
+		JMemoryColumn* column = g_ptr_array_index(table->columns, field->column);
+		JDBTypeValue* value = &g_array_index(column->values, JDBTypeValue, row);
+
+		if (g_array_index(column->set, gboolean, row))
+		{
+			backend_value_clear(column->type, value);
+		}
+
+		backend_value_copy(column->type, value, &(field->value));
+		g_array_index(column->set, gboolean, row) = TRUE;
+	}
+}
+
+static void
+backend_table_remove(JMemoryTable* table, guint32 row)
+{
+	for (guint i = 0; i < table->indexes->len; i++)
+	{
+		backend_index_remove(table, g_ptr_array_index(table->indexes, i), row);
+	}
+
+	for (guint i = 0; i < table->columns->len; i++)
+	{
+		JMemoryColumn* column = g_ptr_array_index(table->columns, i);
+
+		if (g_array_index(column->set, gboolean, row))
+		{
+			backend_value_clear(column->type, &g_array_index(column->values, JDBTypeValue, row));
+			g_array_index(column->set, gboolean, row) = FALSE;
+		}
+	}
+
+	g_hash_table_remove(table->ids, GUINT_TO_POINTER(g_array_index(table->rows, guint32, row)));
+	g_array_index(table->rows, guint32, row) = 0;
+	g_array_append_val(table->free_rows, row);
+}
+
+static gboolean
+backend_table_to_bson(JMemoryTable* table, guint32 row, bson_t* bson, GError** error)
+{
+	JDBTypeValue value;
+
+	value.val_uint32 = g_array_index(table->rows, guint32, row);
+
+	if (G_UNLIKELY(!j_bson_append_value(bson, "_id", J_DB_TYPE_UINT32, &value, error)))
+	{
+		return FALSE;
+	}
+
+	for (guint i = 0; i < table->columns->len; i++)
+	{
+		JMemoryColumn* column = g_ptr_array_index(table->columns, i);
+
+		if (!g_array_index(column->set, gboolean, row))
+		{
+			continue;
+		}
+
+		if (G_UNLIKELY(!j_bson_append_value(bson, column->name, column->type, &g_array_index(column->values, JDBTypeValue, row), error)))
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * Parses the values of a metadata document.
+ */
+static GArray*
+backend_fields_parse(JMemoryTable* table, bson_t const* metadata, GError** error)
+{
+	GArray* fields;
+	bson_iter_t iter;
+	gboolean has_next;
+
+	fields = g_array_new(FALSE, FALSE, sizeof(JMemoryField));
+
+	if (G_UNLIKELY(!j_bson_iter_init(&iter, metadata, error)))
+	{
+		goto _error;
+	}
+
+	while (TRUE)
+	{
+		JMemoryField field;
+		JMemoryColumn* column;
+		gchar const* key;
+		guint position;
+
+		if (G_UNLIKELY(!j_bson_iter_next(&iter, &has_next, error)))
+		{
+			goto _error;
+		}
+
+		if (!has_next)
+		{
+			break;
+		}
+
+		key = j_bson_iter_key(&iter, error);
+
+		if (G_UNLIKELY(key == NULL))
+		{
+			goto _error;
+		}
+
+		position = GPOINTER_TO_UINT(g_hash_table_lookup(table->positions, key));
+
+		if (G_UNLIKELY(position == 0))
+		{
+			g_set_error_literal(error, J_BACKEND_DB_ERROR, J_BACKEND_DB_ERROR_VARIABLE_NOT_FOUND, "variable not found");
+			goto _error;
+		}
+
+		field.column = position - 1;
+		column = g_ptr_array_index(table->columns, field.column);
+
+		if (G_UNLIKELY(!j_bson_iter_value(&iter, column->type, &(field.value), error)))
+		{
+			goto _error;
+		}
+
+		g_array_append_val(fields, field);
+	}
+
+	if (G_UNLIKELY(fields->len == 0))
+	{
+		g_set_error_literal(error, J_BACKEND_DB_ERROR, J_BACKEND_DB_ERROR_NO_VARIABLE_SET, "no variable set");
+		goto _error;
+	}
+
+	return fields;
+
+_error:
+	g_array_unref(fields);
+
+	return NULL;
+}
+
+static void
+backend_condition_free(gpointer data)
+{
+	JMemoryCondition* condition = data;
+
+	if (condition->children != NULL)
+	{
+		g_ptr_array_unref(condition->children);
+	}
+
+	g_slice_free(JMemoryCondition, condition);
+}
+
+/**
+ * Parses a selector document, which contains the comparisons and nested selectors in keys other than _mode.
+ */
+static JMemoryCondition*
+backend_condition_parse(JMemoryTable* table, bson_iter_t* iter, JDBSelectorMode mode, GError** error)
+{
+	JMemoryCondition* condition;
+	gboolean has_next;
+	gboolean equals;
+
+	condition = g_slice_new0(JMemoryCondition);
+	condition->children = g_ptr_array_new_with_free_func(backend_condition_free);
+	condition->mode = mode;
+
+	if (G_UNLIKELY(mode != J_DB_SELECTOR_MODE_AND && mode != J_DB_SELECTOR_MODE_OR))
+	{
+		g_set_error_literal(error, J_BACKEND_DB_ERROR, J_BACKEND_DB_ERROR_OPERATOR_INVALID, "operator invalid");
+		goto _error;
+	}
+
+	while (TRUE)
+	{
+		JMemoryCondition* child;
+		JDBTypeValue value;
+		bson_iter_t iter_child;
+
+		if (G_UNLIKELY(!j_bson_iter_next(iter, &has_next, error)))
+		{
+			goto _error;
+		}
+
+		if (!has_next)
+		{
+			break;
+		}
+
+		if (G_UNLIKELY(!j_bson_iter_key_equals(iter, "_mode", &equals, error)))
+		{
+			goto _error;
+		}
+
+		if (equals)
+		{
+			continue;
+		}
+
+		if (G_UNLIKELY(!j_bson_iter_recurse_document(iter, &iter_child, error)))
+		{
+			goto _error;
+		}
+
+		if (bson_iter_find(&iter_child, "_mode"))
+		{
+			if (G_UNLIKELY(!j_bson_iter_value(&iter_child, J_DB_TYPE_UINT32, &value, error)))
+			{
+				goto _error;
+			}
+
+			if (G_UNLIKELY(!j_bson_iter_recurse_document(iter, &iter_child, error)))
+			{
+				goto _error;
+			}
+
+			if (G_UNLIKELY((child = backend_condition_parse(table, &iter_child, value.val_uint32, error)) == NULL))
+			{
+				goto _error;
+			}
+
+			g_ptr_array_add(condition->children, child);
+		}
+		else
+		{
+			guint position;
+
+			child = g_slice_new0(JMemoryCondition);
+			child->children = NULL;
+			g_ptr_array_add(condition->children, child);
+
+			if (G_UNLIKELY(!j_bson_iter_find(&iter_child, "_name", error)))
+			{
+				goto _error;
+			}
+
+			if (G_UNLIKELY(!j_bson_iter_value(&iter_child, J_DB_TYPE_STRING, &value, error)))
+			{
+				goto _error;
+			}
+
+			if (g_strcmp0(value.val_string, "_id") == 0)
+			{
+				child->column = -1;
+				child->type = J_DB_TYPE_UINT32;
+			}
+			else if ((position = GPOINTER_TO_UINT(g_hash_table_lookup(table->positions, value.val_string))) > 0)
+			{
+				JMemoryColumn* column = g_ptr_array_index(table->columns, position - 1);
+
+				child->column = position - 1;
+				child->type = column->type;
+			}
+			else
+			{
+				g_set_error_literal(error, J_BACKEND_DB_ERROR, J_BACKEND_DB_ERROR_VARIABLE_NOT_FOUND, "variable not found");
+				goto _error;
+			}
+
+			if (G_UNLIKELY(!j_bson_iter_recurse_document(iter, &iter_child, error)))
+			{
+				goto _error;
+			}
+
+			if (G_UNLIKELY(!j_bson_iter_find(&iter_child, "_operator", error)))
+			{
+				goto _error;
+			}
+
+			if (G_UNLIKELY(!j_bson_iter_value(&iter_child, J_DB_TYPE_UINT32, &value, error)))
+			{
+				goto _error;
+			}
+
+			child->operator = value.val_uint32;
+
+			if (G_UNLIKELY(child->operator > J_DB_SELECTOR_OPERATOR_NE))
+			{
+				g_set_error_literal(error, J_BACKEND_DB_ERROR, J_BACKEND_DB_ERROR_COMPARATOR_INVALID, "comparator invalid");
+				goto _error;
+			}
+
+			if (G_UNLIKELY(!j_bson_iter_recurse_document(iter, &iter_child, error)))
+			{
+				goto _error;
+			}
+
+			if (G_UNLIKELY(!j_bson_iter_find(&iter_child, "_value", error)))
+			{
+				goto _error;
+			}
+
+			if (G_UNLIKELY(!j_bson_iter_value(&iter_child, child->type, &(child->value), error)))
+			{
+				goto _error;
+			}
+		}
+	}
+
+	if (G_UNLIKELY(condition->children->len == 0))
+	{
+		g_set_error_literal(error, J_BACKEND_DB_ERROR, J_BACKEND_DB_ERROR_SELECTOR_EMPTY, "selector empty");
+		goto _error;
+	}
+
+	return condition;
+
+_error:
+	backend_condition_free(condition);
+
+	return NULL;
+}
+
+/**
+ * Parses a selector, condition is set to NULL if the selector matches all rows.
+ */
+static gboolean
+backend_selector_parse(JMemoryTable* table, bson_t const* selector, JMemoryCondition** condition, GError** error)
+{
+	JDBTypeValue value;
+	bson_iter_t iter;
+
+	*condition = NULL;
+
+	if (selector == NULL || !j_bson_has_enough_keys(selector, 2, NULL))
+	{
+		return TRUE;
+	}
+
+	if (G_UNLIKELY(!j_bson_iter_init(&iter, selector, error)))
+	{
+		return FALSE;
+	}
+
+	if (G_UNLIKELY(!j_bson_iter_find(&iter, "_mode", error)))
+	{
+		return FALSE;
+	}
+
+	if (G_UNLIKELY(!j_bson_iter_value(&iter, J_DB_TYPE_UINT32, &value, error)))
+	{
+		return FALSE;
+	}
+
+	if (G_UNLIKELY(!j_bson_iter_init(&iter, selector, error)))
+	{
+		return FALSE;
+	}
+
+	*condition = backend_condition_parse(table, &iter, value.val_uint32, error);
+
+	return (*condition != NULL);
+}
+
+static gboolean
+backend_condition_match(JMemoryTable* table, JMemoryCondition const* condition, guint32 row)
+{
+	JDBTypeValue const* value;
+	JDBTypeValue id;
+	gint ret;
+
+	if (condition->children != NULL)
+	{
+		for (guint i = 0; i < condition->children->len; i++)
+		{
+			gboolean match;
+
+			match = backend_condition_match(table, g_ptr_array_index(condition->children, i), row);
+
+			if (condition->mode == J_DB_SELECTOR_MODE_AND && !match)
+			{
+				return FALSE;
+			}
+			else if (condition->mode == J_DB_SELECTOR_MODE_OR && match)
+			{
+				return TRUE;
+			}
+		}
+
+		return (condition->mode == J_DB_SELECTOR_MODE_AND);
+	}
+
+	if (condition->column < 0)
+	{
+		id.val_uint32 = g_array_index(table->rows, guint32, row);
+		value = &id;
+	}
+	else if (backend_table_is_set(table, condition->column, row))
+	{
+		value = backend_table_value(table, condition->column, row);
+	}
+	else
+	{
+		// Like NULL in SQL, missing values do not match any comparison
+		return FALSE;
+	}
+
+	ret = backend_value_compare(condition->type, value, &(condition->value));
 
-#include <julea.h>
+	switch (condition->operator)
+	{
+		case J_DB_SELECTOR_OPERATOR_LT:
+			return (ret < 0);
+		case J_DB_SELECTOR_OPERATOR_LE:
+			return (ret <= 0);
+		case J_DB_SELECTOR_OPERATOR_GT:
+			return (ret > 0);
+		case J_DB_SELECTOR_OPERATOR_GE:
+			return (ret >= 0);
+		case J_DB_SELECTOR_OPERATOR_EQ:
+			return (ret == 0);
+		case J_DB_SELECTOR_OPERATOR_NE:
+			return (ret != 0);
+		default:
+			g_assert_not_reached();
+	}
+
+	return FALSE;
+}
+
+/**
+ * Returns the candidate rows for comparisons that all have to match, NULL if no index can be used.
+ */
+static GArray*
+backend_plan_comparisons(JMemoryTable* table, JMemoryCondition** conditions, guint count)
+{
+	GArray* rows;
+
+	for (guint i = 0; i < count; i++)
+	{
+		JMemoryCondition const* condition = conditions[i];
+
+		if (condition->children == NULL && condition->column < 0 && condition->operator == J_DB_SELECTOR_OPERATOR_EQ)
+		{
+			guint32 row = backend_table_row(table, condition->value.val_uint32);
+
+			rows = g_array_new(FALSE, FALSE, sizeof(guint32));
+
+			if (row != G_MAXUINT32)
+			{
+				g_array_append_val(rows, row);
+			}
+
+			return rows;
+		}
+	}
+
+	// Exact matches of all indexed columns are looked up in the hash table
+	for (guint i = 0; i < table->indexes->len; i++)
+	{
+		JMemoryIndex* index = g_ptr_array_index(table->indexes, i);
+		JMemoryIndexEntry* key;
+		JMemoryIndexEntry* entry;
+		gboolean complete = TRUE;
+
+		key = backend_index_entry_new(index, index->column_count, 0);
+
+		for (guint j = 0; j < index->column_count && complete; j++)
+		{
+			complete = FALSE;
+
+			for (guint k = 0; k < count; k++)
+			{
+				JMemoryCondition const* condition = conditions[k];
+
+				if (condition->children == NULL && condition->column == (gint)index->columns[j] && condition->operator == J_DB_SELECTOR_OPERATOR_EQ)
+				{
+					key->values[j] = condition->value;
+					complete = TRUE;
+					break;
+				}
+			}
+		}
+
+		if (complete)
+		{
+			rows = g_array_new(FALSE, FALSE, sizeof(guint32));
+
+			if ((entry = g_hash_table_lookup(index->hash, key)) != NULL)
+			{
+				g_array_append_vals(rows, entry->rows->data, entry->rows->len);
+			}
+
+			g_free(key);
+
+			return rows;
+		}
+
+		g_free(key);
+	}
+
+	// Ranges of the first indexed column are looked up in the sequence
+	for (guint i = 0; i < table->indexes->len; i++)
+	{
+		JMemoryIndex* index = g_ptr_array_index(table->indexes, i);
+		GSequenceIter* begin;
+		GSequenceIter* end;
+		gboolean usable = FALSE;
+
+		begin = g_sequence_get_begin_iter(index->sequence);
+		end = g_sequence_get_end_iter(index->sequence);
+
+		for (guint j = 0; j < count; j++)
+		{
+			JMemoryCondition const* condition = conditions[j];
+			JMemoryIndexEntry* key;
+			GSequenceIter* lower = NULL;
+			GSequenceIter* upper = NULL;
+
+			if (condition->children != NULL || condition->column != (gint)index->columns[0] || condition->operator == J_DB_SELECTOR_OPERATOR_NE)
+			{
+				continue;
+			}
+
+			key = backend_index_entry_new(index, 1, 0);
+			key->values[0] = condition->value;
+
+			if (condition->operator == J_DB_SELECTOR_OPERATOR_EQ || condition->operator == J_DB_SELECTOR_OPERATOR_GE)
+			{
+				key->bias = -1;
+				lower = g_sequence_search(index->sequence, key, backend_index_entry_compare, index);
+			}
+			else if (condition->operator == J_DB_SELECTOR_OPERATOR_GT)
+			{
+				key->bias = 1;
+				lower = g_sequence_search(index->sequence, key, backend_index_entry_compare, index);
+			}
+
+			if (condition->operator == J_DB_SELECTOR_OPERATOR_EQ || condition->operator == J_DB_SELECTOR_OPERATOR_LE)
+			{
+				key->bias = 1;
+				upper = g_sequence_search(index->sequence, key, backend_index_entry_compare, index);
+			}
+			else if (condition->operator == J_DB_SELECTOR_OPERATOR_LT)
+			{
+				key->bias = -1;
+				upper = g_sequence_search(index->sequence, key, backend_index_entry_compare, index);
+			}
+
+			g_free(key);
+
+			if (lower != NULL && g_sequence_iter_compare(lower, begin) > 0)
+			{
+				begin = lower;
+			}
+
+			if (upper != NULL && g_sequence_iter_compare(upper, end) < 0)
+			{
+				end = upper;
+			}
+
+			usable = TRUE;
+		}
+
+		if (usable)
+		{
+			rows = g_array_new(FALSE, FALSE, sizeof(guint32));
+
+			for (GSequenceIter* iter = begin; g_sequence_iter_compare(iter, end) < 0; iter = g_sequence_iter_next(iter))
+			{
+				JMemoryIndexEntry* entry = g_sequence_get(iter);
+
+				g_array_append_vals(rows, entry->rows->data, entry->rows->len);
+			}
+
+			return rows;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Returns the candidate rows for a condition, NULL if all rows have to be checked.
+ * The candidates can contain duplicates and rows that do not match.
+ */
+static GArray*
+backend_plan(JMemoryTable* table, JMemoryCondition* condition)
+{
+	GArray* rows = NULL;
+
+	if (condition->children == NULL)
+	{
+		return backend_plan_comparisons(table, &condition, 1);
+	}
+
+	if (condition->mode == J_DB_SELECTOR_MODE_AND)
+	{
+		// Any of the conditions narrows down the candidates
+		rows = backend_plan_comparisons(table, (JMemoryCondition**)condition->children->pdata, condition->children->len);
+
+		for (guint i = 0; i < condition->children->len && rows == NULL; i++)
+		{
+			JMemoryCondition* child = g_ptr_array_index(condition->children, i);
+
+			if (child->children != NULL)
+			{
+				rows = backend_plan(table, child);
+			}
+		}
+	}
+	else
+	{
+		// All of the conditions have to be able to use an index
+		rows = g_array_new(FALSE, FALSE, sizeof(guint32));
+
+		for (guint i = 0; i < condition->children->len; i++)
+		{
+			GArray* child_rows;
+
+			if ((child_rows = backend_plan(table, g_ptr_array_index(condition->children, i))) == NULL)
+			{
+				g_array_unref(rows);
+				return NULL;
+			}
+
+			g_array_append_vals(rows, child_rows->data, child_rows->len);
+			g_array_unref(child_rows);
+		}
+	}
+
+	return rows;
+}
+
+static gint
+backend_row_compare(gconstpointer a, gconstpointer b)
+{
+	guint32 row_a = *(guint32 const*)a;
+	guint32 row_b = *(guint32 const*)b;
+
+	return (row_a > row_b) - (row_a < row_b);
+}
+
+static gint
+backend_row_compare_id(gconstpointer a, gconstpointer b, gpointer data)
+{
+	JMemoryTable* table = data;
+	guint32 id_a = g_array_index(table->rows, guint32, *(guint32 const*)a);
+	guint32 id_b = g_array_index(table->rows, guint32, *(guint32 const*)b);
+
+	return (id_a > id_b) - (id_a < id_b);
+}
+
+/**
+ * Returns the rows matching a condition in the order of their IDs.
+ * The table has to be locked.
+ */
+static GArray*
+backend_table_select(JMemoryTable* table, JMemoryCondition* condition)
+{
+	GArray* candidates = NULL;
+	GArray* rows;
+	guint32 previous = G_MAXUINT32;
+
+	rows = g_array_new(FALSE, FALSE, sizeof(guint32));
+
+	if (condition != NULL)
+	{
+		candidates = backend_plan(table, condition);
+	}
+
+	if (candidates != NULL)
+	{
+		g_array_sort(candidates, backend_row_compare);
+	}
+	else
+	{
+		candidates = g_array_sized_new(FALSE, FALSE, sizeof(guint32), table->rows->len);
+
+		for (guint32 row = 0; row < table->rows->len; row++)
+		{
+			g_array_append_val(candidates, row);
+		}
+	}
+
+	for (guint i = 0; i < candidates->len; i++)
+	{
+		guint32 row = g_array_index(candidates, guint32, i);
 
-static bson_t* schema_cache = NULL;
-static bson_t* entry_cache = NULL;
-static guint32 entry_counter = 0;
+		if (row == previous || g_array_index(table->rows, guint32, row) == 0)
+		{
+			continue;
+		}
 
-G_LOCK_DEFINE_STATIC(global_lock);
+		previous = row;
+
+		if (condition == NULL || backend_condition_match(table, condition, row))
+		{
+			g_array_append_val(rows, row);
+		}
+	}
+
+	g_array_unref(candidates);
+
+	// Rows are in the order of their IDs until a row has been reused
+	if (table->last_id > table->rows->len)
+	{
+		g_array_sort_with_data(rows, backend_row_compare_id, table);
+	}
+
+	return rows;
+}
 
 static gboolean
 backend_batch_start(gchar const* namespace, JSemantics* semantics, gpointer* batch, GError** error)
 {
-	(void)error;
-	(void)batch;
+	JMemoryBatch* memory_batch;
+
 	(void)semantics;
-	(void)namespace;
+	(void)error;
+
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(batch != NULL, FALSE);
 
-	// Return something != NULL
-	*batch = batch;
+	memory_batch = g_slice_new(JMemoryBatch);
+	memory_batch->namespace = g_strdup(namespace);
+
+	*batch = memory_batch;
 
 	return TRUE;
 }
@@ -47,8 +1617,14 @@ backend_batch_start(gchar const* namespace, JSemantics* semantics, gpointer* bat
 static gboolean
 backend_batch_execute(gpointer batch, GError** error)
 {
+	JMemoryBatch* memory_batch = batch;
+
 	(void)error;
-	(void)batch;
+
+	g_return_val_if_fail(batch != NULL, FALSE);
+
+	g_free(memory_batch->namespace);
+	g_slice_free(JMemoryBatch, memory_batch);
 
 	return TRUE;
 }
@@ -56,67 +1632,128 @@ backend_batch_execute(gpointer batch, GError** error)
 static gboolean
 backend_schema_create(gpointer batch, gchar const* name, bson_t const* schema, GError** error)
 {
-	(void)error;
-	(void)batch;
-	(void)name;
-	(void)schema;
+	JMemoryBatch* memory_batch = batch;
+	JMemoryTable* table;
+	GHashTable* tables;
+	gboolean ret = FALSE;
 
-	G_LOCK(global_lock);
+	g_return_val_if_fail(batch != NULL, FALSE);
+	g_return_val_if_fail(name != NULL, FALSE);
+	g_return_val_if_fail(schema != NULL, FALSE);
 
-	if (schema_cache != NULL)
+	if ((table = backend_table_new(schema, error)) == NULL)
 	{
-		bson_destroy(schema_cache);
+		return FALSE;
 	}
 
-	schema_cache = bson_copy(schema);
+	g_rw_lock_writer_lock(&backend_namespaces_lock);
 
-	G_UNLOCK(global_lock);
+	if ((tables = g_hash_table_lookup(backend_namespaces, memory_batch->namespace)) == NULL)
+	{
+		tables = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, backend_table_unref);
+		g_hash_table_insert(backend_namespaces, g_strdup(memory_batch->namespace), tables);
+	}
 
-	return TRUE;
+	if (!g_hash_table_contains(tables, name))
+	{
+		g_hash_table_insert(tables, g_strdup(name), table);
+		table = NULL;
+		ret = TRUE;
+	}
+
+	g_rw_lock_writer_unlock(&backend_namespaces_lock);
+
+	if (table != NULL)
+	{
+		g_set_error_literal(error, J_BACKEND_DB_ERROR, J_BACKEND_DB_ERROR_FAILED, "schema already exists");
+		backend_table_unref(table);
+	}
+
+	return ret;
 }
 
 static gboolean
 backend_schema_get(gpointer batch, gchar const* name, bson_t* schema, GError** error)
 {
-	gboolean ret = FALSE;
+	JMemoryBatch* memory_batch = batch;
+	JMemoryTable* table;
+	JDBTypeValue value;
 
-	(void)error;
-	(void)batch;
-	(void)name;
-	(void)schema;
+	g_return_val_if_fail(batch != NULL, FALSE);
+	g_return_val_if_fail(name != NULL, FALSE);
 
-	G_LOCK(global_lock);
+	if ((table = backend_table_get(memory_batch->namespace, name)) == NULL)
+	{
+		g_set_error_literal(error, J_BACKEND_DB_ERROR, J_BACKEND_DB_ERROR_SCHEMA_NOT_FOUND, "schema not found");
+		return FALSE;
+	}
 
-	if (schema_cache != NULL)
+	if (schema != NULL)
 	{
 		// FIXME schema is uninitialized if backend is running on the server but initialized if running on the client
-		// bson_copy_to requires the destination to be uninitialized
-		//bson_destroy(schema);
-		bson_copy_to(schema_cache, schema);
-		ret = TRUE;
+		if (G_UNLIKELY(!j_bson_init(schema, error)))
+		{
+			goto _error;
+		}
+
+		value.val_uint32 = J_DB_TYPE_UINT32;
+
+		if (G_UNLIKELY(!j_bson_append_value(schema, "_id", J_DB_TYPE_UINT32, &value, error)))
+		{
+			goto _error_schema;
+		}
+
+		// The columns do not change after the table has been created
+		for (guint i = 0; i < table->columns->len; i++)
+		{
+			JMemoryColumn* column = g_ptr_array_index(table->columns, i);
+
+			value.val_uint32 = column->type;
+
+			if (G_UNLIKELY(!j_bson_append_value(schema, column->name, J_DB_TYPE_UINT32, &value, error)))
+			{
+				goto _error_schema;
+			}
+		}
 	}
 
-	G_UNLOCK(global_lock);
+	backend_table_unref(table);
 
-	return ret;
+	return TRUE;
+
+_error_schema:
+	j_bson_destroy(schema);
+_error:
+	backend_table_unref(table);
+
+	return FALSE;
 }
 
 static gboolean
 backend_schema_delete(gpointer batch, gchar const* name, GError** error)
 {
+	JMemoryBatch* memory_batch = batch;
+	GHashTable* tables;
+
 	(void)error;
-	(void)batch;
-	(void)name;
 
-	G_LOCK(global_lock);
+	g_return_val_if_fail(batch != NULL, FALSE);
+	g_return_val_if_fail(name != NULL, FALSE);
+
+	g_rw_lock_writer_lock(&backend_namespaces_lock);
 
-	if (schema_cache != NULL)
+	// Concurrent operations keep their references to the table
+	if ((tables = g_hash_table_lookup(backend_namespaces, memory_batch->namespace)) != NULL)
 	{
-		bson_destroy(schema_cache);
-		schema_cache = NULL;
+		g_hash_table_remove(tables, name);
+
+		if (g_hash_table_size(tables) == 0)
+		{
+			g_hash_table_remove(backend_namespaces, memory_batch->namespace);
+		}
 	}
 
-	G_UNLOCK(global_lock);
+	g_rw_lock_writer_unlock(&backend_namespaces_lock);
 
 	return TRUE;
 }
@@ -124,91 +1761,287 @@ backend_schema_delete(gpointer batch, gchar const* name, GError** error)
 static gboolean
 backend_insert(gpointer batch, gchar const* name, bson_t const* metadata, bson_t* id, GError** error)
 {
-	(void)error;
-	(void)batch;
-	(void)name;
-	(void)metadata;
-	(void)id;
+	JMemoryBatch* memory_batch = batch;
+	JMemoryTable* table;
+	g_autoptr(GArray) fields = NULL;
+	JDBTypeValue value;
+	guint32 row;
+	guint32 row_id;
 
-	G_LOCK(global_lock);
+	g_return_val_if_fail(batch != NULL, FALSE);
+	g_return_val_if_fail(name != NULL, FALSE);
+	g_return_val_if_fail(metadata != NULL, FALSE);
 
-	if (entry_cache != NULL)
+	if ((table = backend_table_get(memory_batch->namespace, name)) == NULL)
 	{
-		bson_destroy(entry_cache);
+		g_set_error_literal(error, J_BACKEND_DB_ERROR, J_BACKEND_DB_ERROR_SCHEMA_NOT_FOUND, "schema not found");
+		return FALSE;
 	}
 
-	entry_cache = bson_copy(metadata);
-	entry_counter++;
+	if ((fields = backend_fields_parse(table, metadata, error)) == NULL)
+	{
+		goto _error;
+	}
+
+	g_rw_lock_writer_lock(&(table->lock));
+
+	row = backend_table_append(table);
+	row_id = g_array_index(table->rows, guint32, row);
+	backend_table_set(table, row, fields);
+
+	for (guint i = 0; i < table->indexes->len; i++)
+	{
+		backend_index_add(table, g_ptr_array_index(table->indexes, i), row);
+	}
+
+	g_rw_lock_writer_unlock(&(table->lock));
+
+	value.val_uint32 = row_id;
+
+	if (G_UNLIKELY(!j_bson_append_value(id, "_value", J_DB_TYPE_UINT32, &value, error)))
+	{
+		goto _error;
+	}
+
+	value.val_uint32 = J_DB_TYPE_UINT32;
+
+	if (G_UNLIKELY(!j_bson_append_value(id, "_value_type", J_DB_TYPE_UINT32, &value, error)))
+	{
+		goto _error;
+	}
 
-	G_UNLOCK(global_lock);
+	backend_table_unref(table);
 
 	return TRUE;
+
+_error:
+	backend_table_unref(table);
+
+	return FALSE;
 }
 
 static gboolean
 backend_update(gpointer batch, gchar const* name, bson_t const* selector, bson_t const* metadata, GError** error)
 {
-	(void)error;
-	(void)batch;
-	(void)name;
-	(void)selector;
-	(void)metadata;
+	JMemoryBatch* memory_batch = batch;
+	JMemoryTable* table;
+	JMemoryCondition* condition = NULL;
+	g_autoptr(GArray) fields = NULL;
+	g_autoptr(GArray) rows = NULL;
+	g_autoptr(GPtrArray) indexes = NULL;
+
+	g_return_val_if_fail(batch != NULL, FALSE);
+	g_return_val_if_fail(name != NULL, FALSE);
+	g_return_val_if_fail(selector != NULL, FALSE);
+	g_return_val_if_fail(metadata != NULL, FALSE);
+
+	if ((table = backend_table_get(memory_batch->namespace, name)) == NULL)
+	{
+		g_set_error_literal(error, J_BACKEND_DB_ERROR, J_BACKEND_DB_ERROR_SCHEMA_NOT_FOUND, "schema not found");
+		return FALSE;
+	}
+
+	if (G_UNLIKELY(!j_bson_has_enough_keys(selector, 2, error)))
+	{
+		goto _error;
+	}
+
+	if ((fields = backend_fields_parse(table, metadata, error)) == NULL)
+	{
+		goto _error;
+	}
+
+	if (!backend_selector_parse(table, selector, &condition, error))
+	{
+		goto _error;
+	}
+
+	// Only indexes that contain modified columns have to be updated
+	indexes = g_ptr_array_new();
+
+	for (guint i = 0; i < table->indexes->len; i++)
+	{
+		JMemoryIndex* index = g_ptr_array_index(table->indexes, i);
+
+		if (backend_index_contains(index, fields))
+		{
+			g_ptr_array_add(indexes, index);
+		}
+	}
+
+	g_rw_lock_writer_lock(&(table->lock));
+
+	rows = backend_table_select(table, condition);
+
+	for (guint i = 0; i < rows->len; i++)
+	{
+		guint32 row = g_array_index(rows, guint32, i);
+
+		for (guint j = 0; j < indexes->len; j++)
+		{
+			backend_index_remove(table, g_ptr_array_index(indexes, j), row);
+		}
+
+		backend_table_set(table, row, fields);
+
+		for (guint j = 0; j < indexes->len; j++)
+		{
+			backend_index_add(table, g_ptr_array_index(indexes, j), row);
+		}
+	}
+
+	g_rw_lock_writer_unlock(&(table->lock));
+
+	if (rows->len == 0)
+	{
+		g_set_error_literal(error, J_BACKEND_DB_ERROR, J_BACKEND_DB_ERROR_ITERATOR_NO_MORE_ELEMENTS, "no more elements");
+		goto _error;
+	}
+
+	backend_condition_free(condition);
+	backend_table_unref(table);
 
 	return TRUE;
+
+_error:
+	if (condition != NULL)
+	{
+		backend_condition_free(condition);
+	}
+
+	backend_table_unref(table);
+
+	return FALSE;
 }
 
 static gboolean
 backend_delete(gpointer batch, gchar const* name, bson_t const* selector, GError** error)
 {
-	(void)error;
-	(void)batch;
-	(void)name;
-	(void)selector;
+	JMemoryBatch* memory_batch = batch;
+	JMemoryTable* table;
+	JMemoryCondition* condition = NULL;
+	g_autoptr(GArray) rows = NULL;
+
+	g_return_val_if_fail(batch != NULL, FALSE);
+	g_return_val_if_fail(name != NULL, FALSE);
+
+	if ((table = backend_table_get(memory_batch->namespace, name)) == NULL)
+	{
+		g_set_error_literal(error, J_BACKEND_DB_ERROR, J_BACKEND_DB_ERROR_SCHEMA_NOT_FOUND, "schema not found");
+		return FALSE;
+	}
+
+	if (!backend_selector_parse(table, selector, &condition, error))
+	{
+		goto _error;
+	}
 
-	G_LOCK(global_lock);
+	g_rw_lock_writer_lock(&(table->lock));
 
-	if (entry_cache != NULL)
+	rows = backend_table_select(table, condition);
+
+	for (guint i = 0; i < rows->len; i++)
+	{
+		backend_table_remove(table, g_array_index(rows, guint32, i));
+	}
+
+	g_rw_lock_writer_unlock(&(table->lock));
+
+	if (rows->len == 0)
 	{
-		bson_destroy(entry_cache);
-		entry_cache = NULL;
+		g_set_error_literal(error, J_BACKEND_DB_ERROR, J_BACKEND_DB_ERROR_ITERATOR_NO_MORE_ELEMENTS, "no more elements");
+		goto _error;
 	}
 
-	entry_counter--;
+	if (condition != NULL)
+	{
+		backend_condition_free(condition);
+	}
 
-	G_UNLOCK(global_lock);
+	backend_table_unref(table);
 
 	return TRUE;
+
+_error:
+	if (condition != NULL)
+	{
+		backend_condition_free(condition);
+	}
+
+	backend_table_unref(table);
+
+	return FALSE;
+}
+
+static void
+backend_entry_free(gpointer data)
+{
+	bson_destroy(data);
 }
 
 static gboolean
 backend_query(gpointer batch, gchar const* name, bson_t const* selector, gpointer* iterator, GError** error)
 {
-	guint32* counter;
+	JMemoryBatch* memory_batch = batch;
+	JMemoryIterator* memory_iterator;
+	JMemoryTable* table;
+	JMemoryCondition* condition = NULL;
+	g_autoptr(GArray) rows = NULL;
+	gboolean ret = TRUE;
 
-	(void)error;
-	(void)batch;
-	(void)name;
-	(void)selector;
+	g_return_val_if_fail(batch != NULL, FALSE);
+	g_return_val_if_fail(name != NULL, FALSE);
+	g_return_val_if_fail(iterator != NULL, FALSE);
+
+	if ((table = backend_table_get(memory_batch->namespace, name)) == NULL)
+	{
+		g_set_error_literal(error, J_BACKEND_DB_ERROR, J_BACKEND_DB_ERROR_SCHEMA_NOT_FOUND, "schema not found");
+		return FALSE;
+	}
+
+	if (!backend_selector_parse(table, selector, &condition, error))
+	{
+		backend_table_unref(table);
+		return FALSE;
+	}
+
+	memory_iterator = g_slice_new(JMemoryIterator);
+	memory_iterator->entries = g_ptr_array_new_with_free_func(backend_entry_free);
+	memory_iterator->position = 0;
 
-	counter = g_new(guint32, 1);
-	*iterator = counter;
+	// The matching entries are copied, so the lock does not have to be held while iterating
+	g_rw_lock_reader_lock(&(table->lock));
 
-	G_LOCK(global_lock);
+	rows = backend_table_select(table, condition);
 
-	if (entry_cache == NULL)
+	for (guint i = 0; i < rows->len && ret; i++)
 	{
-		*counter = 0;
+		bson_t* entry;
+
+		entry = bson_new();
+		g_ptr_array_add(memory_iterator->entries, entry);
+
+		ret = backend_table_to_bson(table, g_array_index(rows, guint32, i), entry, error);
 	}
-	else if (selector != NULL)
+
+	g_rw_lock_reader_unlock(&(table->lock));
+
+	if (condition != NULL)
 	{
-		*counter = 1;
+		backend_condition_free(condition);
 	}
-	else
+
+	backend_table_unref(table);
+
+	if (!ret)
 	{
-		*counter = entry_counter;
+		g_ptr_array_unref(memory_iterator->entries);
+		g_slice_free(JMemoryIterator, memory_iterator);
+
+		return FALSE;
 	}
 
-	G_UNLOCK(global_lock);
+	*iterator = memory_iterator;
 
 	return TRUE;
 }
@@ -216,32 +2049,25 @@ backend_query(gpointer batch, gchar const* name, bson_t const* selector, gpointe
 static gboolean
 backend_iterate(gpointer iterator, bson_t* metadata, GError** error)
 {
-	gboolean ret = TRUE;
-	guint32* counter = iterator;
-
-	(void)error;
-	(void)iterator;
-	(void)metadata;
+	JMemoryIterator* memory_iterator = iterator;
 
-	G_LOCK(global_lock);
+	g_return_val_if_fail(iterator != NULL, FALSE);
+	g_return_val_if_fail(metadata != NULL, FALSE);
 
-	if (*counter <= 0 || entry_cache == NULL)
+	if (memory_iterator->position == memory_iterator->entries->len)
 	{
-		g_free(counter);
+		g_ptr_array_unref(memory_iterator->entries);
+		g_slice_free(JMemoryIterator, memory_iterator);
+
 		g_set_error_literal(error, J_BACKEND_DB_ERROR, J_BACKEND_DB_ERROR_ITERATOR_NO_MORE_ELEMENTS, "no more elements");
-		ret = FALSE;
-		goto end;
-	}
 
-	(*counter)--;
-	// bson_copy_to requires the destination to be uninitialized
-	bson_destroy(metadata);
-	bson_copy_to(entry_cache, metadata);
+		return FALSE;
+	}
 
-end:
-	G_UNLOCK(global_lock);
+	bson_concat(metadata, g_ptr_array_index(memory_iterator->entries, memory_iterator->position));
+	memory_iterator->position++;
 
-	return ret;
+	return TRUE;
 }
 
 static gboolean
@@ -249,21 +2075,15 @@ backend_init(gchar const* path)
 {
 	(void)path;
 
+	backend_namespaces = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_hash_table_unref);
+
 	return TRUE;
 }
 
 static void
 backend_fini(void)
 {
-	if (schema_cache != NULL)
-	{
-		bson_destroy(schema_cache);
-	}
-
-	if (entry_cache != NULL)
-	{
-		bson_destroy(entry_cache);
-	}
+	g_hash_table_unref(backend_namespaces);
 }
 
 static JBackend memory_backend = {
@@ -23,15 +23,71 @@
 #include <glib.h>
 #include <gmodule.h>
 
+#include <string.h>
+
 #include <leveldb/c.h>
 
 #include <julea.h>
 
+/**
+ * The first byte of every key, which separates the backend's metadata from the namespaces' key-value pairs.
+ *
+ * Key-value pairs are stored as J_LEVELDB_KEY_DATA, the namespace's ID as a varint and the null-terminated key.
+ * Older versions stored them as namespace:key, these keys start with a printable character and are migrated on startup.
+ */
+enum JLevelDBKey
+{
+	/**
+	 * Maps namespaces to their IDs, followed by J_LEVELDB_META_NAMESPACE and the null-terminated namespace.
+	 */
+	J_LEVELDB_KEY_META = 0x00,
+	J_LEVELDB_KEY_DATA = 0x01
+};
+
+#define J_LEVELDB_META_NAMESPACE 'n'
+#define J_LEVELDB_META_VERSION 'v'
+
+/**
+ * The version of the key format.
+ */
+#define J_LEVELDB_VERSION 1
+
 struct JLevelDBBatch
 {
 	leveldb_writebatch_t* batch;
+
+	/**
+	 * Values returned by backend_get, which are freed when the batch is executed.
+	 */
+	GPtrArray* values;
+
+	/**
+	 * Copies of values returned by backend_get_multi, which are freed when the batch is executed.
+	 */
+	GPtrArray* copies;
+
 	gchar* namespace;
 	JSemantics* semantics;
+
+	/**
+	 * The key of the current operation, which is reused to avoid allocating memory for every operation.
+	 */
+	GString* key;
+
+	/**
+	 * The length of the namespace's part of key, 0 if the namespace's ID has not been looked up yet.
+	 */
+	gsize namespace_len;
+
+	/**
+	 * Whether the batch contains modifications.
+	 */
+	gboolean modified;
+
+	/**
+	 * Whether the batch holds backend_write_mutex, see backend_batch_start_update.
+	 */
+	gboolean update;
 };
 
 typedef struct JLevelDBBatch JLevelDBBatch;
@@ -39,19 +95,240 @@ typedef struct JLevelDBBatch JLevelDBBatch;
 struct JLevelDBIterator
 {
 	leveldb_iterator_t* iterator;
+
+	/**
+	 * The snapshot the iterator reads from, which does not block concurrent writes.
+	 */
+	leveldb_snapshot_t const* snapshot;
+	leveldb_readoptions_t* read_options;
+
 	gboolean first;
-	gchar* prefix;
+	GString* prefix;
 	gsize namespace_len;
+
+	/**
+	 * The key to seek to, NULL to seek to the prefix.
+	 */
+	GString* start;
+
+	/**
+	 * The key to stop at (exclusive), NULL to stop at the end of the prefix.
+	 */
+	GString* end;
+
+	/**
+	 * The maximum number of keys to return, 0 for no limit.
+	 */
+	guint32 limit;
+	guint32 count;
 };
 
 typedef struct JLevelDBIterator JLevelDBIterator;
 
 static leveldb_t* backend_db = NULL;
 
+static leveldb_cache_t* backend_cache = NULL;
+static leveldb_filterpolicy_t* backend_filter_policy = NULL;
+
+/**
+ * The size of the LRU block cache, 0 uses LevelDB's default.
+ * Can be set with the cache-size option in the path (/path/to/storage:cache-size=64M).
+ */
+static gsize backend_cache_size = 64 * 1024 * 1024;
+
+/**
+ * The number of bits per key of the bloom filter, 0 disables the filter.
+ * The filter allows looking up keys that do not exist without reading from disk.
+ * Can be set with the bloom-bits option in the path (/path/to/storage:bloom-bits=10).
+ */
+static guint backend_bloom_bits = 10;
+
+/**
+ * The size of the in-memory write buffer, 0 uses LevelDB's default.
+ * Can be set with the write-buffer-size option in the path (/path/to/storage:write-buffer-size=16M).
+ */
+static gsize backend_write_buffer_size = 16 * 1024 * 1024;
+
+/**
+ * The maximum number of open files, 0 uses LevelDB's default.
+ * Can be set with the max-open-files option in the path (/path/to/storage:max-open-files=1000).
+ */
+static guint backend_max_open_files = 0;
+
 static leveldb_readoptions_t* backend_read_options = NULL;
 static leveldb_writeoptions_t* backend_write_options = NULL;
 static leveldb_writeoptions_t* backend_write_options_sync = NULL;
 
+/**
+ * Maps namespaces to their IDs.
+ */
+static GHashTable* backend_namespaces = NULL;
+
+/**
+ * The ID of the next namespace.
+ */
+static guint32 backend_namespace_next = 1;
+
+G_LOCK_DEFINE_STATIC(backend_namespaces);
+
+/**
+ * Update batches hold the mutex from their start until they have been executed, other batches only while writing their modifications.
+ * LevelDB does not have transactions, so this keeps values read by update batches from being modified concurrently.
+ */
+static GMutex backend_write_mutex;
+
+static void
+backend_varint_append(GString* str, guint32 value)
+{
+	while (value >= 0x80)
+	{
+		g_string_append_c(str, (gchar)((value & 0x7f) | 0x80));
+		value >>= 7;
+	}
+
+	g_string_append_c(str, (gchar)value);
+}
+
+static gboolean
+backend_varint_read(gchar const* data, gsize len, guint32* value)
+{
+	guint32 result = 0;
+
+	for (gsize i = 0; i < len && i < 5; i++)
+	{
+		guint8 byte = data[i];
+
+		result |= (guint32)(byte & 0x7f) << (7 * i);
+
+		if ((byte & 0x80) == 0)
+		{
+			*value = result;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/**
+ * Appends the key of a namespace's entry in the registry.
+ */
+static void
+backend_meta_key_append(GString* str, gchar const* namespace)
+{
+	g_string_append_c(str, J_LEVELDB_KEY_META);
+	g_string_append_c(str, J_LEVELDB_META_NAMESPACE);
+	g_string_append(str, namespace);
+}
+
+/**
+ * Returns the ID of a namespace.
+ * Varints are prefix-free, so the keys of one namespace never share a prefix with the keys of another one.
+ *
+ * \param create Whether to register the namespace if it does not exist.
+ */
+static gboolean
+backend_namespace_get(gchar const* namespace, gboolean create, guint32* id)
+{
+	gpointer value;
+	gboolean ret = FALSE;
+
+	G_LOCK(backend_namespaces);
+
+	if (g_hash_table_lookup_extended(backend_namespaces, namespace, NULL, &value))
+	{
+		*id = GPOINTER_TO_UINT(value);
+		ret = TRUE;
+	}
+	else if (create)
+	{
+		g_autoptr(GString) meta_key = NULL;
+		g_autoptr(GString) meta_value = NULL;
+		g_autofree gchar* leveldb_error = NULL;
+
+		meta_key = g_string_new(NULL);
+		meta_value = g_string_new(NULL);
+
+		backend_meta_key_append(meta_key, namespace);
+		backend_varint_append(meta_value, backend_namespace_next);
+
+		// The namespace has to be registered before any of its keys are written
+		leveldb_put(backend_db, backend_write_options_sync, meta_key->str, meta_key->len + 1, meta_value->str, meta_value->len, &leveldb_error);
+
+		if (leveldb_error == NULL)
+		{
+			*id = backend_namespace_next++;
+			g_hash_table_insert(backend_namespaces, g_strdup(namespace), GUINT_TO_POINTER(*id));
+			ret = TRUE;
+		}
+	}
+
+	G_UNLOCK(backend_namespaces);
+
+	return ret;
+}
+
+/**
+ * Appends the part of a key that identifies the namespace.
+ */
+static gboolean
+backend_namespace_append(GString* str, gchar const* namespace, gboolean create)
+{
+	guint32 id;
+
+	if (!backend_namespace_get(namespace, create, &id))
+	{
+		return FALSE;
+	}
+
+	g_string_append_c(str, J_LEVELDB_KEY_DATA);
+	backend_varint_append(str, id);
+
+	return TRUE;
+}
+
+/**
+ * Sets the batch's current key.
+ *
+ * \param create Whether to register the namespace if it does not exist.
+ */
+static gboolean
+backend_batch_key(JLevelDBBatch* batch, gchar const* key, gboolean create)
+{
+	if (batch->namespace_len == 0)
+	{
+		if (!backend_namespace_append(batch->key, batch->namespace, create))
+		{
+			return FALSE;
+		}
+
+		batch->namespace_len = batch->key->len;
+	}
+
+	g_string_truncate(batch->key, batch->namespace_len);
+	g_string_append(batch->key, key);
+
+	return TRUE;
+}
+
+/**
+ * Compares two keys without their null terminators like strcmp.
+ */
+static gint
+backend_key_compare(gchar const* a, gsize a_len, gchar const* b, gsize b_len)
+{
+	gint ret;
+
+	ret = memcmp(a, b, MIN(a_len, b_len));
+
+	if (ret == 0)
+	{
+		ret = (a_len > b_len) - (a_len < b_len);
+	}
+
+	return ret;
+}
+
 static gboolean
 backend_batch_start(gchar const* namespace, JSemantics* semantics, gpointer* data)
 {
@@ -63,13 +340,38 @@ backend_batch_start(gchar const* namespace, JSemantics* semantics, gpointer* dat
 	batch = g_slice_new(JLevelDBBatch);
 
 	batch->batch = leveldb_writebatch_create();
+	batch->values = g_ptr_array_new_with_free_func(leveldb_free);
+	batch->copies = g_ptr_array_new_with_free_func(g_free);
 	batch->namespace = g_strdup(namespace);
 	batch->semantics = j_semantics_ref(semantics);
+	batch->key = g_string_new(NULL);
+	batch->namespace_len = 0;
+	batch->modified = FALSE;
+	batch->update = FALSE;
 	*data = batch;
 
 	return (batch != NULL);
 }
 
+static gboolean
+backend_batch_start_update(gchar const* namespace, JSemantics* semantics, gpointer* data)
+{
+	JLevelDBBatch* batch;
+
+	g_mutex_lock(&backend_write_mutex);
+
+	if (!backend_batch_start(namespace, semantics, data))
+	{
+		g_mutex_unlock(&backend_write_mutex);
+		return FALSE;
+	}
+
+	batch = *data;
+	batch->update = TRUE;
+
+	return TRUE;
+}
+
 static gboolean
 backend_batch_execute(gpointer data)
 {
@@ -86,10 +388,26 @@ backend_batch_execute(gpointer data)
 		write_options = backend_write_options_sync;
 	}
 
-	leveldb_write(backend_db, write_options, batch->batch, &leveldb_error);
+	if (batch->modified && !batch->update)
+	{
+		g_mutex_lock(&backend_write_mutex);
+	}
+
+	if (batch->modified)
+	{
+		leveldb_write(backend_db, write_options, batch->batch, &leveldb_error);
+	}
+
+	if (batch->modified || batch->update)
+	{
+		g_mutex_unlock(&backend_write_mutex);
+	}
 
+	g_ptr_array_unref(batch->values);
+	g_ptr_array_unref(batch->copies);
 	j_semantics_unref(batch->semantics);
 	g_free(batch->namespace);
+	g_string_free(batch->key, TRUE);
 	leveldb_writebatch_destroy(batch->batch);
 	g_slice_free(JLevelDBBatch, batch);
 
@@ -100,14 +418,18 @@ static gboolean
 backend_put(gpointer data, gchar const* key, gconstpointer value, guint32 len)
 {
 	JLevelDBBatch* batch = data;
-	g_autofree gchar* nskey = NULL;
 
 	g_return_val_if_fail(data != NULL, FALSE);
 	g_return_val_if_fail(key != NULL, FALSE);
 	g_return_val_if_fail(value != NULL, FALSE);
 
-	nskey = g_strdup_printf("%s:%s", batch->namespace, key);
-	leveldb_writebatch_put(batch->batch, nskey, strlen(nskey) + 1, value, len);
+	if (!backend_batch_key(batch, key, TRUE))
+	{
+		return FALSE;
+	}
+
+	leveldb_writebatch_put(batch->batch, batch->key->str, batch->key->len + 1, value, len);
+	batch->modified = TRUE;
 
 	return TRUE;
 }
@@ -116,23 +438,74 @@ static gboolean
 backend_delete(gpointer data, gchar const* key)
 {
 	JLevelDBBatch* batch = data;
-	g_autofree gchar* nskey = NULL;
 
 	g_return_val_if_fail(data != NULL, FALSE);
 	g_return_val_if_fail(key != NULL, FALSE);
 
-	nskey = g_strdup_printf("%s:%s", batch->namespace, key);
-	leveldb_writebatch_delete(batch->batch, nskey, strlen(nskey) + 1);
+	// Namespaces that do not exist do not contain any keys
+	if (!backend_batch_key(batch, key, FALSE))
+	{
+		return TRUE;
+	}
+
+	leveldb_writebatch_delete(batch->batch, batch->key->str, batch->key->len + 1);
+	batch->modified = TRUE;
 
 	return TRUE;
 }
 
 static gboolean
-backend_get(gpointer data, gchar const* key, gpointer* value, guint32* len)
+backend_delete_prefix(gpointer data, gchar const* prefix)
 {
 	JLevelDBBatch* batch = data;
-	g_autofree gchar* nskey = NULL;
-	g_autofree gpointer result = NULL;
+	gchar const* nsprefix;
+	leveldb_readoptions_t* read_options;
+	leveldb_iterator_t* iterator;
+	gsize nsprefix_len;
+
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(prefix != NULL, FALSE);
+
+	if (!backend_batch_key(batch, prefix, FALSE))
+	{
+		return TRUE;
+	}
+
+	nsprefix = batch->key->str;
+	nsprefix_len = batch->key->len;
+
+	read_options = leveldb_readoptions_create();
+	leveldb_readoptions_set_fill_cache(read_options, 0);
+	iterator = leveldb_create_iterator(backend_db, read_options);
+
+	// LevelDB does not support deleting ranges, so the batch deletes all keys of the range individually
+	for (leveldb_iter_seek(iterator, nsprefix, nsprefix_len); leveldb_iter_valid(iterator); leveldb_iter_next(iterator))
+	{
+		gchar const* key;
+		gsize key_len;
+
+		key = leveldb_iter_key(iterator, &key_len);
+
+		if (key_len < nsprefix_len || memcmp(key, nsprefix, nsprefix_len) != 0)
+		{
+			break;
+		}
+
+		leveldb_writebatch_delete(batch->batch, key, key_len);
+		batch->modified = TRUE;
+	}
+
+	leveldb_iter_destroy(iterator);
+	leveldb_readoptions_destroy(read_options);
+
+	return TRUE;
+}
+
+static gboolean
+backend_get(gpointer data, gchar const* key, gconstpointer* value, guint32* len)
+{
+	JLevelDBBatch* batch = data;
+	gchar* result = NULL;
 	gsize result_len;
 
 	g_return_val_if_fail(data != NULL, FALSE);
@@ -140,12 +513,19 @@ backend_get(gpointer data, gchar const* key, gpointer* value, guint32* len)
 	g_return_val_if_fail(value != NULL, FALSE);
 	g_return_val_if_fail(len != NULL, FALSE);
 
-	nskey = g_strdup_printf("%s:%s", batch->namespace, key);
-	result = leveldb_get(backend_db, backend_read_options, nskey, strlen(nskey) + 1, &result_len, NULL);
+	if (!backend_batch_key(batch, key, FALSE))
+	{
+		return FALSE;
+	}
+
+	result = leveldb_get(backend_db, backend_read_options, batch->key->str, batch->key->len + 1, &result_len, NULL);
 
 	if (result != NULL)
 	{
-		*value = g_memdup(result, result_len);
+		// LevelDB returns a copy already, hand it out directly
+		g_ptr_array_add(batch->values, result);
+
+		*value = result;
 		*len = result_len;
 	}
 
@@ -153,54 +533,189 @@ backend_get(gpointer data, gchar const* key, gpointer* value, guint32* len)
 }
 
 static gboolean
-backend_get_all(gchar const* namespace, gpointer* data)
+backend_get_multi(gpointer data, gchar const** keys, guint count, gconstpointer* values, guint32* lens)
 {
-	JLevelDBIterator* iterator = NULL;
+	JLevelDBBatch* batch = data;
+	GString* nskey = batch->key;
 	leveldb_iterator_t* it;
+	leveldb_snapshot_t const* snapshot;
+	leveldb_readoptions_t* read_options;
 
-	g_return_val_if_fail(namespace != NULL, FALSE);
 	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(keys != NULL, FALSE);
+	g_return_val_if_fail(values != NULL, FALSE);
+	g_return_val_if_fail(lens != NULL, FALSE);
+
+	// Namespaces that do not exist do not contain any keys
+	if (!backend_batch_key(batch, "", FALSE))
+	{
+		for (guint i = 0; i < count; i++)
+		{
+			values[i] = NULL;
+			lens[i] = 0;
+		}
+
+		return TRUE;
+	}
+
+	// All keys are read from the same snapshot
+	snapshot = leveldb_create_snapshot(backend_db);
+	read_options = leveldb_readoptions_create();
+	leveldb_readoptions_set_snapshot(read_options, snapshot);
+
+	it = leveldb_create_iterator(backend_db, read_options);
+
+	for (guint i = 0; i < count; i++)
+	{
+		values[i] = NULL;
+		lens[i] = 0;
+
+		if (i > 0 && strcmp(keys[i - 1], keys[i]) == 0)
+		{
+			values[i] = values[i - 1];
+			lens[i] = lens[i - 1];
+			continue;
+		}
 
-	it = leveldb_create_iterator(backend_db, backend_read_options);
+		backend_batch_key(batch, keys[i], FALSE);
 
-	if (it != NULL)
+		// The keys are sorted, so seeking usually stays within blocks that have already been loaded
+		leveldb_iter_seek(it, nskey->str, nskey->len + 1);
+
+		if (leveldb_iter_valid(it))
+		{
+			gchar const* key;
+			gsize key_len;
+
+			key = leveldb_iter_key(it, &key_len);
+
+			if (key_len == nskey->len + 1 && memcmp(key, nskey->str, key_len) == 0)
+			{
+				gchar const* value;
+				gsize value_len;
+				gpointer copy;
+
+				// The value is only valid until the iterator is moved
+				value = leveldb_iter_value(it, &value_len);
+				copy = g_memdup(value, value_len);
+				g_ptr_array_add(batch->copies, copy);
+
+				values[i] = copy;
+				lens[i] = value_len;
+			}
+		}
+	}
+
+	leveldb_iter_destroy(it);
+	leveldb_readoptions_destroy(read_options);
+	leveldb_release_snapshot(backend_db, snapshot);
+
+	return TRUE;
+}
+
+static gboolean
+backend_put_multi(gpointer data, gchar const** keys, gconstpointer* values, guint32* lens, guint count)
+{
+	JLevelDBBatch* batch = data;
+
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(keys != NULL, FALSE);
+	g_return_val_if_fail(values != NULL, FALSE);
+	g_return_val_if_fail(lens != NULL, FALSE);
+
+	for (guint i = 0; i < count; i++)
 	{
-		iterator = g_slice_new(JLevelDBIterator);
-		iterator->iterator = it;
-		iterator->first = TRUE;
-		iterator->prefix = g_strdup_printf("%s:", namespace);
-		iterator->namespace_len = strlen(namespace) + 1;
+		if (!backend_batch_key(batch, keys[i], TRUE))
+		{
+			return FALSE;
+		}
 
-		*data = iterator;
+		leveldb_writebatch_put(batch->batch, batch->key->str, batch->key->len + 1, values[i], lens[i]);
+		batch->modified = TRUE;
 	}
 
-	return (iterator != NULL);
+	return TRUE;
 }
 
+/**
+ * Creates an iterator over the keys of a namespace.
+ * Namespaces that do not exist do not contain any keys, so no LevelDB iterator is created for them.
+ */
 static gboolean
-backend_get_by_prefix(gchar const* namespace, gchar const* prefix, gpointer* data)
+backend_iterator_new(gchar const* namespace, gchar const* prefix, gchar const* start, gchar const* end, guint32 limit, gpointer* data)
 {
 	JLevelDBIterator* iterator = NULL;
-	leveldb_iterator_t* it;
 
+	iterator = g_slice_new(JLevelDBIterator);
+	iterator->iterator = NULL;
+	iterator->snapshot = NULL;
+	iterator->read_options = NULL;
+	iterator->first = TRUE;
+	iterator->prefix = g_string_new(NULL);
+	iterator->start = NULL;
+	iterator->end = NULL;
+	iterator->limit = limit;
+	iterator->count = 0;
+
+	if (backend_namespace_append(iterator->prefix, namespace, FALSE))
+	{
+		iterator->namespace_len = iterator->prefix->len;
+
+		if (start != NULL)
+		{
+			iterator->start = g_string_new_len(iterator->prefix->str, iterator->prefix->len);
+			g_string_append(iterator->start, start);
+		}
+
+		if (end != NULL)
+		{
+			iterator->end = g_string_new_len(iterator->prefix->str, iterator->prefix->len);
+			g_string_append(iterator->end, end);
+		}
+
+		g_string_append(iterator->prefix, prefix);
+
+		iterator->snapshot = leveldb_create_snapshot(backend_db);
+		iterator->read_options = leveldb_readoptions_create();
+
+		// Iterations usually touch many blocks only once, which should not evict frequently read blocks from the cache
+		leveldb_readoptions_set_fill_cache(iterator->read_options, 0);
+		leveldb_readoptions_set_snapshot(iterator->read_options, iterator->snapshot);
+
+		iterator->iterator = leveldb_create_iterator(backend_db, iterator->read_options);
+	}
+
+	*data = iterator;
+
+	return TRUE;
+}
+
+static gboolean
+backend_get_all(gchar const* namespace, gpointer* data)
+{
 	g_return_val_if_fail(namespace != NULL, FALSE);
-	g_return_val_if_fail(prefix != NULL, FALSE);
 	g_return_val_if_fail(data != NULL, FALSE);
 
-	it = leveldb_create_iterator(backend_db, backend_read_options);
+	return backend_iterator_new(namespace, "", NULL, NULL, 0, data);
+}
 
-	if (it != NULL)
-	{
-		iterator = g_slice_new(JLevelDBIterator);
-		iterator->iterator = it;
-		iterator->first = TRUE;
-		iterator->prefix = g_strdup_printf("%s:%s", namespace, prefix);
-		iterator->namespace_len = strlen(namespace) + 1;
+static gboolean
+backend_get_by_prefix(gchar const* namespace, gchar const* prefix, gpointer* data)
+{
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(prefix != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
 
-		*data = iterator;
-	}
+	return backend_iterator_new(namespace, prefix, NULL, NULL, 0, data);
+}
+
+static gboolean
+backend_get_range(gchar const* namespace, gchar const* start, gchar const* end, guint32 limit, gpointer* data)
+{
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
 
-	return (iterator != NULL);
+	return backend_iterator_new(namespace, "", start, end, limit, data);
 }
 
 static gboolean
@@ -212,9 +727,18 @@ backend_iterate(gpointer data, gchar const** key, gconstpointer* value, guint32*
 	g_return_val_if_fail(value != NULL, FALSE);
 	g_return_val_if_fail(len != NULL, FALSE);
 
+	if (iterator->iterator == NULL || (iterator->limit > 0 && iterator->count == iterator->limit))
+	{
+		goto out;
+	}
+
 	if (iterator->first)
 	{
-		leveldb_iter_seek(iterator->iterator, iterator->prefix, strlen(iterator->prefix));
+		GString* seek_key;
+
+		seek_key = (iterator->start != NULL) ? iterator->start : iterator->prefix;
+
+		leveldb_iter_seek(iterator->iterator, seek_key->str, seek_key->len);
 		iterator->first = FALSE;
 	}
 	else
@@ -225,15 +749,24 @@ backend_iterate(gpointer data, gchar const** key, gconstpointer* value, guint32*
 	if (leveldb_iter_valid(iterator->iterator))
 	{
 		gchar const* key_;
+		gsize key_len;
 		gsize tmp;
 
-		key_ = leveldb_iter_key(iterator->iterator, &tmp);
+		key_ = leveldb_iter_key(iterator->iterator, &key_len);
 
-		if (!g_str_has_prefix(key_, iterator->prefix))
+		// Keys contain their null terminator
+		if (key_len <= iterator->prefix->len || memcmp(key_, iterator->prefix->str, iterator->prefix->len) != 0)
 		{
 			goto out;
 		}
 
+		if (iterator->end != NULL && backend_key_compare(key_, key_len - 1, iterator->end->str, iterator->end->len) >= 0)
+		{
+			goto out;
+		}
+
+		iterator->count++;
+
 		*key = key_ + iterator->namespace_len;
 		*value = leveldb_iter_value(iterator->iterator, &tmp);
 		*len = tmp;
@@ -242,38 +775,305 @@ backend_iterate(gpointer data, gchar const** key, gconstpointer* value, guint32*
 	}
 
 out:
-	g_free(iterator->prefix);
-	leveldb_iter_destroy(iterator->iterator);
+	g_string_free(iterator->prefix, TRUE);
+
+	if (iterator->start != NULL)
+	{
+		g_string_free(iterator->start, TRUE);
+	}
+
+	if (iterator->end != NULL)
+	{
+		g_string_free(iterator->end, TRUE);
+	}
+
+	if (iterator->iterator != NULL)
+	{
+		leveldb_iter_destroy(iterator->iterator);
+		leveldb_readoptions_destroy(iterator->read_options);
+		leveldb_release_snapshot(backend_db, iterator->snapshot);
+	}
+
 	g_slice_free(JLevelDBIterator, iterator);
 
 	return FALSE;
 }
 
+/**
+ * Parses a size with an optional K, M or G suffix.
+ */
+static guint64
+backend_parse_size(gchar const* str)
+{
+	gchar* end;
+	guint64 size;
+
+	size = g_ascii_strtoull(str, &end, 10);
+
+	switch (g_ascii_toupper(*end))
+	{
+		case 'G':
+			size *= 1024;
+			// fall through
+		case 'M':
+			size *= 1024;
+			// fall through
+		case 'K':
+			size *= 1024;
+			break;
+		default:
+			break;
+	}
+
+	return size;
+}
+
+/**
+ * Loads the IDs of all namespaces.
+ */
+static void
+backend_namespaces_load(void)
+{
+	leveldb_iterator_t* iterator;
+	gchar const prefix[] = { J_LEVELDB_KEY_META, J_LEVELDB_META_NAMESPACE };
+
+	iterator = leveldb_create_iterator(backend_db, backend_read_options);
+
+	for (leveldb_iter_seek(iterator, prefix, sizeof(prefix)); leveldb_iter_valid(iterator); leveldb_iter_next(iterator))
+	{
+		gchar const* key;
+		gchar const* value;
+		gsize key_len;
+		gsize value_len;
+		guint32 id;
+
+		key = leveldb_iter_key(iterator, &key_len);
+		value = leveldb_iter_value(iterator, &value_len);
+
+		if (key_len <= sizeof(prefix) || memcmp(key, prefix, sizeof(prefix)) != 0)
+		{
+			break;
+		}
+
+		if (backend_varint_read(value, value_len, &id))
+		{
+			g_hash_table_insert(backend_namespaces, g_strdup(key + sizeof(prefix)), GUINT_TO_POINTER(id));
+			backend_namespace_next = MAX(backend_namespace_next, id + 1);
+		}
+	}
+
+	leveldb_iter_destroy(iterator);
+}
+
+/**
+ * Converts keys of the format namespace:key into the binary format.
+ * Older versions stored the namespace as a string in every key.
+ * Every write batch converts a number of keys completely, so an interrupted migration is continued on the next start.
+ */
+static gboolean
+backend_migrate(void)
+{
+	g_autofree gchar* leveldb_error = NULL;
+	g_autoptr(GString) key = NULL;
+	gchar* version;
+	leveldb_writebatch_t* batch;
+	leveldb_snapshot_t const* snapshot;
+	leveldb_readoptions_t* read_options;
+	leveldb_iterator_t* iterator;
+	gchar const version_key[] = { J_LEVELDB_KEY_META, J_LEVELDB_META_VERSION };
+	gchar const version_value = J_LEVELDB_VERSION;
+	gchar const legacy_start = J_LEVELDB_KEY_DATA + 1;
+	guint64 migrated = 0;
+	guint batch_len = 0;
+	gsize version_len;
+
+	version = leveldb_get(backend_db, backend_read_options, version_key, sizeof(version_key), &version_len, NULL);
+
+	if (version != NULL)
+	{
+		leveldb_free(version);
+		return TRUE;
+	}
+
+	key = g_string_new(NULL);
+	batch = leveldb_writebatch_create();
+
+	// Converting keys does not modify the snapshot
+	snapshot = leveldb_create_snapshot(backend_db);
+	read_options = leveldb_readoptions_create();
+	leveldb_readoptions_set_fill_cache(read_options, 0);
+	leveldb_readoptions_set_snapshot(read_options, snapshot);
+	iterator = leveldb_create_iterator(backend_db, read_options);
+
+	// Old keys start with the namespace, which sorts after the metadata and the converted keys
+	for (leveldb_iter_seek(iterator, &legacy_start, 1); leveldb_iter_valid(iterator) && leveldb_error == NULL; leveldb_iter_next(iterator))
+	{
+		g_autofree gchar* namespace = NULL;
+		gchar const* old_key;
+		gchar const* separator;
+		gchar const* value;
+		gsize old_key_len;
+		gsize value_len;
+
+		old_key = leveldb_iter_key(iterator, &old_key_len);
+		value = leveldb_iter_value(iterator, &value_len);
+
+		if (old_key_len == 0 || old_key[old_key_len - 1] != '\0' || (separator = strchr(old_key, ':')) == NULL)
+		{
+			g_warning("leveldb: Not migrating unknown key %.*s.", (gint)old_key_len, old_key);
+			continue;
+		}
+
+		namespace = g_strndup(old_key, separator - old_key);
+		g_string_truncate(key, 0);
+
+		if (!backend_namespace_append(key, namespace, TRUE))
+		{
+			break;
+		}
+
+		g_string_append(key, separator + 1);
+
+		leveldb_writebatch_put(batch, key->str, key->len + 1, value, value_len);
+		leveldb_writebatch_delete(batch, old_key, old_key_len);
+
+		migrated++;
+		batch_len++;
+
+		if (batch_len == 1000)
+		{
+			leveldb_write(backend_db, backend_write_options_sync, batch, &leveldb_error);
+			leveldb_writebatch_clear(batch);
+			batch_len = 0;
+		}
+	}
+
+	if (leveldb_error == NULL && !leveldb_iter_valid(iterator))
+	{
+		leveldb_writebatch_put(batch, version_key, sizeof(version_key), &version_value, 1);
+		leveldb_write(backend_db, backend_write_options_sync, batch, &leveldb_error);
+	}
+	else if (leveldb_error == NULL)
+	{
+		leveldb_error = g_strdup("Registering namespace failed.");
+	}
+
+	leveldb_iter_destroy(iterator);
+	leveldb_readoptions_destroy(read_options);
+	leveldb_release_snapshot(backend_db, snapshot);
+	leveldb_writebatch_destroy(batch);
+
+	if (leveldb_error != NULL)
+	{
+		g_critical("leveldb: Migrating keys failed: %s", leveldb_error);
+		return FALSE;
+	}
+
+	if (migrated > 0)
+	{
+		g_message("leveldb: Migrated %" G_GUINT64_FORMAT " keys to the binary key format.", migrated);
+	}
+
+	return TRUE;
+}
+
 static gboolean
 backend_init(gchar const* path)
 {
 	leveldb_options_t* options;
+	g_auto(GStrv) split = NULL;
 	g_autofree gchar* dirname = NULL;
 
 	g_return_val_if_fail(path != NULL, FALSE);
 
-	dirname = g_path_get_dirname(path);
+	// The path has the format /path/to/storage[:option,...]
+	split = g_strsplit(path, ":", 2);
+
+	if (split[0] == NULL)
+	{
+		return FALSE;
+	}
+
+	if (split[1] != NULL)
+	{
+		g_auto(GStrv) split_options = NULL;
+
+		split_options = g_strsplit(split[1], ",", 0);
+
+		for (guint i = 0; split_options[i] != NULL; i++)
+		{
+			gchar const* option = split_options[i];
+
+			if (g_str_has_prefix(option, "cache-size="))
+			{
+				backend_cache_size = backend_parse_size(option + strlen("cache-size="));
+			}
+			else if (g_str_has_prefix(option, "bloom-bits="))
+			{
+				backend_bloom_bits = g_ascii_strtoull(option + strlen("bloom-bits="), NULL, 10);
+			}
+			else if (g_str_has_prefix(option, "write-buffer-size="))
+			{
+				backend_write_buffer_size = backend_parse_size(option + strlen("write-buffer-size="));
+			}
+			else if (g_str_has_prefix(option, "max-open-files="))
+			{
+				backend_max_open_files = g_ascii_strtoull(option + strlen("max-open-files="), NULL, 10);
+			}
+			else
+			{
+				g_warning("leveldb: Unknown option %s.", option);
+			}
+		}
+	}
+
+	dirname = g_path_get_dirname(split[0]);
 	g_mkdir_with_parents(dirname, 0700);
 
 	options = leveldb_options_create();
 	leveldb_options_set_create_if_missing(options, 1);
 	leveldb_options_set_compression(options, leveldb_snappy_compression);
 
+	if (backend_cache_size > 0)
+	{
+		backend_cache = leveldb_cache_create_lru(backend_cache_size);
+		leveldb_options_set_cache(options, backend_cache);
+	}
+
+	if (backend_bloom_bits > 0)
+	{
+		backend_filter_policy = leveldb_filterpolicy_create_bloom(backend_bloom_bits);
+		leveldb_options_set_filter_policy(options, backend_filter_policy);
+	}
+
+	if (backend_write_buffer_size > 0)
+	{
+		leveldb_options_set_write_buffer_size(options, backend_write_buffer_size);
+	}
+
+	if (backend_max_open_files > 0)
+	{
+		leveldb_options_set_max_open_files(options, backend_max_open_files);
+	}
+
 	backend_read_options = leveldb_readoptions_create();
 	backend_write_options = leveldb_writeoptions_create();
 	backend_write_options_sync = leveldb_writeoptions_create();
 	leveldb_writeoptions_set_sync(backend_write_options_sync, 1);
 
-	backend_db = leveldb_open(options, path, NULL);
+	backend_db = leveldb_open(options, split[0], NULL);
 
 	leveldb_options_destroy(options);
 
-	return (backend_db != NULL);
+	if (backend_db == NULL)
+	{
+		return FALSE;
+	}
+
+	backend_namespaces = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	backend_namespaces_load();
+
+	return backend_migrate();
 }
 
 static void
@@ -283,10 +1083,26 @@ backend_fini(void)
 	leveldb_writeoptions_destroy(backend_write_options);
 	leveldb_writeoptions_destroy(backend_write_options_sync);
 
+	if (backend_namespaces != NULL)
+	{
+		g_hash_table_unref(backend_namespaces);
+	}
+
 	if (backend_db != NULL)
 	{
 		leveldb_close(backend_db);
 	}
+
+	// The cache and the filter policy are used by the database and have to be destroyed afterwards
+	if (backend_filter_policy != NULL)
+	{
+		leveldb_filterpolicy_destroy(backend_filter_policy);
+	}
+
+	if (backend_cache != NULL)
+	{
+		leveldb_cache_destroy(backend_cache);
+	}
 }
 
 static JBackend leveldb_backend = {
@@ -297,11 +1113,16 @@ static JBackend leveldb_backend = {
 		.backend_fini = backend_fini,
 		.backend_batch_start = backend_batch_start,
 		.backend_batch_execute = backend_batch_execute,
+		.backend_batch_start_update = backend_batch_start_update,
 		.backend_put = backend_put,
 		.backend_delete = backend_delete,
+		.backend_delete_prefix = backend_delete_prefix,
 		.backend_get = backend_get,
+		.backend_get_multi = backend_get_multi,
+		.backend_put_multi = backend_put_multi,
 		.backend_get_all = backend_get_all,
 		.backend_get_by_prefix = backend_get_by_prefix,
+		.backend_get_range = backend_get_range,
 		.backend_iterate = backend_iterate }
 };
 
@@ -27,9 +27,77 @@
 
 #include <julea.h>
 
+struct JLMDBOperation
+{
+	gchar* key;
+
+	/**
+	 * The value to put, NULL for deletes.
+	 */
+	gpointer value;
+	guint32 len;
+
+	/**
+	 * Whether all keys starting with key are deleted.
+	 */
+	gboolean prefix;
+
+	/**
+	 * Whether applying the operation failed before the map became full, for example, because the key did not exist.
+	 * Replaying it is expected to fail again.
+	 */
+	gboolean failed;
+};
+
+typedef struct JLMDBOperation JLMDBOperation;
+
 struct JLMDBBatch
 {
+	/**
+	 * The transaction is started by the first operation, NULL before.
+	 */
 	MDB_txn* txn;
+	gboolean read_only;
+
+	/**
+	 * The read-only transaction used before switching to a write transaction.
+	 * Values returned by backend_get point into it, so it is kept until the batch is executed.
+	 */
+	MDB_txn* reader;
+
+	/**
+	 * Copies of values read in the write transaction, which are invalidated by modifications.
+	 */
+	GPtrArray* values;
+
+	/**
+	 * The namespace's database, valid if has_dbi is TRUE.
+	 */
+	MDB_dbi dbi;
+	gboolean has_dbi;
+
+	/**
+	 * The modifications of the batch, which are replayed if the map has to be grown.
+	 */
+	GArray* operations;
+
+	/**
+	 * Whether a modification failed because the map is full.
+	 */
+	gboolean map_full;
+
+	/**
+	 * Whether the batch's modifications cannot be applied.
+	 * This happens if another writer committed between the batch's reads and its switch to a write transaction,
+	 * because the values read might be outdated, or if the batch's operations could not be replayed after the map became full.
+	 */
+	gboolean failed;
+
+	/**
+	 * The map generation the write transaction was started in.
+	 */
+	guint map_generation;
+
 	gchar* namespace;
 	JSemantics* semantics;
 };
@@ -38,152 +106,1031 @@ typedef struct JLMDBBatch JLMDBBatch;
 
 struct JLMDBIterator
 {
+	/**
+	 * NULL if the namespace does not exist.
+	 */
 	MDB_cursor* cursor;
 	MDB_txn* txn;
 	gboolean first;
+
+	/**
+	 * The key to start at, NULL to start at the first key.
+	 */
+	gchar* start;
+
+	/**
+	 * The key to stop at (exclusive), NULL to iterate until the last key.
+	 */
+	gchar* end;
+
 	gchar* prefix;
-	gsize namespace_len;
+
+	/**
+	 * The maximum number of keys to return, 0 for no limit.
+	 */
+	guint32 limit;
+	guint32 count;
 };
 
 typedef struct JLMDBIterator JLMDBIterator;
 
+/**
+ * A reset read-only transaction that can be renewed, which avoids acquiring a new reader slot.
+ */
+struct JLMDBReader
+{
+	MDB_txn* txn;
+};
+
+typedef struct JLMDBReader JLMDBReader;
+
 static MDB_env* backend_env = NULL;
+
+/**
+ * The unnamed database, which contains the names of the namespaces' databases.
+ */
 static MDB_dbi backend_dbi;
 
+/**
+ * Maps namespaces to their databases.
+ */
+static GHashTable* backend_dbis = NULL;
+
+/**
+ * The initial size of the map.
+ * Can be set with the mapsize option in the path (/path/to/storage:mapsize=1G).
+ */
+static gsize backend_mapsize = (gsize)1024 * 1024 * 1024;
+
+/**
+ * The maximum number of namespaces.
+ * Can be set with the maxdbs option in the path (/path/to/storage:maxdbs=1024).
+ */
+static guint backend_maxdbs = 256;
+
+/**
+ * Whether to use a writable memory map.
+ * Can be enabled with the writemap option in the path (/path/to/storage:writemap).
+ */
+static gboolean backend_writemap = FALSE;
+
+/**
+ * All transactions hold a reader lock, which allows growing the map while holding the writer lock.
+ * LMDB requires that no transactions are active while the map is resized.
+ */
+static GRWLock backend_map_lock;
+
+/**
+ * Incremented whenever the map is grown.
+ */
+static guint backend_map_generation = 0;
+
+/**
+ * The number of times the thread has entered backend_map_lock, which allows nesting iterators and batches.
+ */
+static GPrivate backend_map_depth;
+
+/**
+ * All readers, which have to be aborted before the environment is closed.
+ */
+static GPtrArray* backend_readers = NULL;
+
+G_LOCK_DEFINE_STATIC(backend_dbis);
+G_LOCK_DEFINE_STATIC(backend_readers);
+
+static void
+backend_map_enter(void)
+{
+	guint depth;
+
+	depth = GPOINTER_TO_UINT(g_private_get(&backend_map_depth));
+
+	if (depth == 0)
+	{
+		g_rw_lock_reader_lock(&backend_map_lock);
+	}
+
+	g_private_set(&backend_map_depth, GUINT_TO_POINTER(depth + 1));
+}
+
+static void
+backend_map_leave(void)
+{
+	guint depth;
+
+	depth = GPOINTER_TO_UINT(g_private_get(&backend_map_depth));
+
+	g_return_if_fail(depth > 0);
+
+	if (depth == 1)
+	{
+		g_rw_lock_reader_unlock(&backend_map_lock);
+	}
+
+	g_private_set(&backend_map_depth, GUINT_TO_POINTER(depth - 1));
+}
+
+/**
+ * Doubles the size of the map unless it has already been grown since generation.
+ * The calling thread must not have any active transactions.
+ */
+static gboolean
+backend_map_grow(guint generation)
+{
+	gboolean ret = TRUE;
+
+	if (GPOINTER_TO_UINT(g_private_get(&backend_map_depth)) > 0)
+	{
+		g_warning("lmdb: Cannot grow map while the thread has active transactions.");
+		return FALSE;
+	}
+
+	g_rw_lock_writer_lock(&backend_map_lock);
+
+	if (generation == backend_map_generation)
+	{
+		MDB_envinfo info;
+
+		if (mdb_env_info(backend_env, &info) == 0 && mdb_env_set_mapsize(backend_env, info.me_mapsize * 2) == 0)
+		{
+			g_debug("lmdb: Grew map to %" G_GSIZE_FORMAT " bytes.", info.me_mapsize * 2);
+			backend_map_generation++;
+		}
+		else
+		{
+			g_warning("lmdb: Could not grow map.");
+			ret = FALSE;
+		}
+	}
+
+	g_rw_lock_writer_unlock(&backend_map_lock);
+
+	return ret;
+}
+
+static void
+backend_reader_free(gpointer data)
+{
+	JLMDBReader* reader = data;
+
+	G_LOCK(backend_readers);
+
+	if (reader->txn != NULL)
+	{
+		mdb_txn_abort(reader->txn);
+	}
+
+	if (backend_readers != NULL)
+	{
+		g_ptr_array_remove_fast(backend_readers, reader);
+	}
+
+	G_UNLOCK(backend_readers);
+
+	g_slice_free(JLMDBReader, reader);
+}
+
+static GPrivate backend_reader = G_PRIVATE_INIT(backend_reader_free);
+
+/**
+ * Returns a read-only transaction, reusing the thread's reset transaction if possible.
+ */
+static MDB_txn*
+backend_reader_begin(void)
+{
+	JLMDBReader* reader;
+	MDB_txn* txn = NULL;
+
+	backend_map_enter();
+
+	reader = g_private_get(&backend_reader);
+
+	if (reader != NULL)
+	{
+		G_LOCK(backend_readers);
+		txn = reader->txn;
+		reader->txn = NULL;
+		G_UNLOCK(backend_readers);
+	}
+
+	if (txn != NULL && mdb_txn_renew(txn) != 0)
+	{
+		mdb_txn_abort(txn);
+		txn = NULL;
+	}
+
+	if (txn == NULL && mdb_txn_begin(backend_env, NULL, MDB_RDONLY, &txn) != 0)
+	{
+		txn = NULL;
+		backend_map_leave();
+	}
+
+	return txn;
+}
+
+/**
+ * Finishes a read-only transaction, keeping it for the thread's next read if possible.
+ */
+static void
+backend_reader_end(MDB_txn* txn)
+{
+	JLMDBReader* reader;
+
+	mdb_txn_reset(txn);
+
+	if ((reader = g_private_get(&backend_reader)) == NULL)
+	{
+		reader = g_slice_new(JLMDBReader);
+		reader->txn = NULL;
+
+		G_LOCK(backend_readers);
+		g_ptr_array_add(backend_readers, reader);
+		G_UNLOCK(backend_readers);
+
+		g_private_set(&backend_reader, reader);
+	}
+
+	G_LOCK(backend_readers);
+
+	if (reader->txn == NULL)
+	{
+		reader->txn = txn;
+		txn = NULL;
+	}
+
+	G_UNLOCK(backend_readers);
+
+	// The thread already has a reset transaction, for example, because an iterator was used while a batch was running
+	if (txn != NULL)
+	{
+		mdb_txn_abort(txn);
+	}
+
+	backend_map_leave();
+}
+
+/**
+ * Returns the database of a namespace.
+ * Databases must not be opened by concurrent transactions, so they are opened in a transaction of their own.
+ *
+ * \param create Whether to create the database if it does not exist.
+ *               The thread must not have an active write transaction in this case.
+ * \param created Set to the ID of the transaction that created the database, 0 if it already existed. Can be NULL.
+ */
+static gboolean
+backend_dbi_get(gchar const* namespace, gboolean create, MDB_dbi* dbi, gsize* created)
+{
+	MDB_txn* txn;
+	gpointer value;
+	gboolean ret = FALSE;
+
+	if (created != NULL)
+	{
+		*created = 0;
+	}
+
+	G_LOCK(backend_dbis);
+
+	while (!g_hash_table_lookup_extended(backend_dbis, namespace, NULL, &value))
+	{
+		guint generation;
+		gboolean grown;
+		gint err;
+
+		backend_map_enter();
+		generation = backend_map_generation;
+
+		if ((err = mdb_txn_begin(backend_env, NULL, (create) ? 0 : MDB_RDONLY, &txn)) == 0)
+		{
+			gsize txn_id = mdb_txn_id(txn);
+
+			// Only creating the database modifies the environment, opening an existing one does not start a new snapshot
+			if ((err = mdb_dbi_open(txn, namespace, 0, dbi)) == MDB_NOTFOUND && create)
+			{
+				err = mdb_dbi_open(txn, namespace, MDB_CREATE, dbi);
+			}
+			else
+			{
+				txn_id = 0;
+			}
+
+			if (err == 0)
+			{
+				// Committing makes the handle available to other transactions, also for read-only transactions
+				err = mdb_txn_commit(txn);
+			}
+			else
+			{
+				mdb_txn_abort(txn);
+			}
+
+			if (err == 0 && created != NULL)
+			{
+				*created = txn_id;
+			}
+		}
+
+		backend_map_leave();
+
+		if (err == 0)
+		{
+			g_hash_table_insert(backend_dbis, g_strdup(namespace), GUINT_TO_POINTER(*dbi));
+			ret = TRUE;
+			goto end;
+		}
+
+		if (err != MDB_MAP_FULL)
+		{
+			goto end;
+		}
+
+		// Growing the map waits for other threads' transactions, which might wait for the lock
+		G_UNLOCK(backend_dbis);
+		grown = backend_map_grow(generation);
+		G_LOCK(backend_dbis);
+
+		if (!grown)
+		{
+			goto end;
+		}
+	}
+
+	*dbi = GPOINTER_TO_UINT(value);
+	ret = TRUE;
+
+end:
+	G_UNLOCK(backend_dbis);
+
+	return ret;
+}
+
+static gboolean
+backend_batch_write_begin(JLMDBBatch* batch)
+{
+	guint const mask = MDB_NOSYNC | MDB_NOMETASYNC | MDB_MAPASYNC;
+	guint flags = MDB_NOSYNC | MDB_NOMETASYNC;
+
+	backend_map_enter();
+
+	if (mdb_txn_begin(backend_env, NULL, 0, &(batch->txn)) != 0)
+	{
+		batch->txn = NULL;
+		backend_map_leave();
+
+		return FALSE;
+	}
+
+	batch->read_only = FALSE;
+	batch->map_full = FALSE;
+	batch->map_generation = backend_map_generation;
+
+	if (j_semantics_get(batch->semantics, J_SEMANTICS_SAFETY) == J_SEMANTICS_SAFETY_STORAGE)
+	{
+		flags = 0;
+	}
+	else if (j_semantics_get(batch->semantics, J_SEMANTICS_PERSISTENCY) == J_SEMANTICS_PERSISTENCY_IMMEDIATE)
+	{
+		flags = MDB_NOMETASYNC;
+	}
+
+	// Writes to the writable map are flushed asynchronously unless the batch's semantics require syncing
+	if (backend_writemap && flags != 0)
+	{
+		flags |= MDB_MAPASYNC;
+	}
+
+	// LMDB only allows one write transaction at a time, so the flags only affect this batch's commit
+	mdb_env_set_flags(backend_env, mask, 0);
+
+	if (flags != 0)
+	{
+		mdb_env_set_flags(backend_env, flags, 1);
+	}
+
+	return TRUE;
+}
+
+/**
+ * Makes sure the batch has a transaction.
+ * Batches start with a read-only transaction and switch to a write transaction when they modify data.
+ */
+static gboolean
+backend_batch_txn(JLMDBBatch* batch, gboolean write)
+{
+	gsize created = 0;
+
+	if (batch->failed)
+	{
+		return FALSE;
+	}
+
+	if (batch->txn != NULL && (!write || !batch->read_only))
+	{
+		return TRUE;
+	}
+
+	if (batch->txn != NULL)
+	{
+		batch->reader = batch->txn;
+		batch->txn = NULL;
+	}
+
+	// Reading from a namespace that does not exist does not create it
+	if (!batch->has_dbi)
+	{
+		if (!backend_dbi_get(batch->namespace, write, &(batch->dbi), &created))
+		{
+			return FALSE;
+		}
+
+		batch->has_dbi = TRUE;
+	}
+
+	if (!write)
+	{
+		batch->txn = backend_reader_begin();
+		batch->read_only = TRUE;
+
+		return (batch->txn != NULL);
+	}
+
+	if (!backend_batch_write_begin(batch))
+	{
+		return FALSE;
+	}
+
+	// The write transaction directly follows the reader's snapshot unless another writer committed in between
+	// Creating the namespace above also commits a transaction, which does not conflict
+	if (batch->reader != NULL && mdb_txn_id(batch->txn) != mdb_txn_id(batch->reader) + ((created == mdb_txn_id(batch->reader) + 1) ? 2 : 1))
+	{
+		mdb_txn_abort(batch->txn);
+		batch->txn = NULL;
+		backend_map_leave();
+
+		batch->failed = TRUE;
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * Applies an operation to the batch's transaction.
+ *
+ * \param cursor A cursor of the transaction used for puts, NULL to use mdb_put.
+ */
+static gboolean
+backend_batch_apply(JLMDBBatch* batch, JLMDBOperation const* operation, MDB_cursor* cursor)
+{
+	MDB_val m_key;
+	MDB_val m_value;
+	gint ret;
+
+	m_key.mv_size = strlen(operation->key) + 1;
+	m_key.mv_data = operation->key;
+
+	if (operation->prefix)
+	{
+		MDB_cursor* prefix_cursor;
+
+		if ((ret = mdb_cursor_open(batch->txn, batch->dbi, &prefix_cursor)) == 0)
+		{
+			// Position the cursor at the first key that is not smaller than the prefix itself, LMDB does not support empty keys
+			m_key.mv_size--;
+			ret = mdb_cursor_get(prefix_cursor, &m_key, &m_value, (m_key.mv_size > 0) ? MDB_SET_RANGE : MDB_FIRST);
+
+			while (ret == 0 && g_str_has_prefix(m_key.mv_data, operation->key))
+			{
+				if ((ret = mdb_cursor_del(prefix_cursor, 0)) != 0)
+				{
+					break;
+				}
+
+				// The cursor already points to the following key after deleting, MDB_NEXT does not skip it
+				ret = mdb_cursor_get(prefix_cursor, &m_key, &m_value, MDB_NEXT);
+			}
+
+			mdb_cursor_close(prefix_cursor);
+
+			if (ret == MDB_NOTFOUND || (ret == 0 && !g_str_has_prefix(m_key.mv_data, operation->key)))
+			{
+				ret = 0;
+			}
+		}
+	}
+	else if (operation->value != NULL)
+	{
+		m_value.mv_size = operation->len;
+		m_value.mv_data = operation->value;
+
+		if (cursor != NULL)
+		{
+			ret = mdb_cursor_put(cursor, &m_key, &m_value, 0);
+		}
+		else
+		{
+			ret = mdb_put(batch->txn, batch->dbi, &m_key, &m_value, 0);
+		}
+	}
+	else
+	{
+		ret = mdb_del(batch->txn, batch->dbi, &m_key, NULL);
+	}
+
+	if (ret == MDB_MAP_FULL)
+	{
+		// The transaction cannot be used anymore, the operations are replayed after growing the map
+		batch->map_full = TRUE;
+		return TRUE;
+	}
+
+	return (ret == 0);
+}
+
+/**
+ * Grows the map after a modification failed because it was full and replays the batch's operations in a new write transaction.
+ * The thread must not have any other active transactions.
+ */
+static gboolean
+backend_batch_replay(JLMDBBatch* batch)
+{
+	do
+	{
+		gboolean ret = TRUE;
+
+		// The failed transaction cannot be used anymore
+		if (batch->txn != NULL)
+		{
+			mdb_txn_abort(batch->txn);
+			batch->txn = NULL;
+			backend_map_leave();
+		}
+
+		if (!backend_map_grow(batch->map_generation) || !backend_batch_write_begin(batch))
+		{
+			batch->failed = TRUE;
+			return FALSE;
+		}
+
+		for (guint i = 0; i < batch->operations->len && !batch->map_full; i++)
+		{
+			JLMDBOperation const* operation = &g_array_index(batch->operations, JLMDBOperation, i);
+
+			// Operations that succeeded before have to succeed again, otherwise the batch would be applied partially
+			if (!backend_batch_apply(batch, operation, NULL) && !operation->failed)
+			{
+				ret = FALSE;
+			}
+		}
+
+		if (!ret)
+		{
+			mdb_txn_abort(batch->txn);
+			batch->txn = NULL;
+			backend_map_leave();
+
+			batch->failed = TRUE;
+			return FALSE;
+		}
+	} while (batch->map_full);
+
+	return TRUE;
+}
+
+static void
+backend_operation_clear(gpointer data)
+{
+	JLMDBOperation* operation = data;
+
+	g_free(operation->key);
+	g_free(operation->value);
+}
+
 static gboolean
 backend_batch_start(gchar const* namespace, JSemantics* semantics, gpointer* data)
 {
-	JLMDBBatch* batch = NULL;
-	MDB_txn* txn;
+	JLMDBBatch* batch = NULL;
+
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	// Pure read batches must not take LMDB's writer lock, so the transaction is started by the first operation
+	batch = g_slice_new(JLMDBBatch);
+	batch->txn = NULL;
+	batch->read_only = TRUE;
+	batch->reader = NULL;
+	batch->values = g_ptr_array_new_with_free_func(g_free);
+	batch->has_dbi = FALSE;
+	batch->operations = g_array_new(FALSE, FALSE, sizeof(JLMDBOperation));
+	batch->map_full = FALSE;
+	batch->failed = FALSE;
+	batch->map_generation = 0;
+	batch->namespace = g_strdup(namespace);
+	batch->semantics = j_semantics_ref(semantics);
+
+	g_array_set_clear_func(batch->operations, backend_operation_clear);
+
+	*data = batch;
+
+	return TRUE;
+}
+
+static gboolean
+backend_batch_execute(gpointer data)
+{
+	gboolean ret = FALSE;
+
+	JLMDBBatch* batch = data;
+
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	// The map can only be grown if the thread does not have any active transactions
+	if (batch->reader != NULL)
+	{
+		backend_reader_end(batch->reader);
+	}
+
+	if (batch->txn == NULL)
+	{
+		ret = !batch->failed;
+	}
+	else if (batch->read_only)
+	{
+		backend_reader_end(batch->txn);
+		ret = TRUE;
+	}
+	else
+	{
+		while (TRUE)
+		{
+			gint commit;
+
+			if (batch->map_full && !backend_batch_replay(batch))
+			{
+				break;
+			}
+
+			commit = mdb_txn_commit(batch->txn);
+			batch->txn = NULL;
+			backend_map_leave();
+
+			if (commit != MDB_MAP_FULL)
+			{
+				ret = (commit == 0);
+				break;
+			}
+
+			batch->map_full = TRUE;
+		}
+	}
+
+	g_array_unref(batch->operations);
+	g_ptr_array_unref(batch->values);
+	j_semantics_unref(batch->semantics);
+	g_free(batch->namespace);
+	g_slice_free(JLMDBBatch, batch);
+
+	return ret;
+}
+
+/**
+ * Starts a batch with a write transaction, which LMDB only allows once at a time.
+ * Other writers therefore cannot modify values read by the batch until it has been executed.
+ */
+static gboolean
+backend_batch_start_update(gchar const* namespace, JSemantics* semantics, gpointer* data)
+{
+	if (!backend_batch_start(namespace, semantics, data))
+	{
+		return FALSE;
+	}
+
+	if (!backend_batch_txn(*data, TRUE))
+	{
+		backend_batch_execute(*data);
+		*data = NULL;
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+backend_put(gpointer data, gchar const* key, gconstpointer value, guint32 len)
+{
+	JLMDBBatch* batch = data;
+	JLMDBOperation operation;
+
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(key != NULL, FALSE);
+	g_return_val_if_fail(value != NULL, FALSE);
+
+	if (!backend_batch_txn(batch, TRUE))
+	{
+		return FALSE;
+	}
+
+	operation.key = g_strdup(key);
+	// Empty values still need a non-NULL pointer to distinguish them from deletes
+	operation.value = (len > 0) ? g_memdup(value, len) : g_malloc(1);
+	operation.len = len;
+	operation.prefix = FALSE;
+	operation.failed = FALSE;
+
+	// Operations are not applied after the map became full, they are replayed when the batch is executed
+	if (!batch->map_full)
+	{
+		operation.failed = !backend_batch_apply(batch, &operation, NULL);
+	}
+
+	g_array_append_val(batch->operations, operation);
+
+	return !operation.failed;
+}
+
+static gboolean
+backend_delete(gpointer data, gchar const* key)
+{
+	JLMDBBatch* batch = data;
+	JLMDBOperation operation;
 
-	g_return_val_if_fail(namespace != NULL, FALSE);
 	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(key != NULL, FALSE);
 
-	if (mdb_txn_begin(backend_env, NULL, 0, &txn) == 0)
+	if (!backend_batch_txn(batch, TRUE))
 	{
-		batch = g_slice_new(JLMDBBatch);
-		batch->txn = txn;
-		batch->namespace = g_strdup(namespace);
-		batch->semantics = j_semantics_ref(semantics);
+		return FALSE;
 	}
 
-	*data = batch;
+	operation.key = g_strdup(key);
+	operation.value = NULL;
+	operation.len = 0;
+	operation.prefix = FALSE;
+	operation.failed = FALSE;
+
+	// Operations are not applied after the map became full, they are replayed when the batch is executed
+	if (!batch->map_full)
+	{
+		operation.failed = !backend_batch_apply(batch, &operation, NULL);
+	}
 
-	return (batch != NULL);
+	g_array_append_val(batch->operations, operation);
+
+	return !operation.failed;
 }
 
 static gboolean
-backend_batch_execute(gpointer data)
+backend_delete_prefix(gpointer data, gchar const* prefix)
 {
-	gboolean ret = FALSE;
-
 	JLMDBBatch* batch = data;
+	JLMDBOperation operation;
 
 	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(prefix != NULL, FALSE);
+
+	// Deleting from a namespace that does not exist does not create it
+	if (!batch->has_dbi)
+	{
+		if (!backend_dbi_get(batch->namespace, FALSE, &(batch->dbi), NULL))
+		{
+			return TRUE;
+		}
 
-	// FIXME do something with batch->semantics
+		batch->has_dbi = TRUE;
+	}
 
-	if (mdb_txn_commit(batch->txn) == 0)
+	if (!backend_batch_txn(batch, TRUE))
 	{
-		ret = TRUE;
+		return FALSE;
 	}
 
-	// FIXME free txn
+	operation.key = g_strdup(prefix);
+	operation.value = NULL;
+	operation.len = 0;
+	operation.prefix = TRUE;
+	operation.failed = FALSE;
 
-	j_semantics_unref(batch->semantics);
-	g_free(batch->namespace);
-	g_slice_free(JLMDBBatch, batch);
+	// Operations are not applied after the map became full, they are replayed when the batch is executed
+	if (!batch->map_full)
+	{
+		operation.failed = !backend_batch_apply(batch, &operation, NULL);
+	}
 
-	return ret;
+	g_array_append_val(batch->operations, operation);
+
+	return !operation.failed;
+}
+
+/**
+ * Returns a value that stays valid until the batch is executed.
+ */
+static gconstpointer
+backend_batch_value(JLMDBBatch* batch, MDB_val const* m_value)
+{
+	gpointer value;
+
+	// Values of read-only transactions stay valid until the transaction ends, values of write transactions only until the next modification
+	if (batch->read_only)
+	{
+		return m_value->mv_data;
+	}
+
+	value = g_memdup(m_value->mv_data, m_value->mv_size);
+	g_ptr_array_add(batch->values, value);
+
+	return value;
 }
 
 static gboolean
-backend_put(gpointer data, gchar const* key, gconstpointer value, guint32 len)
+backend_get(gpointer data, gchar const* key, gconstpointer* value, guint32* len)
 {
+	gboolean ret = FALSE;
+
 	JLMDBBatch* batch = data;
 	MDB_val m_key;
 	MDB_val m_value;
-	g_autofree gchar* nskey = NULL;
 
 	g_return_val_if_fail(data != NULL, FALSE);
 	g_return_val_if_fail(key != NULL, FALSE);
 	g_return_val_if_fail(value != NULL, FALSE);
+	g_return_val_if_fail(len != NULL, FALSE);
+
+	if (!backend_batch_txn(batch, FALSE))
+	{
+		return FALSE;
+	}
+
+	// The transaction cannot be used anymore after a modification failed because the map was full
+	if (batch->map_full && !backend_batch_replay(batch))
+	{
+		return FALSE;
+	}
+
+	m_key.mv_size = strlen(key) + 1;
+	m_key.mv_data = (gpointer)(guintptr)key;
 
-	nskey = g_strdup_printf("%s:%s", batch->namespace, key);
+	if (mdb_get(batch->txn, batch->dbi, &m_key, &m_value) == 0)
+	{
+		*value = backend_batch_value(batch, &m_value);
+		*len = m_value.mv_size;
 
-	m_key.mv_size = strlen(nskey) + 1;
-	m_key.mv_data = nskey;
-	m_value.mv_size = len;
-	m_value.mv_data = value;
+		ret = TRUE;
+	}
 
-	return (mdb_put(batch->txn, backend_dbi, &m_key, &m_value, 0) == 0);
+	return ret;
 }
 
 static gboolean
-backend_delete(gpointer data, gchar const* key)
+backend_get_multi(gpointer data, gchar const** keys, guint count, gconstpointer* values, guint32* lens)
 {
 	JLMDBBatch* batch = data;
-	MDB_val m_key;
-	g_autofree gchar* nskey = NULL;
+	MDB_cursor* cursor;
 
 	g_return_val_if_fail(data != NULL, FALSE);
-	g_return_val_if_fail(key != NULL, FALSE);
+	g_return_val_if_fail(keys != NULL, FALSE);
+	g_return_val_if_fail(values != NULL, FALSE);
+	g_return_val_if_fail(lens != NULL, FALSE);
+
+	for (guint i = 0; i < count; i++)
+	{
+		values[i] = NULL;
+		lens[i] = 0;
+	}
+
+	// The namespace does not exist
+	if (!backend_batch_txn(batch, FALSE))
+	{
+		return !batch->failed;
+	}
+
+	if (batch->map_full && !backend_batch_replay(batch))
+	{
+		return FALSE;
+	}
+
+	if (mdb_cursor_open(batch->txn, batch->dbi, &cursor) != 0)
+	{
+		return FALSE;
+	}
+
+	for (guint i = 0; i < count; i++)
+	{
+		MDB_val m_key;
+		MDB_val m_value;
+
+		if (i > 0 && strcmp(keys[i - 1], keys[i]) == 0)
+		{
+			values[i] = values[i - 1];
+			lens[i] = lens[i - 1];
+			continue;
+		}
 
-	nskey = g_strdup_printf("%s:%s", batch->namespace, key);
+		m_key.mv_size = strlen(keys[i]) + 1;
+		m_key.mv_data = (gpointer)(guintptr)keys[i];
+
+		// The keys are sorted, so the cursor often stays on the same leaf page, which avoids searching from the root
+		if (mdb_cursor_get(cursor, &m_key, &m_value, MDB_SET_KEY) == 0)
+		{
+			values[i] = backend_batch_value(batch, &m_value);
+			lens[i] = m_value.mv_size;
+		}
+	}
 
-	m_key.mv_size = strlen(nskey) + 1;
-	m_key.mv_data = nskey;
+	mdb_cursor_close(cursor);
 
-	return (mdb_del(batch->txn, backend_dbi, &m_key, NULL) == 0);
+	return TRUE;
 }
 
 static gboolean
-backend_get(gpointer data, gchar const* key, gpointer* value, guint32* len)
+backend_put_multi(gpointer data, gchar const** keys, gconstpointer* values, guint32* lens, guint count)
 {
-	gboolean ret = FALSE;
-
 	JLMDBBatch* batch = data;
-	MDB_val m_key;
-	MDB_val m_value;
-	g_autofree gchar* nskey = NULL;
+	MDB_cursor* cursor = NULL;
+	gboolean ret = TRUE;
 
 	g_return_val_if_fail(data != NULL, FALSE);
-	g_return_val_if_fail(key != NULL, FALSE);
-	g_return_val_if_fail(value != NULL, FALSE);
-	g_return_val_if_fail(len != NULL, FALSE);
+	g_return_val_if_fail(keys != NULL, FALSE);
+	g_return_val_if_fail(values != NULL, FALSE);
+	g_return_val_if_fail(lens != NULL, FALSE);
 
-	nskey = g_strdup_printf("%s:%s", batch->namespace, key);
+	if (!backend_batch_txn(batch, TRUE))
+	{
+		return FALSE;
+	}
 
-	m_key.mv_size = strlen(nskey) + 1;
-	m_key.mv_data = nskey;
+	if (!batch->map_full && mdb_cursor_open(batch->txn, batch->dbi, &cursor) != 0)
+	{
+		return FALSE;
+	}
 
-	if (mdb_get(batch->txn, backend_dbi, &m_key, &m_value) == 0)
+	for (guint i = 0; i < count; i++)
 	{
-		// FIXME check whether copies can be avoided
-		*value = g_memdup(m_value.mv_data, m_value.mv_size);
-		*len = m_value.mv_size;
+		JLMDBOperation operation;
 
-		ret = TRUE;
+		operation.key = g_strdup(keys[i]);
+		operation.value = (lens[i] > 0) ? g_memdup(values[i], lens[i]) : g_malloc(1);
+		operation.len = lens[i];
+		operation.prefix = FALSE;
+		operation.failed = FALSE;
+
+		if (!batch->map_full)
+		{
+			operation.failed = !backend_batch_apply(batch, &operation, cursor);
+			ret = !operation.failed && ret;
+		}
+
+		g_array_append_val(batch->operations, operation);
+	}
+
+	if (cursor != NULL)
+	{
+		mdb_cursor_close(cursor);
 	}
 
 	return ret;
 }
 
+static void
+backend_iterator_free(JLMDBIterator* iterator)
+{
+	g_free(iterator->start);
+	g_free(iterator->end);
+	g_free(iterator->prefix);
+	g_slice_free(JLMDBIterator, iterator);
+}
+
 static gboolean
-backend_get_all(gchar const* namespace, gpointer* data)
+backend_iterator_new(gchar const* namespace, gchar const* start, gchar const* end, gchar const* prefix, guint32 limit, gpointer* data)
 {
 	JLMDBIterator* iterator = NULL;
-
-	g_return_val_if_fail(namespace != NULL, FALSE);
-	g_return_val_if_fail(data != NULL, FALSE);
+	MDB_dbi dbi;
 
 	iterator = g_slice_new(JLMDBIterator);
+	iterator->cursor = NULL;
+	iterator->txn = NULL;
 	iterator->first = TRUE;
-	iterator->prefix = g_strdup_printf("%s:", namespace);
-	iterator->namespace_len = strlen(namespace) + 1;
-
-	mdb_txn_begin(backend_env, NULL, 0, &(iterator->txn));
-	mdb_cursor_open(iterator->txn, backend_dbi, &(iterator->cursor));
+	// LMDB does not support empty keys
+	iterator->start = (start != NULL && start[0] != '\0') ? g_strdup(start) : NULL;
+	iterator->end = g_strdup(end);
+	iterator->prefix = g_strdup(prefix);
+	iterator->limit = limit;
+	iterator->count = 0;
+
+	// Namespaces without a database do not contain any keys
+	if (backend_dbi_get(namespace, FALSE, &dbi, NULL))
+	{
+		if ((iterator->txn = backend_reader_begin()) == NULL)
+		{
+			backend_iterator_free(iterator);
+			iterator = NULL;
+		}
+		else if (mdb_cursor_open(iterator->txn, dbi, &(iterator->cursor)) != 0)
+		{
+			iterator->cursor = NULL;
+		}
+	}
 
 	*data = iterator;
 
@@ -191,25 +1138,31 @@ backend_get_all(gchar const* namespace, gpointer* data)
 }
 
 static gboolean
-backend_get_by_prefix(gchar const* namespace, gchar const* prefix, gpointer* data)
+backend_get_all(gchar const* namespace, gpointer* data)
 {
-	JLMDBIterator* iterator = NULL;
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
 
+	return backend_iterator_new(namespace, NULL, NULL, "", 0, data);
+}
+
+static gboolean
+backend_get_by_prefix(gchar const* namespace, gchar const* prefix, gpointer* data)
+{
 	g_return_val_if_fail(namespace != NULL, FALSE);
 	g_return_val_if_fail(prefix != NULL, FALSE);
 	g_return_val_if_fail(data != NULL, FALSE);
 
-	iterator = g_slice_new(JLMDBIterator);
-	iterator->first = TRUE;
-	iterator->prefix = g_strdup_printf("%s:%s", namespace, prefix);
-	iterator->namespace_len = strlen(namespace) + 1;
-
-	mdb_txn_begin(backend_env, NULL, 0, &(iterator->txn));
-	mdb_cursor_open(iterator->txn, backend_dbi, &(iterator->cursor));
+	return backend_iterator_new(namespace, prefix, NULL, prefix, 0, data);
+}
 
-	*data = iterator;
+static gboolean
+backend_get_range(gchar const* namespace, gchar const* start, gchar const* end, guint32 limit, gpointer* data)
+{
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
 
-	return (iterator != NULL);
+	return backend_iterator_new(namespace, start, end, "", limit, data);
 }
 
 static gboolean
@@ -224,26 +1177,48 @@ backend_iterate(gpointer data, gchar const** key, gconstpointer* value, guint32*
 	g_return_val_if_fail(value != NULL, FALSE);
 	g_return_val_if_fail(len != NULL, FALSE);
 
-	if (iterator->first)
+	if (iterator->cursor == NULL)
 	{
-		// FIXME check +1
-		m_key.mv_size = strlen(iterator->prefix) + 1;
-		m_key.mv_data = iterator->prefix;
+		goto out;
+	}
+
+	if (iterator->limit > 0 && iterator->count == iterator->limit)
+	{
+		goto out;
+	}
 
-		cursor_op = MDB_SET_RANGE;
+	if (iterator->first)
+	{
+		if (iterator->start != NULL)
+		{
+			m_key.mv_size = strlen(iterator->start);
+			m_key.mv_data = iterator->start;
+			cursor_op = MDB_SET_RANGE;
+		}
+		else
+		{
+			cursor_op = MDB_FIRST;
+		}
 
 		iterator->first = FALSE;
 	}
 
 	if (mdb_cursor_get(iterator->cursor, &m_key, &m_value, cursor_op) == 0)
 	{
+		// Keys are sorted and the namespace has its own database, so the first key without the prefix ends the iteration
 		if (!g_str_has_prefix(m_key.mv_data, iterator->prefix))
 		{
-			// FIXME check whether we can completely terminate
 			goto out;
 		}
 
-		*key = (gchar const*)m_key.mv_data + iterator->namespace_len;
+		if (iterator->end != NULL && strcmp(m_key.mv_data, iterator->end) >= 0)
+		{
+			goto out;
+		}
+
+		iterator->count++;
+
+		*key = m_key.mv_data;
 		*value = m_value.mv_data;
 		*len = m_value.mv_size;
 
@@ -251,36 +1226,254 @@ backend_iterate(gpointer data, gchar const** key, gconstpointer* value, guint32*
 	}
 
 out:
-	mdb_txn_commit(iterator->txn);
+	if (iterator->cursor != NULL)
+	{
+		// Cursors of read-only transactions have to be closed explicitly
+		mdb_cursor_close(iterator->cursor);
+	}
 
-	g_free(iterator->prefix);
-	g_slice_free(JLMDBIterator, iterator);
+	if (iterator->txn != NULL)
+	{
+		backend_reader_end(iterator->txn);
+	}
+
+	backend_iterator_free(iterator);
 
 	return FALSE;
 }
 
+/**
+ * Moves keys of the format namespace:key from the unnamed database into the namespaces' databases.
+ * Older versions stored all namespaces in the unnamed database.
+ */
+static gboolean
+backend_migrate(void)
+{
+	guint64 migrated = 0;
+
+	while (TRUE)
+	{
+		g_autoptr(GPtrArray) keys = NULL;
+		MDB_cursor* cursor;
+		MDB_txn* txn;
+		MDB_val m_key;
+		MDB_val m_value;
+		gint ret = 0;
+
+		keys = g_ptr_array_new_with_free_func(g_free);
+
+		if (mdb_txn_begin(backend_env, NULL, 0, &txn) != 0)
+		{
+			return FALSE;
+		}
+
+		if (mdb_cursor_open(txn, backend_dbi, &cursor) != 0)
+		{
+			mdb_txn_abort(txn);
+			return FALSE;
+		}
+
+		// Names of databases are not null-terminated, old keys are
+		for (gint op = MDB_FIRST; keys->len < 1000 && mdb_cursor_get(cursor, &m_key, &m_value, op) == 0; op = MDB_NEXT)
+		{
+			gchar const* data = m_key.mv_data;
+
+			if (m_key.mv_size > 0 && data[m_key.mv_size - 1] == '\0' && strchr(data, ':') != NULL)
+			{
+				g_ptr_array_add(keys, g_strdup(data));
+			}
+		}
+
+		mdb_cursor_close(cursor);
+
+		if (keys->len == 0)
+		{
+			mdb_txn_abort(txn);
+			break;
+		}
+
+		for (guint i = 0; i < keys->len && ret == 0; i++)
+		{
+			gchar* old_key = g_ptr_array_index(keys, i);
+			gchar* separator = strchr(old_key, ':');
+			MDB_val m_new_key;
+			MDB_dbi dbi;
+
+			m_key.mv_size = strlen(old_key) + 1;
+			m_key.mv_data = old_key;
+
+			if ((ret = mdb_get(txn, backend_dbi, &m_key, &m_value)) != 0)
+			{
+				break;
+			}
+
+			*separator = '\0';
+
+			if ((ret = mdb_dbi_open(txn, old_key, MDB_CREATE, &dbi)) != 0)
+			{
+				break;
+			}
+
+			m_new_key.mv_size = strlen(separator + 1) + 1;
+			m_new_key.mv_data = separator + 1;
+
+			if ((ret = mdb_put(txn, dbi, &m_new_key, &m_value, 0)) != 0)
+			{
+				break;
+			}
+
+			*separator = ':';
+
+			ret = mdb_del(txn, backend_dbi, &m_key, NULL);
+		}
+
+		if (ret == 0)
+		{
+			ret = mdb_txn_commit(txn);
+		}
+		else
+		{
+			mdb_txn_abort(txn);
+		}
+
+		if (ret == MDB_MAP_FULL)
+		{
+			MDB_envinfo info;
+
+			// No other transactions are active during initialization
+			if (mdb_env_info(backend_env, &info) != 0 || mdb_env_set_mapsize(backend_env, info.me_mapsize * 2) != 0)
+			{
+				return FALSE;
+			}
+
+			continue;
+		}
+
+		if (ret != 0)
+		{
+			return FALSE;
+		}
+
+		migrated += keys->len;
+	}
+
+	if (migrated > 0)
+	{
+		g_message("lmdb: Migrated %" G_GUINT64_FORMAT " keys to per-namespace databases.", migrated);
+	}
+
+	return TRUE;
+}
+
+/**
+ * Parses a size with an optional K, M, G or T suffix.
+ */
+static guint64
+backend_parse_size(gchar const* str)
+{
+	gchar* end;
+	guint64 size;
+
+	size = g_ascii_strtoull(str, &end, 10);
+
+	switch (g_ascii_toupper(*end))
+	{
+		case 'T':
+			size *= 1024;
+			// fall through
+		case 'G':
+			size *= 1024;
+			// fall through
+		case 'M':
+			size *= 1024;
+			// fall through
+		case 'K':
+			size *= 1024;
+			break;
+		default:
+			break;
+	}
+
+	return size;
+}
+
 static gboolean
 backend_init(gchar const* path)
 {
+	g_auto(GStrv) split = NULL;
 	MDB_txn* txn;
+	MDB_envinfo info;
+	guint flags = MDB_NOTLS;
 
 	g_return_val_if_fail(path != NULL, FALSE);
 
-	g_mkdir_with_parents(path, 0700);
+	// The path has the format /path/to/storage[:option,...]
+	split = g_strsplit(path, ":", 2);
+
+	if (split[0] == NULL)
+	{
+		return FALSE;
+	}
+
+	if (split[1] != NULL)
+	{
+		g_auto(GStrv) options = NULL;
+
+		options = g_strsplit(split[1], ",", 0);
+
+		for (guint i = 0; options[i] != NULL; i++)
+		{
+			if (g_strcmp0(options[i], "writemap") == 0)
+			{
+				backend_writemap = TRUE;
+			}
+			else if (g_str_has_prefix(options[i], "mapsize="))
+			{
+				backend_mapsize = backend_parse_size(options[i] + strlen("mapsize="));
+			}
+			else if (g_str_has_prefix(options[i], "maxdbs="))
+			{
+				backend_maxdbs = g_ascii_strtoull(options[i] + strlen("maxdbs="), NULL, 10);
+			}
+			else
+			{
+				g_warning("lmdb: Unknown option %s.", options[i]);
+			}
+		}
+	}
+
+	g_mkdir_with_parents(split[0], 0700);
+
+	if (backend_writemap)
+	{
+		flags |= MDB_WRITEMAP;
+	}
 
 	if (mdb_env_create(&backend_env) == 0)
 	{
-		// FIXME grow mapsize dynamically (default is 10 MiB)
-		if (mdb_env_set_mapsize(backend_env, (gsize)4 * 1024 * 1024 * 1024) != 0)
+		// The map is grown when it is full
+		if (mdb_env_set_mapsize(backend_env, backend_mapsize) != 0)
+		{
+			goto error;
+		}
+
+		if (mdb_env_set_maxdbs(backend_env, backend_maxdbs) != 0)
 		{
 			goto error;
 		}
 
-		if (mdb_env_open(backend_env, path, 0, 0600) != 0)
+		// Read-only transactions are not bound to threads, which allows reusing them and using iterators and batches at the same time
+		if (mdb_env_open(backend_env, split[0], flags, 0600) != 0)
 		{
 			goto error;
 		}
 
+		// Existing environments might have been grown beyond the initial size
+		if (mdb_env_info(backend_env, &info) == 0 && info.me_mapsize < backend_mapsize)
+		{
+			mdb_env_set_mapsize(backend_env, backend_mapsize);
+		}
+
 		if (mdb_txn_begin(backend_env, NULL, 0, &txn) != 0)
 		{
 			goto error;
@@ -295,12 +1488,21 @@ backend_init(gchar const* path)
 		{
 			goto error;
 		}
+
+		if (!backend_migrate())
+		{
+			goto error;
+		}
 	}
 
+	backend_readers = g_ptr_array_new();
+	backend_dbis = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
 	return (backend_env != NULL);
 
 error:
 	mdb_env_close(backend_env);
+	backend_env = NULL;
 
 	return FALSE;
 }
@@ -308,9 +1510,34 @@ error:
 static void
 backend_fini(void)
 {
+	G_LOCK(backend_readers);
+
+	// Threads might still hold readers, which are freed when the threads exit
+	for (guint i = 0; i < backend_readers->len; i++)
+	{
+		JLMDBReader* reader = g_ptr_array_index(backend_readers, i);
+
+		if (reader->txn != NULL)
+		{
+			mdb_txn_abort(reader->txn);
+			reader->txn = NULL;
+		}
+	}
+
+	g_ptr_array_free(backend_readers, TRUE);
+	backend_readers = NULL;
+
+	G_UNLOCK(backend_readers);
+
+	g_hash_table_destroy(backend_dbis);
+	backend_dbis = NULL;
+
 	if (backend_env != NULL)
 	{
+		// Batches might not have synced their commits
+		mdb_env_sync(backend_env, 1);
 		mdb_env_close(backend_env);
+		backend_env = NULL;
 	}
 }
 
@@ -322,11 +1549,16 @@ static JBackend lmdb_backend = {
 		.backend_fini = backend_fini,
 		.backend_batch_start = backend_batch_start,
 		.backend_batch_execute = backend_batch_execute,
+		.backend_batch_start_update = backend_batch_start_update,
 		.backend_put = backend_put,
 		.backend_delete = backend_delete,
+		.backend_delete_prefix = backend_delete_prefix,
 		.backend_get = backend_get,
+		.backend_get_multi = backend_get_multi,
+		.backend_put_multi = backend_put_multi,
 		.backend_get_all = backend_get_all,
 		.backend_get_by_prefix = backend_get_by_prefix,
+		.backend_get_range = backend_get_range,
 		.backend_iterate = backend_iterate }
 };
 
@@ -0,0 +1,1305 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2019 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * A KV backend that keeps all key-value pairs in memory.
+ *
+ * Every namespace has its own skip list, which keeps keys ordered for prefix iteration.
+ * Namespaces are distributed across shards and every namespace has its own lock, so different namespaces do not contend.
+ * Keys and values are stored in reference-counted records, which allows handing out values without copying and without holding locks.
+ *
+ * Optionally, modifications are appended to a log and the whole state is written to a snapshot periodically, which allows restarting.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gmodule.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <julea.h>
+
+/**
+ * The number of shards of the namespace table.
+ */
+#define JD_BACKEND_SHARDS 64
+
+/**
+ * The maximum height of skip list nodes, which is sufficient for billions of keys.
+ */
+#define JD_BACKEND_MAX_HEIGHT 24
+
+/**
+ * Identifies snapshot files.
+ */
+#define JD_BACKEND_SNAPSHOT_MAGIC "JKVMEM01"
+
+enum JMemoryLogType
+{
+	J_MEMORY_LOG_PUT = 1,
+	J_MEMORY_LOG_DELETE = 2
+};
+
+typedef enum JMemoryLogType JMemoryLogType;
+
+/**
+ * A key-value pair.
+ * The key is stored null-terminated, followed by the value.
+ * Records are immutable, overwriting a key replaces its record.
+ */
+struct JMemoryRecord
+{
+	gint ref_count;
+	guint32 key_len;
+	guint32 len;
+	gchar data[];
+};
+
+typedef struct JMemoryRecord JMemoryRecord;
+
+struct JMemoryNode
+{
+	JMemoryRecord* record;
+	guint height;
+	struct JMemoryNode* next[];
+};
+
+typedef struct JMemoryNode JMemoryNode;
+
+struct JMemoryNamespace
+{
+	gchar* name;
+
+	/**
+	 * Protects the skip list.
+	 * Lookups only require a reader lock.
+	 */
+	GRWLock lock;
+
+	/**
+	 * Update batches hold the mutex from their start until they have been executed, other batches only while applying their modifications.
+	 * This keeps values read by update batches from being modified concurrently.
+	 * It has to be locked before lock.
+	 */
+	GMutex update_mutex;
+
+	JMemoryNode* head;
+	guint height;
+
+	/**
+	 * The state of the random number generator used for node heights, protected by the writer lock.
+	 */
+	guint32 random;
+};
+
+typedef struct JMemoryNamespace JMemoryNamespace;
+
+struct JMemoryShard
+{
+	GRWLock lock;
+	GHashTable* namespaces;
+};
+
+typedef struct JMemoryShard JMemoryShard;
+
+struct JMemoryOperation
+{
+	/**
+	 * The record to put, NULL for deletes.
+	 */
+	JMemoryRecord* record;
+	gchar* key;
+
+	/**
+	 * Whether all keys starting with key are deleted.
+	 */
+	gboolean prefix;
+};
+
+typedef struct JMemoryOperation JMemoryOperation;
+
+struct JMemoryBatch
+{
+	gchar* namespace;
+	JSemantics* semantics;
+
+	/**
+	 * Modifications are applied atomically when the batch is executed.
+	 */
+	GArray* operations;
+
+	/**
+	 * Records of values returned by backend_get, which are released when the batch is executed.
+	 */
+	GPtrArray* values;
+
+	/**
+	 * The namespace whose update_mutex the batch holds, NULL if the batch has not been started with backend_batch_start_update.
+	 */
+	JMemoryNamespace* update;
+};
+
+typedef struct JMemoryBatch JMemoryBatch;
+
+/**
+ * Iterators work on the records that existed when they were created, so they do not hold any locks.
+ */
+struct JMemoryIterator
+{
+	GPtrArray* records;
+	guint index;
+};
+
+typedef struct JMemoryIterator JMemoryIterator;
+
+static JMemoryShard jd_backend_shards[JD_BACKEND_SHARDS];
+
+/**
+ * The directory used for persistence, NULL if everything is kept in memory only.
+ * Can be set with the path option in the path (path=/path/to/storage).
+ */
+static gchar* jd_backend_path = NULL;
+
+/**
+ * The interval between snapshots in seconds, 0 if snapshots are only written when the backend is finalized.
+ * Can be set with the snapshot-interval option in the path (path=/path/to/storage,snapshot-interval=60).
+ */
+static guint jd_backend_snapshot_interval = 60;
+
+/**
+ * Modifications hold a reader lock, snapshots take the writer lock to switch to a new log.
+ */
+static GRWLock jd_backend_persist_lock;
+
+/**
+ * Protects the log file.
+ */
+static GMutex jd_backend_log_mutex;
+static gint jd_backend_log_fd = -1;
+static guint jd_backend_log_sequence = 0;
+
+static GThread* jd_backend_snapshot_thread = NULL;
+static GMutex jd_backend_snapshot_mutex;
+static GCond jd_backend_snapshot_cond;
+static gboolean jd_backend_snapshot_stop = FALSE;
+
+static JMemoryRecord*
+backend_record_new(gchar const* key, gconstpointer value, guint32 len)
+{
+	JMemoryRecord* record;
+	gsize key_len;
+
+	key_len = strlen(key);
+
+	record = g_malloc(sizeof(JMemoryRecord) + key_len + 1 + len);
+	record->ref_count = 1;
+	record->key_len = key_len;
+	record->len = len;
+
+	memcpy(record->data, key, key_len + 1);
+	memcpy(record->data + key_len + 1, value, len);
+
+	return record;
+}
+
+static JMemoryRecord*
+backend_record_ref(JMemoryRecord* record)
+{
+	g_atomic_int_inc(&(record->ref_count));
+
+	return record;
+}
+
+static void
+backend_record_unref(gpointer data)
+{
+	JMemoryRecord* record = data;
+
+	if (g_atomic_int_dec_and_test(&(record->ref_count)))
+	{
+		g_free(record);
+	}
+}
+
+static gchar const*
+backend_record_key(JMemoryRecord const* record)
+{
+	return record->data;
+}
+
+static gconstpointer
+backend_record_value(JMemoryRecord const* record)
+{
+	return record->data + record->key_len + 1;
+}
+
+static JMemoryNode*
+backend_node_new(JMemoryRecord* record, guint height)
+{
+	JMemoryNode* node;
+
+	node = g_malloc0(sizeof(JMemoryNode) + height * sizeof(JMemoryNode*));
+	node->record = record;
+	node->height = height;
+
+	return node;
+}
+
+static void
+backend_node_free(JMemoryNode* node)
+{
+	if (node->record != NULL)
+	{
+		backend_record_unref(node->record);
+	}
+
+	g_free(node);
+}
+
+static JMemoryNamespace*
+backend_namespace_new(gchar const* name)
+{
+	JMemoryNamespace* namespace;
+
+	namespace = g_slice_new(JMemoryNamespace);
+	namespace->name = g_strdup(name);
+	namespace->head = backend_node_new(NULL, JD_BACKEND_MAX_HEIGHT);
+	namespace->height = 1;
+	namespace->random = g_str_hash(name) | 1;
+
+	g_rw_lock_init(&(namespace->lock));
+	g_mutex_init(&(namespace->update_mutex));
+
+	return namespace;
+}
+
+static void
+backend_namespace_free(gpointer data)
+{
+	JMemoryNamespace* namespace = data;
+	JMemoryNode* node;
+
+	node = namespace->head;
+
+	while (node != NULL)
+	{
+		JMemoryNode* next = node->next[0];
+
+		backend_node_free(node);
+		node = next;
+	}
+
+	g_rw_lock_clear(&(namespace->lock));
+	g_mutex_clear(&(namespace->update_mutex));
+	g_free(namespace->name);
+	g_slice_free(JMemoryNamespace, namespace);
+}
+
+/**
+ * Returns the namespace called name.
+ * Namespaces are never removed while the backend is running, so the returned pointer stays valid.
+ *
+ * \param create Whether to create the namespace if it does not exist.
+ */
+static JMemoryNamespace*
+backend_namespace_get(gchar const* name, gboolean create)
+{
+	JMemoryShard* shard;
+	JMemoryNamespace* namespace;
+
+	shard = &(jd_backend_shards[g_str_hash(name) % JD_BACKEND_SHARDS]);
+
+	g_rw_lock_reader_lock(&(shard->lock));
+	namespace = g_hash_table_lookup(shard->namespaces, name);
+	g_rw_lock_reader_unlock(&(shard->lock));
+
+	if (namespace == NULL && create)
+	{
+		g_rw_lock_writer_lock(&(shard->lock));
+
+		if ((namespace = g_hash_table_lookup(shard->namespaces, name)) == NULL)
+		{
+			namespace = backend_namespace_new(name);
+			g_hash_table_insert(shard->namespaces, namespace->name, namespace);
+		}
+
+		g_rw_lock_writer_unlock(&(shard->lock));
+	}
+
+	return namespace;
+}
+
+/**
+ * Returns the first node whose key is greater than or equal to key.
+ *
+ * \param update If not NULL, is set to the rightmost node on each level whose key is less than key.
+ */
+static JMemoryNode*
+backend_skiplist_seek(JMemoryNamespace* namespace, gchar const* key, JMemoryNode** update)
+{
+	JMemoryNode* node = namespace->head;
+
+	for (guint i = namespace->height; i-- > 0;)
+	{
+		while (node->next[i] != NULL && strcmp(backend_record_key(node->next[i]->record), key) < 0)
+		{
+			node = node->next[i];
+		}
+
+		if (update != NULL)
+		{
+			update[i] = node;
+		}
+	}
+
+	return node->next[0];
+}
+
+static guint
+backend_skiplist_random_height(JMemoryNamespace* namespace)
+{
+	guint height = 1;
+
+	// xorshift32
+	namespace->random ^= namespace->random << 13;
+	namespace->random ^= namespace->random >> 17;
+	namespace->random ^= namespace->random << 5;
+
+	// Every level has a quarter of the nodes of the level below
+	for (guint32 bits = namespace->random; height < JD_BACKEND_MAX_HEIGHT && (bits & 3) == 0; bits >>= 2)
+	{
+		height++;
+	}
+
+	return height;
+}
+
+/**
+ * Inserts or replaces a record, taking over the caller's reference.
+ * The namespace's writer lock has to be held.
+ */
+static void
+backend_skiplist_put(JMemoryNamespace* namespace, JMemoryRecord* record)
+{
+	JMemoryNode* update[JD_BACKEND_MAX_HEIGHT];
+	JMemoryNode* node;
+	guint height;
+
+	node = backend_skiplist_seek(namespace, backend_record_key(record), update);
+
+	if (node != NULL && strcmp(backend_record_key(node->record), backend_record_key(record)) == 0)
+	{
+		// Readers might still use the old record, they hold their own references
+		backend_record_unref(node->record);
+		node->record = record;
+
+		return;
+	}
+
+	height = backend_skiplist_random_height(namespace);
+
+	for (guint i = namespace->height; i < height; i++)
+	{
+		update[i] = namespace->head;
+	}
+
+	namespace->height = MAX(namespace->height, height);
+
+	node = backend_node_new(record, height);
+
+	for (guint i = 0; i < height; i++)
+	{
+		node->next[i] = update[i]->next[i];
+		update[i]->next[i] = node;
+	}
+}
+
+/**
+ * Removes a key.
+ * The namespace's writer lock has to be held.
+ */
+static gboolean
+backend_skiplist_delete(JMemoryNamespace* namespace, gchar const* key)
+{
+	JMemoryNode* update[JD_BACKEND_MAX_HEIGHT];
+	JMemoryNode* node;
+
+	node = backend_skiplist_seek(namespace, key, update);
+
+	if (node == NULL || strcmp(backend_record_key(node->record), key) != 0)
+	{
+		return FALSE;
+	}
+
+	for (guint i = 0; i < node->height; i++)
+	{
+		update[i]->next[i] = node->next[i];
+	}
+
+	while (namespace->height > 1 && namespace->head->next[namespace->height - 1] == NULL)
+	{
+		namespace->height--;
+	}
+
+	backend_node_free(node);
+
+	return TRUE;
+}
+
+/**
+ * Appends a log entry to buffer.
+ * Log entries and snapshots use the same format, which is only meant to be read on the same machine.
+ */
+static void
+backend_log_entry(GByteArray* buffer, JMemoryLogType type, gchar const* namespace, gchar const* key, gconstpointer value, guint32 len)
+{
+	guint8 type_ = type;
+	guint32 namespace_len;
+	guint32 key_len;
+
+	namespace_len = strlen(namespace);
+	key_len = strlen(key);
+
+	g_byte_array_append(buffer, &type_, sizeof(type_));
+	g_byte_array_append(buffer, (guint8 const*)&namespace_len, sizeof(namespace_len));
+	g_byte_array_append(buffer, (guint8 const*)&key_len, sizeof(key_len));
+	g_byte_array_append(buffer, (guint8 const*)&len, sizeof(len));
+	g_byte_array_append(buffer, (guint8 const*)namespace, namespace_len);
+	g_byte_array_append(buffer, (guint8 const*)key, key_len);
+
+	if (len > 0)
+	{
+		g_byte_array_append(buffer, value, len);
+	}
+}
+
+/**
+ * Applies the log entries contained in data.
+ * A truncated entry at the end, which is caused by a crash while appending, is ignored.
+ */
+static void
+backend_log_replay(gchar const* data, gsize length)
+{
+	gsize const header_len = sizeof(guint8) + 3 * sizeof(guint32);
+	gsize offset = 0;
+
+	while (offset + header_len <= length)
+	{
+		g_autofree gchar* namespace_name = NULL;
+		g_autofree gchar* key = NULL;
+		JMemoryNamespace* namespace;
+		guint8 type;
+		guint32 namespace_len;
+		guint32 key_len;
+		guint32 len;
+
+		memcpy(&type, data + offset, sizeof(type));
+		memcpy(&namespace_len, data + offset + 1, sizeof(namespace_len));
+		memcpy(&key_len, data + offset + 5, sizeof(key_len));
+		memcpy(&len, data + offset + 9, sizeof(len));
+		offset += header_len;
+
+		if ((guint64)offset + namespace_len + key_len + len > length)
+		{
+			g_warning("memory: Ignoring truncated log entry.");
+			break;
+		}
+
+		namespace_name = g_strndup(data + offset, namespace_len);
+		key = g_strndup(data + offset + namespace_len, key_len);
+
+		namespace = backend_namespace_get(namespace_name, TRUE);
+
+		if (type == J_MEMORY_LOG_PUT)
+		{
+			backend_skiplist_put(namespace, backend_record_new(key, data + offset + namespace_len + key_len, len));
+		}
+		else if (type == J_MEMORY_LOG_DELETE)
+		{
+			backend_skiplist_delete(namespace, key);
+		}
+		else
+		{
+			g_warning("memory: Ignoring log entry of unknown type %u.", type);
+		}
+
+		offset += namespace_len + key_len + len;
+	}
+}
+
+static gchar*
+backend_log_path(guint sequence)
+{
+	g_autofree gchar* name = NULL;
+
+	name = g_strdup_printf("log.%08u", sequence);
+
+	return g_build_filename(jd_backend_path, name, NULL);
+}
+
+static gboolean
+backend_write_all(gint fd, gconstpointer data, gsize length)
+{
+	gsize done = 0;
+
+	while (done < length)
+	{
+		gssize ret;
+
+		ret = write(fd, (gchar const*)data + done, length - done);
+
+		if (ret < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if (ret <= 0)
+		{
+			return FALSE;
+		}
+
+		done += ret;
+	}
+
+	return TRUE;
+}
+
+/**
+ * Switches to a new log.
+ * The persistence writer lock has to be held.
+ */
+static gboolean
+backend_log_open(guint sequence)
+{
+	g_autofree gchar* log_path = NULL;
+	gint fd;
+
+	log_path = backend_log_path(sequence);
+
+	if ((fd = open(log_path, O_WRONLY | O_CREAT | O_APPEND, 0600)) < 0)
+	{
+		g_warning("memory: Could not open log %s: %s", log_path, g_strerror(errno));
+		return FALSE;
+	}
+
+	if (jd_backend_log_fd >= 0)
+	{
+		close(jd_backend_log_fd);
+	}
+
+	jd_backend_log_fd = fd;
+	jd_backend_log_sequence = sequence;
+
+	return TRUE;
+}
+
+/**
+ * Writes all key-value pairs to a new snapshot and removes the logs it contains.
+ * Modifications are only blocked while switching to a new log and collecting the records.
+ */
+static gboolean
+backend_snapshot(void)
+{
+	g_autoptr(GByteArray) buffer = NULL;
+	g_autoptr(GPtrArray) records = NULL;
+	g_autoptr(GPtrArray) namespaces = NULL;
+	g_autofree gchar* snapshot_path = NULL;
+	g_autofree gchar* tmp_path = NULL;
+	guint32 sequence;
+	gboolean ret = FALSE;
+	gint fd;
+
+	records = g_ptr_array_new_with_free_func(backend_record_unref);
+	namespaces = g_ptr_array_new();
+
+	g_rw_lock_writer_lock(&jd_backend_persist_lock);
+
+	// The snapshot contains all modifications of the previous logs, later modifications go to the new log
+	if (!backend_log_open(jd_backend_log_sequence + 1))
+	{
+		g_rw_lock_writer_unlock(&jd_backend_persist_lock);
+		return FALSE;
+	}
+
+	sequence = jd_backend_log_sequence;
+
+	for (guint i = 0; i < JD_BACKEND_SHARDS; i++)
+	{
+		GHashTableIter iter;
+		gpointer value;
+
+		g_rw_lock_reader_lock(&(jd_backend_shards[i].lock));
+		g_hash_table_iter_init(&iter, jd_backend_shards[i].namespaces);
+
+		while (g_hash_table_iter_next(&iter, NULL, &value))
+		{
+			JMemoryNamespace* namespace = value;
+
+			g_rw_lock_reader_lock(&(namespace->lock));
+
+			for (JMemoryNode* node = namespace->head->next[0]; node != NULL; node = node->next[0])
+			{
+				g_ptr_array_add(namespaces, namespace->name);
+				g_ptr_array_add(records, backend_record_ref(node->record));
+			}
+
+			g_rw_lock_reader_unlock(&(namespace->lock));
+		}
+
+		g_rw_lock_reader_unlock(&(jd_backend_shards[i].lock));
+	}
+
+	g_rw_lock_writer_unlock(&jd_backend_persist_lock);
+
+	snapshot_path = g_build_filename(jd_backend_path, "snapshot", NULL);
+	tmp_path = g_build_filename(jd_backend_path, "snapshot.tmp", NULL);
+
+	if ((fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600)) < 0)
+	{
+		g_warning("memory: Could not create snapshot %s: %s", tmp_path, g_strerror(errno));
+		return FALSE;
+	}
+
+	buffer = g_byte_array_new();
+	g_byte_array_append(buffer, (guint8 const*)JD_BACKEND_SNAPSHOT_MAGIC, strlen(JD_BACKEND_SNAPSHOT_MAGIC));
+	g_byte_array_append(buffer, (guint8 const*)&sequence, sizeof(sequence));
+
+	for (guint i = 0; i < records->len; i++)
+	{
+		JMemoryRecord* record = g_ptr_array_index(records, i);
+
+		backend_log_entry(buffer, J_MEMORY_LOG_PUT, g_ptr_array_index(namespaces, i), backend_record_key(record), backend_record_value(record), record->len);
+
+		if (buffer->len >= 4 * 1024 * 1024)
+		{
+			if (!backend_write_all(fd, buffer->data, buffer->len))
+			{
+				goto end;
+			}
+
+			g_byte_array_set_size(buffer, 0);
+		}
+	}
+
+	if (!backend_write_all(fd, buffer->data, buffer->len) || fsync(fd) != 0)
+	{
+		goto end;
+	}
+
+	if (g_rename(tmp_path, snapshot_path) != 0)
+	{
+		goto end;
+	}
+
+	// Logs before the new one are contained in the snapshot
+	for (guint i = sequence; i-- > 0;)
+	{
+		g_autofree gchar* log_path = NULL;
+
+		log_path = backend_log_path(i);
+
+		if (g_unlink(log_path) != 0)
+		{
+			break;
+		}
+	}
+
+	ret = TRUE;
+
+end:
+	if (!ret)
+	{
+		g_warning("memory: Could not write snapshot %s: %s", tmp_path, g_strerror(errno));
+		g_unlink(tmp_path);
+	}
+
+	close(fd);
+
+	return ret;
+}
+
+static gpointer
+backend_snapshot_thread(gpointer data)
+{
+	(void)data;
+
+	g_mutex_lock(&jd_backend_snapshot_mutex);
+
+	while (!jd_backend_snapshot_stop)
+	{
+		gint64 end_time;
+
+		end_time = g_get_monotonic_time() + jd_backend_snapshot_interval * G_TIME_SPAN_SECOND;
+
+		if (g_cond_wait_until(&jd_backend_snapshot_cond, &jd_backend_snapshot_mutex, end_time) || jd_backend_snapshot_stop)
+		{
+			continue;
+		}
+
+		g_mutex_unlock(&jd_backend_snapshot_mutex);
+		backend_snapshot();
+		g_mutex_lock(&jd_backend_snapshot_mutex);
+	}
+
+	g_mutex_unlock(&jd_backend_snapshot_mutex);
+
+	return NULL;
+}
+
+/**
+ * Loads the snapshot and replays the logs written after it.
+ */
+static gboolean
+backend_restore(void)
+{
+	g_autofree gchar* snapshot_path = NULL;
+	g_autofree gchar* contents = NULL;
+	gsize length;
+	guint32 sequence = 0;
+
+	snapshot_path = g_build_filename(jd_backend_path, "snapshot", NULL);
+
+	if (g_file_get_contents(snapshot_path, &contents, &length, NULL))
+	{
+		gsize const header_len = strlen(JD_BACKEND_SNAPSHOT_MAGIC) + sizeof(sequence);
+
+		if (length < header_len || memcmp(contents, JD_BACKEND_SNAPSHOT_MAGIC, strlen(JD_BACKEND_SNAPSHOT_MAGIC)) != 0)
+		{
+			g_warning("memory: %s is not a valid snapshot.", snapshot_path);
+			return FALSE;
+		}
+
+		memcpy(&sequence, contents + strlen(JD_BACKEND_SNAPSHOT_MAGIC), sizeof(sequence));
+		backend_log_replay(contents + header_len, length - header_len);
+	}
+
+	// Logs are replayed in order, the last one is used for new modifications
+	while (TRUE)
+	{
+		g_autofree gchar* log_path = NULL;
+		g_autofree gchar* log_contents = NULL;
+		gsize log_length;
+
+		log_path = backend_log_path(sequence);
+
+		if (!g_file_get_contents(log_path, &log_contents, &log_length, NULL))
+		{
+			break;
+		}
+
+		backend_log_replay(log_contents, log_length);
+		sequence++;
+	}
+
+	// Modifications are appended to a new log, which avoids appending to a truncated entry
+	return backend_log_open(sequence);
+}
+
+/**
+ * Removes all keys with a prefix.
+ * The namespace's writer lock has to be held.
+ *
+ * \param buffer If not NULL, a log entry is appended for each removed key.
+ */
+static void
+backend_skiplist_delete_prefix(JMemoryNamespace* namespace, gchar const* prefix, GByteArray* buffer)
+{
+	JMemoryNode* update[JD_BACKEND_MAX_HEIGHT];
+	JMemoryNode* node;
+
+	node = backend_skiplist_seek(namespace, prefix, update);
+
+	// All keys with the prefix follow each other, so they can be unlinked from the same predecessors
+	while (node != NULL && g_str_has_prefix(backend_record_key(node->record), prefix))
+	{
+		JMemoryNode* next = node->next[0];
+
+		if (buffer != NULL)
+		{
+			backend_log_entry(buffer, J_MEMORY_LOG_DELETE, namespace->name, backend_record_key(node->record), NULL, 0);
+		}
+
+		for (guint i = 0; i < node->height; i++)
+		{
+			update[i]->next[i] = node->next[i];
+		}
+
+		backend_node_free(node);
+		node = next;
+	}
+
+	while (namespace->height > 1 && namespace->head->next[namespace->height - 1] == NULL)
+	{
+		namespace->height--;
+	}
+}
+
+static gboolean
+backend_batch_start(gchar const* namespace, JSemantics* semantics, gpointer* data)
+{
+	JMemoryBatch* batch;
+
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	batch = g_slice_new(JMemoryBatch);
+	batch->namespace = g_strdup(namespace);
+	batch->semantics = j_semantics_ref(semantics);
+	batch->operations = g_array_new(FALSE, FALSE, sizeof(JMemoryOperation));
+	batch->values = g_ptr_array_new_with_free_func(backend_record_unref);
+	batch->update = NULL;
+
+	*data = batch;
+
+	return TRUE;
+}
+
+static gboolean
+backend_batch_start_update(gchar const* namespace, JSemantics* semantics, gpointer* data)
+{
+	JMemoryBatch* batch;
+
+	if (!backend_batch_start(namespace, semantics, data))
+	{
+		return FALSE;
+	}
+
+	batch = *data;
+	batch->update = backend_namespace_get(namespace, TRUE);
+
+	g_mutex_lock(&(batch->update->update_mutex));
+
+	return TRUE;
+}
+
+static gboolean
+backend_batch_execute(gpointer data)
+{
+	JMemoryBatch* batch = data;
+	gboolean ret = TRUE;
+
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	if (batch->operations->len > 0)
+	{
+		g_autoptr(GByteArray) buffer = NULL;
+		JMemoryNamespace* namespace;
+
+		namespace = backend_namespace_get(batch->namespace, TRUE);
+
+		// Update batches already hold the mutex, which has to be locked before jd_backend_persist_lock
+		if (batch->update == NULL)
+		{
+			g_mutex_lock(&(namespace->update_mutex));
+		}
+
+		if (jd_backend_path != NULL)
+		{
+			g_rw_lock_reader_lock(&jd_backend_persist_lock);
+			buffer = g_byte_array_new();
+		}
+
+		g_rw_lock_writer_lock(&(namespace->lock));
+
+		for (guint i = 0; i < batch->operations->len; i++)
+		{
+			JMemoryOperation* operation = &g_array_index(batch->operations, JMemoryOperation, i);
+
+			if (operation->record != NULL)
+			{
+				if (buffer != NULL)
+				{
+					backend_log_entry(buffer, J_MEMORY_LOG_PUT, batch->namespace, operation->key, backend_record_value(operation->record), operation->record->len);
+				}
+
+				backend_skiplist_put(namespace, operation->record);
+				operation->record = NULL;
+			}
+			else if (operation->prefix)
+			{
+				backend_skiplist_delete_prefix(namespace, operation->key, buffer);
+			}
+			else
+			{
+				if (buffer != NULL)
+				{
+					backend_log_entry(buffer, J_MEMORY_LOG_DELETE, batch->namespace, operation->key, NULL, 0);
+				}
+
+				backend_skiplist_delete(namespace, operation->key);
+			}
+		}
+
+		// The log has to be appended in the same order the modifications are applied
+		if (buffer != NULL)
+		{
+			g_mutex_lock(&jd_backend_log_mutex);
+			ret = backend_write_all(jd_backend_log_fd, buffer->data, buffer->len);
+			g_mutex_unlock(&jd_backend_log_mutex);
+		}
+
+		g_rw_lock_writer_unlock(&(namespace->lock));
+
+		if (buffer != NULL)
+		{
+			if (ret && j_semantics_get(batch->semantics, J_SEMANTICS_SAFETY) == J_SEMANTICS_SAFETY_STORAGE)
+			{
+				ret = (fdatasync(jd_backend_log_fd) == 0);
+			}
+
+			g_rw_lock_reader_unlock(&jd_backend_persist_lock);
+		}
+
+		if (batch->update == NULL)
+		{
+			g_mutex_unlock(&(namespace->update_mutex));
+		}
+	}
+
+	for (guint i = 0; i < batch->operations->len; i++)
+	{
+		JMemoryOperation* operation = &g_array_index(batch->operations, JMemoryOperation, i);
+
+		g_free(operation->key);
+	}
+
+	if (batch->update != NULL)
+	{
+		g_mutex_unlock(&(batch->update->update_mutex));
+	}
+
+	g_array_unref(batch->operations);
+	g_ptr_array_unref(batch->values);
+	j_semantics_unref(batch->semantics);
+	g_free(batch->namespace);
+	g_slice_free(JMemoryBatch, batch);
+
+	return ret;
+}
+
+static gboolean
+backend_put(gpointer data, gchar const* key, gconstpointer value, guint32 len)
+{
+	JMemoryBatch* batch = data;
+	JMemoryOperation operation;
+
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(key != NULL, FALSE);
+	g_return_val_if_fail(value != NULL, FALSE);
+
+	operation.record = backend_record_new(key, value, len);
+	operation.key = g_strdup(key);
+	operation.prefix = FALSE;
+	g_array_append_val(batch->operations, operation);
+
+	return TRUE;
+}
+
+static gboolean
+backend_delete(gpointer data, gchar const* key)
+{
+	JMemoryBatch* batch = data;
+	JMemoryOperation operation;
+
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(key != NULL, FALSE);
+
+	operation.record = NULL;
+	operation.key = g_strdup(key);
+	operation.prefix = FALSE;
+	g_array_append_val(batch->operations, operation);
+
+	return TRUE;
+}
+
+static gboolean
+backend_delete_prefix(gpointer data, gchar const* prefix)
+{
+	JMemoryBatch* batch = data;
+	JMemoryOperation operation;
+
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(prefix != NULL, FALSE);
+
+	operation.record = NULL;
+	operation.key = g_strdup(prefix);
+	operation.prefix = TRUE;
+	g_array_append_val(batch->operations, operation);
+
+	return TRUE;
+}
+
+static gboolean
+backend_get(gpointer data, gchar const* key, gconstpointer* value, guint32* len)
+{
+	JMemoryBatch* batch = data;
+	JMemoryNamespace* namespace;
+	JMemoryNode* node;
+	gboolean ret = FALSE;
+
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(key != NULL, FALSE);
+	g_return_val_if_fail(value != NULL, FALSE);
+	g_return_val_if_fail(len != NULL, FALSE);
+
+	if ((namespace = backend_namespace_get(batch->namespace, FALSE)) == NULL)
+	{
+		return FALSE;
+	}
+
+	g_rw_lock_reader_lock(&(namespace->lock));
+
+	node = backend_skiplist_seek(namespace, key, NULL);
+
+	if (node != NULL && strcmp(backend_record_key(node->record), key) == 0)
+	{
+		// The batch keeps the record alive, even if it is replaced concurrently
+		g_ptr_array_add(batch->values, backend_record_ref(node->record));
+
+		*value = backend_record_value(node->record);
+		*len = node->record->len;
+
+		ret = TRUE;
+	}
+
+	g_rw_lock_reader_unlock(&(namespace->lock));
+
+	return ret;
+}
+
+static gboolean
+backend_iterator_new(gchar const* namespace_name, gchar const* start, gchar const* end, gchar const* prefix, guint32 limit, gpointer* data)
+{
+	JMemoryIterator* iterator;
+	JMemoryNamespace* namespace;
+
+	iterator = g_slice_new(JMemoryIterator);
+	iterator->records = g_ptr_array_new_with_free_func(backend_record_unref);
+	iterator->index = 0;
+
+	if ((namespace = backend_namespace_get(namespace_name, FALSE)) != NULL)
+	{
+		g_rw_lock_reader_lock(&(namespace->lock));
+
+		// Keys are ordered, so all keys with the prefix follow each other
+		for (JMemoryNode* node = backend_skiplist_seek(namespace, start, NULL); node != NULL; node = node->next[0])
+		{
+			if (!g_str_has_prefix(backend_record_key(node->record), prefix))
+			{
+				break;
+			}
+
+			if (end != NULL && strcmp(backend_record_key(node->record), end) >= 0)
+			{
+				break;
+			}
+
+			if (limit > 0 && iterator->records->len == limit)
+			{
+				break;
+			}
+
+			g_ptr_array_add(iterator->records, backend_record_ref(node->record));
+		}
+
+		g_rw_lock_reader_unlock(&(namespace->lock));
+	}
+
+	*data = iterator;
+
+	return TRUE;
+}
+
+static gboolean
+backend_get_all(gchar const* namespace, gpointer* data)
+{
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	return backend_iterator_new(namespace, "", NULL, "", 0, data);
+}
+
+static gboolean
+backend_get_by_prefix(gchar const* namespace, gchar const* prefix, gpointer* data)
+{
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(prefix != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	return backend_iterator_new(namespace, prefix, NULL, prefix, 0, data);
+}
+
+static gboolean
+backend_get_range(gchar const* namespace, gchar const* start, gchar const* end, guint32 limit, gpointer* data)
+{
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	return backend_iterator_new(namespace, (start != NULL) ? start : "", end, "", limit, data);
+}
+
+static gboolean
+backend_iterate(gpointer data, gchar const** key, gconstpointer* value, guint32* len)
+{
+	JMemoryIterator* iterator = data;
+
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(value != NULL, FALSE);
+	g_return_val_if_fail(len != NULL, FALSE);
+
+	if (iterator->index < iterator->records->len)
+	{
+		JMemoryRecord* record = g_ptr_array_index(iterator->records, iterator->index);
+
+		*key = backend_record_key(record);
+		*value = backend_record_value(record);
+		*len = record->len;
+
+		iterator->index++;
+
+		return TRUE;
+	}
+
+	g_ptr_array_unref(iterator->records);
+	g_slice_free(JMemoryIterator, iterator);
+
+	return FALSE;
+}
+
+static gboolean
+backend_init(gchar const* path)
+{
+	g_auto(GStrv) options = NULL;
+
+	// The path has the format [option,...]
+	options = g_strsplit(path, ",", 0);
+
+	for (guint i = 0; options[i] != NULL; i++)
+	{
+		if (options[i][0] == '\0')
+		{
+			continue;
+		}
+		else if (g_str_has_prefix(options[i], "path="))
+		{
+			g_free(jd_backend_path);
+			jd_backend_path = g_strdup(options[i] + strlen("path="));
+		}
+		else if (g_str_has_prefix(options[i], "snapshot-interval="))
+		{
+			jd_backend_snapshot_interval = g_ascii_strtoull(options[i] + strlen("snapshot-interval="), NULL, 10);
+		}
+		else
+		{
+			g_warning("memory: Unknown option %s.", options[i]);
+		}
+	}
+
+	for (guint i = 0; i < JD_BACKEND_SHARDS; i++)
+	{
+		g_rw_lock_init(&(jd_backend_shards[i].lock));
+		jd_backend_shards[i].namespaces = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, backend_namespace_free);
+	}
+
+	if (jd_backend_path != NULL)
+	{
+		g_mkdir_with_parents(jd_backend_path, 0700);
+
+		if (!backend_restore())
+		{
+			g_free(jd_backend_path);
+			jd_backend_path = NULL;
+
+			return FALSE;
+		}
+
+		if (jd_backend_snapshot_interval > 0)
+		{
+			jd_backend_snapshot_stop = FALSE;
+			jd_backend_snapshot_thread = g_thread_new("julea-kv-memory-snapshot", backend_snapshot_thread, NULL);
+		}
+	}
+
+	return TRUE;
+}
+
+static void
+backend_fini(void)
+{
+	if (jd_backend_snapshot_thread != NULL)
+	{
+		g_mutex_lock(&jd_backend_snapshot_mutex);
+		jd_backend_snapshot_stop = TRUE;
+		g_cond_signal(&jd_backend_snapshot_cond);
+		g_mutex_unlock(&jd_backend_snapshot_mutex);
+
+		g_thread_join(jd_backend_snapshot_thread);
+		jd_backend_snapshot_thread = NULL;
+	}
+
+	if (jd_backend_path != NULL)
+	{
+		// A final snapshot makes the next start faster
+		backend_snapshot();
+
+		close(jd_backend_log_fd);
+		jd_backend_log_fd = -1;
+
+		g_free(jd_backend_path);
+		jd_backend_path = NULL;
+	}
+
+	for (guint i = 0; i < JD_BACKEND_SHARDS; i++)
+	{
+		g_hash_table_destroy(jd_backend_shards[i].namespaces);
+		g_rw_lock_clear(&(jd_backend_shards[i].lock));
+	}
+}
+
+static JBackend memory_backend = {
+	.type = J_BACKEND_TYPE_KV,
+	.component = J_BACKEND_COMPONENT_CLIENT | J_BACKEND_COMPONENT_SERVER,
+	.kv = {
+		.backend_init = backend_init,
+		.backend_fini = backend_fini,
+		.backend_batch_start = backend_batch_start,
+		.backend_batch_execute = backend_batch_execute,
+		.backend_batch_start_update = backend_batch_start_update,
+		.backend_put = backend_put,
+		.backend_delete = backend_delete,
+		.backend_delete_prefix = backend_delete_prefix,
+		.backend_get = backend_get,
+		.backend_get_all = backend_get_all,
+		.backend_get_by_prefix = backend_get_by_prefix,
+		.backend_get_range = backend_get_range,
+		.backend_iterate = backend_iterate }
+};
+
+G_MODULE_EXPORT
+JBackend*
+backend_info(void)
+{
+	return &memory_backend;
+}
@@ -30,6 +30,12 @@
 struct JMongoDBBatch
 {
 	mongoc_bulk_operation_t* bulk_op;
+
+	/**
+	 * Values returned by backend_get, which are freed when the batch is executed.
+	 */
+	GPtrArray* values;
+
 	gchar* namespace;
 };
 
@@ -116,6 +122,7 @@ backend_batch_start(gchar const* namespace, JSemantics* semantics, gpointer* dat
 
 	batch = g_slice_new(JMongoDBBatch);
 	batch->bulk_op = bulk_op;
+	batch->values = g_ptr_array_new_with_free_func(g_free);
 	batch->namespace = g_strdup(namespace);
 
 	*data = batch;
@@ -149,6 +156,7 @@ backend_batch_execute(gpointer data)
 
 	mongoc_bulk_operation_destroy(batch->bulk_op);
 	bson_destroy(reply);
+	g_ptr_array_unref(batch->values);
 	g_free(batch->namespace);
 	g_slice_free(JMongoDBBatch, batch);
 
@@ -214,7 +222,7 @@ backend_delete(gpointer data, gchar const* key)
 }
 
 static gboolean
-backend_get(gpointer data, gchar const* key, gpointer* value, guint32* len)
+backend_get(gpointer data, gchar const* key, gconstpointer* value, guint32* len)
 {
 	gboolean ret = FALSE;
 
@@ -252,6 +260,8 @@ backend_get(gpointer data, gchar const* key, gpointer* value, guint32* len)
 			*value = g_memdup(bv->value.v_binary.data, bv->value.v_binary.data_len);
 			*len = bv->value.v_binary.data_len;
 
+			g_ptr_array_add(batch->values, (gpointer)(guintptr)*value);
+
 			ret = TRUE;
 
 			break;
@@ -334,6 +344,60 @@ backend_get_by_prefix(gchar const* namespace, gchar const* prefix, gpointer* dat
 	return ret;
 }
 
+static gboolean
+backend_get_range(gchar const* namespace, gchar const* start, gchar const* end, guint32 limit, gpointer* data)
+{
+	gboolean ret = FALSE;
+
+	bson_t document[1];
+	bson_t opts[1];
+	bson_t range[1];
+	bson_t sort[1];
+	mongoc_collection_t* m_collection;
+	mongoc_cursor_t* cursor;
+
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	bson_init(document);
+	bson_append_document_begin(document, "key", -1, range);
+	bson_append_utf8(range, "$gte", -1, (start != NULL) ? start : "", -1);
+
+	if (end != NULL)
+	{
+		bson_append_utf8(range, "$lt", -1, end, -1);
+	}
+
+	bson_append_document_end(document, range);
+
+	// Strings are compared bytewise, which matches the order of the other backends
+	bson_init(opts);
+	bson_append_document_begin(opts, "sort", -1, sort);
+	bson_append_int32(sort, "key", -1, 1);
+	bson_append_document_end(opts, sort);
+
+	if (limit > 0)
+	{
+		bson_append_int64(opts, "limit", -1, limit);
+	}
+
+	m_collection = mongoc_client_get_collection(backend_connection, backend_database, namespace);
+	cursor = mongoc_collection_find_with_opts(m_collection, document, opts, NULL);
+
+	if (cursor != NULL)
+	{
+		ret = TRUE;
+		*data = cursor;
+	}
+
+	mongoc_collection_destroy(m_collection);
+
+	bson_destroy(opts);
+	bson_destroy(document);
+
+	return ret;
+}
+
 static gboolean
 backend_iterate(gpointer data, gchar const** key, gconstpointer* value, guint32* len)
 {
@@ -444,6 +508,7 @@ static JBackend mongodb_backend = {
 		.backend_get = backend_get,
 		.backend_get_all = backend_get_all,
 		.backend_get_by_prefix = backend_get_by_prefix,
+		.backend_get_range = backend_get_range,
 		.backend_iterate = backend_iterate }
 };
 
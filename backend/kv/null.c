@@ -67,7 +67,7 @@ backend_delete(gpointer data, gchar const* key)
 }
 
 static gboolean
-backend_get(gpointer data, gchar const* key, gpointer* value, guint32* len)
+backend_get(gpointer data, gchar const* key, gconstpointer* value, guint32* len)
 {
 	g_return_val_if_fail(data != NULL, FALSE);
 	g_return_val_if_fail(key != NULL, FALSE);
@@ -103,6 +103,21 @@ backend_get_by_prefix(gchar const* namespace, gchar const* prefix, gpointer* dat
 	return TRUE;
 }
 
+static gboolean
+backend_get_range(gchar const* namespace, gchar const* start, gchar const* end, guint32 limit, gpointer* data)
+{
+	(void)start;
+	(void)end;
+	(void)limit;
+
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	*data = NULL;
+
+	return TRUE;
+}
+
 static gboolean
 backend_iterate(gpointer data, gchar const** key, gconstpointer* value, guint32* len)
 {
@@ -143,6 +158,7 @@ static JBackend null_backend = {
 		.backend_get = backend_get,
 		.backend_get_all = backend_get_all,
 		.backend_get_by_prefix = backend_get_by_prefix,
+		.backend_get_range = backend_get_range,
 		.backend_iterate = backend_iterate }
 };
 
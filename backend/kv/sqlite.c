@@ -23,32 +23,362 @@
 #include <glib.h>
 #include <gmodule.h>
 
+#include <string.h>
+
 #include <sqlite3.h>
 
 #include <julea.h>
 
+/**
+ * The number of keys handled by one statement of backend_get_multi and backend_put_multi.
+ */
+#define J_SQLITE_MULTI_COUNT 16
+
+enum JSQLiteStatement
+{
+	J_SQLITE_STATEMENT_PUT,
+	J_SQLITE_STATEMENT_DELETE,
+	J_SQLITE_STATEMENT_DELETE_RANGE,
+	J_SQLITE_STATEMENT_DELETE_RANGE_END,
+	J_SQLITE_STATEMENT_GET,
+	J_SQLITE_STATEMENT_GET_ALL,
+	J_SQLITE_STATEMENT_GET_BY_PREFIX,
+	J_SQLITE_STATEMENT_GET_RANGE,
+	J_SQLITE_STATEMENT_GET_RANGE_END,
+	J_SQLITE_STATEMENT_GET_MULTI,
+	J_SQLITE_STATEMENT_PUT_MULTI,
+	J_SQLITE_STATEMENT_DATA_VERSION,
+	J_SQLITE_STATEMENT_COUNT
+};
+
+typedef enum JSQLiteStatement JSQLiteStatement;
+
+static gchar const* const backend_statements[J_SQLITE_STATEMENT_COUNT] = {
+	"INSERT OR REPLACE INTO julea (namespace, key, value) VALUES (?, ?, ?);",
+	"DELETE FROM julea WHERE namespace = ? AND key = ?;",
+	"DELETE FROM julea WHERE namespace = ? AND key >= ?;",
+	"DELETE FROM julea WHERE namespace = ? AND key >= ? AND key < ?;",
+	"SELECT value FROM julea WHERE namespace = ? AND key = ?;",
+	"SELECT key, value FROM julea WHERE namespace = ?;",
+	"SELECT key, value FROM julea WHERE namespace = ? AND key LIKE ? || '%';",
+	"SELECT key, value FROM julea WHERE namespace = ? AND key >= ? ORDER BY key LIMIT ?;",
+	"SELECT key, value FROM julea WHERE namespace = ? AND key >= ? AND key < ? ORDER BY key LIMIT ?;",
+	"SELECT key, value FROM julea WHERE namespace = ? AND key IN (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?) ORDER BY key;",
+	"INSERT OR REPLACE INTO julea (namespace, key, value) VALUES (?1, ?, ?), (?1, ?, ?), (?1, ?, ?), (?1, ?, ?), (?1, ?, ?), (?1, ?, ?), (?1, ?, ?), (?1, ?, ?), (?1, ?, ?), (?1, ?, ?), (?1, ?, ?), (?1, ?, ?), (?1, ?, ?), (?1, ?, ?), (?1, ?, ?), (?1, ?, ?);",
+	"PRAGMA data_version;"
+};
+
+/**
+ * A connection used by a single thread.
+ * SQLite connections must not be used concurrently, so every thread has its own one, which allows reads to run in parallel.
+ */
+struct JSQLiteConnection
+{
+	/**
+	 * NULL if the backend has been finalized.
+	 */
+	sqlite3* db;
+
+	/**
+	 * Statements are prepared on first use and reused afterwards.
+	 */
+	sqlite3_stmt* statements[J_SQLITE_STATEMENT_COUNT];
+
+	/**
+	 * The current value of PRAGMA synchronous, -1 if unknown.
+	 */
+	gint synchronous;
+};
+
+typedef struct JSQLiteConnection JSQLiteConnection;
+
 struct JSQLiteBatch
 {
+	JSQLiteConnection* connection;
+
+	/**
+	 * Whether a transaction has been started, which happens on the first operation.
+	 */
+	gboolean transaction;
+
+	/**
+	 * Whether the transaction has been started for writing.
+	 */
+	gboolean write;
+
+	/**
+	 * Whether an operation failed, which rolls back the transaction.
+	 */
+	gboolean failed;
+
+	/**
+	 * Values returned by backend_get, which are freed when the batch is executed.
+	 */
+	GPtrArray* values;
+
 	gchar* namespace;
 	JSemantics* semantics;
 };
 
 typedef struct JSQLiteBatch JSQLiteBatch;
 
-static sqlite3* backend_db = NULL;
+struct JSQLiteIterator
+{
+	JSQLiteConnection* connection;
+	sqlite3_stmt* stmt;
+
+	/**
+	 * Whether stmt belongs to the connection's statement cache.
+	 */
+	gboolean cached;
+};
+
+typedef struct JSQLiteIterator JSQLiteIterator;
+
+static gchar* backend_path = NULL;
+
+/**
+ * All connections, which have to be closed when the backend is finalized.
+ */
+static GPtrArray* backend_connections = NULL;
+
+G_LOCK_DEFINE_STATIC(backend_connections);
+
+static void
+backend_connection_close(JSQLiteConnection* connection)
+{
+	if (connection->db == NULL)
+	{
+		return;
+	}
+
+	for (guint i = 0; i < J_SQLITE_STATEMENT_COUNT; i++)
+	{
+		sqlite3_finalize(connection->statements[i]);
+		connection->statements[i] = NULL;
+	}
+
+	// Iterators that have not been finished finalize their statements later, the connection is closed afterwards
+	sqlite3_close_v2(connection->db);
+	connection->db = NULL;
+}
+
+static void
+backend_connection_free(gpointer data)
+{
+	JSQLiteConnection* connection = data;
+
+	G_LOCK(backend_connections);
+
+	backend_connection_close(connection);
+
+	if (backend_connections != NULL)
+	{
+		g_ptr_array_remove_fast(backend_connections, connection);
+	}
+
+	G_UNLOCK(backend_connections);
+
+	g_slice_free(JSQLiteConnection, connection);
+}
+
+static GPrivate backend_connection = G_PRIVATE_INIT(backend_connection_free);
+
+/**
+ * Returns the calling thread's connection, opening it if necessary.
+ */
+static JSQLiteConnection*
+backend_connection_get(void)
+{
+	JSQLiteConnection* connection;
+
+	if ((connection = g_private_get(&backend_connection)) != NULL)
+	{
+		return (connection->db != NULL) ? connection : NULL;
+	}
+
+	connection = g_slice_new0(JSQLiteConnection);
+	connection->synchronous = -1;
+
+	// The connection is only used by this thread, so SQLite does not have to lock it
+	if (sqlite3_open_v2(backend_path, &(connection->db), SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, NULL) != SQLITE_OK)
+	{
+		g_warning("sqlite: Could not open connection: %s", sqlite3_errmsg(connection->db));
+		sqlite3_close(connection->db);
+		g_slice_free(JSQLiteConnection, connection);
+
+		return NULL;
+	}
+
+	// Writers of other threads hold the lock only briefly
+	sqlite3_busy_timeout(connection->db, 10000);
+
+	// Reads are served from the page cache's memory map instead of copying pages
+	sqlite3_exec(connection->db, "PRAGMA mmap_size = 268435456;", NULL, NULL, NULL);
+
+	G_LOCK(backend_connections);
+	g_ptr_array_add(backend_connections, connection);
+	G_UNLOCK(backend_connections);
+
+	g_private_set(&backend_connection, connection);
+
+	return connection;
+}
+
+/**
+ * Returns a prepared statement from the connection's cache.
+ */
+static sqlite3_stmt*
+backend_statement_get(JSQLiteConnection* connection, JSQLiteStatement statement)
+{
+	sqlite3_stmt** stmt = &(connection->statements[statement]);
+
+	if (*stmt == NULL && sqlite3_prepare_v3(connection->db, backend_statements[statement], -1, SQLITE_PREPARE_PERSISTENT, stmt, NULL) != SQLITE_OK)
+	{
+		g_warning("sqlite: Could not prepare statement: %s", sqlite3_errmsg(connection->db));
+		*stmt = NULL;
+	}
+
+	return *stmt;
+}
+
+static void
+backend_statement_reset(sqlite3_stmt* stmt)
+{
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+}
+
+/**
+ * Returns a value that changes whenever another connection commits a transaction.
+ */
+static gboolean
+backend_data_version(JSQLiteConnection* connection, gint64* version)
+{
+	sqlite3_stmt* stmt;
+	gboolean ret = FALSE;
+
+	if ((stmt = backend_statement_get(connection, J_SQLITE_STATEMENT_DATA_VERSION)) == NULL)
+	{
+		return FALSE;
+	}
+
+	if (sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		*version = sqlite3_column_int64(stmt, 0);
+		ret = TRUE;
+	}
+
+	backend_statement_reset(stmt);
+
+	return ret;
+}
+
+/**
+ * Starts the batch's transaction if necessary.
+ * Transactions are started lazily, so batches that only read never take the write lock.
+ */
+static gboolean
+backend_batch_begin(JSQLiteBatch* batch, gboolean write)
+{
+	gint64 read_version = 0;
+	gboolean upgrade = FALSE;
+
+	if (batch->transaction && (batch->write || !write))
+	{
+		return TRUE;
+	}
+
+	// A read transaction cannot always be upgraded without deadlocking with other writers, it did not modify anything and can be committed
+	// The values read have to be checked for modifications by other writers once the write transaction has been started
+	if (batch->transaction)
+	{
+		if (!backend_data_version(batch->connection, &read_version))
+		{
+			batch->failed = TRUE;
+			return FALSE;
+		}
+
+		sqlite3_exec(batch->connection->db, "COMMIT;", NULL, NULL, NULL);
+		batch->transaction = FALSE;
+		upgrade = TRUE;
+	}
+
+	if (write)
+	{
+		gint synchronous = 1;
+
+		switch (j_semantics_get(batch->semantics, J_SEMANTICS_SAFETY))
+		{
+			case J_SEMANTICS_SAFETY_NONE:
+				synchronous = 0;
+				break;
+			case J_SEMANTICS_SAFETY_NETWORK:
+				// Commits are durable after application crashes, syncs happen during checkpoints
+				synchronous = 1;
+				break;
+			case J_SEMANTICS_SAFETY_STORAGE:
+				synchronous = 2;
+				break;
+			default:
+				g_warn_if_reached();
+		}
+
+		// The synchronous setting cannot be changed inside a transaction
+		if (synchronous != batch->connection->synchronous)
+		{
+			g_autofree gchar* pragma = NULL;
+
+			pragma = g_strdup_printf("PRAGMA synchronous = %d;", synchronous);
+
+			if (sqlite3_exec(batch->connection->db, pragma, NULL, NULL, NULL) == SQLITE_OK)
+			{
+				batch->connection->synchronous = synchronous;
+			}
+		}
+	}
+
+	if (sqlite3_exec(batch->connection->db, (write) ? "BEGIN IMMEDIATE;" : "BEGIN;", NULL, NULL, NULL) != SQLITE_OK)
+	{
+		return FALSE;
+	}
+
+	batch->transaction = TRUE;
+	batch->write = write;
+
+	if (upgrade)
+	{
+		gint64 write_version;
+
+		if (!backend_data_version(batch->connection, &write_version) || write_version != read_version)
+		{
+			// The transaction is rolled back when the batch is executed
+			batch->failed = TRUE;
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
 
 static gboolean
 backend_batch_start(gchar const* namespace, JSemantics* semantics, gpointer* data)
 {
 	JSQLiteBatch* batch = NULL;
+	JSQLiteConnection* connection;
 
 	g_return_val_if_fail(namespace != NULL, FALSE);
 	g_return_val_if_fail(data != NULL, FALSE);
 
-	if (sqlite3_exec(backend_db, "BEGIN TRANSACTION;", NULL, NULL, NULL) == SQLITE_OK)
+	if ((connection = backend_connection_get()) != NULL)
 	{
 		batch = g_slice_new(JSQLiteBatch);
 
+		batch->connection = connection;
+		batch->transaction = FALSE;
+		batch->write = FALSE;
+		batch->failed = FALSE;
+		batch->values = g_ptr_array_new_with_free_func(g_free);
 		batch->namespace = g_strdup(namespace);
 		batch->semantics = j_semantics_ref(semantics);
 	}
@@ -67,13 +397,20 @@ backend_batch_execute(gpointer data)
 
 	g_return_val_if_fail(data != NULL, FALSE);
 
-	// FIXME do something with batch->semantics
-
-	if (sqlite3_exec(backend_db, "COMMIT;", NULL, NULL, NULL) == SQLITE_OK)
+	if (!batch->transaction)
+	{
+		ret = !batch->failed;
+	}
+	else if (batch->failed)
+	{
+		sqlite3_exec(batch->connection->db, "ROLLBACK;", NULL, NULL, NULL);
+	}
+	else if (sqlite3_exec(batch->connection->db, "COMMIT;", NULL, NULL, NULL) == SQLITE_OK)
 	{
 		ret = TRUE;
 	}
 
+	g_ptr_array_unref(batch->values);
 	j_semantics_unref(batch->semantics);
 	g_free(batch->namespace);
 	g_slice_free(JSQLiteBatch, batch);
@@ -81,26 +418,56 @@ backend_batch_execute(gpointer data)
 	return ret;
 }
 
+/**
+ * Starts a batch with BEGIN IMMEDIATE, which takes the write lock right away.
+ * Other connections therefore cannot modify values read by the batch until it has been executed.
+ */
+static gboolean
+backend_batch_start_update(gchar const* namespace, JSemantics* semantics, gpointer* data)
+{
+	if (!backend_batch_start(namespace, semantics, data))
+	{
+		return FALSE;
+	}
+
+	if (!backend_batch_begin(*data, TRUE))
+	{
+		backend_batch_execute(*data);
+		*data = NULL;
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 static gboolean
 backend_put(gpointer data, gchar const* key, gconstpointer value, guint32 len)
 {
 	JSQLiteBatch* batch = data;
 	sqlite3_stmt* stmt;
+	gboolean ret = FALSE;
 
 	g_return_val_if_fail(data != NULL, FALSE);
 	g_return_val_if_fail(key != NULL, FALSE);
 	g_return_val_if_fail(value != NULL, FALSE);
 
-	sqlite3_prepare_v2(backend_db, "INSERT INTO julea (namespace, key, value) VALUES (?, ?, ?);", -1, &stmt, NULL);
-	sqlite3_bind_text(stmt, 1, batch->namespace, -1, NULL);
-	sqlite3_bind_text(stmt, 2, key, -1, NULL);
-	sqlite3_bind_blob(stmt, 3, value, len, NULL);
+	if (!backend_batch_begin(batch, TRUE) || (stmt = backend_statement_get(batch->connection, J_SQLITE_STATEMENT_PUT)) == NULL)
+	{
+		batch->failed = TRUE;
+		return FALSE;
+	}
 
-	sqlite3_step(stmt);
-	sqlite3_finalize(stmt);
+	sqlite3_bind_text(stmt, 1, batch->namespace, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, key, -1, SQLITE_STATIC);
+	sqlite3_bind_blob(stmt, 3, value, len, SQLITE_STATIC);
 
-	// FIXME
-	return TRUE;
+	ret = (sqlite3_step(stmt) == SQLITE_DONE);
+	backend_statement_reset(stmt);
+
+	batch->failed = batch->failed || !ret;
+
+	return ret;
 }
 
 static gboolean
@@ -108,113 +475,369 @@ backend_delete(gpointer data, gchar const* key)
 {
 	JSQLiteBatch* batch = data;
 	sqlite3_stmt* stmt;
+	gboolean ret = FALSE;
 
 	g_return_val_if_fail(data != NULL, FALSE);
 	g_return_val_if_fail(key != NULL, FALSE);
 
-	sqlite3_prepare_v2(backend_db, "DELETE FROM julea WHERE namespace = ? AND key = ?;", -1, &stmt, NULL);
-	sqlite3_bind_text(stmt, 1, batch->namespace, -1, NULL);
-	sqlite3_bind_text(stmt, 2, key, -1, NULL);
+	if (!backend_batch_begin(batch, TRUE) || (stmt = backend_statement_get(batch->connection, J_SQLITE_STATEMENT_DELETE)) == NULL)
+	{
+		batch->failed = TRUE;
+		return FALSE;
+	}
+
+	sqlite3_bind_text(stmt, 1, batch->namespace, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, key, -1, SQLITE_STATIC);
 
-	sqlite3_step(stmt);
-	sqlite3_finalize(stmt);
+	ret = (sqlite3_step(stmt) == SQLITE_DONE);
+	backend_statement_reset(stmt);
 
-	// FIXME
-	return TRUE;
+	batch->failed = batch->failed || !ret;
+
+	return ret;
+}
+
+/**
+ * Returns the first key that is greater than all keys with a prefix, NULL if there is none.
+ */
+static gchar*
+backend_prefix_end(gchar const* prefix)
+{
+	gchar* end;
+	gsize len;
+
+	end = g_strdup(prefix);
+	len = strlen(end);
+
+	while (len > 0)
+	{
+		if ((guchar)end[len - 1] < 0xff)
+		{
+			end[len - 1]++;
+			end[len] = '\0';
+
+			return end;
+		}
+
+		len--;
+	}
+
+	g_free(end);
+
+	return NULL;
 }
 
 static gboolean
-backend_get(gpointer data, gchar const* key, gpointer* value, guint32* len)
+backend_delete_prefix(gpointer data, gchar const* prefix)
 {
 	JSQLiteBatch* batch = data;
+	g_autofree gchar* end = NULL;
 	sqlite3_stmt* stmt;
-	gint ret;
-	gconstpointer result = NULL;
+	gboolean ret = FALSE;
+
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(prefix != NULL, FALSE);
+
+	// Keys are compared bytewise, so the prefix can be turned into a range that uses the index
+	end = backend_prefix_end(prefix);
+
+	if (!backend_batch_begin(batch, TRUE) || (stmt = backend_statement_get(batch->connection, (end != NULL) ? J_SQLITE_STATEMENT_DELETE_RANGE_END : J_SQLITE_STATEMENT_DELETE_RANGE)) == NULL)
+	{
+		batch->failed = TRUE;
+		return FALSE;
+	}
+
+	sqlite3_bind_text(stmt, 1, batch->namespace, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, prefix, -1, SQLITE_STATIC);
+
+	if (end != NULL)
+	{
+		sqlite3_bind_text(stmt, 3, end, -1, SQLITE_STATIC);
+	}
+
+	ret = (sqlite3_step(stmt) == SQLITE_DONE);
+	backend_statement_reset(stmt);
+
+	batch->failed = batch->failed || !ret;
+
+	return ret;
+}
+
+static gboolean
+backend_get(gpointer data, gchar const* key, gconstpointer* value, guint32* len)
+{
+	JSQLiteBatch* batch = data;
+	sqlite3_stmt* stmt;
+	gconstpointer result;
 	gsize result_len;
+	gboolean found = FALSE;
 
 	g_return_val_if_fail(data != NULL, FALSE);
 	g_return_val_if_fail(key != NULL, FALSE);
 	g_return_val_if_fail(value != NULL, FALSE);
 	g_return_val_if_fail(len != NULL, FALSE);
 
-	sqlite3_prepare_v2(backend_db, "SELECT value FROM julea WHERE namespace = ? AND key = ?;", -1, &stmt, NULL);
-	sqlite3_bind_text(stmt, 1, batch->namespace, -1, NULL);
-	sqlite3_bind_text(stmt, 2, key, -1, NULL);
+	if (!backend_batch_begin(batch, FALSE) || (stmt = backend_statement_get(batch->connection, J_SQLITE_STATEMENT_GET)) == NULL)
+	{
+		return FALSE;
+	}
 
-	ret = sqlite3_step(stmt);
+	sqlite3_bind_text(stmt, 1, batch->namespace, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, key, -1, SQLITE_STATIC);
 
-	if (ret == SQLITE_ROW)
+	if (sqlite3_step(stmt) == SQLITE_ROW)
 	{
 		result = sqlite3_column_blob(stmt, 0);
 		result_len = sqlite3_column_bytes(stmt, 0);
 
-		// FIXME check whether copies can be avoided
-		*value = g_memdup(result, result_len);
+		// The blob is only valid until the statement is reset, empty blobs are NULL but existing values need a non-NULL pointer
+		*value = (result_len > 0) ? g_memdup(result, result_len) : g_malloc(1);
 		*len = result_len;
+
+		g_ptr_array_add(batch->values, (gpointer)(guintptr)*value);
+		found = TRUE;
 	}
 
-	sqlite3_finalize(stmt);
+	backend_statement_reset(stmt);
 
-	return (result != NULL);
+	return found;
 }
 
 static gboolean
-backend_get_all(gchar const* namespace, gpointer* data)
+backend_get_multi(gpointer data, gchar const** keys, guint count, gconstpointer* values, guint32* lens)
 {
-	sqlite3_stmt* stmt = NULL;
+	JSQLiteBatch* batch = data;
+	sqlite3_stmt* stmt;
 
-	g_return_val_if_fail(namespace != NULL, FALSE);
 	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(keys != NULL, FALSE);
+	g_return_val_if_fail(values != NULL, FALSE);
+	g_return_val_if_fail(lens != NULL, FALSE);
 
-	if (sqlite3_prepare_v2(backend_db, "SELECT key, value FROM julea WHERE namespace = ?;", -1, &stmt, NULL) == SQLITE_OK)
+	for (guint i = 0; i < count; i++)
 	{
-		sqlite3_bind_text(stmt, 1, namespace, -1, NULL);
+		values[i] = NULL;
+		lens[i] = 0;
 	}
 
-	*data = stmt;
+	if (!backend_batch_begin(batch, FALSE) || (stmt = backend_statement_get(batch->connection, J_SQLITE_STATEMENT_GET_MULTI)) == NULL)
+	{
+		return FALSE;
+	}
+
+	for (guint offset = 0; offset < count; offset += J_SQLITE_MULTI_COUNT)
+	{
+		guint n = MIN(J_SQLITE_MULTI_COUNT, count - offset);
+		guint j = offset;
+
+		sqlite3_bind_text(stmt, 1, batch->namespace, -1, SQLITE_STATIC);
+
+		// Unused parameters repeat the last key, which does not change the result
+		for (guint i = 0; i < J_SQLITE_MULTI_COUNT; i++)
+		{
+			sqlite3_bind_text(stmt, i + 2, keys[offset + MIN(i, n - 1)], -1, SQLITE_STATIC);
+		}
+
+		// Both the keys and the rows are sorted, so they can be matched in one pass
+		while (sqlite3_step(stmt) == SQLITE_ROW)
+		{
+			gchar const* key;
+			gpointer value;
+			guint32 len;
+
+			key = (gchar const*)sqlite3_column_text(stmt, 0);
+
+			while (j < offset + n && strcmp(keys[j], key) < 0)
+			{
+				j++;
+			}
+
+			if (j == offset + n || strcmp(keys[j], key) != 0)
+			{
+				continue;
+			}
+
+			len = sqlite3_column_bytes(stmt, 1);
+			value = (len > 0) ? g_memdup(sqlite3_column_blob(stmt, 1), len) : g_malloc(1);
+			g_ptr_array_add(batch->values, value);
+
+			for (; j < offset + n && strcmp(keys[j], key) == 0; j++)
+			{
+				values[j] = value;
+				lens[j] = len;
+			}
+		}
+
+		backend_statement_reset(stmt);
+	}
 
-	return (stmt != NULL);
+	return TRUE;
 }
 
 static gboolean
-backend_get_by_prefix(gchar const* namespace, gchar const* prefix, gpointer* data)
+backend_put_multi(gpointer data, gchar const** keys, gconstpointer* values, guint32* lens, guint count)
 {
-	sqlite3_stmt* stmt = NULL;
+	JSQLiteBatch* batch = data;
+	sqlite3_stmt* stmt;
+	guint offset = 0;
+	gboolean ret = TRUE;
 
-	g_return_val_if_fail(namespace != NULL, FALSE);
-	g_return_val_if_fail(prefix != NULL, FALSE);
 	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(keys != NULL, FALSE);
+	g_return_val_if_fail(values != NULL, FALSE);
+	g_return_val_if_fail(lens != NULL, FALSE);
 
-	if (sqlite3_prepare_v2(backend_db, "SELECT key, value FROM julea WHERE namespace = ? AND key LIKE ? || '%';", -1, &stmt, NULL) == SQLITE_OK)
+	if (!backend_batch_begin(batch, TRUE) || (stmt = backend_statement_get(batch->connection, J_SQLITE_STATEMENT_PUT_MULTI)) == NULL)
 	{
-		sqlite3_bind_text(stmt, 1, namespace, -1, NULL);
-		sqlite3_bind_text(stmt, 2, prefix, -1, NULL);
+		batch->failed = TRUE;
+		return FALSE;
 	}
 
-	*data = stmt;
+	// Rows are inserted in order, so the last value of duplicate keys wins
+	for (; offset + J_SQLITE_MULTI_COUNT <= count && ret; offset += J_SQLITE_MULTI_COUNT)
+	{
+		sqlite3_bind_text(stmt, 1, batch->namespace, -1, SQLITE_STATIC);
+
+		for (guint i = 0; i < J_SQLITE_MULTI_COUNT; i++)
+		{
+			sqlite3_bind_text(stmt, 2 * i + 2, keys[offset + i], -1, SQLITE_STATIC);
+			sqlite3_bind_blob(stmt, 2 * i + 3, values[offset + i], lens[offset + i], SQLITE_STATIC);
+		}
 
-	return (stmt != NULL);
+		ret = (sqlite3_step(stmt) == SQLITE_DONE);
+		backend_statement_reset(stmt);
+	}
+
+	batch->failed = batch->failed || !ret;
+
+	for (; offset < count && ret; offset++)
+	{
+		ret = backend_put(batch, keys[offset], values[offset], lens[offset]);
+	}
+
+	return ret;
+}
+
+static gboolean
+backend_iterator_new(JSQLiteStatement statement, gchar const* namespace, gchar const* prefix, gchar const* end, guint32 limit, gpointer* data)
+{
+	JSQLiteIterator* iterator = NULL;
+	JSQLiteConnection* connection;
+	sqlite3_stmt* stmt;
+	gboolean cached = TRUE;
+
+	if ((connection = backend_connection_get()) == NULL)
+	{
+		return FALSE;
+	}
+
+	stmt = backend_statement_get(connection, statement);
+
+	// Iterators can be nested, only one of them can use the cached statement
+	if (stmt != NULL && sqlite3_stmt_busy(stmt))
+	{
+		cached = FALSE;
+
+		if (sqlite3_prepare_v2(connection->db, backend_statements[statement], -1, &stmt, NULL) != SQLITE_OK)
+		{
+			stmt = NULL;
+		}
+	}
+
+	if (stmt != NULL)
+	{
+		// The strings have to stay valid while iterating
+		sqlite3_bind_text(stmt, 1, namespace, -1, SQLITE_TRANSIENT);
+
+		if (prefix != NULL)
+		{
+			sqlite3_bind_text(stmt, 2, prefix, -1, SQLITE_TRANSIENT);
+		}
+
+		if (end != NULL)
+		{
+			sqlite3_bind_text(stmt, 3, end, -1, SQLITE_TRANSIENT);
+		}
+
+		if (statement == J_SQLITE_STATEMENT_GET_RANGE || statement == J_SQLITE_STATEMENT_GET_RANGE_END)
+		{
+			// A negative limit returns all rows
+			sqlite3_bind_int64(stmt, (end != NULL) ? 4 : 3, (limit > 0) ? (sqlite3_int64)limit : -1);
+		}
+
+		iterator = g_slice_new(JSQLiteIterator);
+		iterator->connection = connection;
+		iterator->stmt = stmt;
+		iterator->cached = cached;
+	}
+
+	*data = iterator;
+
+	return (iterator != NULL);
+}
+
+static gboolean
+backend_get_all(gchar const* namespace, gpointer* data)
+{
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	return backend_iterator_new(J_SQLITE_STATEMENT_GET_ALL, namespace, NULL, NULL, 0, data);
+}
+
+static gboolean
+backend_get_by_prefix(gchar const* namespace, gchar const* prefix, gpointer* data)
+{
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(prefix != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	return backend_iterator_new(J_SQLITE_STATEMENT_GET_BY_PREFIX, namespace, prefix, NULL, 0, data);
+}
+
+static gboolean
+backend_get_range(gchar const* namespace, gchar const* start, gchar const* end, guint32 limit, gpointer* data)
+{
+	JSQLiteStatement statement;
+
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	statement = (end != NULL) ? J_SQLITE_STATEMENT_GET_RANGE_END : J_SQLITE_STATEMENT_GET_RANGE;
+
+	// Keys use the binary collation, so the empty string is the smallest key
+	return backend_iterator_new(statement, namespace, (start != NULL) ? start : "", end, limit, data);
 }
 
 static gboolean
 backend_iterate(gpointer data, gchar const** key, gconstpointer* value, guint32* len)
 {
-	sqlite3_stmt* stmt = data;
+	JSQLiteIterator* iterator = data;
 
 	g_return_val_if_fail(data != NULL, FALSE);
 	g_return_val_if_fail(value != NULL, FALSE);
 	g_return_val_if_fail(len != NULL, FALSE);
 
-	if (sqlite3_step(stmt) == SQLITE_ROW)
+	if (iterator->connection->db != NULL && sqlite3_step(iterator->stmt) == SQLITE_ROW)
 	{
-		*key = (gchar const*)sqlite3_column_text(stmt, 0);
-		*value = sqlite3_column_blob(stmt, 1);
-		*len = sqlite3_column_bytes(stmt, 1);
+		*key = (gchar const*)sqlite3_column_text(iterator->stmt, 0);
+		*value = sqlite3_column_blob(iterator->stmt, 1);
+		*len = sqlite3_column_bytes(iterator->stmt, 1);
 
 		return TRUE;
 	}
 
-	sqlite3_finalize(stmt);
+	if (!iterator->cached)
+	{
+		// Statements can also be finalized after their connection has been closed
+		sqlite3_finalize(iterator->stmt);
+	}
+	else if (iterator->connection->db != NULL)
+	{
+		backend_statement_reset(iterator->stmt);
+	}
+
+	g_slice_free(JSQLiteIterator, iterator);
 
 	return FALSE;
 }
@@ -223,31 +846,44 @@ static gboolean
 backend_init(gchar const* path)
 {
 	g_autofree gchar* dirname = NULL;
+	sqlite3* db = NULL;
 
 	g_return_val_if_fail(path != NULL, FALSE);
 
 	dirname = g_path_get_dirname(path);
 	g_mkdir_with_parents(dirname, 0700);
 
-	if (sqlite3_open(path, &backend_db) != SQLITE_OK)
+	if (sqlite3_open(path, &db) != SQLITE_OK)
 	{
 		goto error;
 	}
 
-	if (sqlite3_exec(backend_db, "CREATE TABLE IF NOT EXISTS julea (namespace TEXT NOT NULL, key TEXT NOT NULL, value BLOB NOT NULL);", NULL, NULL, NULL) != SQLITE_OK)
+	// The journal mode is persistent, readers do not block writers and vice versa
+	if (sqlite3_exec(db, "PRAGMA journal_mode = WAL;", NULL, NULL, NULL) != SQLITE_OK)
 	{
 		goto error;
 	}
 
-	if (sqlite3_exec(backend_db, "CREATE UNIQUE INDEX IF NOT EXISTS julea_namespace_key ON julea (namespace, key);", NULL, NULL, NULL) != SQLITE_OK)
+	if (sqlite3_exec(db, "CREATE TABLE IF NOT EXISTS julea (namespace TEXT NOT NULL, key TEXT NOT NULL, value BLOB NOT NULL);", NULL, NULL, NULL) != SQLITE_OK)
 	{
 		goto error;
 	}
 
-	return (backend_db != NULL);
+	if (sqlite3_exec(db, "CREATE UNIQUE INDEX IF NOT EXISTS julea_namespace_key ON julea (namespace, key);", NULL, NULL, NULL) != SQLITE_OK)
+	{
+		goto error;
+	}
+
+	// The threads open their own connections
+	sqlite3_close(db);
+
+	backend_path = g_strdup(path);
+	backend_connections = g_ptr_array_new();
+
+	return TRUE;
 
 error:
-	sqlite3_close(backend_db);
+	sqlite3_close(db);
 
 	return FALSE;
 }
@@ -255,10 +891,21 @@ error:
 static void
 backend_fini(void)
 {
-	if (backend_db != NULL)
+	G_LOCK(backend_connections);
+
+	// Threads might still hold connections, which are freed when the threads exit
+	for (guint i = 0; i < backend_connections->len; i++)
 	{
-		sqlite3_close(backend_db);
+		backend_connection_close(g_ptr_array_index(backend_connections, i));
 	}
+
+	g_ptr_array_free(backend_connections, TRUE);
+	backend_connections = NULL;
+
+	G_UNLOCK(backend_connections);
+
+	g_free(backend_path);
+	backend_path = NULL;
 }
 
 static JBackend sqlite_backend = {
@@ -269,11 +916,16 @@ static JBackend sqlite_backend = {
 		.backend_fini = backend_fini,
 		.backend_batch_start = backend_batch_start,
 		.backend_batch_execute = backend_batch_execute,
+		.backend_batch_start_update = backend_batch_start_update,
 		.backend_put = backend_put,
 		.backend_delete = backend_delete,
+		.backend_delete_prefix = backend_delete_prefix,
 		.backend_get = backend_get,
+		.backend_get_multi = backend_get_multi,
+		.backend_put_multi = backend_put_multi,
 		.backend_get_all = backend_get_all,
 		.backend_get_by_prefix = backend_get_by_prefix,
+		.backend_get_range = backend_get_range,
 		.backend_iterate = backend_iterate }
 };
 
@@ -0,0 +1,765 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2019 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * An object backend that compresses objects using LZ4 and stores them in another object backend.
+ *
+ * Objects are split into chunks of a fixed size that are compressed independently.
+ * Each chunk is stored in a slot of its own, which starts with a header that records how the chunk is stored.
+ * Because the offset of a slot only depends on the chunk's index, reads only decompress the chunks they touch and writes never move other chunks.
+ * Unused parts of slots are never written, so file-based backends store them as holes.
+ * Chunks that do not compress well are stored uncompressed.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <gmodule.h>
+
+#include <string.h>
+
+#include <lz4.h>
+
+#include <julea.h>
+
+/**
+ * The size of the object header, which also aligns the slots.
+ */
+#define JD_BACKEND_HEADER_SIZE 4096
+
+/**
+ * The magic number that identifies compressed objects.
+ */
+#define JD_BACKEND_MAGIC "JCOMPRES"
+
+#define JD_BACKEND_VERSION 1
+
+/**
+ * The default size of chunks.
+ * Can be set with the chunk-size option (chunk-size=256K).
+ */
+#define JD_BACKEND_CHUNK_SIZE (1024 * 1024)
+
+/**
+ * Chunks that are not reduced by at least 1/JD_BACKEND_MIN_SAVINGS of their size are stored uncompressed.
+ */
+#define JD_BACKEND_MIN_SAVINGS 8
+
+/**
+ * The number of locks that serialize accesses to objects.
+ */
+#define JD_BACKEND_LOCKS 64
+
+enum JBackendChunkMode
+{
+	/**
+	 * The chunk has never been written and contains zeroes.
+	 */
+	J_BACKEND_CHUNK_EMPTY,
+	J_BACKEND_CHUNK_RAW,
+	J_BACKEND_CHUNK_LZ4
+};
+
+typedef enum JBackendChunkMode JBackendChunkMode;
+
+/**
+ * The header at the start of each compressed object.
+ * All integers are stored in little endian.
+ */
+struct JBackendHeader
+{
+	gchar magic[8];
+	guint32 version;
+	guint32 chunk_size;
+	guint64 size;
+};
+
+typedef struct JBackendHeader JBackendHeader;
+
+/**
+ * The header at the start of each slot.
+ * All integers are stored in little endian.
+ */
+struct JBackendChunkHeader
+{
+	guint32 mode;
+
+	/**
+	 * The number of bytes stored after the header.
+	 */
+	guint32 stored_length;
+
+	/**
+	 * The uncompressed length of the chunk, the rest of the chunk contains zeroes.
+	 */
+	guint32 length;
+
+	guint32 reserved;
+};
+
+typedef struct JBackendChunkHeader JBackendChunkHeader;
+
+struct JBackendObject
+{
+	gchar* key;
+
+	/**
+	 * The object of the underlying backend.
+	 */
+	gpointer data;
+
+	/**
+	 * Whether the object is compressed.
+	 * Objects in namespaces that are not compressed and objects written without this backend are passed through.
+	 */
+	gboolean compressed;
+
+	guint32 chunk_size;
+};
+
+typedef struct JBackendObject JBackendObject;
+
+static JBackend* jd_backend_inner = NULL;
+static GModule* jd_backend_inner_module = NULL;
+
+/**
+ * The size of chunks of new objects.
+ */
+static guint32 jd_backend_chunk_size = JD_BACKEND_CHUNK_SIZE;
+
+/**
+ * The namespaces that are compressed, NULL if all namespaces are compressed.
+ * Can be set with the namespaces option (namespaces=simulation+checkpoints).
+ */
+static gchar** jd_backend_namespaces = NULL;
+
+static GRWLock jd_backend_locks[JD_BACKEND_LOCKS];
+
+static GRWLock*
+backend_lock_get(JBackendObject* object)
+{
+	return &(jd_backend_locks[g_str_hash(object->key) % JD_BACKEND_LOCKS]);
+}
+
+static guint64
+backend_slot_offset(JBackendObject* object, guint64 index)
+{
+	// Slots are padded to keep them aligned
+	return JD_BACKEND_HEADER_SIZE + index * (object->chunk_size + JD_BACKEND_HEADER_SIZE);
+}
+
+static gboolean
+backend_header_read(JBackendObject* object, guint64* size)
+{
+	JBackendHeader header;
+	guint64 nbytes = 0;
+
+	if (!j_backend_object_read(jd_backend_inner, object->data, &header, sizeof(header), 0, &nbytes) || nbytes != sizeof(header))
+	{
+		return FALSE;
+	}
+
+	if (memcmp(header.magic, JD_BACKEND_MAGIC, sizeof(header.magic)) != 0 || GUINT32_FROM_LE(header.version) != JD_BACKEND_VERSION)
+	{
+		return FALSE;
+	}
+
+	object->chunk_size = GUINT32_FROM_LE(header.chunk_size);
+
+	if (size != NULL)
+	{
+		*size = GUINT64_FROM_LE(header.size);
+	}
+
+	return TRUE;
+}
+
+static gboolean
+backend_header_write(JBackendObject* object, guint64 size)
+{
+	JBackendHeader header;
+	guint64 nbytes = 0;
+
+	memcpy(header.magic, JD_BACKEND_MAGIC, sizeof(header.magic));
+	header.version = GUINT32_TO_LE(JD_BACKEND_VERSION);
+	header.chunk_size = GUINT32_TO_LE(object->chunk_size);
+	header.size = GUINT64_TO_LE(size);
+
+	return j_backend_object_write(jd_backend_inner, object->data, &header, sizeof(header), 0, &nbytes) && nbytes == sizeof(header);
+}
+
+static gboolean
+backend_chunk_header_read(JBackendObject* object, guint64 index, JBackendChunkHeader* header)
+{
+	guint64 nbytes = 0;
+
+	j_backend_object_read(jd_backend_inner, object->data, header, sizeof(*header), backend_slot_offset(object, index), &nbytes);
+
+	if (nbytes < sizeof(*header))
+	{
+		// Slots beyond the end of the object have not been written
+		memset(header, 0, sizeof(*header));
+	}
+
+	header->mode = GUINT32_FROM_LE(header->mode);
+	header->stored_length = GUINT32_FROM_LE(header->stored_length);
+	header->length = GUINT32_FROM_LE(header->length);
+
+	if (header->mode > J_BACKEND_CHUNK_LZ4 || header->length > object->chunk_size || header->stored_length > object->chunk_size)
+	{
+		g_warning("compress: Chunk %" G_GUINT64_FORMAT " of %s is corrupted.", index, object->key);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * Reads length bytes starting at offset within a chunk whose header has already been read.
+ * Raw chunks are read directly into the buffer, compressed chunks are decompressed into chunk first.
+ *
+ * \param chunk   A buffer of chunk_size bytes, which may also be the buffer.
+ * \param scratch A buffer of chunk_size bytes.
+ */
+static gboolean
+backend_chunk_read(JBackendObject* object, guint64 index, JBackendChunkHeader const* header, gchar* buffer, guint32 length, guint32 offset, gchar* chunk, gchar* scratch)
+{
+	guint64 slot_offset;
+	guint32 available;
+	guint64 nbytes = 0;
+
+	slot_offset = backend_slot_offset(object, index) + sizeof(*header);
+	available = (offset < header->length) ? MIN(length, header->length - offset) : 0;
+
+	switch (header->mode)
+	{
+		case J_BACKEND_CHUNK_EMPTY:
+			available = 0;
+			break;
+		case J_BACKEND_CHUNK_RAW:
+			if (available > 0)
+			{
+				j_backend_object_read(jd_backend_inner, object->data, buffer, available, slot_offset + offset, &nbytes);
+
+				if (nbytes != available)
+				{
+					return FALSE;
+				}
+			}
+			break;
+		case J_BACKEND_CHUNK_LZ4:
+			if (available > 0)
+			{
+				j_backend_object_read(jd_backend_inner, object->data, scratch, header->stored_length, slot_offset, &nbytes);
+
+				if (nbytes != header->stored_length
+				    || LZ4_decompress_safe(scratch, chunk, header->stored_length, object->chunk_size) != (gint)header->length)
+				{
+					g_warning("compress: Could not decompress chunk %" G_GUINT64_FORMAT " of %s.", index, object->key);
+					return FALSE;
+				}
+
+				if (buffer != chunk + offset)
+				{
+					memcpy(buffer, chunk + offset, available);
+				}
+			}
+			break;
+		default:
+			g_assert_not_reached();
+	}
+
+	memset(buffer + available, 0, length - available);
+
+	return TRUE;
+}
+
+/**
+ * Compresses and stores a chunk.
+ *
+ * \param scratch A buffer of sizeof(JBackendChunkHeader) + LZ4_compressBound(chunk_size) bytes.
+ */
+static gboolean
+backend_chunk_write(JBackendObject* object, guint64 index, gchar const* chunk, guint32 length, gchar* scratch)
+{
+	JBackendChunkHeader header;
+	gchar* payload = scratch + sizeof(header);
+	gint compressed;
+	guint64 nbytes = 0;
+
+	compressed = LZ4_compress_default(chunk, payload, length, LZ4_compressBound(object->chunk_size));
+
+	// Skip compression for incompressible chunks, reading them is cheaper
+	if (compressed <= 0 || (guint32)compressed > length - (length / JD_BACKEND_MIN_SAVINGS))
+	{
+		header.mode = GUINT32_TO_LE(J_BACKEND_CHUNK_RAW);
+		header.stored_length = GUINT32_TO_LE(length);
+		memcpy(payload, chunk, length);
+		compressed = length;
+	}
+	else
+	{
+		header.mode = GUINT32_TO_LE(J_BACKEND_CHUNK_LZ4);
+		header.stored_length = GUINT32_TO_LE(compressed);
+	}
+
+	header.length = GUINT32_TO_LE(length);
+	header.reserved = 0;
+	memcpy(scratch, &header, sizeof(header));
+
+	// Header and payload are written at once
+	return j_backend_object_write(jd_backend_inner, object->data, scratch, sizeof(header) + compressed, backend_slot_offset(object, index), &nbytes)
+	       && nbytes == sizeof(header) + compressed;
+}
+
+static gboolean
+backend_namespace_compressed(gchar const* namespace)
+{
+	return (jd_backend_namespaces == NULL || g_strv_contains((gchar const* const*)jd_backend_namespaces, namespace));
+}
+
+static JBackendObject*
+backend_object_new(gchar const* namespace, gchar const* path, gpointer data)
+{
+	JBackendObject* object;
+
+	object = g_slice_new(JBackendObject);
+	object->key = g_build_path("/", namespace, path, NULL);
+	object->data = data;
+	object->compressed = FALSE;
+	object->chunk_size = jd_backend_chunk_size;
+
+	return object;
+}
+
+static void
+backend_object_free(JBackendObject* object)
+{
+	g_free(object->key);
+	g_slice_free(JBackendObject, object);
+}
+
+static gboolean
+backend_create(gchar const* namespace, gchar const* path, gpointer* data)
+{
+	JBackendObject* object;
+	gpointer inner_data = NULL;
+	gint64 modification_time = 0;
+	guint64 size = 0;
+
+	if (!j_backend_object_create(jd_backend_inner, namespace, path, &inner_data))
+	{
+		return FALSE;
+	}
+
+	object = backend_object_new(namespace, path, inner_data);
+
+	if (backend_namespace_compressed(namespace))
+	{
+		j_backend_object_status(jd_backend_inner, inner_data, &modification_time, &size);
+
+		if (size == 0)
+		{
+			object->compressed = backend_header_write(object, 0);
+		}
+		else
+		{
+			// Existing objects that are not compressed are passed through
+			object->compressed = backend_header_read(object, NULL);
+		}
+	}
+
+	*data = object;
+
+	return TRUE;
+}
+
+static gboolean
+backend_open(gchar const* namespace, gchar const* path, gpointer* data)
+{
+	JBackendObject* object;
+	gpointer inner_data = NULL;
+
+	if (!j_backend_object_open(jd_backend_inner, namespace, path, &inner_data))
+	{
+		return FALSE;
+	}
+
+	object = backend_object_new(namespace, path, inner_data);
+
+	if (backend_namespace_compressed(namespace))
+	{
+		object->compressed = backend_header_read(object, NULL);
+	}
+
+	*data = object;
+
+	return TRUE;
+}
+
+static gboolean
+backend_delete(gpointer data)
+{
+	JBackendObject* object = data;
+	gboolean ret;
+
+	ret = j_backend_object_delete(jd_backend_inner, object->data);
+	backend_object_free(object);
+
+	return ret;
+}
+
+static gboolean
+backend_close(gpointer data)
+{
+	JBackendObject* object = data;
+	gboolean ret;
+
+	ret = j_backend_object_close(jd_backend_inner, object->data);
+	backend_object_free(object);
+
+	return ret;
+}
+
+static gboolean
+backend_delete_namespace(gchar const* namespace)
+{
+	// Compressed objects do not have any state outside of the stored objects
+	return j_backend_object_delete_namespace(jd_backend_inner, namespace);
+}
+
+static gboolean
+backend_status(gpointer data, gint64* modification_time, guint64* size)
+{
+	JBackendObject* object = data;
+	GRWLock* lock;
+	gboolean ret;
+	guint64 stored_size = 0;
+
+	if (!object->compressed)
+	{
+		return j_backend_object_status(jd_backend_inner, object->data, modification_time, size);
+	}
+
+	// The size of the stored object includes headers and padding
+	ret = j_backend_object_status(jd_backend_inner, object->data, modification_time, &stored_size);
+
+	if (ret)
+	{
+		lock = backend_lock_get(object);
+
+		g_rw_lock_reader_lock(lock);
+		ret = backend_header_read(object, size);
+		g_rw_lock_reader_unlock(lock);
+	}
+
+	return ret;
+}
+
+static gboolean
+backend_sync(gpointer data)
+{
+	JBackendObject* object = data;
+
+	return j_backend_object_sync(jd_backend_inner, object->data);
+}
+
+static gboolean
+backend_read(gpointer data, gpointer buffer, guint64 length, guint64 offset, guint64* bytes_read)
+{
+	JBackendObject* object = data;
+
+	g_autofree gchar* chunk = NULL;
+	g_autofree gchar* scratch = NULL;
+	GRWLock* lock;
+	gboolean ret = TRUE;
+	guint64 size = 0;
+	guint64 nbytes = 0;
+
+	if (!object->compressed)
+	{
+		return j_backend_object_read(jd_backend_inner, object->data, buffer, length, offset, bytes_read);
+	}
+
+	lock = backend_lock_get(object);
+
+	g_rw_lock_reader_lock(lock);
+
+	if (!backend_header_read(object, &size))
+	{
+		ret = FALSE;
+		goto end;
+	}
+
+	chunk = g_malloc(object->chunk_size);
+	scratch = g_malloc(object->chunk_size);
+
+	// Reads beyond the end of the object are short
+	length = (offset < size) ? MIN(length, size - offset) : 0;
+
+	while (nbytes < length)
+	{
+		guint64 position = offset + nbytes;
+		guint32 chunk_offset = position % object->chunk_size;
+		guint32 chunk_length = MIN(object->chunk_size - chunk_offset, length - nbytes);
+		JBackendChunkHeader header;
+
+		if (!backend_chunk_header_read(object, position / object->chunk_size, &header)
+		    || !backend_chunk_read(object, position / object->chunk_size, &header, (gchar*)buffer + nbytes, chunk_length, chunk_offset, chunk, scratch))
+		{
+			ret = FALSE;
+			break;
+		}
+
+		nbytes += chunk_length;
+	}
+
+end:
+	g_rw_lock_reader_unlock(lock);
+
+	if (bytes_read != NULL)
+	{
+		*bytes_read = nbytes;
+	}
+
+	return ret;
+}
+
+static gboolean
+backend_write(gpointer data, gconstpointer buffer, guint64 length, guint64 offset, guint64* bytes_written)
+{
+	JBackendObject* object = data;
+
+	g_autofree gchar* chunk = NULL;
+	g_autofree gchar* scratch = NULL;
+	GRWLock* lock;
+	gboolean ret = TRUE;
+	guint64 size = 0;
+	guint64 nbytes = 0;
+
+	if (!object->compressed)
+	{
+		return j_backend_object_write(jd_backend_inner, object->data, buffer, length, offset, bytes_written);
+	}
+
+	lock = backend_lock_get(object);
+
+	// Partially written chunks are read, modified and written again
+	g_rw_lock_writer_lock(lock);
+
+	if (!backend_header_read(object, &size))
+	{
+		ret = FALSE;
+		goto end;
+	}
+
+	chunk = g_malloc(object->chunk_size);
+	scratch = g_malloc(sizeof(JBackendChunkHeader) + LZ4_compressBound(object->chunk_size));
+
+	while (nbytes < length)
+	{
+		guint64 position = offset + nbytes;
+		guint64 index = position / object->chunk_size;
+		guint32 chunk_offset = position % object->chunk_size;
+		guint32 chunk_length = MIN(object->chunk_size - chunk_offset, length - nbytes);
+		gchar const* source = (gchar const*)buffer + nbytes;
+		guint32 source_length = chunk_length;
+
+		if (chunk_length < object->chunk_size)
+		{
+			JBackendChunkHeader header;
+
+			if (!backend_chunk_header_read(object, index, &header)
+			    || !backend_chunk_read(object, index, &header, chunk, object->chunk_size, 0, chunk, scratch))
+			{
+				ret = FALSE;
+				break;
+			}
+
+			memcpy(chunk + chunk_offset, source, chunk_length);
+
+			source = chunk;
+			source_length = MAX(header.length, chunk_offset + chunk_length);
+		}
+
+		if (!backend_chunk_write(object, index, source, source_length, scratch))
+		{
+			ret = FALSE;
+			break;
+		}
+
+		nbytes += chunk_length;
+	}
+
+	if (offset + nbytes > size)
+	{
+		ret = backend_header_write(object, offset + nbytes) && ret;
+	}
+
+end:
+	g_rw_lock_writer_unlock(lock);
+
+	if (bytes_written != NULL)
+	{
+		*bytes_written = nbytes;
+	}
+
+	return ret;
+}
+
+/**
+ * Parses a size with an optional K or M suffix.
+ */
+static guint64
+backend_parse_size(gchar const* str)
+{
+	gchar* end;
+	guint64 size;
+
+	size = g_ascii_strtoull(str, &end, 10);
+
+	switch (g_ascii_toupper(*end))
+	{
+		case 'M':
+			size *= 1024;
+			// fall through
+		case 'K':
+			size *= 1024;
+			break;
+		default:
+			break;
+	}
+
+	return size;
+}
+
+static gboolean
+backend_init(gchar const* path)
+{
+	g_auto(GStrv) split = NULL;
+	g_auto(GStrv) inner = NULL;
+
+	// The path has the format backend:path[;option,...]
+	split = g_strsplit(path, ";", 2);
+
+	if (split[0] == NULL)
+	{
+		return FALSE;
+	}
+
+	inner = g_strsplit(split[0], ":", 2);
+
+	if (inner[0] == NULL || inner[1] == NULL || g_strcmp0(inner[0], "compress") == 0)
+	{
+		g_critical("compress: Path %s does not specify a backend to compress.", path);
+		return FALSE;
+	}
+
+	if (split[1] != NULL)
+	{
+		g_auto(GStrv) options = NULL;
+
+		options = g_strsplit(split[1], ",", 0);
+
+		for (guint i = 0; options[i] != NULL; i++)
+		{
+			if (g_str_has_prefix(options[i], "chunk-size="))
+			{
+				guint64 chunk_size;
+
+				chunk_size = backend_parse_size(options[i] + strlen("chunk-size="));
+
+				// The chunk header has to fit into the slot padding
+				if (chunk_size < JD_BACKEND_HEADER_SIZE || chunk_size > 64 * 1024 * 1024)
+				{
+					g_warning("compress: Invalid chunk size %s, using the default.", options[i]);
+					continue;
+				}
+
+				jd_backend_chunk_size = chunk_size;
+			}
+			else if (g_str_has_prefix(options[i], "namespaces="))
+			{
+				g_strfreev(jd_backend_namespaces);
+				jd_backend_namespaces = g_strsplit(options[i] + strlen("namespaces="), "+", 0);
+			}
+			else
+			{
+				g_warning("compress: Unknown option %s.", options[i]);
+			}
+		}
+	}
+
+	if (!j_backend_load_server(inner[0], "server", J_BACKEND_TYPE_OBJECT, &jd_backend_inner_module, &jd_backend_inner) || jd_backend_inner == NULL)
+	{
+		g_critical("compress: Could not load object backend %s.", inner[0]);
+		return FALSE;
+	}
+
+	if (!j_backend_object_init(jd_backend_inner, inner[1]))
+	{
+		g_module_close(jd_backend_inner_module);
+		jd_backend_inner_module = NULL;
+		jd_backend_inner = NULL;
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+backend_fini(void)
+{
+	j_backend_object_fini(jd_backend_inner);
+	g_module_close(jd_backend_inner_module);
+
+	jd_backend_inner = NULL;
+	jd_backend_inner_module = NULL;
+
+	g_strfreev(jd_backend_namespaces);
+	jd_backend_namespaces = NULL;
+
+	jd_backend_chunk_size = JD_BACKEND_CHUNK_SIZE;
+}
+
+static JBackend compress_backend = {
+	.type = J_BACKEND_TYPE_OBJECT,
+	.component = J_BACKEND_COMPONENT_SERVER,
+	.object = {
+		.backend_init = backend_init,
+		.backend_fini = backend_fini,
+		.backend_create = backend_create,
+		.backend_delete = backend_delete,
+		.backend_open = backend_open,
+		.backend_close = backend_close,
+		.backend_delete_namespace = backend_delete_namespace,
+		.backend_status = backend_status,
+		.backend_sync = backend_sync,
+		.backend_read = backend_read,
+		.backend_write = backend_write }
+};
+
+G_MODULE_EXPORT
+JBackend*
+backend_info(void)
+{
+	return &compress_backend;
+}
@@ -0,0 +1,1493 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2019 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * An object backend that deduplicates data.
+ *
+ * Written data is split into content-defined chunks using FastCDC.
+ * Each unique chunk is stored once in an append-only pack file and identified by its SHA-256 hash.
+ * Objects are maps of extents that reference (parts of) chunks, which are kept in LMDB together with the chunk index.
+ * Chunks are reference-counted by extents, pack files are removed when none of their chunks are referenced anymore.
+ * Data appended by aborted transactions is truncated, pack files left without live data are removed when they stop being current and on startup.
+ **/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gmodule.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <lmdb.h>
+
+#include <julea.h>
+
+/**
+ * The minimum, average and maximum size of chunks.
+ */
+#define JD_BACKEND_CHUNK_MIN (4 * 1024)
+#define JD_BACKEND_CHUNK_AVG (16 * 1024)
+#define JD_BACKEND_CHUNK_MAX (64 * 1024)
+
+/**
+ * The masks used before and after reaching the average chunk size.
+ * They use two bits more and less than log2(JD_BACKEND_CHUNK_AVG), which normalizes the chunk size distribution.
+ */
+#define JD_BACKEND_MASK_SMALL (G_GUINT64_CONSTANT(0xffff) << 48)
+#define JD_BACKEND_MASK_LARGE (G_GUINT64_CONSTANT(0xfff) << 52)
+
+/**
+ * The size after which a new pack file is started.
+ */
+#define JD_BACKEND_PACK_SIZE (256 * 1024 * 1024)
+
+#define JD_BACKEND_HASH_SIZE 32
+
+struct JBackendObject
+{
+	gchar* key;
+};
+
+typedef struct JBackendObject JBackendObject;
+
+/**
+ * The metadata of an object, stored in the objects database.
+ */
+struct JBackendMeta
+{
+	guint64 size;
+	gint64 modification_time;
+};
+
+typedef struct JBackendMeta JBackendMeta;
+
+/**
+ * An extent of an object, stored in the extents database.
+ * The key is the object's key followed by a null byte and the big-endian offset, which sorts extents by offset.
+ */
+struct JBackendExtent
+{
+	guint32 length;
+
+	/**
+	 * The offset within the chunk.
+	 */
+	guint32 chunk_offset;
+
+	guchar hash[JD_BACKEND_HASH_SIZE];
+};
+
+typedef struct JBackendExtent JBackendExtent;
+
+/**
+ * The location of a chunk, stored in the chunks database under its hash.
+ */
+struct JBackendChunk
+{
+	guint32 pack;
+	guint32 length;
+	guint64 offset;
+	guint64 ref_count;
+};
+
+typedef struct JBackendChunk JBackendChunk;
+
+/**
+ * A chunk of the data being written.
+ */
+struct JBackendWriteChunk
+{
+	gchar const* data;
+	guint32 length;
+	guchar hash[JD_BACKEND_HASH_SIZE];
+};
+
+typedef struct JBackendWriteChunk JBackendWriteChunk;
+
+static gchar* jd_backend_path = NULL;
+
+static MDB_env* jd_backend_env = NULL;
+
+/**
+ * Maps object keys to JBackendMeta.
+ */
+static MDB_dbi jd_backend_objects;
+
+/**
+ * Maps object keys and offsets to JBackendExtent.
+ */
+static MDB_dbi jd_backend_extents;
+
+/**
+ * Maps hashes to JBackendChunk.
+ */
+static MDB_dbi jd_backend_chunks;
+
+/**
+ * Maps big-endian pack numbers to the number of referenced bytes.
+ */
+static MDB_dbi jd_backend_packs;
+
+/**
+ * The gear table of FastCDC.
+ */
+static guint64 jd_backend_gear[256];
+
+/**
+ * The pack file new chunks are appended to.
+ * Only modified while holding LMDB's write transaction or jd_backend_txn_mutex.
+ */
+static guint32 jd_backend_pack = 0;
+static gint jd_backend_pack_fd = -1;
+static guint64 jd_backend_pack_size = 0;
+
+/**
+ * The current pack file and its size when the write transaction began, used to undo appends of aborted transactions.
+ */
+static guint32 jd_backend_txn_pack = 0;
+static guint64 jd_backend_txn_pack_size = 0;
+
+/**
+ * Pack files that stopped being current during the write transaction.
+ * They are removed at the end of the transaction unless they contain live chunks.
+ */
+static GArray* jd_backend_retired_packs = NULL;
+
+/**
+ * Held for the duration of write transactions that might append to pack files, see backend_txn_begin().
+ * Aborted transactions have to undo their appends before the next transaction begins.
+ */
+static GMutex jd_backend_txn_mutex;
+
+/**
+ * File descriptors of pack files that are read from.
+ */
+static GHashTable* jd_backend_pack_fds = NULL;
+
+/**
+ * Readers hold a reader lock while reading from pack files, which are only removed while holding a writer lock.
+ */
+static GRWLock jd_backend_pack_lock;
+
+G_LOCK_DEFINE_STATIC(jd_backend_pack_fds);
+
+static void
+backend_gear_init(void)
+{
+	// The table has to be identical across restarts, so it is derived from a fixed seed using splitmix64
+	guint64 state = G_GUINT64_CONSTANT(0x4a554c4541);
+
+	for (guint i = 0; i < G_N_ELEMENTS(jd_backend_gear); i++)
+	{
+		guint64 z;
+
+		state += G_GUINT64_CONSTANT(0x9e3779b97f4a7c15);
+		z = state;
+		z = (z ^ (z >> 30)) * G_GUINT64_CONSTANT(0xbf58476d1ce4e5b9);
+		z = (z ^ (z >> 27)) * G_GUINT64_CONSTANT(0x94d049bb133111eb);
+		jd_backend_gear[i] = z ^ (z >> 31);
+	}
+}
+
+/**
+ * Returns the length of the next chunk using FastCDC.
+ * The gear hash only needs a shift, an addition and a table lookup per byte.
+ */
+static gsize
+backend_chunk_boundary(guchar const* data, gsize length)
+{
+	guint64 hash = 0;
+	gsize normal;
+	gsize max;
+	gsize i;
+
+	if (length <= JD_BACKEND_CHUNK_MIN)
+	{
+		return length;
+	}
+
+	normal = MIN(length, JD_BACKEND_CHUNK_AVG);
+	max = MIN(length, JD_BACKEND_CHUNK_MAX);
+
+	// Boundaries are not allowed before the minimum size, so it is skipped
+	for (i = JD_BACKEND_CHUNK_MIN; i < normal; i++)
+	{
+		hash = (hash << 1) + jd_backend_gear[data[i]];
+
+		if ((hash & JD_BACKEND_MASK_SMALL) == 0)
+		{
+			return i + 1;
+		}
+	}
+
+	for (; i < max; i++)
+	{
+		hash = (hash << 1) + jd_backend_gear[data[i]];
+
+		if ((hash & JD_BACKEND_MASK_LARGE) == 0)
+		{
+			return i + 1;
+		}
+	}
+
+	return max;
+}
+
+static GArray*
+backend_split(gconstpointer buffer, guint64 length)
+{
+	g_autoptr(GChecksum) checksum = NULL;
+	GArray* chunks;
+	guint64 done = 0;
+
+	chunks = g_array_new(FALSE, FALSE, sizeof(JBackendWriteChunk));
+	checksum = g_checksum_new(G_CHECKSUM_SHA256);
+
+	while (done < length)
+	{
+		JBackendWriteChunk chunk;
+		gsize hash_size = JD_BACKEND_HASH_SIZE;
+
+		chunk.data = (gchar const*)buffer + done;
+		chunk.length = backend_chunk_boundary((guchar const*)chunk.data, length - done);
+
+		g_checksum_reset(checksum);
+		g_checksum_update(checksum, (guchar const*)chunk.data, chunk.length);
+		g_checksum_get_digest(checksum, chunk.hash, &hash_size);
+
+		g_array_append_val(chunks, chunk);
+		done += chunk.length;
+	}
+
+	return chunks;
+}
+
+static gchar*
+backend_pack_path(guint32 pack)
+{
+	g_autofree gchar* name = NULL;
+
+	name = g_strdup_printf("%08x", pack);
+
+	return g_build_filename(jd_backend_path, "packs", name, NULL);
+}
+
+/**
+ * Returns a file descriptor for reading from a pack file.
+ * Must be called while holding a reader lock on jd_backend_pack_lock.
+ */
+static gint
+backend_pack_get_fd(guint32 pack)
+{
+	gpointer value;
+	gint fd;
+
+	G_LOCK(jd_backend_pack_fds);
+
+	if (g_hash_table_lookup_extended(jd_backend_pack_fds, GUINT_TO_POINTER(pack), NULL, &value))
+	{
+		fd = GPOINTER_TO_INT(value);
+	}
+	else
+	{
+		g_autofree gchar* path = NULL;
+
+		path = backend_pack_path(pack);
+
+		if ((fd = open(path, O_RDONLY)) != -1)
+		{
+			g_hash_table_insert(jd_backend_pack_fds, GUINT_TO_POINTER(pack), GINT_TO_POINTER(fd));
+		}
+	}
+
+	G_UNLOCK(jd_backend_pack_fds);
+
+	return fd;
+}
+
+static void
+backend_pack_remove(guint32 pack)
+{
+	g_autofree gchar* path = NULL;
+	gpointer value;
+
+	path = backend_pack_path(pack);
+
+	g_rw_lock_writer_lock(&jd_backend_pack_lock);
+
+	G_LOCK(jd_backend_pack_fds);
+
+	if (g_hash_table_lookup_extended(jd_backend_pack_fds, GUINT_TO_POINTER(pack), NULL, &value))
+	{
+		close(GPOINTER_TO_INT(value));
+		g_hash_table_remove(jd_backend_pack_fds, GUINT_TO_POINTER(pack));
+	}
+
+	G_UNLOCK(jd_backend_pack_fds);
+
+	g_unlink(path);
+
+	g_rw_lock_writer_unlock(&jd_backend_pack_lock);
+}
+
+/**
+ * Opens a new pack file for appending.
+ * Must be called while holding LMDB's write transaction.
+ */
+static gboolean
+backend_pack_next(void)
+{
+	g_autofree gchar* path = NULL;
+
+	if (jd_backend_pack_fd != -1)
+	{
+		// Pack files are synced when they are full, backend_sync() only syncs the current one
+		fdatasync(jd_backend_pack_fd);
+		close(jd_backend_pack_fd);
+		g_array_append_val(jd_backend_retired_packs, jd_backend_pack);
+		jd_backend_pack++;
+	}
+
+	path = backend_pack_path(jd_backend_pack);
+	jd_backend_pack_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	jd_backend_pack_size = 0;
+
+	return (jd_backend_pack_fd != -1);
+}
+
+static gboolean
+backend_pack_append(gchar const* data, guint32 length, guint32* pack, guint64* offset)
+{
+	guint64 nbytes = 0;
+
+	if (jd_backend_pack_fd == -1 || jd_backend_pack_size >= JD_BACKEND_PACK_SIZE)
+	{
+		if (!backend_pack_next())
+		{
+			return FALSE;
+		}
+	}
+
+	while (nbytes < length)
+	{
+		gssize ret;
+
+		ret = pwrite(jd_backend_pack_fd, data + nbytes, length - nbytes, jd_backend_pack_size + nbytes);
+
+		if (ret < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if (ret <= 0)
+		{
+			return FALSE;
+		}
+
+		nbytes += ret;
+	}
+
+	*pack = jd_backend_pack;
+	*offset = jd_backend_pack_size;
+
+	jd_backend_pack_size += length;
+
+	return TRUE;
+}
+
+/**
+ * Returns the number of referenced bytes in a pack file, 0 if it has no live chunks.
+ */
+static guint64
+backend_pack_live(MDB_txn* txn, guint32 pack)
+{
+	MDB_val key;
+	MDB_val value;
+	guint32 pack_be = GUINT32_TO_BE(pack);
+	guint64 live = 0;
+
+	key.mv_size = sizeof(pack_be);
+	key.mv_data = &pack_be;
+
+	if (mdb_get(txn, jd_backend_packs, &key, &value) == 0)
+	{
+		memcpy(&live, value.mv_data, sizeof(live));
+	}
+
+	return live;
+}
+
+static gboolean
+backend_pack_account(MDB_txn* txn, guint32 pack, gint64 delta, GArray* removed_packs)
+{
+	MDB_val key;
+	MDB_val value;
+	guint32 pack_be = GUINT32_TO_BE(pack);
+	guint64 live;
+
+	key.mv_size = sizeof(pack_be);
+	key.mv_data = &pack_be;
+
+	live = backend_pack_live(txn, pack) + delta;
+
+	// The current pack file is kept even if it is empty because new chunks are appended to it
+	// It is removed when it stops being current, see backend_txn_commit() and backend_txn_abort()
+	if (live == 0 && pack != jd_backend_pack)
+	{
+		g_array_append_val(removed_packs, pack);
+
+		return (mdb_del(txn, jd_backend_packs, &key, NULL) == 0);
+	}
+
+	value.mv_size = sizeof(live);
+	value.mv_data = &live;
+
+	return (mdb_put(txn, jd_backend_packs, &key, &value, 0) == 0);
+}
+
+/**
+ * Adds a reference to a chunk, storing it if it is new.
+ */
+static gboolean
+backend_chunk_ref(MDB_txn* txn, guchar const* hash, gchar const* data, guint32 length)
+{
+	JBackendChunk chunk;
+	MDB_val key;
+	MDB_val value;
+
+	key.mv_size = JD_BACKEND_HASH_SIZE;
+	key.mv_data = (gpointer)(guintptr)hash;
+
+	if (mdb_get(txn, jd_backend_chunks, &key, &value) == 0)
+	{
+		memcpy(&chunk, value.mv_data, sizeof(chunk));
+		chunk.ref_count++;
+	}
+	else
+	{
+		g_return_val_if_fail(data != NULL, FALSE);
+
+		if (!backend_pack_append(data, length, &(chunk.pack), &(chunk.offset)))
+		{
+			return FALSE;
+		}
+
+		chunk.length = length;
+		chunk.ref_count = 1;
+
+		// Adding references never removes pack files
+		if (!backend_pack_account(txn, chunk.pack, length, NULL))
+		{
+			return FALSE;
+		}
+	}
+
+	value.mv_size = sizeof(chunk);
+	value.mv_data = &chunk;
+
+	return (mdb_put(txn, jd_backend_chunks, &key, &value, 0) == 0);
+}
+
+/**
+ * Removes a reference to a chunk, removing it if it is not referenced anymore.
+ */
+static gboolean
+backend_chunk_unref(MDB_txn* txn, guchar const* hash, GArray* removed_packs)
+{
+	JBackendChunk chunk;
+	MDB_val key;
+	MDB_val value;
+
+	key.mv_size = JD_BACKEND_HASH_SIZE;
+	key.mv_data = (gpointer)(guintptr)hash;
+
+	if (mdb_get(txn, jd_backend_chunks, &key, &value) != 0)
+	{
+		return FALSE;
+	}
+
+	memcpy(&chunk, value.mv_data, sizeof(chunk));
+	chunk.ref_count--;
+
+	if (chunk.ref_count == 0)
+	{
+		return (mdb_del(txn, jd_backend_chunks, &key, NULL) == 0)
+		       && backend_pack_account(txn, chunk.pack, -(gint64)chunk.length, removed_packs);
+	}
+
+	value.mv_size = sizeof(chunk);
+	value.mv_data = &chunk;
+
+	return (mdb_put(txn, jd_backend_chunks, &key, &value, 0) == 0);
+}
+
+static gchar*
+backend_extent_key(JBackendObject* object, guint64 offset, gsize* length)
+{
+	gsize key_length = strlen(object->key) + 1;
+	guint64 offset_be = GUINT64_TO_BE(offset);
+	gchar* key;
+
+	key = g_malloc(key_length + sizeof(offset_be));
+	memcpy(key, object->key, key_length);
+	memcpy(key + key_length, &offset_be, sizeof(offset_be));
+
+	*length = key_length + sizeof(offset_be);
+
+	return key;
+}
+
+/**
+ * Returns the offset of an extent if it belongs to the object.
+ */
+static gboolean
+backend_extent_offset(JBackendObject* object, MDB_val const* key, guint64* offset)
+{
+	gsize key_length = strlen(object->key) + 1;
+	guint64 offset_be;
+
+	if (key->mv_size != key_length + sizeof(offset_be) || memcmp(key->mv_data, object->key, key_length) != 0)
+	{
+		return FALSE;
+	}
+
+	memcpy(&offset_be, (gchar const*)key->mv_data + key_length, sizeof(offset_be));
+	*offset = GUINT64_FROM_BE(offset_be);
+
+	return TRUE;
+}
+
+static gboolean
+backend_extent_put(MDB_txn* txn, JBackendObject* object, guint64 offset, JBackendExtent const* extent)
+{
+	g_autofree gchar* extent_key = NULL;
+	MDB_val key;
+	MDB_val value;
+
+	extent_key = backend_extent_key(object, offset, &(key.mv_size));
+	key.mv_data = extent_key;
+	value.mv_size = sizeof(*extent);
+	value.mv_data = (gpointer)(guintptr)extent;
+
+	return (mdb_put(txn, jd_backend_extents, &key, &value, 0) == 0);
+}
+
+/**
+ * Positions a cursor at the first extent that overlaps offset.
+ *
+ * \return Whether such an extent exists.
+ */
+static gboolean
+backend_extent_seek(MDB_cursor* cursor, JBackendObject* object, guint64 offset, MDB_val* key, MDB_val* value)
+{
+	g_autofree gchar* extent_key = NULL;
+	guint64 extent_offset;
+	gint ret;
+
+	extent_key = backend_extent_key(object, offset, &(key->mv_size));
+	key->mv_data = extent_key;
+
+	ret = mdb_cursor_get(cursor, key, value, MDB_SET_RANGE);
+
+	if (ret == 0 && backend_extent_offset(object, key, &extent_offset) && extent_offset == offset)
+	{
+		return TRUE;
+	}
+
+	// The previous extent might start before offset and overlap it
+	if (mdb_cursor_get(cursor, key, value, (ret == 0) ? MDB_PREV : MDB_LAST) == 0 && backend_extent_offset(object, key, &extent_offset))
+	{
+		JBackendExtent const* extent = value->mv_data;
+
+		if (extent_offset + extent->length > offset)
+		{
+			return TRUE;
+		}
+	}
+
+	return (mdb_cursor_get(cursor, key, value, MDB_NEXT) == 0 && backend_extent_offset(object, key, &extent_offset));
+}
+
+/**
+ * Removes the extents in [offset, offset + length), keeping the parts outside of it.
+ */
+static gboolean
+backend_extents_punch(MDB_txn* txn, JBackendObject* object, guint64 offset, guint64 length, GArray* removed_packs)
+{
+	g_autoptr(GArray) offsets = NULL;
+	g_autoptr(GArray) extents = NULL;
+	MDB_cursor* cursor;
+	MDB_val key;
+	MDB_val value;
+	guint64 end = offset + length;
+	gboolean ret = TRUE;
+
+	offsets = g_array_new(FALSE, FALSE, sizeof(guint64));
+	extents = g_array_new(FALSE, FALSE, sizeof(JBackendExtent));
+
+	if (mdb_cursor_open(txn, jd_backend_extents, &cursor) != 0)
+	{
+		return FALSE;
+	}
+
+	if (backend_extent_seek(cursor, object, offset, &key, &value))
+	{
+		do
+		{
+			guint64 extent_offset;
+
+			if (!backend_extent_offset(object, &key, &extent_offset) || extent_offset >= end)
+			{
+				break;
+			}
+
+			g_array_append_val(offsets, extent_offset);
+			g_array_append_vals(extents, value.mv_data, 1);
+		} while (mdb_cursor_get(cursor, &key, &value, MDB_NEXT) == 0);
+	}
+
+	mdb_cursor_close(cursor);
+
+	for (guint i = 0; i < offsets->len && ret; i++)
+	{
+		guint64 extent_offset = g_array_index(offsets, guint64, i);
+		JBackendExtent* extent = &g_array_index(extents, JBackendExtent, i);
+		guint64 extent_end = extent_offset + extent->length;
+		g_autofree gchar* extent_key = NULL;
+		gboolean head = (extent_offset < offset);
+		gboolean tail = (extent_end > end);
+
+		extent_key = backend_extent_key(object, extent_offset, &(key.mv_size));
+		key.mv_data = extent_key;
+
+		ret = (mdb_del(txn, jd_backend_extents, &key, NULL) == 0);
+
+		if (ret && head)
+		{
+			JBackendExtent head_extent = *extent;
+
+			head_extent.length = offset - extent_offset;
+			ret = backend_extent_put(txn, object, extent_offset, &head_extent);
+		}
+
+		if (ret && tail)
+		{
+			JBackendExtent tail_extent = *extent;
+
+			tail_extent.length = extent_end - end;
+			tail_extent.chunk_offset += end - extent_offset;
+			ret = backend_extent_put(txn, object, end, &tail_extent);
+		}
+
+		// The head keeps the extent's reference, the tail needs another one
+		if (ret && head && tail)
+		{
+			ret = backend_chunk_ref(txn, extent->hash, NULL, 0);
+		}
+		else if (ret && !head && !tail)
+		{
+			ret = backend_chunk_unref(txn, extent->hash, removed_packs);
+		}
+	}
+
+	return ret;
+}
+
+static gboolean
+backend_meta_get(MDB_txn* txn, JBackendObject* object, JBackendMeta* meta)
+{
+	MDB_val key;
+	MDB_val value;
+
+	key.mv_size = strlen(object->key) + 1;
+	key.mv_data = object->key;
+
+	if (mdb_get(txn, jd_backend_objects, &key, &value) != 0)
+	{
+		return FALSE;
+	}
+
+	memcpy(meta, value.mv_data, sizeof(*meta));
+
+	return TRUE;
+}
+
+static gboolean
+backend_meta_put(MDB_txn* txn, JBackendObject* object, JBackendMeta const* meta)
+{
+	MDB_val key;
+	MDB_val value;
+
+	key.mv_size = strlen(object->key) + 1;
+	key.mv_data = object->key;
+	value.mv_size = sizeof(*meta);
+	value.mv_data = (gpointer)(guintptr)meta;
+
+	return (mdb_put(txn, jd_backend_objects, &key, &value, 0) == 0);
+}
+
+/**
+ * Begins a write transaction that might append to pack files.
+ */
+static gboolean
+backend_txn_begin(MDB_txn** txn)
+{
+	g_mutex_lock(&jd_backend_txn_mutex);
+
+	if (mdb_txn_begin(jd_backend_env, NULL, 0, txn) != 0)
+	{
+		g_mutex_unlock(&jd_backend_txn_mutex);
+		return FALSE;
+	}
+
+	jd_backend_txn_pack = jd_backend_pack;
+	jd_backend_txn_pack_size = jd_backend_pack_size;
+	g_array_set_size(jd_backend_retired_packs, 0);
+
+	return TRUE;
+}
+
+/**
+ * Discards the data appended to pack files by a write transaction that has been aborted.
+ * Must be called while holding jd_backend_txn_mutex.
+ */
+static void
+backend_txn_rollback(void)
+{
+	MDB_txn* txn;
+	gboolean synced = FALSE;
+
+	if (jd_backend_pack_fd != -1)
+	{
+		jd_backend_pack_size = (jd_backend_pack == jd_backend_txn_pack) ? jd_backend_txn_pack_size : 0;
+
+		if (ftruncate(jd_backend_pack_fd, jd_backend_pack_size) != 0)
+		{
+			g_warning("dedup: Could not truncate pack file %08x.", jd_backend_pack);
+		}
+	}
+
+	if (jd_backend_retired_packs->len == 0 || mdb_txn_begin(jd_backend_env, NULL, MDB_RDONLY, &txn) != 0)
+	{
+		return;
+	}
+
+	for (guint i = 0; i < jd_backend_retired_packs->len; i++)
+	{
+		guint32 pack = g_array_index(jd_backend_retired_packs, guint32, i);
+
+		if (backend_pack_live(txn, pack) == 0)
+		{
+			// The committed state might not be persistent yet, see backend_txn_commit()
+			if (!synced && !(synced = (mdb_env_sync(jd_backend_env, 1) == 0)))
+			{
+				continue;
+			}
+
+			// Leftover entries without live data are removed by backend_packs_collect()
+			backend_pack_remove(pack);
+		}
+		else if (pack == jd_backend_txn_pack)
+		{
+			g_autofree gchar* path = NULL;
+
+			// Readers only access committed chunks, which are located before the appended data
+			path = backend_pack_path(pack);
+
+			if (truncate(path, jd_backend_txn_pack_size) != 0)
+			{
+				g_warning("dedup: Could not truncate pack file %08x.", pack);
+			}
+		}
+	}
+
+	mdb_txn_abort(txn);
+}
+
+static void
+backend_txn_abort(MDB_txn* txn)
+{
+	mdb_txn_abort(txn);
+	backend_txn_rollback();
+
+	g_mutex_unlock(&jd_backend_txn_mutex);
+}
+
+/**
+ * Commits a write transaction and removes pack files that are not referenced anymore.
+ */
+static gboolean
+backend_txn_commit(MDB_txn* txn, GArray* removed_packs)
+{
+	// Pack files whose chunks were all released while they were current are removed once they are retired
+	for (guint i = 0; i < jd_backend_retired_packs->len; i++)
+	{
+		guint32 pack = g_array_index(jd_backend_retired_packs, guint32, i);
+		guint32 pack_be = GUINT32_TO_BE(pack);
+		MDB_val key;
+		gint ret;
+
+		if (backend_pack_live(txn, pack) > 0)
+		{
+			continue;
+		}
+
+		key.mv_size = sizeof(pack_be);
+		key.mv_data = &pack_be;
+
+		if ((ret = mdb_del(txn, jd_backend_packs, &key, NULL)) != 0 && ret != MDB_NOTFOUND)
+		{
+			backend_txn_abort(txn);
+			return FALSE;
+		}
+
+		g_array_append_val(removed_packs, pack);
+	}
+
+	if (mdb_txn_commit(txn) != 0)
+	{
+		// The transaction has been aborted
+		backend_txn_rollback();
+		g_mutex_unlock(&jd_backend_txn_mutex);
+
+		return FALSE;
+	}
+
+	g_mutex_unlock(&jd_backend_txn_mutex);
+
+	if (removed_packs->len == 0)
+	{
+		return TRUE;
+	}
+
+	// The environment is opened with MDB_NOSYNC, the index must not reference the pack files anymore after a crash
+	if (mdb_env_sync(jd_backend_env, 1) != 0)
+	{
+		// The pack files are removed by backend_packs_collect() on the next start
+		g_warning("dedup: Could not sync index, keeping %u unreferenced pack files.", removed_packs->len);
+		return TRUE;
+	}
+
+	for (guint i = 0; i < removed_packs->len; i++)
+	{
+		backend_pack_remove(g_array_index(removed_packs, guint32, i));
+	}
+
+	return TRUE;
+}
+
+/**
+ * Removes pack files without live chunks, which are left over from crashes or from pack files that were current when the server stopped.
+ * Must be called before the current pack file is chosen.
+ */
+static gboolean
+backend_packs_collect(MDB_txn* txn, gchar const* packs_path)
+{
+	g_autoptr(GDir) dir = NULL;
+	gchar const* entry;
+
+	if ((dir = g_dir_open(packs_path, 0, NULL)) == NULL)
+	{
+		return FALSE;
+	}
+
+	while ((entry = g_dir_read_name(dir)) != NULL)
+	{
+		g_autofree gchar* path = NULL;
+		guint32 pack;
+		guint32 pack_be;
+		MDB_val key;
+		gchar* end;
+		gint ret;
+
+		pack = g_ascii_strtoull(entry, &end, 16);
+
+		if (*end != '\0' || backend_pack_live(txn, pack) > 0)
+		{
+			continue;
+		}
+
+		pack_be = GUINT32_TO_BE(pack);
+		key.mv_size = sizeof(pack_be);
+		key.mv_data = &pack_be;
+
+		if ((ret = mdb_del(txn, jd_backend_packs, &key, NULL)) != 0 && ret != MDB_NOTFOUND)
+		{
+			return FALSE;
+		}
+
+		path = g_build_filename(packs_path, entry, NULL);
+		g_unlink(path);
+	}
+
+	return TRUE;
+}
+
+static JBackendObject*
+backend_object_new(gchar const* namespace, gchar const* path)
+{
+	JBackendObject* object;
+
+	object = g_slice_new(JBackendObject);
+	object->key = g_build_path("/", namespace, path, NULL);
+
+	return object;
+}
+
+static void
+backend_object_free(JBackendObject* object)
+{
+	g_free(object->key);
+	g_slice_free(JBackendObject, object);
+}
+
+static gboolean
+backend_create(gchar const* namespace, gchar const* path, gpointer* data)
+{
+	JBackendObject* object;
+	JBackendMeta meta;
+	MDB_txn* txn;
+	gboolean ret = TRUE;
+
+	object = backend_object_new(namespace, path);
+
+	j_trace_file_begin(object->key, J_TRACE_FILE_CREATE);
+
+	if (mdb_txn_begin(jd_backend_env, NULL, 0, &txn) != 0)
+	{
+		ret = FALSE;
+	}
+	else if (!backend_meta_get(txn, object, &meta))
+	{
+		meta.size = 0;
+		meta.modification_time = g_get_real_time();
+
+		ret = backend_meta_put(txn, object, &meta) && (mdb_txn_commit(txn) == 0);
+	}
+	else
+	{
+		mdb_txn_abort(txn);
+	}
+
+	j_trace_file_end(object->key, J_TRACE_FILE_CREATE, 0, 0);
+
+	if (!ret)
+	{
+		backend_object_free(object);
+		object = NULL;
+	}
+
+	*data = object;
+
+	return ret;
+}
+
+static gboolean
+backend_open(gchar const* namespace, gchar const* path, gpointer* data)
+{
+	JBackendObject* object;
+	JBackendMeta meta;
+	MDB_txn* txn;
+	gboolean ret = FALSE;
+
+	object = backend_object_new(namespace, path);
+
+	j_trace_file_begin(object->key, J_TRACE_FILE_OPEN);
+
+	if (mdb_txn_begin(jd_backend_env, NULL, MDB_RDONLY, &txn) == 0)
+	{
+		ret = backend_meta_get(txn, object, &meta);
+		mdb_txn_abort(txn);
+	}
+
+	j_trace_file_end(object->key, J_TRACE_FILE_OPEN, 0, 0);
+
+	if (!ret)
+	{
+		backend_object_free(object);
+		object = NULL;
+	}
+
+	*data = object;
+
+	return ret;
+}
+
+static gboolean
+backend_delete(gpointer data)
+{
+	JBackendObject* object = data;
+
+	g_autoptr(GArray) removed_packs = NULL;
+	JBackendMeta meta;
+	MDB_txn* txn;
+	MDB_val key;
+	gboolean ret;
+
+	j_trace_file_begin(object->key, J_TRACE_FILE_DELETE);
+
+	removed_packs = g_array_new(FALSE, FALSE, sizeof(guint32));
+
+	if (!backend_txn_begin(&txn))
+	{
+		ret = FALSE;
+		goto end;
+	}
+
+	ret = backend_meta_get(txn, object, &meta) && backend_extents_punch(txn, object, 0, meta.size, removed_packs);
+
+	key.mv_size = strlen(object->key) + 1;
+	key.mv_data = object->key;
+
+	ret = ret && (mdb_del(txn, jd_backend_objects, &key, NULL) == 0);
+
+	if (ret)
+	{
+		ret = backend_txn_commit(txn, removed_packs);
+	}
+	else
+	{
+		backend_txn_abort(txn);
+	}
+
+end:
+	j_trace_file_end(object->key, J_TRACE_FILE_DELETE, 0, 0);
+
+	backend_object_free(object);
+
+	return ret;
+}
+
+static gboolean
+backend_close(gpointer data)
+{
+	JBackendObject* object = data;
+
+	j_trace_file_begin(object->key, J_TRACE_FILE_CLOSE);
+	j_trace_file_end(object->key, J_TRACE_FILE_CLOSE, 0, 0);
+
+	backend_object_free(object);
+
+	return TRUE;
+}
+
+static gboolean
+backend_status(gpointer data, gint64* modification_time, guint64* size)
+{
+	JBackendObject* object = data;
+	JBackendMeta meta;
+	MDB_txn* txn;
+	gboolean ret = FALSE;
+
+	j_trace_file_begin(object->key, J_TRACE_FILE_STATUS);
+
+	if (mdb_txn_begin(jd_backend_env, NULL, MDB_RDONLY, &txn) == 0)
+	{
+		ret = backend_meta_get(txn, object, &meta);
+		mdb_txn_abort(txn);
+	}
+
+	j_trace_file_end(object->key, J_TRACE_FILE_STATUS, 0, 0);
+
+	if (ret)
+	{
+		if (modification_time != NULL)
+		{
+			*modification_time = meta.modification_time;
+		}
+
+		if (size != NULL)
+		{
+			*size = meta.size;
+		}
+	}
+
+	return ret;
+}
+
+static gboolean
+backend_sync(gpointer data)
+{
+	JBackendObject* object = data;
+	MDB_txn* txn;
+	gboolean ret = TRUE;
+
+	j_trace_file_begin(object->key, J_TRACE_FILE_SYNC);
+
+	// Holding the write transaction prevents switching the pack file
+	if (mdb_txn_begin(jd_backend_env, NULL, 0, &txn) == 0)
+	{
+		if (jd_backend_pack_fd != -1)
+		{
+			ret = (fdatasync(jd_backend_pack_fd) == 0);
+		}
+
+		mdb_txn_abort(txn);
+	}
+
+	// Chunks have to be persistent before the extents referencing them
+	ret = ret && (mdb_env_sync(jd_backend_env, 1) == 0);
+
+	j_trace_file_end(object->key, J_TRACE_FILE_SYNC, 0, 0);
+
+	return ret;
+}
+
+static gboolean
+backend_read(gpointer data, gpointer buffer, guint64 length, guint64 offset, guint64* bytes_read)
+{
+	JBackendObject* object = data;
+	JBackendMeta meta;
+	MDB_txn* txn = NULL;
+	MDB_cursor* cursor = NULL;
+	MDB_val key;
+	MDB_val value;
+	gboolean ret = FALSE;
+	guint64 end;
+
+	j_trace_file_begin(object->key, J_TRACE_FILE_READ);
+
+	g_rw_lock_reader_lock(&jd_backend_pack_lock);
+
+	if (mdb_txn_begin(jd_backend_env, NULL, MDB_RDONLY, &txn) != 0)
+	{
+		txn = NULL;
+		length = 0;
+		goto end;
+	}
+
+	if (!backend_meta_get(txn, object, &meta) || mdb_cursor_open(txn, jd_backend_extents, &cursor) != 0)
+	{
+		length = 0;
+		goto end;
+	}
+
+	// Reads beyond the end of the object are short, holes contain zeroes
+	length = (offset < meta.size) ? MIN(length, meta.size - offset) : 0;
+	end = offset + length;
+	memset(buffer, 0, length);
+	ret = TRUE;
+
+	if (length > 0 && backend_extent_seek(cursor, object, offset, &key, &value))
+	{
+		do
+		{
+			JBackendExtent const* extent = value.mv_data;
+			JBackendChunk chunk;
+			MDB_val chunk_key;
+			MDB_val chunk_value;
+			guint64 extent_offset;
+			guint64 from;
+			guint64 to;
+			gint fd;
+
+			if (!backend_extent_offset(object, &key, &extent_offset) || extent_offset >= end)
+			{
+				break;
+			}
+
+			chunk_key.mv_size = JD_BACKEND_HASH_SIZE;
+			chunk_key.mv_data = (gpointer)(guintptr)extent->hash;
+
+			if (mdb_get(txn, jd_backend_chunks, &chunk_key, &chunk_value) != 0)
+			{
+				ret = FALSE;
+				break;
+			}
+
+			memcpy(&chunk, chunk_value.mv_data, sizeof(chunk));
+
+			from = MAX(offset, extent_offset);
+			to = MIN(end, extent_offset + extent->length);
+
+			if ((fd = backend_pack_get_fd(chunk.pack)) == -1)
+			{
+				ret = FALSE;
+				break;
+			}
+
+			for (guint64 done = 0; done < to - from;)
+			{
+				gssize nbytes;
+
+				nbytes = pread(fd, (gchar*)buffer + (from - offset) + done, (to - from) - done, chunk.offset + extent->chunk_offset + (from - extent_offset) + done);
+
+				if (nbytes < 0 && errno == EINTR)
+				{
+					continue;
+				}
+
+				if (nbytes <= 0)
+				{
+					ret = FALSE;
+					break;
+				}
+
+				done += nbytes;
+			}
+		} while (ret && mdb_cursor_get(cursor, &key, &value, MDB_NEXT) == 0);
+	}
+
+end:
+	if (cursor != NULL)
+	{
+		mdb_cursor_close(cursor);
+	}
+
+	if (txn != NULL)
+	{
+		mdb_txn_abort(txn);
+	}
+
+	g_rw_lock_reader_unlock(&jd_backend_pack_lock);
+
+	j_trace_file_end(object->key, J_TRACE_FILE_READ, length, offset);
+
+	if (bytes_read != NULL)
+	{
+		*bytes_read = (ret) ? length : 0;
+	}
+
+	return ret;
+}
+
+static gboolean
+backend_write(gpointer data, gconstpointer buffer, guint64 length, guint64 offset, guint64* bytes_written)
+{
+	JBackendObject* object = data;
+
+	g_autoptr(GArray) chunks = NULL;
+	g_autoptr(GArray) removed_packs = NULL;
+	JBackendMeta meta;
+	MDB_txn* txn;
+	gboolean ret;
+	guint64 position = offset;
+
+	j_trace_file_begin(object->key, J_TRACE_FILE_WRITE);
+
+	// Chunking and hashing do not require the write transaction
+	chunks = backend_split(buffer, length);
+	removed_packs = g_array_new(FALSE, FALSE, sizeof(guint32));
+
+	if (!backend_txn_begin(&txn))
+	{
+		ret = FALSE;
+		goto end;
+	}
+
+	ret = backend_meta_get(txn, object, &meta);
+
+	// New chunks are referenced before old ones are released, which keeps chunks that are written again
+	for (guint i = 0; i < chunks->len && ret; i++)
+	{
+		JBackendWriteChunk* chunk = &g_array_index(chunks, JBackendWriteChunk, i);
+
+		ret = backend_chunk_ref(txn, chunk->hash, chunk->data, chunk->length);
+	}
+
+	ret = ret && backend_extents_punch(txn, object, offset, length, removed_packs);
+
+	for (guint i = 0; i < chunks->len && ret; i++)
+	{
+		JBackendWriteChunk* chunk = &g_array_index(chunks, JBackendWriteChunk, i);
+		JBackendExtent extent;
+
+		extent.length = chunk->length;
+		extent.chunk_offset = 0;
+		memcpy(extent.hash, chunk->hash, JD_BACKEND_HASH_SIZE);
+
+		ret = backend_extent_put(txn, object, position, &extent);
+		position += chunk->length;
+	}
+
+	if (ret)
+	{
+		meta.size = MAX(meta.size, offset + length);
+		meta.modification_time = g_get_real_time();
+
+		ret = backend_meta_put(txn, object, &meta);
+	}
+
+	if (ret)
+	{
+		ret = backend_txn_commit(txn, removed_packs);
+	}
+	else
+	{
+		backend_txn_abort(txn);
+	}
+
+end:
+	j_trace_file_end(object->key, J_TRACE_FILE_WRITE, (ret) ? length : 0, offset);
+
+	if (bytes_written != NULL)
+	{
+		*bytes_written = (ret) ? length : 0;
+	}
+
+	return ret;
+}
+
+static gboolean
+backend_init(gchar const* path)
+{
+	g_autofree gchar* index_path = NULL;
+	g_autofree gchar* packs_path = NULL;
+	MDB_txn* txn;
+	MDB_cursor* cursor;
+	MDB_val key;
+	MDB_val value;
+
+	jd_backend_path = g_strdup(path);
+	index_path = g_build_filename(jd_backend_path, "index", NULL);
+	packs_path = g_build_filename(jd_backend_path, "packs", NULL);
+
+	g_mkdir_with_parents(index_path, 0700);
+	g_mkdir_with_parents(packs_path, 0700);
+
+	backend_gear_init();
+
+	if (mdb_env_create(&jd_backend_env) != 0)
+	{
+		goto error;
+	}
+
+	// backend_sync() syncs the pack file before the index
+	if (mdb_env_set_mapsize(jd_backend_env, (gsize)16 * 1024 * 1024 * 1024) != 0
+	    || mdb_env_set_maxdbs(jd_backend_env, 4) != 0
+	    || mdb_env_open(jd_backend_env, index_path, MDB_NOSYNC, 0600) != 0)
+	{
+		goto error;
+	}
+
+	if (mdb_txn_begin(jd_backend_env, NULL, 0, &txn) != 0)
+	{
+		goto error;
+	}
+
+	if (mdb_dbi_open(txn, "objects", MDB_CREATE, &jd_backend_objects) != 0
+	    || mdb_dbi_open(txn, "extents", MDB_CREATE, &jd_backend_extents) != 0
+	    || mdb_dbi_open(txn, "chunks", MDB_CREATE, &jd_backend_chunks) != 0
+	    || mdb_dbi_open(txn, "packs", MDB_CREATE, &jd_backend_packs) != 0
+	    || !backend_packs_collect(txn, packs_path))
+	{
+		mdb_txn_abort(txn);
+		goto error;
+	}
+
+	// Start a new pack file after the last one
+	jd_backend_pack = 0;
+
+	if (mdb_cursor_open(txn, jd_backend_packs, &cursor) == 0)
+	{
+		if (mdb_cursor_get(cursor, &key, &value, MDB_LAST) == 0)
+		{
+			guint32 pack_be;
+
+			memcpy(&pack_be, key.mv_data, sizeof(pack_be));
+			jd_backend_pack = GUINT32_FROM_BE(pack_be) + 1;
+		}
+
+		mdb_cursor_close(cursor);
+	}
+
+	if (mdb_txn_commit(txn) != 0)
+	{
+		goto error;
+	}
+
+	jd_backend_pack_fds = g_hash_table_new(NULL, NULL);
+	jd_backend_retired_packs = g_array_new(FALSE, FALSE, sizeof(guint32));
+
+	return TRUE;
+
+error:
+	if (jd_backend_env != NULL)
+	{
+		mdb_env_close(jd_backend_env);
+		jd_backend_env = NULL;
+	}
+
+	g_free(jd_backend_path);
+	jd_backend_path = NULL;
+
+	return FALSE;
+}
+
+static void
+backend_fini(void)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	g_hash_table_iter_init(&iter, jd_backend_pack_fds);
+
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		close(GPOINTER_TO_INT(value));
+	}
+
+	g_hash_table_destroy(jd_backend_pack_fds);
+	g_array_unref(jd_backend_retired_packs);
+	jd_backend_retired_packs = NULL;
+
+	if (jd_backend_pack_fd != -1)
+	{
+		fdatasync(jd_backend_pack_fd);
+		close(jd_backend_pack_fd);
+		jd_backend_pack_fd = -1;
+	}
+
+	mdb_env_sync(jd_backend_env, 1);
+	mdb_env_close(jd_backend_env);
+	jd_backend_env = NULL;
+
+	g_free(jd_backend_path);
+	jd_backend_path = NULL;
+}
+
+static JBackend dedup_backend = {
+	.type = J_BACKEND_TYPE_OBJECT,
+	.component = J_BACKEND_COMPONENT_SERVER,
+	.object = {
+		.backend_init = backend_init,
+		.backend_fini = backend_fini,
+		.backend_create = backend_create,
+		.backend_delete = backend_delete,
+		.backend_open = backend_open,
+		.backend_close = backend_close,
+		.backend_status = backend_status,
+		.backend_sync = backend_sync,
+		.backend_read = backend_read,
+		.backend_write = backend_write }
+};
+
+G_MODULE_EXPORT
+JBackend*
+backend_info(void)
+{
+	return &dedup_backend;
+}
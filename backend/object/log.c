@@ -0,0 +1,1475 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2019 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * A log-structured object backend for small objects.
+ *
+ * Objects are appended to segment files (path/segments/xxxxxxxx) and located using an in-memory index.
+ * Every change to the index is appended to an index log (path/index), which is replayed on startup.
+ * Writes never modify data in place; instead, the complete object is appended again.
+ * A background thread compacts segments that mostly contain stale data.
+ * Objects that grow beyond a threshold are moved to individual files (path/large/namespace/name).
+ **/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gmodule.h>
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <julea.h>
+
+/**
+ * The default size at which objects are moved to individual files.
+ * Can be changed with the threshold option in the path (/path/to/storage:threshold=65536).
+ */
+#define JD_BACKEND_THRESHOLD (64 * 1024)
+
+/**
+ * The default size at which a new segment is started.
+ * Can be changed with the segment-size option in the path (/path/to/storage:segment-size=67108864).
+ */
+#define JD_BACKEND_SEGMENT_SIZE (64 * 1024 * 1024)
+
+/**
+ * Segments with less live data than this percentage are compacted.
+ */
+#define JD_BACKEND_COMPACTION_RATIO 50
+
+/**
+ * The interval in which the compaction thread checks for work even if it has not been woken up.
+ */
+#define JD_BACKEND_COMPACTION_INTERVAL (60 * G_TIME_SPAN_SECOND)
+
+enum JBackendRecordType
+{
+	/**
+	 * The object's data is stored in a segment.
+	 * The segment is 0 for empty objects.
+	 */
+	JD_BACKEND_RECORD_PUT = 1,
+	JD_BACKEND_RECORD_DELETE,
+	/**
+	 * The object's data is stored in an individual file.
+	 */
+	JD_BACKEND_RECORD_LARGE
+};
+
+/**
+ * A record in the index log, followed by the key.
+ *
+ * Records are stored in host byte order.
+ */
+struct JBackendRecord
+{
+	guint32 type;
+	guint32 key_length;
+	guint32 segment;
+	guint32 reserved;
+	guint64 offset;
+	guint64 length;
+	gint64 modification_time;
+};
+
+typedef struct JBackendRecord JBackendRecord;
+
+struct JBackendSegment
+{
+	guint32 id;
+	gint fd;
+
+	/**
+	 * The number of bytes appended to the segment.
+	 */
+	guint64 size;
+
+	/**
+	 * The number of bytes still referenced by the index.
+	 */
+	guint64 live;
+};
+
+typedef struct JBackendSegment JBackendSegment;
+
+struct JBackendEntry
+{
+	guint32 segment;
+	guint64 offset;
+	guint64 length;
+	gint64 modification_time;
+
+	/**
+	 * Whether the object is stored in an individual file.
+	 */
+	gboolean large;
+
+	/**
+	 * The individual file's descriptor, -1 if it has not been opened yet.
+	 */
+	gint large_fd;
+};
+
+typedef struct JBackendEntry JBackendEntry;
+
+struct JBackendObject
+{
+	gchar* key;
+};
+
+typedef struct JBackendObject JBackendObject;
+
+static gchar* jd_backend_path = NULL;
+
+static guint64 jd_backend_threshold = JD_BACKEND_THRESHOLD;
+static guint64 jd_backend_segment_size = JD_BACKEND_SEGMENT_SIZE;
+
+/**
+ * Maps namespace/name to JBackendEntry.
+ */
+static GHashTable* jd_backend_index = NULL;
+
+/**
+ * Maps segment IDs to JBackendSegment.
+ */
+static GHashTable* jd_backend_segments = NULL;
+
+/**
+ * The segment new data is appended to.
+ */
+static JBackendSegment* jd_backend_active = NULL;
+
+/**
+ * The ID of the next segment.
+ */
+static guint32 jd_backend_next_segment = 1;
+
+static gint jd_backend_index_fd = -1;
+static guint64 jd_backend_index_size = 0;
+
+/**
+ * The number of records appended since the index log was last rewritten.
+ */
+static guint64 jd_backend_index_records = 0;
+
+/**
+ * Protects the index, the segments and the index log.
+ * Reads and writes to individual files only require a reader lock because segment data is never modified in place.
+ * Segments are only removed by the compaction thread, which can therefore access them without holding the lock.
+ */
+static GRWLock jd_backend_lock;
+
+static GThread* jd_backend_compaction_thread = NULL;
+static GMutex jd_backend_compaction_mutex;
+static GCond jd_backend_compaction_cond;
+static gboolean jd_backend_compaction_stop = FALSE;
+
+static guint64
+backend_pread(gint fd, gchar* buffer, guint64 length, guint64 offset)
+{
+	guint64 nbytes_total = 0;
+
+	while (nbytes_total < length)
+	{
+		gssize nbytes;
+
+		nbytes = pread(fd, buffer + nbytes_total, length - nbytes_total, offset + nbytes_total);
+
+		if (nbytes == 0)
+		{
+			break;
+		}
+		else if (nbytes < 0)
+		{
+			if (errno != EINTR)
+			{
+				break;
+			}
+
+			continue;
+		}
+
+		nbytes_total += nbytes;
+	}
+
+	return nbytes_total;
+}
+
+static guint64
+backend_pwrite(gint fd, gchar const* buffer, guint64 length, guint64 offset)
+{
+	guint64 nbytes_total = 0;
+
+	while (nbytes_total < length)
+	{
+		gssize nbytes;
+
+		nbytes = pwrite(fd, buffer + nbytes_total, length - nbytes_total, offset + nbytes_total);
+
+		if (nbytes <= 0)
+		{
+			if (nbytes < 0 && errno == EINTR)
+			{
+				continue;
+			}
+
+			break;
+		}
+
+		nbytes_total += nbytes;
+	}
+
+	return nbytes_total;
+}
+
+static void
+backend_entry_free(gpointer data)
+{
+	JBackendEntry* entry = data;
+
+	if (entry->large_fd != -1)
+	{
+		close(entry->large_fd);
+	}
+
+	g_slice_free(JBackendEntry, entry);
+}
+
+static void
+backend_segment_free(gpointer data)
+{
+	JBackendSegment* segment = data;
+
+	close(segment->fd);
+	g_slice_free(JBackendSegment, segment);
+}
+
+static gchar*
+backend_segment_path(guint32 id)
+{
+	g_autofree gchar* name = NULL;
+
+	name = g_strdup_printf("%08x", id);
+
+	return g_build_filename(jd_backend_path, "segments", name, NULL);
+}
+
+static JBackendSegment*
+backend_segment_open(guint32 id, gboolean create)
+{
+	JBackendSegment* segment;
+	g_autofree gchar* path = NULL;
+	struct stat buf;
+	gint fd;
+
+	path = backend_segment_path(id);
+
+	if ((fd = open(path, O_RDWR | ((create) ? O_CREAT | O_EXCL : 0), 0600)) == -1)
+	{
+		return NULL;
+	}
+
+	if (fstat(fd, &buf) != 0)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	segment = g_slice_new(JBackendSegment);
+	segment->id = id;
+	segment->fd = fd;
+	segment->size = buf.st_size;
+	segment->live = 0;
+
+	g_hash_table_insert(jd_backend_segments, GUINT_TO_POINTER(id), segment);
+
+	return segment;
+}
+
+/**
+ * Starts a new active segment.
+ * Must be called with the writer lock held.
+ */
+static gboolean
+backend_segment_roll(void)
+{
+	JBackendSegment* segment;
+	guint32 id;
+
+	if (jd_backend_active != NULL)
+	{
+		// Data in previous segments is not synced by backend_sync()
+		fsync(jd_backend_active->fd);
+	}
+
+	id = jd_backend_next_segment++;
+
+	if ((segment = backend_segment_open(id, TRUE)) == NULL)
+	{
+		g_critical("log: Could not create segment %u.", id);
+		return FALSE;
+	}
+
+	jd_backend_active = segment;
+
+	return TRUE;
+}
+
+static gchar*
+backend_large_path(gchar const* key)
+{
+	return g_build_filename(jd_backend_path, "large", key, NULL);
+}
+
+/**
+ * Returns the file descriptor of an individual file, opening it if necessary.
+ * Only requires a reader lock.
+ */
+static gint
+backend_large_fd(JBackendEntry* entry, gchar const* key)
+{
+	g_autofree gchar* path = NULL;
+	gint fd;
+
+	if ((fd = g_atomic_int_get(&entry->large_fd)) != -1)
+	{
+		return fd;
+	}
+
+	path = backend_large_path(key);
+
+	if ((fd = open(path, O_RDWR)) == -1)
+	{
+		return -1;
+	}
+
+	// Another reader might have opened the file concurrently
+	if (!g_atomic_int_compare_and_exchange(&entry->large_fd, -1, fd))
+	{
+		close(fd);
+		fd = g_atomic_int_get(&entry->large_fd);
+	}
+
+	return fd;
+}
+
+static void
+backend_compaction_wake(void)
+{
+	g_mutex_lock(&jd_backend_compaction_mutex);
+	g_cond_signal(&jd_backend_compaction_cond);
+	g_mutex_unlock(&jd_backend_compaction_mutex);
+}
+
+static gboolean
+backend_segment_needs_compaction(JBackendSegment* segment)
+{
+	return (segment != jd_backend_active && segment->live * 100 < segment->size * JD_BACKEND_COMPACTION_RATIO);
+}
+
+/**
+ * Releases the segment space referenced by an entry.
+ * Must be called with the writer lock held.
+ */
+static void
+backend_entry_release(JBackendEntry* entry)
+{
+	JBackendSegment* segment;
+
+	if (entry->large || entry->segment == 0)
+	{
+		return;
+	}
+
+	segment = g_hash_table_lookup(jd_backend_segments, GUINT_TO_POINTER(entry->segment));
+	g_assert(segment != NULL);
+
+	segment->live -= entry->length;
+
+	if (backend_segment_needs_compaction(segment))
+	{
+		backend_compaction_wake();
+	}
+}
+
+static gboolean
+backend_index_write(gint fd, guint64 offset, guint32 type, gchar const* key, JBackendEntry const* entry)
+{
+	g_autofree gchar* buffer = NULL;
+	JBackendRecord record;
+	gsize key_length;
+
+	key_length = strlen(key);
+
+	record.type = type;
+	record.key_length = key_length;
+	record.segment = (entry != NULL) ? entry->segment : 0;
+	record.reserved = 0;
+	record.offset = (entry != NULL) ? entry->offset : 0;
+	record.length = (entry != NULL) ? entry->length : 0;
+	record.modification_time = (entry != NULL) ? entry->modification_time : 0;
+
+	// Write the record and key at once to avoid partial records
+	buffer = g_malloc(sizeof(record) + key_length);
+	memcpy(buffer, &record, sizeof(record));
+	memcpy(buffer + sizeof(record), key, key_length);
+
+	return (backend_pwrite(fd, buffer, sizeof(record) + key_length, offset) == sizeof(record) + key_length);
+}
+
+/**
+ * Appends a record to the index log.
+ * Must be called with the writer lock held.
+ */
+static gboolean
+backend_index_append(guint32 type, gchar const* key, JBackendEntry const* entry)
+{
+	if (!backend_index_write(jd_backend_index_fd, jd_backend_index_size, type, key, entry))
+	{
+		g_critical("log: Could not append to index log.");
+		return FALSE;
+	}
+
+	jd_backend_index_size += sizeof(JBackendRecord) + strlen(key);
+	jd_backend_index_records++;
+
+	if (jd_backend_index_records > 2 * g_hash_table_size(jd_backend_index) + 1024)
+	{
+		backend_compaction_wake();
+	}
+
+	return TRUE;
+}
+
+/**
+ * Replaces the index log with a snapshot of the in-memory index.
+ * Must be called with the writer lock held.
+ */
+static gboolean
+backend_index_rewrite(void)
+{
+	GHashTableIter iter;
+	gpointer key;
+	gpointer value;
+	g_autofree gchar* path = NULL;
+	g_autofree gchar* tmp_path = NULL;
+	guint64 size = 0;
+	gint fd;
+
+	path = g_build_filename(jd_backend_path, "index", NULL);
+	tmp_path = g_build_filename(jd_backend_path, "index.tmp", NULL);
+
+	if ((fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC, 0600)) == -1)
+	{
+		return FALSE;
+	}
+
+	g_hash_table_iter_init(&iter, jd_backend_index);
+
+	while (g_hash_table_iter_next(&iter, &key, &value))
+	{
+		JBackendEntry* entry = value;
+
+		if (!backend_index_write(fd, size, (entry->large) ? JD_BACKEND_RECORD_LARGE : JD_BACKEND_RECORD_PUT, key, entry))
+		{
+			goto error;
+		}
+
+		size += sizeof(JBackendRecord) + strlen(key);
+	}
+
+	// Segment data referenced by the snapshot has to be persistent before the old index log is replaced
+	fsync(jd_backend_active->fd);
+
+	if (fsync(fd) != 0 || g_rename(tmp_path, path) != 0)
+	{
+		goto error;
+	}
+
+	close(jd_backend_index_fd);
+
+	jd_backend_index_fd = fd;
+	jd_backend_index_size = size;
+	jd_backend_index_records = 0;
+
+	return TRUE;
+
+error:
+	close(fd);
+	g_unlink(tmp_path);
+
+	return FALSE;
+}
+
+/**
+ * Rebuilds the in-memory index by replaying the index log.
+ */
+static gboolean
+backend_index_replay(void)
+{
+	g_autofree gchar* path = NULL;
+	g_autoptr(GString) key = NULL;
+	GHashTableIter iter;
+	gpointer iter_key;
+	gpointer value;
+	guint64 offset = 0;
+
+	path = g_build_filename(jd_backend_path, "index", NULL);
+
+	if ((jd_backend_index_fd = open(path, O_RDWR | O_CREAT, 0600)) == -1)
+	{
+		g_critical("log: Could not open index log %s.", path);
+		return FALSE;
+	}
+
+	key = g_string_new(NULL);
+
+	while (TRUE)
+	{
+		JBackendEntry* entry;
+		JBackendRecord record;
+
+		if (backend_pread(jd_backend_index_fd, (gchar*)&record, sizeof(record), offset) != sizeof(record))
+		{
+			break;
+		}
+
+		if (record.type < JD_BACKEND_RECORD_PUT || record.type > JD_BACKEND_RECORD_LARGE || record.key_length > G_MAXUINT16)
+		{
+			break;
+		}
+
+		g_string_set_size(key, record.key_length);
+
+		if (backend_pread(jd_backend_index_fd, key->str, record.key_length, offset + sizeof(record)) != record.key_length)
+		{
+			break;
+		}
+
+		offset += sizeof(record) + record.key_length;
+		jd_backend_index_records++;
+
+		if (record.type == JD_BACKEND_RECORD_DELETE)
+		{
+			g_hash_table_remove(jd_backend_index, key->str);
+			continue;
+		}
+
+		entry = g_slice_new(JBackendEntry);
+		entry->segment = record.segment;
+		entry->offset = record.offset;
+		entry->length = record.length;
+		entry->modification_time = record.modification_time;
+		entry->large = (record.type == JD_BACKEND_RECORD_LARGE);
+		entry->large_fd = -1;
+
+		g_hash_table_replace(jd_backend_index, g_strdup(key->str), entry);
+	}
+
+	// Drop a partial record left behind by a crash
+	if (ftruncate(jd_backend_index_fd, offset) != 0)
+	{
+		g_critical("log: Could not truncate index log %s.", path);
+		return FALSE;
+	}
+
+	jd_backend_index_size = offset;
+
+	g_hash_table_iter_init(&iter, jd_backend_index);
+
+	while (g_hash_table_iter_next(&iter, &iter_key, &value))
+	{
+		JBackendEntry* entry = value;
+		JBackendSegment* segment;
+
+		if (entry->large || entry->segment == 0)
+		{
+			continue;
+		}
+
+		segment = g_hash_table_lookup(jd_backend_segments, GUINT_TO_POINTER(entry->segment));
+
+		if (segment == NULL)
+		{
+			segment = backend_segment_open(entry->segment, FALSE);
+		}
+
+		// The segment data might not have been persistent when the crash happened
+		if (segment == NULL || entry->offset + entry->length > segment->size)
+		{
+			g_warning("log: Dropping object %s with missing data.", (gchar const*)iter_key);
+			g_hash_table_iter_remove(&iter);
+			continue;
+		}
+
+		segment->live += entry->length;
+	}
+
+	return TRUE;
+}
+
+/**
+ * Reserves space in the active segment, which does not count as live data until it is referenced by the index.
+ * Must be called with the writer lock held.
+ */
+static JBackendSegment*
+backend_reserve(guint64 length, guint64* offset)
+{
+	JBackendSegment* segment;
+
+	if (jd_backend_active->size > 0 && jd_backend_active->size + length > jd_backend_segment_size)
+	{
+		if (!backend_segment_roll())
+		{
+			return NULL;
+		}
+	}
+
+	segment = jd_backend_active;
+	*offset = segment->size;
+	segment->size += length;
+
+	return segment;
+}
+
+/**
+ * Appends data to the active segment.
+ * The data only counts as live once the caller has added it to the index.
+ * Must be called with the writer lock held.
+ */
+static gboolean
+backend_append(gchar const* buffer, guint64 length, guint32* segment, guint64* offset)
+{
+	JBackendSegment* active;
+	guint64 active_offset;
+
+	if ((active = backend_reserve(length, &active_offset)) == NULL)
+	{
+		return FALSE;
+	}
+
+	// A failed write only leaves stale data behind, which is removed by compaction
+	if (backend_pwrite(active->fd, buffer, length, active_offset) != length)
+	{
+		return FALSE;
+	}
+
+	*segment = active->id;
+	*offset = active_offset;
+
+	return TRUE;
+}
+
+/**
+ * Moves all live data out of a segment and removes it.
+ * Must be called without holding the lock, which is only taken to collect, reserve and update the index.
+ */
+static gboolean
+backend_compact_segment(JBackendSegment* segment)
+{
+	GHashTableIter iter;
+	gpointer key;
+	gpointer value;
+	g_autoptr(GPtrArray) keys = NULL;
+	g_autoptr(GArray) entries = NULL;
+	g_autofree gchar* buffer = NULL;
+	g_autofree gchar* path = NULL;
+	JBackendSegment* target = NULL;
+	gboolean ret = TRUE;
+	guint64 length = 0;
+	guint64 position = 0;
+	guint64 target_offset = 0;
+	guint32 id;
+
+	keys = g_ptr_array_new_with_free_func(g_free);
+	entries = g_array_new(FALSE, FALSE, sizeof(JBackendEntry));
+
+	// Scanning the index does not modify it, so reads can continue in the meantime
+	g_rw_lock_reader_lock(&jd_backend_lock);
+
+	g_hash_table_iter_init(&iter, jd_backend_index);
+
+	while (g_hash_table_iter_next(&iter, &key, &value))
+	{
+		JBackendEntry* entry = value;
+
+		if (entry->large || entry->segment != segment->id)
+		{
+			continue;
+		}
+
+		g_ptr_array_add(keys, g_strdup(key));
+		g_array_append_val(entries, *entry);
+		length += entry->length;
+	}
+
+	g_rw_lock_reader_unlock(&jd_backend_lock);
+
+	buffer = g_malloc(length);
+
+	for (guint i = 0; i < entries->len; i++)
+	{
+		JBackendEntry const* entry = &g_array_index(entries, JBackendEntry, i);
+
+		if (backend_pread(segment->fd, buffer + position, entry->length, entry->offset) != entry->length)
+		{
+			return FALSE;
+		}
+
+		position += entry->length;
+	}
+
+	if (length > 0)
+	{
+		g_rw_lock_writer_lock(&jd_backend_lock);
+		target = backend_reserve(length, &target_offset);
+		g_rw_lock_writer_unlock(&jd_backend_lock);
+
+		// The target segment is persistent before the index references it
+		if (target == NULL
+		    || backend_pwrite(target->fd, buffer, length, target_offset) != length
+		    || fsync(target->fd) != 0)
+		{
+			return FALSE;
+		}
+	}
+
+	position = 0;
+
+	g_rw_lock_writer_lock(&jd_backend_lock);
+
+	for (guint i = 0; i < entries->len && ret; i++)
+	{
+		JBackendEntry const* old_entry = &g_array_index(entries, JBackendEntry, i);
+		gchar const* entry_key = g_ptr_array_index(keys, i);
+		JBackendEntry* entry;
+
+		// Objects that have been modified or deleted in the meantime are not moved
+		if ((entry = g_hash_table_lookup(jd_backend_index, entry_key)) != NULL
+		    && !entry->large && entry->segment == old_entry->segment && entry->offset == old_entry->offset)
+		{
+			JBackendEntry new_entry;
+
+			// Empty objects do not need a segment
+			new_entry = *entry;
+			new_entry.segment = (entry->length > 0) ? target->id : 0;
+			new_entry.offset = (entry->length > 0) ? target_offset + position : 0;
+
+			if ((ret = backend_index_append(JD_BACKEND_RECORD_PUT, entry_key, &new_entry)))
+			{
+				if (entry->length > 0)
+				{
+					segment->live -= entry->length;
+					target->live += entry->length;
+				}
+
+				entry->segment = new_entry.segment;
+				entry->offset = new_entry.offset;
+			}
+		}
+
+		position += old_entry->length;
+	}
+
+	g_rw_lock_writer_unlock(&jd_backend_lock);
+
+	if (!ret)
+	{
+		return FALSE;
+	}
+
+	// The records of the moved objects have to be persistent before the segment is removed
+	g_rw_lock_reader_lock(&jd_backend_lock);
+	ret = (fsync(jd_backend_index_fd) == 0);
+	g_rw_lock_reader_unlock(&jd_backend_lock);
+
+	if (!ret)
+	{
+		return FALSE;
+	}
+
+	id = segment->id;
+	path = backend_segment_path(id);
+
+	g_rw_lock_writer_lock(&jd_backend_lock);
+
+	if ((ret = (segment->live == 0)))
+	{
+		g_hash_table_remove(jd_backend_segments, GUINT_TO_POINTER(id));
+		g_unlink(path);
+	}
+
+	g_rw_lock_writer_unlock(&jd_backend_lock);
+
+	return ret;
+}
+
+static void
+backend_compact(void)
+{
+	while (TRUE)
+	{
+		JBackendSegment* victim = NULL;
+		GHashTableIter iter;
+		gpointer value;
+
+		g_rw_lock_writer_lock(&jd_backend_lock);
+
+		g_hash_table_iter_init(&iter, jd_backend_segments);
+
+		while (g_hash_table_iter_next(&iter, NULL, &value))
+		{
+			JBackendSegment* segment = value;
+
+			if (backend_segment_needs_compaction(segment))
+			{
+				victim = segment;
+				break;
+			}
+		}
+
+		if (victim == NULL)
+		{
+			if (jd_backend_index_records > 2 * g_hash_table_size(jd_backend_index) + 1024)
+			{
+				backend_index_rewrite();
+			}
+
+			g_rw_lock_writer_unlock(&jd_backend_lock);
+			break;
+		}
+
+		g_rw_lock_writer_unlock(&jd_backend_lock);
+
+		// Compact one segment at a time to give other operations a chance to run
+		if (!backend_compact_segment(victim))
+		{
+			g_warning("log: Could not compact segment %u.", victim->id);
+			break;
+		}
+	}
+}
+
+static gpointer
+backend_compaction_thread(gpointer data)
+{
+	(void)data;
+
+	g_mutex_lock(&jd_backend_compaction_mutex);
+
+	while (!jd_backend_compaction_stop)
+	{
+		g_cond_wait_until(&jd_backend_compaction_cond, &jd_backend_compaction_mutex, g_get_monotonic_time() + JD_BACKEND_COMPACTION_INTERVAL);
+
+		if (jd_backend_compaction_stop)
+		{
+			break;
+		}
+
+		g_mutex_unlock(&jd_backend_compaction_mutex);
+		backend_compact();
+		g_mutex_lock(&jd_backend_compaction_mutex);
+	}
+
+	g_mutex_unlock(&jd_backend_compaction_mutex);
+
+	return NULL;
+}
+
+/**
+ * Moves an object from its segment to an individual file.
+ * Must be called with the writer lock held.
+ */
+static gboolean
+backend_make_large(JBackendEntry* entry, gchar const* key)
+{
+	g_autofree gchar* path = NULL;
+	g_autofree gchar* parent = NULL;
+	g_autofree gchar* buffer = NULL;
+	JBackendEntry large_entry;
+	gint fd;
+
+	path = backend_large_path(key);
+	parent = g_path_get_dirname(path);
+	g_mkdir_with_parents(parent, 0700);
+
+	if ((fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600)) == -1)
+	{
+		return FALSE;
+	}
+
+	if (entry->segment != 0 && entry->length > 0)
+	{
+		JBackendSegment* segment;
+
+		segment = g_hash_table_lookup(jd_backend_segments, GUINT_TO_POINTER(entry->segment));
+		buffer = g_malloc(entry->length);
+
+		if (backend_pread(segment->fd, buffer, entry->length, entry->offset) != entry->length
+		    || backend_pwrite(fd, buffer, entry->length, 0) != entry->length)
+		{
+			goto error;
+		}
+	}
+
+	large_entry = *entry;
+	large_entry.segment = 0;
+	large_entry.offset = 0;
+	large_entry.large = TRUE;
+
+	if (!backend_index_append(JD_BACKEND_RECORD_LARGE, key, &large_entry))
+	{
+		goto error;
+	}
+
+	backend_entry_release(entry);
+
+	entry->segment = 0;
+	entry->offset = 0;
+	entry->large = TRUE;
+	entry->large_fd = fd;
+
+	return TRUE;
+
+error:
+	close(fd);
+	g_unlink(path);
+
+	return FALSE;
+}
+
+static gboolean
+backend_create(gchar const* namespace, gchar const* path, gpointer* data)
+{
+	JBackendObject* object;
+	gboolean ret = TRUE;
+	gchar* key;
+
+	key = g_build_filename(namespace, path, NULL);
+
+	j_trace_file_begin(key, J_TRACE_FILE_CREATE);
+
+	g_rw_lock_writer_lock(&jd_backend_lock);
+
+	if (!g_hash_table_contains(jd_backend_index, key))
+	{
+		JBackendEntry* entry;
+
+		entry = g_slice_new(JBackendEntry);
+		entry->segment = 0;
+		entry->offset = 0;
+		entry->length = 0;
+		entry->modification_time = g_get_real_time();
+		entry->large = FALSE;
+		entry->large_fd = -1;
+
+		if ((ret = backend_index_append(JD_BACKEND_RECORD_PUT, key, entry)))
+		{
+			g_hash_table_insert(jd_backend_index, g_strdup(key), entry);
+		}
+		else
+		{
+			g_slice_free(JBackendEntry, entry);
+		}
+	}
+
+	g_rw_lock_writer_unlock(&jd_backend_lock);
+
+	j_trace_file_end(key, J_TRACE_FILE_CREATE, 0, 0);
+
+	object = g_slice_new(JBackendObject);
+	object->key = key;
+
+	*data = object;
+
+	return ret;
+}
+
+static gboolean
+backend_open(gchar const* namespace, gchar const* path, gpointer* data)
+{
+	JBackendObject* object;
+	gboolean ret;
+	gchar* key;
+
+	key = g_build_filename(namespace, path, NULL);
+
+	j_trace_file_begin(key, J_TRACE_FILE_OPEN);
+
+	g_rw_lock_reader_lock(&jd_backend_lock);
+	ret = g_hash_table_contains(jd_backend_index, key);
+	g_rw_lock_reader_unlock(&jd_backend_lock);
+
+	j_trace_file_end(key, J_TRACE_FILE_OPEN, 0, 0);
+
+	object = g_slice_new(JBackendObject);
+	object->key = key;
+
+	*data = object;
+
+	return ret;
+}
+
+static gboolean
+backend_delete(gpointer data)
+{
+	JBackendObject* object = data;
+	JBackendEntry* entry;
+	gboolean ret = FALSE;
+
+	j_trace_file_begin(object->key, J_TRACE_FILE_DELETE);
+
+	g_rw_lock_writer_lock(&jd_backend_lock);
+
+	if ((entry = g_hash_table_lookup(jd_backend_index, object->key)) != NULL
+	    && backend_index_append(JD_BACKEND_RECORD_DELETE, object->key, NULL))
+	{
+		if (entry->large)
+		{
+			g_autofree gchar* path = NULL;
+
+			path = backend_large_path(object->key);
+			g_unlink(path);
+		}
+
+		backend_entry_release(entry);
+		g_hash_table_remove(jd_backend_index, object->key);
+
+		ret = TRUE;
+	}
+
+	g_rw_lock_writer_unlock(&jd_backend_lock);
+
+	j_trace_file_end(object->key, J_TRACE_FILE_DELETE, 0, 0);
+
+	g_free(object->key);
+	g_slice_free(JBackendObject, object);
+
+	return ret;
+}
+
+static gboolean
+backend_close(gpointer data)
+{
+	JBackendObject* object = data;
+
+	g_free(object->key);
+	g_slice_free(JBackendObject, object);
+
+	return TRUE;
+}
+
+static gboolean
+backend_status(gpointer data, gint64* modification_time, guint64* size)
+{
+	JBackendObject* object = data;
+	JBackendEntry* entry;
+	gboolean ret = FALSE;
+
+	j_trace_file_begin(object->key, J_TRACE_FILE_STATUS);
+
+	g_rw_lock_reader_lock(&jd_backend_lock);
+
+	if ((entry = g_hash_table_lookup(jd_backend_index, object->key)) != NULL)
+	{
+		ret = TRUE;
+
+		if (modification_time != NULL)
+		{
+			*modification_time = entry->modification_time;
+		}
+
+		if (size != NULL)
+		{
+			*size = entry->length;
+		}
+
+		if (entry->large)
+		{
+			struct stat buf;
+			gint fd;
+
+			ret = ((fd = backend_large_fd(entry, object->key)) != -1 && fstat(fd, &buf) == 0);
+
+			if (ret && modification_time != NULL)
+			{
+				*modification_time = buf.st_mtime * G_USEC_PER_SEC;
+
+#ifdef HAVE_STMTIM_TVNSEC
+				*modification_time += buf.st_mtim.tv_nsec / 1000;
+#endif
+			}
+
+			if (ret && size != NULL)
+			{
+				*size = buf.st_size;
+			}
+		}
+	}
+
+	g_rw_lock_reader_unlock(&jd_backend_lock);
+
+	j_trace_file_end(object->key, J_TRACE_FILE_STATUS, 0, 0);
+
+	return ret;
+}
+
+static gboolean
+backend_sync(gpointer data)
+{
+	JBackendObject* object = data;
+	JBackendEntry* entry;
+	gboolean ret = FALSE;
+
+	j_trace_file_begin(object->key, J_TRACE_FILE_SYNC);
+
+	g_rw_lock_reader_lock(&jd_backend_lock);
+
+	if ((entry = g_hash_table_lookup(jd_backend_index, object->key)) != NULL)
+	{
+		gint fd;
+
+		// Syncing the active segment also covers other objects' data
+		ret = (fsync(jd_backend_active->fd) == 0 && fsync(jd_backend_index_fd) == 0);
+
+		if (ret && entry->large)
+		{
+			ret = ((fd = backend_large_fd(entry, object->key)) != -1 && fsync(fd) == 0);
+		}
+	}
+
+	g_rw_lock_reader_unlock(&jd_backend_lock);
+
+	j_trace_file_end(object->key, J_TRACE_FILE_SYNC, 0, 0);
+
+	return ret;
+}
+
+static gboolean
+backend_read(gpointer data, gpointer buffer, guint64 length, guint64 offset, guint64* bytes_read)
+{
+	JBackendObject* object = data;
+	JBackendEntry* entry;
+	gboolean ret = FALSE;
+	guint64 nbytes = 0;
+
+	j_trace_file_begin(object->key, J_TRACE_FILE_READ);
+
+	g_rw_lock_reader_lock(&jd_backend_lock);
+
+	if ((entry = g_hash_table_lookup(jd_backend_index, object->key)) != NULL)
+	{
+		if (entry->large)
+		{
+			gint fd;
+
+			if ((fd = backend_large_fd(entry, object->key)) != -1)
+			{
+				nbytes = backend_pread(fd, buffer, length, offset);
+			}
+		}
+		else if (offset < entry->length)
+		{
+			JBackendSegment* segment;
+
+			segment = g_hash_table_lookup(jd_backend_segments, GUINT_TO_POINTER(entry->segment));
+			nbytes = backend_pread(segment->fd, buffer, MIN(length, entry->length - offset), entry->offset + offset);
+		}
+
+		// Like pread(), reading beyond the end of the object is not an error
+		ret = TRUE;
+	}
+
+	g_rw_lock_reader_unlock(&jd_backend_lock);
+
+	j_trace_file_end(object->key, J_TRACE_FILE_READ, nbytes, offset);
+
+	if (bytes_read != NULL)
+	{
+		*bytes_read = nbytes;
+	}
+
+	return ret;
+}
+
+/**
+ * Writes to an object that is stored in an individual file.
+ * Only requires a reader lock because the index is not modified.
+ * Returns FALSE if the object does not exist or is stored in a segment.
+ */
+static gboolean
+backend_write_large(gchar const* key, gconstpointer buffer, guint64 length, guint64 offset, guint64* bytes_written)
+{
+	JBackendEntry* entry;
+	gboolean ret = FALSE;
+
+	g_rw_lock_reader_lock(&jd_backend_lock);
+
+	if ((entry = g_hash_table_lookup(jd_backend_index, key)) != NULL && entry->large)
+	{
+		gint fd;
+
+		ret = TRUE;
+
+		if ((fd = backend_large_fd(entry, key)) != -1)
+		{
+			*bytes_written = backend_pwrite(fd, buffer, length, offset);
+		}
+	}
+
+	g_rw_lock_reader_unlock(&jd_backend_lock);
+
+	return ret;
+}
+
+static gboolean
+backend_write(gpointer data, gconstpointer buffer, guint64 length, guint64 offset, guint64* bytes_written)
+{
+	JBackendObject* object = data;
+	JBackendEntry* entry;
+	guint64 nbytes = 0;
+
+	j_trace_file_begin(object->key, J_TRACE_FILE_WRITE);
+
+	if (backend_write_large(object->key, buffer, length, offset, &nbytes))
+	{
+		goto end;
+	}
+
+	g_rw_lock_writer_lock(&jd_backend_lock);
+
+	if ((entry = g_hash_table_lookup(jd_backend_index, object->key)) == NULL)
+	{
+		goto unlock;
+	}
+
+	if (!entry->large && offset + length > jd_backend_threshold)
+	{
+		if (!backend_make_large(entry, object->key))
+		{
+			goto unlock;
+		}
+	}
+
+	if (entry->large)
+	{
+		// The object has just been moved to an individual file, which does not require the writer lock anymore
+		g_rw_lock_writer_unlock(&jd_backend_lock);
+		backend_write_large(object->key, buffer, length, offset, &nbytes);
+		goto end;
+	}
+	else
+	{
+		g_autofree gchar* new_data = NULL;
+		JBackendSegment* new_segment;
+		JBackendEntry new_entry;
+
+		new_entry = *entry;
+		new_entry.length = MAX(entry->length, offset + length);
+		new_entry.modification_time = g_get_real_time();
+
+		// Objects are small, so the complete object is appended again
+		new_data = g_malloc0(new_entry.length);
+
+		if (entry->segment != 0 && entry->length > 0)
+		{
+			JBackendSegment* segment;
+
+			segment = g_hash_table_lookup(jd_backend_segments, GUINT_TO_POINTER(entry->segment));
+
+			if (backend_pread(segment->fd, new_data, entry->length, entry->offset) != entry->length)
+			{
+				goto unlock;
+			}
+		}
+
+		memcpy(new_data + offset, buffer, length);
+
+		if (!backend_append(new_data, new_entry.length, &new_entry.segment, &new_entry.offset)
+		    || !backend_index_append(JD_BACKEND_RECORD_PUT, object->key, &new_entry))
+		{
+			goto unlock;
+		}
+
+		backend_entry_release(entry);
+		*entry = new_entry;
+
+		new_segment = g_hash_table_lookup(jd_backend_segments, GUINT_TO_POINTER(new_entry.segment));
+		new_segment->live += new_entry.length;
+
+		nbytes = length;
+	}
+
+unlock:
+	g_rw_lock_writer_unlock(&jd_backend_lock);
+
+end:
+	j_trace_file_end(object->key, J_TRACE_FILE_WRITE, nbytes, offset);
+
+	if (bytes_written != NULL)
+	{
+		*bytes_written = nbytes;
+	}
+
+	return (nbytes == length);
+}
+
+static gboolean
+backend_init(gchar const* path)
+{
+	g_auto(GStrv) split = NULL;
+	g_autoptr(GDir) dir = NULL;
+	g_autofree gchar* segments_path = NULL;
+	gchar const* name;
+
+	// The path has the format /path/to/storage[:option,...]
+	split = g_strsplit(path, ":", 2);
+
+	if (split[0] == NULL)
+	{
+		return FALSE;
+	}
+
+	if (split[1] != NULL)
+	{
+		g_auto(GStrv) options = NULL;
+
+		options = g_strsplit(split[1], ",", 0);
+
+		for (guint i = 0; options[i] != NULL; i++)
+		{
+			if (g_str_has_prefix(options[i], "threshold="))
+			{
+				jd_backend_threshold = g_ascii_strtoull(options[i] + strlen("threshold="), NULL, 10);
+			}
+			else if (g_str_has_prefix(options[i], "segment-size="))
+			{
+				jd_backend_segment_size = g_ascii_strtoull(options[i] + strlen("segment-size="), NULL, 10);
+			}
+			else
+			{
+				g_warning("log: Unknown option %s.", options[i]);
+			}
+		}
+	}
+
+	jd_backend_path = g_strdup(split[0]);
+	jd_backend_index = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, backend_entry_free);
+	jd_backend_segments = g_hash_table_new_full(NULL, NULL, NULL, backend_segment_free);
+
+	segments_path = g_build_filename(jd_backend_path, "segments", NULL);
+	g_mkdir_with_parents(segments_path, 0700);
+
+	if (!backend_index_replay())
+	{
+		return FALSE;
+	}
+
+	if ((dir = g_dir_open(segments_path, 0, NULL)) == NULL)
+	{
+		return FALSE;
+	}
+
+	while ((name = g_dir_read_name(dir)) != NULL)
+	{
+		g_autofree gchar* segment_path = NULL;
+		guint32 id;
+
+		id = g_ascii_strtoull(name, NULL, 16);
+
+		if (id == 0)
+		{
+			continue;
+		}
+
+		jd_backend_next_segment = MAX(jd_backend_next_segment, id + 1);
+
+		// Segments that are not referenced by the index are left over from a compaction or contain only stale data
+		if (g_hash_table_lookup(jd_backend_segments, GUINT_TO_POINTER(id)) == NULL)
+		{
+			segment_path = backend_segment_path(id);
+			g_unlink(segment_path);
+		}
+	}
+
+	if (!backend_segment_roll())
+	{
+		return FALSE;
+	}
+
+	jd_backend_compaction_stop = FALSE;
+	jd_backend_compaction_thread = g_thread_new("log-compaction", backend_compaction_thread, NULL);
+
+	return TRUE;
+}
+
+static void
+backend_fini(void)
+{
+	g_mutex_lock(&jd_backend_compaction_mutex);
+	jd_backend_compaction_stop = TRUE;
+	g_cond_signal(&jd_backend_compaction_cond);
+	g_mutex_unlock(&jd_backend_compaction_mutex);
+
+	g_thread_join(jd_backend_compaction_thread);
+	jd_backend_compaction_thread = NULL;
+
+	fsync(jd_backend_active->fd);
+	fsync(jd_backend_index_fd);
+	close(jd_backend_index_fd);
+
+	jd_backend_active = NULL;
+	jd_backend_next_segment = 1;
+
+	g_hash_table_destroy(jd_backend_index);
+	g_hash_table_destroy(jd_backend_segments);
+
+	g_free(jd_backend_path);
+}
+
+static JBackend log_backend = {
+	.type = J_BACKEND_TYPE_OBJECT,
+	.component = J_BACKEND_COMPONENT_SERVER,
+	.object = {
+		.backend_init = backend_init,
+		.backend_fini = backend_fini,
+		.backend_create = backend_create,
+		.backend_delete = backend_delete,
+		.backend_open = backend_open,
+		.backend_close = backend_close,
+		.backend_status = backend_status,
+		.backend_sync = backend_sync,
+		.backend_read = backend_read,
+		.backend_write = backend_write }
+};
+
+G_MODULE_EXPORT
+JBackend*
+backend_info(void)
+{
+	return &log_backend;
+}
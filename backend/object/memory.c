@@ -0,0 +1,715 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2019 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * An object backend that keeps all objects in memory.
+ *
+ * Small objects are stored in a heap buffer that grows by doubling.
+ * Larger objects are stored in extents of JD_BACKEND_EXTENT_SIZE bytes that are backed by huge pages if possible.
+ * Extents are only allocated when they are written to, reading unallocated extents returns zeroes.
+ **/
+
+// MAP_ANONYMOUS, MAP_HUGETLB and madvise()
+#define _GNU_SOURCE
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <gmodule.h>
+
+#include <string.h>
+#include <sys/mman.h>
+
+#include <julea.h>
+
+/**
+ * The size of extents, which matches the size of huge pages on x86-64.
+ */
+#define JD_BACKEND_EXTENT_SIZE (2 * 1024 * 1024)
+
+/**
+ * The initial size of the heap buffer of small objects.
+ */
+#define JD_BACKEND_SMALL_SIZE 4096
+
+/**
+ * The number of shards of the object table, which reduces lock contention.
+ */
+#define JD_BACKEND_SHARDS 64
+
+struct JBackendObject
+{
+	gchar* key;
+
+	/**
+	 * Protects the object's data.
+	 * Reads only require a reader lock.
+	 */
+	GRWLock lock;
+
+	guint64 size;
+	gint64 modification_time;
+
+	/**
+	 * The heap buffer of small objects, NULL if extents are used.
+	 */
+	gchar* small;
+	guint64 small_capacity;
+
+	/**
+	 * The extents of large objects, unallocated extents are NULL.
+	 */
+	GPtrArray* extents;
+
+	gint ref_count;
+};
+
+typedef struct JBackendObject JBackendObject;
+
+struct JBackendShard
+{
+	GRWLock lock;
+	GHashTable* objects;
+};
+
+typedef struct JBackendShard JBackendShard;
+
+static JBackendShard jd_backend_shards[JD_BACKEND_SHARDS];
+
+/**
+ * The maximum amount of memory used for object data, 0 if unlimited.
+ * Can be set with the cap option in the path (cap=4G).
+ */
+static guint64 jd_backend_cap = 0;
+
+/**
+ * The amount of memory currently used for object data.
+ */
+static guint64 jd_backend_used = 0;
+
+/**
+ * Whether to allocate extents from the huge page pool using MAP_HUGETLB.
+ * Can be enabled with the hugetlb option in the path (cap=4G,hugetlb).
+ * Otherwise, transparent huge pages are requested using madvise().
+ */
+static gboolean jd_backend_hugetlb = FALSE;
+
+G_LOCK_DEFINE_STATIC(jd_backend_used);
+
+static gboolean
+backend_memory_reserve(guint64 size)
+{
+	gboolean ret = TRUE;
+
+	G_LOCK(jd_backend_used);
+
+	if (jd_backend_cap > 0 && jd_backend_used + size > jd_backend_cap)
+	{
+		ret = FALSE;
+	}
+	else
+	{
+		jd_backend_used += size;
+	}
+
+	G_UNLOCK(jd_backend_used);
+
+	return ret;
+}
+
+static void
+backend_memory_release(guint64 size)
+{
+	G_LOCK(jd_backend_used);
+	jd_backend_used -= size;
+	G_UNLOCK(jd_backend_used);
+}
+
+static gchar*
+backend_extent_alloc(void)
+{
+	gpointer extent;
+
+	if (!backend_memory_reserve(JD_BACKEND_EXTENT_SIZE))
+	{
+		return NULL;
+	}
+
+#ifdef MAP_HUGETLB
+	if (jd_backend_hugetlb)
+	{
+		extent = mmap(NULL, JD_BACKEND_EXTENT_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+		if (extent != MAP_FAILED)
+		{
+			return extent;
+		}
+
+		// The huge page pool is exhausted or not configured
+	}
+#endif
+
+	extent = mmap(NULL, JD_BACKEND_EXTENT_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (extent == MAP_FAILED)
+	{
+		backend_memory_release(JD_BACKEND_EXTENT_SIZE);
+		return NULL;
+	}
+
+#ifdef MADV_HUGEPAGE
+	madvise(extent, JD_BACKEND_EXTENT_SIZE, MADV_HUGEPAGE);
+#endif
+
+	return extent;
+}
+
+static void
+backend_extent_free(gpointer data)
+{
+	if (data == NULL)
+	{
+		return;
+	}
+
+	munmap(data, JD_BACKEND_EXTENT_SIZE);
+	backend_memory_release(JD_BACKEND_EXTENT_SIZE);
+}
+
+static JBackendShard*
+backend_shard_get(gchar const* key)
+{
+	return &(jd_backend_shards[g_str_hash(key) % JD_BACKEND_SHARDS]);
+}
+
+static JBackendObject*
+backend_object_ref(JBackendObject* object)
+{
+	g_atomic_int_inc(&(object->ref_count));
+
+	return object;
+}
+
+static void
+backend_object_unref(gpointer data)
+{
+	JBackendObject* object = data;
+
+	if (g_atomic_int_dec_and_test(&(object->ref_count)))
+	{
+		if (object->extents != NULL)
+		{
+			g_ptr_array_free(object->extents, TRUE);
+		}
+
+		g_free(object->small);
+		backend_memory_release(object->small_capacity);
+
+		g_rw_lock_clear(&(object->lock));
+		g_free(object->key);
+		g_slice_free(JBackendObject, object);
+	}
+}
+
+/**
+ * Grows the heap buffer of a small object to hold at least size bytes.
+ * Must be called with the object's writer lock held.
+ */
+static gboolean
+backend_object_grow_small(JBackendObject* object, guint64 size)
+{
+	guint64 capacity;
+
+	if (size <= object->small_capacity)
+	{
+		return TRUE;
+	}
+
+	capacity = MAX(object->small_capacity, JD_BACKEND_SMALL_SIZE);
+
+	while (capacity < size)
+	{
+		capacity *= 2;
+	}
+
+	capacity = MIN(capacity, JD_BACKEND_EXTENT_SIZE);
+
+	if (!backend_memory_reserve(capacity - object->small_capacity))
+	{
+		return FALSE;
+	}
+
+	object->small = g_realloc(object->small, capacity);
+	memset(object->small + object->small_capacity, 0, capacity - object->small_capacity);
+	object->small_capacity = capacity;
+
+	return TRUE;
+}
+
+/**
+ * Switches a small object to extents.
+ * Must be called with the object's writer lock held.
+ */
+static gboolean
+backend_object_use_extents(JBackendObject* object)
+{
+	object->extents = g_ptr_array_new_with_free_func(backend_extent_free);
+
+	if (object->small != NULL)
+	{
+		gchar* extent;
+
+		if ((extent = backend_extent_alloc()) == NULL)
+		{
+			g_ptr_array_free(object->extents, TRUE);
+			object->extents = NULL;
+
+			return FALSE;
+		}
+
+		memcpy(extent, object->small, object->size);
+		g_ptr_array_add(object->extents, extent);
+
+		g_free(object->small);
+		backend_memory_release(object->small_capacity);
+
+		object->small = NULL;
+		object->small_capacity = 0;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+backend_create(gchar const* namespace, gchar const* path, gpointer* data)
+{
+	JBackendObject* object;
+	JBackendShard* shard;
+	gchar* key;
+
+	key = g_build_filename(namespace, path, NULL);
+	shard = backend_shard_get(key);
+
+	j_trace_file_begin(key, J_TRACE_FILE_CREATE);
+
+	g_rw_lock_writer_lock(&(shard->lock));
+
+	if ((object = g_hash_table_lookup(shard->objects, key)) == NULL)
+	{
+		object = g_slice_new(JBackendObject);
+		object->key = key;
+		g_rw_lock_init(&(object->lock));
+		object->size = 0;
+		object->modification_time = g_get_real_time();
+		object->small = NULL;
+		object->small_capacity = 0;
+		object->extents = NULL;
+		object->ref_count = 1;
+
+		g_hash_table_insert(shard->objects, object->key, object);
+	}
+	else
+	{
+		g_free(key);
+	}
+
+	backend_object_ref(object);
+
+	g_rw_lock_writer_unlock(&(shard->lock));
+
+	j_trace_file_end(object->key, J_TRACE_FILE_CREATE, 0, 0);
+
+	*data = object;
+
+	return TRUE;
+}
+
+static gboolean
+backend_open(gchar const* namespace, gchar const* path, gpointer* data)
+{
+	JBackendObject* object;
+	JBackendShard* shard;
+	g_autofree gchar* key = NULL;
+
+	key = g_build_filename(namespace, path, NULL);
+	shard = backend_shard_get(key);
+
+	j_trace_file_begin(key, J_TRACE_FILE_OPEN);
+
+	g_rw_lock_reader_lock(&(shard->lock));
+
+	if ((object = g_hash_table_lookup(shard->objects, key)) != NULL)
+	{
+		backend_object_ref(object);
+	}
+
+	g_rw_lock_reader_unlock(&(shard->lock));
+
+	j_trace_file_end(key, J_TRACE_FILE_OPEN, 0, 0);
+
+	*data = object;
+
+	return (object != NULL);
+}
+
+static gboolean
+backend_delete(gpointer data)
+{
+	JBackendObject* object = data;
+	JBackendShard* shard;
+	gboolean ret;
+
+	shard = backend_shard_get(object->key);
+
+	j_trace_file_begin(object->key, J_TRACE_FILE_DELETE);
+
+	g_rw_lock_writer_lock(&(shard->lock));
+
+	// A stale handle must not delete an object that has been recreated with the same name
+	if ((ret = (g_hash_table_lookup(shard->objects, object->key) == object)))
+	{
+		// Drops the table's reference, the data is freed once all handles have been closed
+		g_hash_table_remove(shard->objects, object->key);
+	}
+
+	g_rw_lock_writer_unlock(&(shard->lock));
+
+	j_trace_file_end(object->key, J_TRACE_FILE_DELETE, 0, 0);
+
+	backend_object_unref(object);
+
+	return ret;
+}
+
+static gboolean
+backend_close(gpointer data)
+{
+	JBackendObject* object = data;
+
+	backend_object_unref(object);
+
+	return TRUE;
+}
+
+static gboolean
+backend_object_has_prefix(gpointer key, gpointer value, gpointer data)
+{
+	(void)value;
+
+	return g_str_has_prefix(key, data);
+}
+
+static gboolean
+backend_delete_namespace(gchar const* namespace)
+{
+	g_autofree gchar* prefix = NULL;
+
+	prefix = g_strconcat(namespace, G_DIR_SEPARATOR_S, NULL);
+
+	j_trace_file_begin(namespace, J_TRACE_FILE_DELETE);
+
+	// Objects are distributed across all shards by their key
+	for (guint i = 0; i < JD_BACKEND_SHARDS; i++)
+	{
+		JBackendShard* shard = &(jd_backend_shards[i]);
+
+		g_rw_lock_writer_lock(&(shard->lock));
+		g_hash_table_foreach_remove(shard->objects, backend_object_has_prefix, prefix);
+		g_rw_lock_writer_unlock(&(shard->lock));
+	}
+
+	j_trace_file_end(namespace, J_TRACE_FILE_DELETE, 0, 0);
+
+	return TRUE;
+}
+
+static gboolean
+backend_status(gpointer data, gint64* modification_time, guint64* size)
+{
+	JBackendObject* object = data;
+
+	j_trace_file_begin(object->key, J_TRACE_FILE_STATUS);
+
+	g_rw_lock_reader_lock(&(object->lock));
+
+	if (modification_time != NULL)
+	{
+		*modification_time = object->modification_time;
+	}
+
+	if (size != NULL)
+	{
+		*size = object->size;
+	}
+
+	g_rw_lock_reader_unlock(&(object->lock));
+
+	j_trace_file_end(object->key, J_TRACE_FILE_STATUS, 0, 0);
+
+	return TRUE;
+}
+
+static gboolean
+backend_sync(gpointer data)
+{
+	JBackendObject* object = data;
+
+	j_trace_file_begin(object->key, J_TRACE_FILE_SYNC);
+	j_trace_file_end(object->key, J_TRACE_FILE_SYNC, 0, 0);
+
+	return TRUE;
+}
+
+static gboolean
+backend_read(gpointer data, gpointer buffer, guint64 length, guint64 offset, guint64* bytes_read)
+{
+	JBackendObject* object = data;
+	gchar* buffer_pos = buffer;
+	guint64 nbytes = 0;
+
+	j_trace_file_begin(object->key, J_TRACE_FILE_READ);
+
+	g_rw_lock_reader_lock(&(object->lock));
+
+	if (offset < object->size)
+	{
+		nbytes = MIN(length, object->size - offset);
+
+		if (object->extents == NULL)
+		{
+			memcpy(buffer_pos, object->small + offset, nbytes);
+		}
+		else
+		{
+			guint64 pos = 0;
+
+			while (pos < nbytes)
+			{
+				guint64 index = (offset + pos) / JD_BACKEND_EXTENT_SIZE;
+				guint64 extent_offset = (offset + pos) % JD_BACKEND_EXTENT_SIZE;
+				guint64 chunk = MIN(nbytes - pos, JD_BACKEND_EXTENT_SIZE - extent_offset);
+				gchar* extent = NULL;
+
+				if (index < object->extents->len)
+				{
+					extent = g_ptr_array_index(object->extents, index);
+				}
+
+				if (extent != NULL)
+				{
+					memcpy(buffer_pos + pos, extent + extent_offset, chunk);
+				}
+				else
+				{
+					memset(buffer_pos + pos, 0, chunk);
+				}
+
+				pos += chunk;
+			}
+		}
+	}
+
+	g_rw_lock_reader_unlock(&(object->lock));
+
+	j_trace_file_end(object->key, J_TRACE_FILE_READ, nbytes, offset);
+
+	if (bytes_read != NULL)
+	{
+		*bytes_read = nbytes;
+	}
+
+	return (nbytes == length);
+}
+
+static gboolean
+backend_write(gpointer data, gconstpointer buffer, guint64 length, guint64 offset, guint64* bytes_written)
+{
+	JBackendObject* object = data;
+	gchar const* buffer_pos = buffer;
+	guint64 nbytes = 0;
+
+	j_trace_file_begin(object->key, J_TRACE_FILE_WRITE);
+
+	g_rw_lock_writer_lock(&(object->lock));
+
+	if (object->extents == NULL && offset + length <= JD_BACKEND_EXTENT_SIZE)
+	{
+		if (backend_object_grow_small(object, offset + length))
+		{
+			memcpy(object->small + offset, buffer_pos, length);
+			nbytes = length;
+		}
+	}
+	else if (object->extents != NULL || backend_object_use_extents(object))
+	{
+		while (nbytes < length)
+		{
+			guint64 index = (offset + nbytes) / JD_BACKEND_EXTENT_SIZE;
+			guint64 extent_offset = (offset + nbytes) % JD_BACKEND_EXTENT_SIZE;
+			guint64 chunk = MIN(length - nbytes, JD_BACKEND_EXTENT_SIZE - extent_offset);
+			gchar* extent;
+
+			if (index >= object->extents->len)
+			{
+				g_ptr_array_set_size(object->extents, index + 1);
+			}
+
+			if ((extent = g_ptr_array_index(object->extents, index)) == NULL)
+			{
+				// The memory cap has been reached
+				if ((extent = backend_extent_alloc()) == NULL)
+				{
+					break;
+				}
+
+				g_ptr_array_index(object->extents, index) = extent;
+			}
+
+			memcpy(extent + extent_offset, buffer_pos + nbytes, chunk);
+			nbytes += chunk;
+		}
+	}
+
+	if (nbytes > 0)
+	{
+		object->size = MAX(object->size, offset + nbytes);
+		object->modification_time = g_get_real_time();
+	}
+
+	g_rw_lock_writer_unlock(&(object->lock));
+
+	j_trace_file_end(object->key, J_TRACE_FILE_WRITE, nbytes, offset);
+
+	if (bytes_written != NULL)
+	{
+		*bytes_written = nbytes;
+	}
+
+	return (nbytes == length);
+}
+
+/**
+ * Parses a size with an optional K, M, G or T suffix.
+ */
+static guint64
+backend_parse_size(gchar const* str)
+{
+	gchar* end;
+	guint64 size;
+
+	size = g_ascii_strtoull(str, &end, 10);
+
+	switch (g_ascii_toupper(*end))
+	{
+		case 'T':
+			size *= 1024;
+			// fall through
+		case 'G':
+			size *= 1024;
+			// fall through
+		case 'M':
+			size *= 1024;
+			// fall through
+		case 'K':
+			size *= 1024;
+			break;
+		default:
+			break;
+	}
+
+	return size;
+}
+
+static gboolean
+backend_init(gchar const* path)
+{
+	g_auto(GStrv) options = NULL;
+
+	// The path has the format [option,...]
+	options = g_strsplit(path, ",", 0);
+
+	for (guint i = 0; options[i] != NULL; i++)
+	{
+		if (options[i][0] == '\0')
+		{
+			continue;
+		}
+		else if (g_str_has_prefix(options[i], "cap="))
+		{
+			jd_backend_cap = backend_parse_size(options[i] + strlen("cap="));
+		}
+		else if (g_strcmp0(options[i], "hugetlb") == 0)
+		{
+#ifdef MAP_HUGETLB
+			jd_backend_hugetlb = TRUE;
+#else
+			g_warning("memory: hugetlb is not supported, falling back to transparent huge pages.");
+#endif
+		}
+		else
+		{
+			g_warning("memory: Unknown option %s.", options[i]);
+		}
+	}
+
+	for (guint i = 0; i < JD_BACKEND_SHARDS; i++)
+	{
+		g_rw_lock_init(&(jd_backend_shards[i].lock));
+		jd_backend_shards[i].objects = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, backend_object_unref);
+	}
+
+	return TRUE;
+}
+
+static void
+backend_fini(void)
+{
+	for (guint i = 0; i < JD_BACKEND_SHARDS; i++)
+	{
+		g_hash_table_destroy(jd_backend_shards[i].objects);
+		g_rw_lock_clear(&(jd_backend_shards[i].lock));
+	}
+
+	g_assert(jd_backend_used == 0);
+}
+
+static JBackend memory_backend = {
+	.type = J_BACKEND_TYPE_OBJECT,
+	.component = J_BACKEND_COMPONENT_CLIENT | J_BACKEND_COMPONENT_SERVER,
+	.object = {
+		.backend_init = backend_init,
+		.backend_fini = backend_fini,
+		.backend_create = backend_create,
+		.backend_delete = backend_delete,
+		.backend_open = backend_open,
+		.backend_close = backend_close,
+		.backend_delete_namespace = backend_delete_namespace,
+		.backend_status = backend_status,
+		.backend_sync = backend_sync,
+		.backend_read = backend_read,
+		.backend_write = backend_write }
+};
+
+G_MODULE_EXPORT
+JBackend*
+backend_info(void)
+{
+	return &memory_backend;
+}
@@ -79,6 +79,15 @@ backend_close(gpointer data)
 	return TRUE;
 }
 
+static gboolean
+backend_delete_namespace(gchar const* namespace)
+{
+	j_trace_file_begin(namespace, J_TRACE_FILE_DELETE);
+	j_trace_file_end(namespace, J_TRACE_FILE_DELETE, 0, 0);
+
+	return TRUE;
+}
+
 static gboolean
 backend_status(gpointer data, gint64* modification_time, guint64* size)
 {
@@ -170,6 +179,7 @@ static JBackend null_backend = {
 		.backend_delete = backend_delete,
 		.backend_open = backend_open,
 		.backend_close = backend_close,
+		.backend_delete_namespace = backend_delete_namespace,
 		.backend_status = backend_status,
 		.backend_sync = backend_sync,
 		.backend_read = backend_read,
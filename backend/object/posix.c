@@ -16,7 +16,8 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#define _POSIX_C_SOURCE 200809L
+// O_DIRECT and fallocate()
+#define _GNU_SOURCE
 
 #include <julea-config.h>
 
@@ -24,17 +25,38 @@
 #include <glib/gstdio.h>
 #include <gmodule.h>
 
+#include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
 #include <julea.h>
 
 struct JBackendFile
 {
 	gchar* path;
 	gint fd;
+
+	/**
+	 * A file descriptor opened with O_DIRECT, -1 if direct I/O is not used.
+	 */
+	gint direct_fd;
+
+	/**
+	 * The sidecar file that stores block checksums, NULL and -1 if checksums are not used.
+	 */
+	gchar* checksum_path;
+	gint checksum_fd;
+
 	guint ref_count;
 };
 
@@ -43,7 +65,111 @@ typedef struct JBackendFile JBackendFile;
 static GHashTable* jd_backend_file_cache = NULL;
 static gchar* jd_backend_path = NULL;
 
+#ifdef HAVE_LIBURING
+/**
+ * Whether to use io_uring for reads and writes.
+ * Can be enabled with the io_uring option in the path (/path/to/storage:io_uring).
+ */
+static gboolean jd_backend_io_uring = FALSE;
+#endif
+
+/**
+ * The name of the file that stores the layout version.
+ */
+#define JD_BACKEND_LAYOUT_FILE ".julea-layout"
+
+/**
+ * Objects are stored in path/namespace/name.
+ */
+#define JD_BACKEND_LAYOUT_FLAT 1
+
+/**
+ * Objects are stored in path/namespace/xx/yy/name, where xx and yy are derived from a hash of name.
+ */
+#define JD_BACKEND_LAYOUT_SHARDED 2
+
+/**
+ * The layout version.
+ * Can be selected for new storage with the layout option in the path (/path/to/storage:layout=sharded).
+ * Existing storage has to be converted using julea-posix-migrate.
+ */
+static guint jd_backend_layout = JD_BACKEND_LAYOUT_FLAT;
+
+/**
+ * A cache of directories that have already been created.
+ */
+static GHashTable* jd_backend_directories = NULL;
+
+/**
+ * Whether to use direct I/O for aligned parts of reads and writes.
+ * Can be enabled with the direct option in the path (/path/to/storage:direct).
+ */
+static gboolean jd_backend_direct = FALSE;
+
+/**
+ * The alignment required for direct I/O.
+ */
+#define JD_BACKEND_DIRECT_ALIGNMENT 4096
+
+/**
+ * The size of bounce buffers for direct I/O with unaligned memory.
+ */
+#define JD_BACKEND_DIRECT_BOUNCE_SIZE (4 * 1024 * 1024)
+
+/**
+ * The granularity of preallocations for direct I/O.
+ */
+#define JD_BACKEND_DIRECT_PREALLOCATE_SIZE (64 * 1024 * 1024)
+
+/**
+ * A pool of bounce buffers for direct I/O.
+ */
+static GSList* jd_backend_bounce_buffers = NULL;
+
+/**
+ * Whether to maintain checksums of blocks, which are verified when reading.
+ * Can be enabled with the checksum option in the path (/path/to/storage:checksum).
+ */
+static gboolean jd_backend_checksum = FALSE;
+static gchar* jd_backend_checksum_path = NULL;
+
+/**
+ * The directory that contains the sidecar files with checksums.
+ * It mirrors the layout of the objects.
+ */
+#define JD_BACKEND_CHECKSUM_DIR ".julea-checksums"
+
+/**
+ * The size of checksummed blocks.
+ * Each block has a CRC32C checksum of 4 bytes, 0 if the checksum is unknown.
+ * Blocks at the end of the object are padded with zeroes.
+ */
+#define JD_BACKEND_CHECKSUM_BLOCK_SIZE (64 * 1024)
+
+/**
+ * The number of locks that serialize checksum updates.
+ */
+#define JD_BACKEND_CHECKSUM_LOCKS 64
+
+/**
+ * The interval in seconds between scrubs of all checksummed objects, 0 if scrubbing is disabled.
+ * Can be set with the scrub option in the path (/path/to/storage:checksum,scrub=86400).
+ */
+static guint64 jd_backend_scrub_interval = 0;
+
+static GThread* jd_backend_scrub_thread = NULL;
+static GMutex jd_backend_scrub_mutex;
+static GCond jd_backend_scrub_cond;
+static gboolean jd_backend_scrub_stop = FALSE;
+
+static guint32 jd_backend_crc32c_table[256];
+static guint32 (*jd_backend_crc32c_update)(guint32, guchar const*, gsize) = NULL;
+static guchar const jd_backend_zero_block[JD_BACKEND_CHECKSUM_BLOCK_SIZE];
+static GMutex jd_backend_checksum_locks[JD_BACKEND_CHECKSUM_LOCKS];
+
 G_LOCK_DEFINE_STATIC(jd_backend_file_cache);
+G_LOCK_DEFINE_STATIC(jd_backend_directories);
+G_LOCK_DEFINE_STATIC(jd_backend_bounce_buffers);
 
 static void
 jd_backend_files_free(gpointer data)
@@ -56,6 +182,162 @@ jd_backend_files_free(gpointer data)
 // FIXME not deleted?
 static GPrivate jd_backend_files = G_PRIVATE_INIT(jd_backend_files_free);
 
+#ifdef HAVE_LIBURING
+/**
+ * The maximum number of I/O requests in flight per thread.
+ */
+#define JD_BACKEND_IO_URING_DEPTH 32
+
+/**
+ * The minimum size of a single I/O request.
+ */
+#define JD_BACKEND_IO_URING_BLOCK_SIZE (1024 * 1024)
+
+static void
+jd_backend_ring_free(gpointer data)
+{
+	struct io_uring* ring = data;
+
+	io_uring_queue_exit(ring);
+	g_slice_free(struct io_uring, ring);
+}
+
+static GPrivate jd_backend_ring = G_PRIVATE_INIT(jd_backend_ring_free);
+
+static struct io_uring*
+jd_backend_ring_get_thread(void)
+{
+	struct io_uring* ring;
+
+	ring = g_private_get(&jd_backend_ring);
+
+	if (G_UNLIKELY(ring == NULL))
+	{
+		ring = g_slice_new(struct io_uring);
+
+		if (io_uring_queue_init(JD_BACKEND_IO_URING_DEPTH, ring, 0) < 0)
+		{
+			g_slice_free(struct io_uring, ring);
+			return NULL;
+		}
+
+		g_private_replace(&jd_backend_ring, ring);
+	}
+
+	return ring;
+}
+
+/**
+ * Reads or writes a buffer using io_uring.
+ * The buffer is split into multiple requests that are in flight at the same time.
+ *
+ * \return The number of bytes that have been transferred contiguously from the beginning of the buffer.
+ **/
+static guint64
+backend_io_uring_transfer(gint fd, gchar* buffer, guint64 length, guint64 offset, gboolean write)
+{
+	struct io_uring* ring;
+	gint results[JD_BACKEND_IO_URING_DEPTH];
+	guint64 block_size;
+	guint64 nbytes_total = 0;
+	guint count;
+	guint submitted = 0;
+	guint reaped = 0;
+
+	if (length == 0 || (ring = jd_backend_ring_get_thread()) == NULL)
+	{
+		return 0;
+	}
+
+	block_size = MAX(JD_BACKEND_IO_URING_BLOCK_SIZE, (length + JD_BACKEND_IO_URING_DEPTH - 1) / JD_BACKEND_IO_URING_DEPTH);
+	count = (length + block_size - 1) / block_size;
+
+	for (guint i = 0; i < count; i++)
+	{
+		struct io_uring_sqe* sqe;
+		guint64 block_offset = i * block_size;
+		guint64 block_length = MIN(block_size, length - block_offset);
+
+		sqe = io_uring_get_sqe(ring);
+
+		if (write)
+		{
+			io_uring_prep_write(sqe, fd, buffer + block_offset, block_length, offset + block_offset);
+		}
+		else
+		{
+			io_uring_prep_read(sqe, fd, buffer + block_offset, block_length, offset + block_offset);
+		}
+
+		io_uring_sqe_set_data(sqe, GUINT_TO_POINTER(i));
+		results[i] = -ECANCELED;
+	}
+
+	// Every submitted request has to be reaped before returning because it still references the buffer
+	while (reaped < count)
+	{
+		struct io_uring_cqe* cqe;
+		gint ret;
+
+		if (submitted < count)
+		{
+			ret = io_uring_submit(ring);
+
+			if (ret > 0)
+			{
+				submitted += ret;
+				continue;
+			}
+
+			// The kernel might be short on resources until some requests have completed
+			if (reaped == submitted)
+			{
+				break;
+			}
+		}
+
+		if ((ret = io_uring_wait_cqe(ring, &cqe)) < 0)
+		{
+			if (ret == -EINTR || ret == -EAGAIN)
+			{
+				continue;
+			}
+
+			g_error("posix: Could not wait for io_uring requests (%s).", g_strerror(-ret));
+		}
+
+		results[GPOINTER_TO_UINT(io_uring_cqe_get_data(cqe))] = cqe->res;
+		io_uring_cqe_seen(ring, cqe);
+		reaped++;
+	}
+
+	if (submitted < count)
+	{
+		// Requests that could not be submitted are still queued and would be submitted later, discard them with the ring
+		g_private_replace(&jd_backend_ring, NULL);
+	}
+
+	for (guint i = 0; i < count; i++)
+	{
+		guint64 block_length = MIN(block_size, length - (i * block_size));
+
+		if (results[i] < 0)
+		{
+			break;
+		}
+
+		nbytes_total += results[i];
+
+		if ((guint64)results[i] < block_length)
+		{
+			break;
+		}
+	}
+
+	return nbytes_total;
+}
+#endif
+
 static void
 backend_file_unref(gpointer data)
 {
@@ -71,8 +353,20 @@ backend_file_unref(gpointer data)
 
 		j_trace_file_begin(file->path, J_TRACE_FILE_CLOSE);
 		close(file->fd);
+
+		if (file->direct_fd != -1)
+		{
+			close(file->direct_fd);
+		}
+
+		if (file->checksum_fd != -1)
+		{
+			close(file->checksum_fd);
+		}
+
 		j_trace_file_end(file->path, J_TRACE_FILE_CLOSE, 0, 0);
 
+		g_free(file->checksum_path);
 		g_free(file->path);
 		g_slice_free(JBackendFile, file);
 	}
@@ -130,243 +424,1645 @@ backend_file_add(GHashTable* files, JBackendFile* file)
 	G_UNLOCK(jd_backend_file_cache);
 }
 
-static gboolean
-backend_create(gchar const* namespace, gchar const* path, gpointer* data)
+/**
+ * Returns the full path of an object below base.
+ *
+ * The hash function must match the one in julea-posix-migrate.
+ */
+static gchar*
+backend_build_path_in(gchar const* base, gchar const* namespace, gchar const* path)
 {
-	GHashTable* files = jd_backend_files_get_thread();
-
-	JBackendFile* file = NULL;
-	g_autofree gchar* parent = NULL;
-	gchar* full_path;
-	gint fd;
-
-	full_path = g_build_filename(jd_backend_path, namespace, path, NULL);
-
-	if ((file = backend_file_get(files, full_path)) != NULL)
+	if (jd_backend_layout == JD_BACKEND_LAYOUT_SHARDED)
 	{
-		g_free(full_path);
+		gchar shard[2][3];
+		guint32 hash = 2166136261U;
 
-		// FIXME
-		fd = file->fd;
+		// FNV-1a, which is independent of the distribution's hash
+		for (gchar const* c = path; *c != '\0'; c++)
+		{
+			hash ^= (guchar)*c;
+			hash *= 16777619U;
+		}
 
-		goto end;
+		g_snprintf(shard[0], sizeof(shard[0]), "%02x", (hash >> 8) & 0xff);
+		g_snprintf(shard[1], sizeof(shard[1]), "%02x", hash & 0xff);
+
+		return g_build_filename(base, namespace, shard[0], shard[1], path, NULL);
 	}
 
-	j_trace_file_begin(full_path, J_TRACE_FILE_CREATE);
+	return g_build_filename(base, namespace, path, NULL);
+}
 
-	parent = g_path_get_dirname(full_path);
-	g_mkdir_with_parents(parent, 0700);
+/**
+ * Returns the full path of an object.
+ */
+static gchar*
+backend_build_path(gchar const* namespace, gchar const* path)
+{
+	return backend_build_path_in(jd_backend_path, namespace, path);
+}
 
-	fd = open(full_path, O_RDWR | O_CREAT, 0600);
+/**
+ * Creates the parent directory of path unless it is known to exist.
+ */
+static void
+backend_create_parent(gchar const* path)
+{
+	gchar* parent;
+	gboolean exists;
 
-	j_trace_file_end(full_path, J_TRACE_FILE_CREATE, 0, 0);
+	parent = g_path_get_dirname(path);
 
-	file = g_slice_new(JBackendFile);
-	file->path = full_path;
-	file->fd = fd;
-	file->ref_count = 1;
+	G_LOCK(jd_backend_directories);
+	exists = g_hash_table_contains(jd_backend_directories, parent);
+	G_UNLOCK(jd_backend_directories);
 
-	backend_file_add(files, file);
+	if (exists)
+	{
+		g_free(parent);
+		return;
+	}
 
-end:
-	*data = file;
+	// Only remember directories that exist, so that a failed attempt is repeated by the next create
+	if (g_mkdir_with_parents(parent, 0700) != 0 && errno != EEXIST)
+	{
+		g_free(parent);
+		return;
+	}
 
-	return (fd != -1);
+	G_LOCK(jd_backend_directories);
+	g_hash_table_add(jd_backend_directories, parent);
+	G_UNLOCK(jd_backend_directories);
 }
 
+/**
+ * Determines the layout of the storage.
+ *
+ * \param requested The requested layout, 0 if none.
+ */
 static gboolean
-backend_open(gchar const* namespace, gchar const* path, gpointer* data)
+backend_init_layout(guint requested)
 {
-	GHashTable* files = jd_backend_files_get_thread();
+	g_autoptr(GDir) dir = NULL;
+	g_autofree gchar* layout_path = NULL;
+	g_autofree gchar* contents = NULL;
+	guint layout;
 
-	JBackendFile* file = NULL;
-	gchar* full_path;
-	gint fd;
-
-	full_path = g_build_filename(jd_backend_path, namespace, path, NULL);
+	layout_path = g_build_filename(jd_backend_path, JD_BACKEND_LAYOUT_FILE, NULL);
 
-	if ((file = backend_file_get(files, full_path)) != NULL)
+	if (g_file_get_contents(layout_path, &contents, NULL, NULL))
 	{
-		g_free(full_path);
+		layout = g_ascii_strtoull(contents, NULL, 10);
+	}
+	else if ((dir = g_dir_open(jd_backend_path, 0, NULL)) != NULL && g_dir_read_name(dir) != NULL)
+	{
+		// Storage created before the layout was versioned
+		layout = JD_BACKEND_LAYOUT_FLAT;
+	}
+	else
+	{
+		g_autofree gchar* version = NULL;
 
-		// FIXME
-		fd = file->fd;
+		layout = (requested != 0) ? requested : JD_BACKEND_LAYOUT_FLAT;
+		version = g_strdup_printf("%u\n", layout);
 
-		goto end;
+		if (!g_file_set_contents(layout_path, version, -1, NULL))
+		{
+			g_critical("posix: Could not write layout file %s.", layout_path);
+			return FALSE;
+		}
 	}
 
-	j_trace_file_begin(full_path, J_TRACE_FILE_OPEN);
-	fd = open(full_path, O_RDWR);
-	j_trace_file_end(full_path, J_TRACE_FILE_OPEN, 0, 0);
+	if (layout != JD_BACKEND_LAYOUT_FLAT && layout != JD_BACKEND_LAYOUT_SHARDED)
+	{
+		g_critical("posix: Unknown layout %u.", layout);
+		return FALSE;
+	}
 
-	file = g_slice_new(JBackendFile);
-	file->path = full_path;
-	file->fd = fd;
-	file->ref_count = 1;
+	if (requested != 0 && requested != layout)
+	{
+		g_critical("posix: Storage uses layout %u but layout %u was requested, use julea-posix-migrate to convert it.", layout, requested);
+		return FALSE;
+	}
 
-	backend_file_add(files, file);
+	jd_backend_layout = layout;
 
-end:
-	*data = file;
+	return TRUE;
+}
 
-	return (fd != -1);
+/**
+ * Opens a second file descriptor for direct I/O.
+ * Returns -1 if direct I/O is disabled or not supported by the file system.
+ */
+static gint
+backend_open_direct(gchar const* path, gint fd)
+{
+	if (!jd_backend_direct || fd == -1)
+	{
+		return -1;
+	}
+
+	return open(path, O_RDWR | O_DIRECT);
 }
 
-static gboolean
-backend_delete(gpointer data)
+static gchar*
+backend_bounce_buffer_get(void)
 {
-	JBackendFile* file = data;
-	GHashTable* files = jd_backend_files_get_thread();
-	gboolean ret;
+	gpointer buffer = NULL;
 
-	j_trace_file_begin(file->path, J_TRACE_FILE_DELETE);
-	ret = (g_unlink(file->path) == 0);
-	j_trace_file_end(file->path, J_TRACE_FILE_DELETE, 0, 0);
+	G_LOCK(jd_backend_bounce_buffers);
 
-	g_hash_table_remove(files, file->path);
+	if (jd_backend_bounce_buffers != NULL)
+	{
+		buffer = jd_backend_bounce_buffers->data;
+		jd_backend_bounce_buffers = g_slist_delete_link(jd_backend_bounce_buffers, jd_backend_bounce_buffers);
+	}
 
-	return ret;
-}
+	G_UNLOCK(jd_backend_bounce_buffers);
 
-static gboolean
-backend_close(gpointer data)
-{
-	JBackendFile* file = data;
-	GHashTable* files = jd_backend_files_get_thread();
-	gboolean ret;
+	if (buffer == NULL && posix_memalign(&buffer, JD_BACKEND_DIRECT_ALIGNMENT, JD_BACKEND_DIRECT_BOUNCE_SIZE) != 0)
+	{
+		buffer = NULL;
+	}
 
-	ret = g_hash_table_remove(files, file->path);
+	return buffer;
+}
 
-	return ret;
+static void
+backend_bounce_buffer_put(gchar* buffer)
+{
+	G_LOCK(jd_backend_bounce_buffers);
+	jd_backend_bounce_buffers = g_slist_prepend(jd_backend_bounce_buffers, buffer);
+	G_UNLOCK(jd_backend_bounce_buffers);
 }
 
-static gboolean
-backend_status(gpointer data, gint64* modification_time, guint64* size)
+static guint64
+backend_pread(gint fd, gchar* buffer, guint64 length, guint64 offset)
 {
-	JBackendFile* file = data;
-	gboolean ret = TRUE;
-	struct stat buf;
+	guint64 nbytes_total = 0;
 
-	if (modification_time != NULL || size != NULL)
+	while (nbytes_total < length)
 	{
-		j_trace_file_begin(file->path, J_TRACE_FILE_STATUS);
-		ret = (fstat(file->fd, &buf) == 0);
-		j_trace_file_end(file->path, J_TRACE_FILE_STATUS, 0, 0);
-
-		if (ret && modification_time != NULL)
-		{
-			*modification_time = buf.st_mtime * G_USEC_PER_SEC;
+		gssize nbytes;
 
-#ifdef HAVE_STMTIM_TVNSEC
-			*modification_time += buf.st_mtim.tv_nsec / 1000;
-#endif
-		}
+		nbytes = pread(fd, buffer + nbytes_total, length - nbytes_total, offset + nbytes_total);
 
-		if (ret && size != NULL)
+		if (nbytes == 0)
 		{
-			*size = buf.st_size;
+			break;
 		}
-	}
-
+		else if (nbytes < 0)
+		{
+			if (errno != EINTR)
+			{
+				break;
+			}
+
+			continue;
+		}
+
+		nbytes_total += nbytes;
+	}
+
+	return nbytes_total;
+}
+
+static guint64
+backend_pwrite(gint fd, gchar const* buffer, guint64 length, guint64 offset)
+{
+	guint64 nbytes_total = 0;
+
+	while (nbytes_total < length)
+	{
+		gssize nbytes;
+
+		nbytes = pwrite(fd, buffer + nbytes_total, length - nbytes_total, offset + nbytes_total);
+
+		if (nbytes <= 0)
+		{
+			if (nbytes < 0 && errno == EINTR)
+			{
+				continue;
+			}
+
+			break;
+		}
+
+		nbytes_total += nbytes;
+	}
+
+	return nbytes_total;
+}
+
+/**
+ * Transfers an aligned range using direct I/O.
+ * Unaligned memory is copied through bounce buffers.
+ **/
+static guint64
+backend_direct_transfer(gint fd, gchar* buffer, guint64 length, guint64 offset, gboolean write)
+{
+	gchar* bounce_buffer;
+	guint64 nbytes_total = 0;
+
+	if ((guintptr)buffer % JD_BACKEND_DIRECT_ALIGNMENT == 0)
+	{
+		return (write) ? backend_pwrite(fd, buffer, length, offset) : backend_pread(fd, buffer, length, offset);
+	}
+
+	if ((bounce_buffer = backend_bounce_buffer_get()) == NULL)
+	{
+		return 0;
+	}
+
+	while (nbytes_total < length)
+	{
+		guint64 chunk_length = MIN(length - nbytes_total, JD_BACKEND_DIRECT_BOUNCE_SIZE);
+		guint64 nbytes;
+
+		if (write)
+		{
+			memcpy(bounce_buffer, buffer + nbytes_total, chunk_length);
+			nbytes = backend_pwrite(fd, bounce_buffer, chunk_length, offset + nbytes_total);
+		}
+		else
+		{
+			nbytes = backend_pread(fd, bounce_buffer, chunk_length, offset + nbytes_total);
+			memcpy(buffer + nbytes_total, bounce_buffer, nbytes);
+		}
+
+		nbytes_total += nbytes;
+
+		if (nbytes < chunk_length)
+		{
+			break;
+		}
+	}
+
+	backend_bounce_buffer_put(bounce_buffer);
+
+	return nbytes_total;
+}
+
+/**
+ * Reads or writes using direct I/O for the aligned part.
+ * The unaligned head and tail are transferred using buffered I/O.
+ **/
+static guint64
+backend_direct(JBackendFile* file, gchar* buffer, guint64 length, guint64 offset, gboolean write)
+{
+	guint64 head;
+	guint64 body;
+	guint64 tail;
+	guint64 nbytes_total = 0;
+	guint64 nbytes;
+
+	head = MIN(length, (JD_BACKEND_DIRECT_ALIGNMENT - (offset % JD_BACKEND_DIRECT_ALIGNMENT)) % JD_BACKEND_DIRECT_ALIGNMENT);
+	body = ((length - head) / JD_BACKEND_DIRECT_ALIGNMENT) * JD_BACKEND_DIRECT_ALIGNMENT;
+	tail = length - head - body;
+
+	if (write && length >= JD_BACKEND_DIRECT_BOUNCE_SIZE)
+	{
+		guint64 end = offset + length;
+
+		// Preallocate the next region when sequential writes cross into it
+		if (offset / JD_BACKEND_DIRECT_PREALLOCATE_SIZE != end / JD_BACKEND_DIRECT_PREALLOCATE_SIZE)
+		{
+			// This is only a hint, errors (for example, EOPNOTSUPP) are ignored
+			fallocate(file->fd, FALLOC_FL_KEEP_SIZE, (end / JD_BACKEND_DIRECT_PREALLOCATE_SIZE) * JD_BACKEND_DIRECT_PREALLOCATE_SIZE, JD_BACKEND_DIRECT_PREALLOCATE_SIZE);
+		}
+	}
+
+	if (head > 0)
+	{
+		nbytes = (write) ? backend_pwrite(file->fd, buffer, head, offset) : backend_pread(file->fd, buffer, head, offset);
+		nbytes_total += nbytes;
+
+		if (nbytes < head)
+		{
+			return nbytes_total;
+		}
+	}
+
+	if (body > 0)
+	{
+		nbytes = backend_direct_transfer(file->direct_fd, buffer + head, body, offset + head, write);
+		nbytes_total += nbytes;
+
+		if (nbytes < body)
+		{
+			return nbytes_total;
+		}
+	}
+
+	if (tail > 0)
+	{
+		nbytes = (write) ? backend_pwrite(file->fd, buffer + head + body, tail, offset + head + body) : backend_pread(file->fd, buffer + head + body, tail, offset + head + body);
+		nbytes_total += nbytes;
+	}
+
+	return nbytes_total;
+}
+
+static void
+backend_crc32c_init_table(void)
+{
+	for (guint i = 0; i < 256; i++)
+	{
+		guint32 crc = i;
+
+		for (guint j = 0; j < 8; j++)
+		{
+			// Reversed Castagnoli polynomial
+			crc = (crc >> 1) ^ ((crc & 1) ? 0x82f63b78U : 0);
+		}
+
+		jd_backend_crc32c_table[i] = crc;
+	}
+}
+
+static guint32
+backend_crc32c_update_generic(guint32 crc, guchar const* data, gsize length)
+{
+	for (gsize i = 0; i < length; i++)
+	{
+		crc = jd_backend_crc32c_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	}
+
+	return crc;
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+__attribute__((target("sse4.2"))) static guint32
+backend_crc32c_update_sse42(guint32 crc, guchar const* data, gsize length)
+{
+	guint64 crc64 = crc;
+
+	// The crc32 instruction processes eight bytes at once
+	while (length >= sizeof(guint64))
+	{
+		guint64 value;
+
+		memcpy(&value, data, sizeof(value));
+		crc64 = __builtin_ia32_crc32di(crc64, value);
+
+		data += sizeof(guint64);
+		length -= sizeof(guint64);
+	}
+
+	crc = crc64;
+
+	while (length > 0)
+	{
+		crc = __builtin_ia32_crc32qi(crc, *data);
+
+		data++;
+		length--;
+	}
+
+	return crc;
+}
+#endif
+
+static void
+backend_crc32c_init(void)
+{
+	backend_crc32c_init_table();
+	jd_backend_crc32c_update = backend_crc32c_update_generic;
+
+#if defined(__x86_64__) && defined(__GNUC__)
+	if (__builtin_cpu_supports("sse4.2"))
+	{
+		jd_backend_crc32c_update = backend_crc32c_update_sse42;
+	}
+#endif
+}
+
+/**
+ * Returns the checksum of a block, which is padded with zeroes if it is shorter than the block size.
+ */
+static guint32
+backend_checksum_block(gchar const* data, guint64 length)
+{
+	guint32 crc = 0xffffffffU;
+
+	crc = jd_backend_crc32c_update(crc, (guchar const*)data, length);
+	crc = jd_backend_crc32c_update(crc, jd_backend_zero_block, JD_BACKEND_CHECKSUM_BLOCK_SIZE - length);
+
+	return ~crc;
+}
+
+static GMutex*
+backend_checksum_lock(JBackendFile* file)
+{
+	return &(jd_backend_checksum_locks[g_str_hash(file->path) % JD_BACKEND_CHECKSUM_LOCKS]);
+}
+
+/**
+ * Opens the sidecar file of an object.
+ * Returns -1 if checksums are disabled.
+ */
+static gint
+backend_open_checksum(gchar const* checksum_path, gint fd)
+{
+	gint checksum_fd;
+
+	if (checksum_path == NULL || fd == -1)
+	{
+		return -1;
+	}
+
+	backend_create_parent(checksum_path);
+
+	if ((checksum_fd = open(checksum_path, O_RDWR | O_CREAT, 0600)) == -1)
+	{
+		g_warning("posix: Could not open checksum file %s, checksums are disabled for this object.", checksum_path);
+	}
+
+	return checksum_fd;
+}
+
+/**
+ * Locks the checksums of a file for a write.
+ * The lock has to be held across writing the data and backend_checksum_update(),
+ * otherwise a concurrent write to the same block could store the checksum of stale data.
+ *
+ * \return The lock, NULL if the file has no checksums.
+ */
+static GMutex*
+backend_checksum_write_begin(JBackendFile* file)
+{
+	GMutex* lock;
+
+	if (file->checksum_fd == -1)
+	{
+		return NULL;
+	}
+
+	lock = backend_checksum_lock(file);
+	g_mutex_lock(lock);
+
+	return lock;
+}
+
+static void
+backend_checksum_write_end(GMutex* lock)
+{
+	if (lock != NULL)
+	{
+		g_mutex_unlock(lock);
+	}
+}
+
+/**
+ * Updates the checksums of all blocks touched by a write.
+ * Blocks that are only partially written are read back from the file.
+ * Must be called with the lock returned by backend_checksum_write_begin() held.
+ */
+static void
+backend_checksum_update(JBackendFile* file, gchar const* buffer, guint64 length, guint64 offset)
+{
+	g_autofree guint32* checksums = NULL;
+	g_autofree gchar* block = NULL;
+	guint64 first;
+	guint64 last;
+
+	if (file->checksum_fd == -1 || length == 0)
+	{
+		return;
+	}
+
+	first = offset / JD_BACKEND_CHECKSUM_BLOCK_SIZE;
+	last = (offset + length - 1) / JD_BACKEND_CHECKSUM_BLOCK_SIZE;
+	checksums = g_new(guint32, last - first + 1);
+
+	for (guint64 i = first; i <= last; i++)
+	{
+		guint64 block_offset = i * JD_BACKEND_CHECKSUM_BLOCK_SIZE;
+
+		if (block_offset >= offset && block_offset + JD_BACKEND_CHECKSUM_BLOCK_SIZE <= offset + length)
+		{
+			checksums[i - first] = backend_checksum_block(buffer + (block_offset - offset), JD_BACKEND_CHECKSUM_BLOCK_SIZE);
+		}
+		else
+		{
+			guint64 nbytes;
+
+			if (block == NULL)
+			{
+				block = g_malloc(JD_BACKEND_CHECKSUM_BLOCK_SIZE);
+			}
+
+			nbytes = backend_pread(file->fd, block, JD_BACKEND_CHECKSUM_BLOCK_SIZE, block_offset);
+			checksums[i - first] = backend_checksum_block(block, nbytes);
+		}
+	}
+
+	backend_pwrite(file->checksum_fd, (gchar const*)checksums, (last - first + 1) * sizeof(guint32), first * sizeof(guint32));
+}
+
+/**
+ * Verifies the checksums of all blocks touched by a read.
+ * Blocks that are only partially read are read completely from the file.
+ *
+ * \return The number of bytes before the first corrupted block.
+ */
+static guint64
+backend_checksum_verify(JBackendFile* file, gchar const* buffer, guint64 length, guint64 offset)
+{
+	g_autofree guint32* checksums = NULL;
+	g_autofree gchar* block = NULL;
+	guint64 first;
+	guint64 last;
+	guint64 count;
+	guint64 nbytes;
+
+	if (file->checksum_fd == -1 || length == 0)
+	{
+		return length;
+	}
+
+	first = offset / JD_BACKEND_CHECKSUM_BLOCK_SIZE;
+	last = (offset + length - 1) / JD_BACKEND_CHECKSUM_BLOCK_SIZE;
+	count = last - first + 1;
+	checksums = g_new(guint32, count);
+
+	// Blocks without a stored checksum cannot be verified
+	nbytes = backend_pread(file->checksum_fd, (gchar*)checksums, count * sizeof(guint32), first * sizeof(guint32));
+	memset((gchar*)checksums + nbytes, 0, (count * sizeof(guint32)) - nbytes);
+
+	for (guint64 i = first; i <= last; i++)
+	{
+		guint64 block_offset = i * JD_BACKEND_CHECKSUM_BLOCK_SIZE;
+		guint32 checksum;
+
+		if (checksums[i - first] == 0)
+		{
+			continue;
+		}
+
+		if (block_offset >= offset && block_offset + JD_BACKEND_CHECKSUM_BLOCK_SIZE <= offset + length)
+		{
+			checksum = backend_checksum_block(buffer + (block_offset - offset), JD_BACKEND_CHECKSUM_BLOCK_SIZE);
+		}
+		else
+		{
+			if (block == NULL)
+			{
+				block = g_malloc(JD_BACKEND_CHECKSUM_BLOCK_SIZE);
+			}
+
+			nbytes = backend_pread(file->fd, block, JD_BACKEND_CHECKSUM_BLOCK_SIZE, block_offset);
+			checksum = backend_checksum_block(block, nbytes);
+		}
+
+		if (checksum != checksums[i - first])
+		{
+			GMutex* lock = backend_checksum_lock(file);
+			guint32 stored = 0;
+
+			if (block == NULL)
+			{
+				block = g_malloc(JD_BACKEND_CHECKSUM_BLOCK_SIZE);
+			}
+
+			// The block might have been modified by a concurrent write, check the current contents
+			g_mutex_lock(lock);
+			backend_pread(file->checksum_fd, (gchar*)&stored, sizeof(stored), i * sizeof(guint32));
+			nbytes = backend_pread(file->fd, block, JD_BACKEND_CHECKSUM_BLOCK_SIZE, block_offset);
+			checksum = backend_checksum_block(block, nbytes);
+			g_mutex_unlock(lock);
+
+			if (checksum == stored)
+			{
+				continue;
+			}
+
+			g_warning("posix: Checksum mismatch in block %" G_GUINT64_FORMAT " of %s.", i, file->path);
+
+			return (block_offset > offset) ? block_offset - offset : 0;
+		}
+	}
+
+	return length;
+}
+
+static gboolean
+backend_scrub_stopped(void)
+{
+	gboolean stop;
+
+	g_mutex_lock(&jd_backend_scrub_mutex);
+	stop = jd_backend_scrub_stop;
+	g_mutex_unlock(&jd_backend_scrub_mutex);
+
+	return stop;
+}
+
+/**
+ * Verifies the checksums of all blocks of an object.
+ * Corrupted blocks are only reported, reads of them fail via backend_checksum_verify().
+ */
+static void
+backend_scrub_file(gchar const* path, gchar const* checksum_path)
+{
+	g_autofree gchar* block = NULL;
+	GMutex* lock;
+	gint fd;
+	gint checksum_fd;
+
+	if ((fd = open(path, O_RDONLY)) == -1)
+	{
+		return;
+	}
+
+	if ((checksum_fd = open(checksum_path, O_RDONLY)) == -1)
+	{
+		close(fd);
+		return;
+	}
+
+	block = g_malloc(JD_BACKEND_CHECKSUM_BLOCK_SIZE);
+	// Objects opened by the server use the same path, see backend_build_path()
+	lock = &(jd_backend_checksum_locks[g_str_hash(path) % JD_BACKEND_CHECKSUM_LOCKS]);
+
+	for (guint64 i = 0; !backend_scrub_stopped(); i++)
+	{
+		guint32 stored = 0;
+		guint32 checksum;
+		guint64 nbytes;
+
+		// Writes update the data and the checksum atomically with respect to this lock
+		g_mutex_lock(lock);
+
+		if (backend_pread(checksum_fd, (gchar*)&stored, sizeof(stored), i * sizeof(guint32)) < sizeof(stored))
+		{
+			g_mutex_unlock(lock);
+			break;
+		}
+
+		if (stored == 0)
+		{
+			g_mutex_unlock(lock);
+			continue;
+		}
+
+		nbytes = backend_pread(fd, block, JD_BACKEND_CHECKSUM_BLOCK_SIZE, i * JD_BACKEND_CHECKSUM_BLOCK_SIZE);
+		checksum = backend_checksum_block(block, nbytes);
+
+		g_mutex_unlock(lock);
+
+		if (checksum != stored)
+		{
+			g_warning("posix: Checksum mismatch in block %" G_GUINT64_FORMAT " of %s found while scrubbing.", i, path);
+		}
+	}
+
+	close(checksum_fd);
+	close(fd);
+}
+
+/**
+ * Scrubs all objects below a directory.
+ *
+ * \param relative The path relative to the storage directory, NULL for the storage directory itself.
+ */
+static void
+backend_scrub_directory(gchar const* relative)
+{
+	g_autoptr(GDir) dir = NULL;
+	g_autofree gchar* path = NULL;
+	gchar const* entry;
+
+	path = (relative != NULL) ? g_build_filename(jd_backend_path, relative, NULL) : g_strdup(jd_backend_path);
+
+	if ((dir = g_dir_open(path, 0, NULL)) == NULL)
+	{
+		return;
+	}
+
+	while ((entry = g_dir_read_name(dir)) != NULL && !backend_scrub_stopped())
+	{
+		g_autofree gchar* entry_relative = NULL;
+		g_autofree gchar* entry_path = NULL;
+
+		// Skip the sidecar files and the layout file
+		if (relative == NULL && g_str_has_prefix(entry, ".julea-"))
+		{
+			continue;
+		}
+
+		entry_relative = (relative != NULL) ? g_build_filename(relative, entry, NULL) : g_strdup(entry);
+		entry_path = g_build_filename(path, entry, NULL);
+
+		if (g_file_test(entry_path, G_FILE_TEST_IS_SYMLINK))
+		{
+			continue;
+		}
+
+		if (g_file_test(entry_path, G_FILE_TEST_IS_DIR))
+		{
+			backend_scrub_directory(entry_relative);
+		}
+		else
+		{
+			g_autofree gchar* checksum_path = NULL;
+
+			checksum_path = g_build_filename(jd_backend_checksum_path, entry_relative, NULL);
+			backend_scrub_file(entry_path, checksum_path);
+		}
+	}
+}
+
+/**
+ * Periodically verifies the checksums of all objects in the background.
+ * This detects corruption of data that is rarely read.
+ */
+static gpointer
+backend_scrub_thread(gpointer data)
+{
+	(void)data;
+
+	g_mutex_lock(&jd_backend_scrub_mutex);
+
+	while (!jd_backend_scrub_stop)
+	{
+		g_cond_wait_until(&jd_backend_scrub_cond, &jd_backend_scrub_mutex, g_get_monotonic_time() + jd_backend_scrub_interval * G_TIME_SPAN_SECOND);
+
+		if (jd_backend_scrub_stop)
+		{
+			break;
+		}
+
+		g_mutex_unlock(&jd_backend_scrub_mutex);
+		backend_scrub_directory(NULL);
+		g_mutex_lock(&jd_backend_scrub_mutex);
+	}
+
+	g_mutex_unlock(&jd_backend_scrub_mutex);
+
+	return NULL;
+}
+
+static gboolean
+backend_create(gchar const* namespace, gchar const* path, gpointer* data)
+{
+	GHashTable* files = jd_backend_files_get_thread();
+
+	JBackendFile* file = NULL;
+	gchar* full_path;
+	gint fd;
+
+	full_path = backend_build_path(namespace, path);
+
+	if ((file = backend_file_get(files, full_path)) != NULL)
+	{
+		g_free(full_path);
+
+		// FIXME
+		fd = file->fd;
+
+		goto end;
+	}
+
+	j_trace_file_begin(full_path, J_TRACE_FILE_CREATE);
+
+	backend_create_parent(full_path);
+
+	fd = open(full_path, O_RDWR | O_CREAT, 0600);
+
+	if (fd == -1 && errno == ENOENT)
+	{
+		// The cached directory might have been removed in the meantime
+		g_autofree gchar* parent = NULL;
+
+		parent = g_path_get_dirname(full_path);
+		g_mkdir_with_parents(parent, 0700);
+
+		fd = open(full_path, O_RDWR | O_CREAT, 0600);
+	}
+
+	j_trace_file_end(full_path, J_TRACE_FILE_CREATE, 0, 0);
+
+	file = g_slice_new(JBackendFile);
+	file->path = full_path;
+	file->fd = fd;
+	file->direct_fd = backend_open_direct(full_path, fd);
+	file->checksum_path = (jd_backend_checksum) ? backend_build_path_in(jd_backend_checksum_path, namespace, path) : NULL;
+	file->checksum_fd = backend_open_checksum(file->checksum_path, fd);
+	file->ref_count = 1;
+
+	backend_file_add(files, file);
+
+end:
+	*data = file;
+
+	return (fd != -1);
+}
+
+static gboolean
+backend_open(gchar const* namespace, gchar const* path, gpointer* data)
+{
+	GHashTable* files = jd_backend_files_get_thread();
+
+	JBackendFile* file = NULL;
+	gchar* full_path;
+	gint fd;
+
+	full_path = backend_build_path(namespace, path);
+
+	if ((file = backend_file_get(files, full_path)) != NULL)
+	{
+		g_free(full_path);
+
+		// FIXME
+		fd = file->fd;
+
+		goto end;
+	}
+
+	j_trace_file_begin(full_path, J_TRACE_FILE_OPEN);
+	fd = open(full_path, O_RDWR);
+	j_trace_file_end(full_path, J_TRACE_FILE_OPEN, 0, 0);
+
+	file = g_slice_new(JBackendFile);
+	file->path = full_path;
+	file->fd = fd;
+	file->direct_fd = backend_open_direct(full_path, fd);
+	file->checksum_path = (jd_backend_checksum) ? backend_build_path_in(jd_backend_checksum_path, namespace, path) : NULL;
+	file->checksum_fd = backend_open_checksum(file->checksum_path, fd);
+	file->ref_count = 1;
+
+	backend_file_add(files, file);
+
+end:
+	*data = file;
+
+	return (fd != -1);
+}
+
+static gboolean
+backend_delete(gpointer data)
+{
+	JBackendFile* file = data;
+	GHashTable* files = jd_backend_files_get_thread();
+	gboolean ret;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_DELETE);
+	ret = (g_unlink(file->path) == 0);
+
+	if (file->checksum_path != NULL)
+	{
+		g_unlink(file->checksum_path);
+	}
+
+	j_trace_file_end(file->path, J_TRACE_FILE_DELETE, 0, 0);
+
+	g_hash_table_remove(files, file->path);
+
+	return ret;
+}
+
+static gboolean
+backend_close(gpointer data)
+{
+	JBackendFile* file = data;
+	GHashTable* files = jd_backend_files_get_thread();
+	gboolean ret;
+
+	ret = g_hash_table_remove(files, file->path);
+
+	return ret;
+}
+
+/**
+ * Removes a directory and everything below it.
+ */
+static gboolean
+backend_remove_directory(gchar const* path)
+{
+	g_autoptr(GDir) dir = NULL;
+	gchar const* entry;
+	gboolean ret = TRUE;
+
+	if ((dir = g_dir_open(path, 0, NULL)) == NULL)
+	{
+		return FALSE;
+	}
+
+	while ((entry = g_dir_read_name(dir)) != NULL)
+	{
+		g_autofree gchar* entry_path = NULL;
+
+		entry_path = g_build_filename(path, entry, NULL);
+
+		if (g_file_test(entry_path, G_FILE_TEST_IS_DIR) && !g_file_test(entry_path, G_FILE_TEST_IS_SYMLINK))
+		{
+			ret = backend_remove_directory(entry_path) && ret;
+		}
+		else
+		{
+			ret = (g_unlink(entry_path) == 0) && ret;
+		}
+	}
+
+	ret = (g_rmdir(path) == 0) && ret;
+
+	return ret;
+}
+
+static gboolean
+backend_directory_is_below(gpointer key, gpointer value, gpointer data)
+{
+	gchar const* directory = key;
+	gchar const* path = data;
+	gsize path_len;
+
+	(void)value;
+
+	path_len = strlen(path);
+
+	return (strncmp(directory, path, path_len) == 0 && (directory[path_len] == '\0' || directory[path_len] == G_DIR_SEPARATOR));
+}
+
+static gboolean
+backend_delete_namespace(gchar const* namespace)
+{
+	g_autofree gchar* path = NULL;
+	gboolean ret = TRUE;
+
+	// Namespaces must not refer to the storage directory itself, other directories or the backend's own files
+	if (namespace[0] == '\0' || g_strcmp0(namespace, ".") == 0 || g_strcmp0(namespace, "..") == 0
+	    || strchr(namespace, '/') != NULL || strchr(namespace, G_DIR_SEPARATOR) != NULL
+	    || g_strcmp0(namespace, JD_BACKEND_CHECKSUM_DIR) == 0 || g_strcmp0(namespace, JD_BACKEND_LAYOUT_FILE) == 0)
+	{
+		g_warning("posix: Refusing to delete invalid namespace \"%s\".", namespace);
+		return FALSE;
+	}
+
+	path = g_build_filename(jd_backend_path, namespace, NULL);
+
+	j_trace_file_begin(path, J_TRACE_FILE_DELETE);
+
+	// The whole directory is removed at once, which is much cheaper than deleting every object via a message of its own
+	if (g_file_test(path, G_FILE_TEST_IS_DIR))
+	{
+		ret = backend_remove_directory(path);
+	}
+
+	if (jd_backend_checksum)
+	{
+		g_autofree gchar* checksum_path = NULL;
+
+		checksum_path = g_build_filename(jd_backend_checksum_path, namespace, NULL);
+
+		if (g_file_test(checksum_path, G_FILE_TEST_IS_DIR))
+		{
+			ret = backend_remove_directory(checksum_path) && ret;
+		}
+
+		G_LOCK(jd_backend_directories);
+		g_hash_table_foreach_remove(jd_backend_directories, backend_directory_is_below, checksum_path);
+		G_UNLOCK(jd_backend_directories);
+	}
+
+	j_trace_file_end(path, J_TRACE_FILE_DELETE, 0, 0);
+
+	// The directories have to be created again for new objects
+	G_LOCK(jd_backend_directories);
+	g_hash_table_foreach_remove(jd_backend_directories, backend_directory_is_below, path);
+	G_UNLOCK(jd_backend_directories);
+
+	return ret;
+}
+
+static gboolean
+backend_status(gpointer data, gint64* modification_time, guint64* size)
+{
+	JBackendFile* file = data;
+	gboolean ret = TRUE;
+	struct stat buf;
+
+	if (modification_time != NULL || size != NULL)
+	{
+		j_trace_file_begin(file->path, J_TRACE_FILE_STATUS);
+		ret = (fstat(file->fd, &buf) == 0);
+		j_trace_file_end(file->path, J_TRACE_FILE_STATUS, 0, 0);
+
+		if (ret && modification_time != NULL)
+		{
+			*modification_time = buf.st_mtime * G_USEC_PER_SEC;
+
+#ifdef HAVE_STMTIM_TVNSEC
+			*modification_time += buf.st_mtim.tv_nsec / 1000;
+#endif
+		}
+
+		if (ret && size != NULL)
+		{
+			*size = buf.st_size;
+		}
+	}
+
+	return ret;
+}
+
+static gboolean
+backend_sync(gpointer data)
+{
+	JBackendFile* file = data;
+	gboolean ret;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_SYNC);
+	ret = (fsync(file->fd) == 0);
+	j_trace_file_end(file->path, J_TRACE_FILE_SYNC, 0, 0);
+
 	return ret;
 }
 
-static gboolean
-backend_sync(gpointer data)
+/**
+ * Reads from a file and verifies the checksums of the data read.
+ *
+ * \param failed Set to TRUE if the data is corrupted.
+ *
+ * \return The number of valid bytes read.
+ */
+static guint64
+backend_read_file(JBackendFile* file, gchar* buffer, guint64 length, guint64 offset, gboolean* failed)
+{
+	guint64 nbytes_total = 0;
+	guint64 nbytes_valid;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_READ);
+
+	if (file->direct_fd != -1)
+	{
+		nbytes_total = backend_direct(file, buffer, length, offset, FALSE);
+	}
+	else
+	{
+#ifdef HAVE_LIBURING
+		if (jd_backend_io_uring)
+		{
+			nbytes_total = backend_io_uring_transfer(file->fd, buffer, length, offset, FALSE);
+		}
+#endif
+
+		// Also handles short and failed io_uring reads
+		nbytes_total += backend_pread(file->fd, buffer + nbytes_total, length - nbytes_total, offset + nbytes_total);
+	}
+
+	j_trace_file_end(file->path, J_TRACE_FILE_READ, nbytes_total, offset);
+
+	nbytes_valid = backend_checksum_verify(file, buffer, nbytes_total, offset);
+	*failed = (nbytes_valid < nbytes_total);
+
+	return nbytes_valid;
+}
+
+static gboolean
+backend_read(gpointer data, gpointer buffer, guint64 length, guint64 offset, guint64* bytes_read)
+{
+	JBackendFile* file = data;
+
+	gboolean failed;
+	guint64 nbytes_total;
+
+	nbytes_total = backend_read_file(file, buffer, length, offset, &failed);
+
+	if (bytes_read != NULL)
+	{
+		*bytes_read = nbytes_total;
+	}
+
+	return (nbytes_total == length && !failed);
+}
+
+static gboolean
+backend_write(gpointer data, gconstpointer buffer, guint64 length, guint64 offset, guint64* bytes_written)
+{
+	JBackendFile* file = data;
+
+	GMutex* lock;
+	gsize nbytes_total = 0;
+
+	lock = backend_checksum_write_begin(file);
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_WRITE);
+
+	if (file->direct_fd != -1)
+	{
+		// The buffer is not modified when writing
+		nbytes_total = backend_direct(file, (gchar*)(guintptr)buffer, length, offset, TRUE);
+	}
+	else
+	{
+#ifdef HAVE_LIBURING
+		if (jd_backend_io_uring)
+		{
+			// io_uring does not modify the buffer
+			nbytes_total = backend_io_uring_transfer(file->fd, (gchar*)(guintptr)buffer, length, offset, TRUE);
+		}
+#endif
+
+		// Also handles short and failed io_uring writes
+		nbytes_total += backend_pwrite(file->fd, (gchar const*)buffer + nbytes_total, length - nbytes_total, offset + nbytes_total);
+	}
+
+	j_trace_file_end(file->path, J_TRACE_FILE_WRITE, nbytes_total, offset);
+
+	backend_checksum_update(file, buffer, nbytes_total, offset);
+	backend_checksum_write_end(lock);
+
+	if (bytes_written != NULL)
+	{
+		*bytes_written = nbytes_total;
+	}
+
+	return (nbytes_total == length);
+}
+
+static gint
+backend_range_compare(gconstpointer a, gconstpointer b, gpointer data)
 {
-	JBackendFile* file = data;
-	gboolean ret;
+	JBackendObjectRange const* range_a = *(JBackendObjectRange* const*)a;
+	JBackendObjectRange const* range_b = *(JBackendObjectRange* const*)b;
 
-	j_trace_file_begin(file->path, J_TRACE_FILE_SYNC);
-	ret = (fsync(file->fd) == 0);
-	j_trace_file_end(file->path, J_TRACE_FILE_SYNC, 0, 0);
+	(void)data;
 
-	return ret;
+	if (range_a->offset < range_b->offset)
+	{
+		return -1;
+	}
+
+	return (range_a->offset > range_b->offset) ? 1 : 0;
 }
 
+/**
+ * Transfers multiple ranges using preadv() and pwritev().
+ * Ranges are sorted by offset so that adjacent ranges can be transferred with a single system call.
+ **/
 static gboolean
-backend_read(gpointer data, gpointer buffer, guint64 length, guint64 offset, guint64* bytes_read)
+backend_transfer_ranges(JBackendFile* file, JBackendObjectRange* ranges, guint range_count, gboolean write)
 {
-	JBackendFile* file = data;
+	g_autofree JBackendObjectRange** sorted = NULL;
+	g_autofree struct iovec* iov = NULL;
+	GMutex* lock = NULL;
+	gboolean ret = TRUE;
+	guint64 nbytes_total = 0;
 
-	gsize nbytes_total = 0;
+	sorted = g_new(JBackendObjectRange*, range_count);
 
-	j_trace_file_begin(file->path, J_TRACE_FILE_READ);
+	for (guint i = 0; i < range_count; i++)
+	{
+		sorted[i] = &(ranges[i]);
+	}
 
-	while (nbytes_total < length)
+	// The sort is stable, so identical ranges are still transferred in order
+	g_qsort_with_data(sorted, range_count, sizeof(JBackendObjectRange*), backend_range_compare, NULL);
+
+	if (write)
+	{
+		for (guint i = 1; i < range_count; i++)
+		{
+			// Overlapping writes have to be performed in their original order
+			if (sorted[i]->offset < sorted[i - 1]->offset + sorted[i - 1]->length)
+			{
+				for (guint j = 0; j < range_count; j++)
+				{
+					sorted[j] = &(ranges[j]);
+				}
+
+				break;
+			}
+		}
+	}
+
+	iov = g_new(struct iovec, MIN(range_count, IOV_MAX));
+
+	if (write)
+	{
+		lock = backend_checksum_write_begin(file);
+	}
+
+	j_trace_file_begin(file->path, (write) ? J_TRACE_FILE_WRITE : J_TRACE_FILE_READ);
+
+	for (guint i = 0; i < range_count;)
 	{
+		guint64 offset;
+		guint64 length = 0;
+		guint count = 0;
 		gssize nbytes;
 
-		nbytes = pread(file->fd, (gchar*)buffer + nbytes_total, length - nbytes_total, offset + nbytes_total);
+		offset = sorted[i]->offset;
 
-		if (nbytes == 0)
+		// Collect adjacent ranges
+		while (i + count < range_count && count < IOV_MAX && sorted[i + count]->offset == offset + length)
 		{
-			break;
+			iov[count].iov_base = sorted[i + count]->buffer;
+			iov[count].iov_len = sorted[i + count]->length;
+			length += sorted[i + count]->length;
+			count++;
 		}
-		else if (nbytes < 0)
+
+		do
 		{
-			if (errno != EINTR)
+			nbytes = (write) ? pwritev(file->fd, iov, count, offset) : preadv(file->fd, iov, count, offset);
+		} while (nbytes < 0 && errno == EINTR);
+
+		if (nbytes < 0)
+		{
+			nbytes = 0;
+		}
+
+		for (guint j = 0; j < count; j++)
+		{
+			JBackendObjectRange* range = sorted[i + j];
+			guint64 done;
+
+			done = MIN((guint64)nbytes, range->length);
+			nbytes -= done;
+
+			// Finish short transfers range by range, which also detects the end of the file
+			if (done < range->length)
 			{
-				break;
+				gchar* buffer = (gchar*)range->buffer + done;
+
+				done += (write) ? backend_pwrite(file->fd, buffer, range->length - done, range->offset + done) : backend_pread(file->fd, buffer, range->length - done, range->offset + done);
+			}
+
+			if (write)
+			{
+				backend_checksum_update(file, range->buffer, done, range->offset);
+			}
+			else
+			{
+				guint64 valid;
+
+				valid = backend_checksum_verify(file, range->buffer, done, range->offset);
+				range->failed = (valid < done);
+				done = valid;
 			}
+
+			range->bytes = done;
+			nbytes_total += done;
+			ret = (done == range->length && !range->failed) && ret;
 		}
 
-		nbytes_total += nbytes;
+		i += count;
 	}
 
-	j_trace_file_end(file->path, J_TRACE_FILE_READ, nbytes_total, offset);
+	j_trace_file_end(file->path, (write) ? J_TRACE_FILE_WRITE : J_TRACE_FILE_READ, nbytes_total, (range_count > 0) ? sorted[0]->offset : 0);
 
-	if (bytes_read != NULL)
+	backend_checksum_write_end(lock);
+
+	return ret;
+}
+
+/**
+ * Returns whether ranges can be transferred using backend_transfer_ranges().
+ * Direct I/O and io_uring are handled by backend_read() and backend_write().
+ **/
+static gboolean
+backend_use_vectored(JBackendFile* file)
+{
+#ifdef HAVE_LIBURING
+	if (jd_backend_io_uring)
 	{
-		*bytes_read = nbytes_total;
+		return FALSE;
 	}
+#endif
 
-	return (nbytes_total == length);
+	return (file->direct_fd == -1);
 }
 
 static gboolean
-backend_write(gpointer data, gconstpointer buffer, guint64 length, guint64 offset, guint64* bytes_written)
+backend_readv(gpointer data, JBackendObjectRange* ranges, guint range_count)
 {
 	JBackendFile* file = data;
+	gboolean ret = TRUE;
 
-	gsize nbytes_total = 0;
+	if (backend_use_vectored(file))
+	{
+		return backend_transfer_ranges(file, ranges, range_count, FALSE);
+	}
 
-	j_trace_file_begin(file->path, J_TRACE_FILE_WRITE);
+	for (guint i = 0; i < range_count; i++)
+	{
+		ranges[i].bytes = backend_read_file(file, ranges[i].buffer, ranges[i].length, ranges[i].offset, &(ranges[i].failed));
+		ret = (ranges[i].bytes == ranges[i].length && !ranges[i].failed) && ret;
+	}
 
-	while (nbytes_total < length)
+	return ret;
+}
+
+static gboolean
+backend_writev(gpointer data, JBackendObjectRange* ranges, guint range_count)
+{
+	JBackendFile* file = data;
+	gboolean ret = TRUE;
+
+	if (backend_use_vectored(file))
 	{
-		gssize nbytes;
+		return backend_transfer_ranges(file, ranges, range_count, TRUE);
+	}
 
-		nbytes = pwrite(file->fd, (gchar const*)buffer + nbytes_total, length - nbytes_total, offset + nbytes_total);
+	for (guint i = 0; i < range_count; i++)
+	{
+		ranges[i].bytes = 0;
+		ret = backend_write(file, ranges[i].buffer, ranges[i].length, ranges[i].offset, &(ranges[i].bytes)) && ret;
+	}
 
-		if (nbytes <= 0)
+	return ret;
+}
+
+#ifdef HAVE_LIBURING
+/**
+ * The maximum number of asynchronous requests in flight per queue.
+ */
+#define JD_BACKEND_QUEUE_DEPTH 128
+
+struct JBackendRing
+{
+	struct io_uring ring;
+
+	/**
+	 * The number of requests that have been submitted to the ring but not completed.
+	 */
+	guint in_flight;
+
+	/**
+	 * The number of requests completed since the last call to backend_poll().
+	 */
+	guint completed;
+};
+
+typedef struct JBackendRing JBackendRing;
+
+static gpointer
+backend_queue_new(void)
+{
+	JBackendRing* ring;
+
+	if (!jd_backend_io_uring)
+	{
+		return NULL;
+	}
+
+	ring = g_slice_new(JBackendRing);
+	ring->in_flight = 0;
+	ring->completed = 0;
+
+	if (io_uring_queue_init(JD_BACKEND_QUEUE_DEPTH, &(ring->ring), 0) < 0)
+	{
+		g_slice_free(JBackendRing, ring);
+		return NULL;
+	}
+
+	return ring;
+}
+
+static void
+backend_queue_free(gpointer data)
+{
+	JBackendRing* ring = data;
+
+	g_assert(ring->in_flight == 0);
+
+	io_uring_queue_exit(&(ring->ring));
+	g_slice_free(JBackendRing, ring);
+}
+
+/**
+ * Finishes a request whose asynchronous part returned result.
+ * Short transfers are completed synchronously, which also detects the end of the file.
+ */
+static void
+backend_request_finish(JBackendRing* ring, JBackendRequest* request, gint result)
+{
+	JBackendFile* file = request->data;
+	gchar* buffer = request->object.buffer;
+	guint64 length = request->object.length;
+	guint64 offset = request->object.offset;
+	guint64 done;
+
+	done = (result > 0) ? (guint64)result : 0;
+
+	if (done < length)
+	{
+		if (request->type == J_BACKEND_REQUEST_OBJECT_WRITE)
 		{
-			if (errno != EINTR)
-			{
-				break;
-			}
+			done += backend_pwrite(file->fd, buffer + done, length - done, offset + done);
+		}
+		else
+		{
+			done += backend_pread(file->fd, buffer + done, length - done, offset + done);
 		}
+	}
 
-		nbytes_total += nbytes;
+	j_trace_file_end(file->path, (request->type == J_BACKEND_REQUEST_OBJECT_WRITE) ? J_TRACE_FILE_WRITE : J_TRACE_FILE_READ, done, offset);
+
+	request->object.failed = FALSE;
+
+	// Writes to files with checksums are not queued, see backend_submit()
+	if (request->type == J_BACKEND_REQUEST_OBJECT_READ)
+	{
+		guint64 valid;
+
+		valid = backend_checksum_verify(file, buffer, done, offset);
+		request->object.failed = (valid < done);
+		done = valid;
 	}
 
-	j_trace_file_end(file->path, J_TRACE_FILE_WRITE, nbytes_total, offset);
+	request->object.bytes = done;
+	request->ret = (done == length && !request->object.failed);
 
-	if (bytes_written != NULL)
+	ring->completed++;
+}
+
+/**
+ * Reaps completed requests.
+ */
+static void
+backend_ring_reap(JBackendRing* ring, gboolean wait)
+{
+	struct io_uring_cqe* cqe;
+
+	if (wait && ring->in_flight > 0)
 	{
-		*bytes_written = nbytes_total;
+		if (io_uring_wait_cqe(&(ring->ring), &cqe) == 0)
+		{
+			backend_request_finish(ring, io_uring_cqe_get_data(cqe), cqe->res);
+			io_uring_cqe_seen(&(ring->ring), cqe);
+			ring->in_flight--;
+		}
 	}
 
-	return (nbytes_total == length);
+	while (ring->in_flight > 0 && io_uring_peek_cqe(&(ring->ring), &cqe) == 0)
+	{
+		backend_request_finish(ring, io_uring_cqe_get_data(cqe), cqe->res);
+		io_uring_cqe_seen(&(ring->ring), cqe);
+		ring->in_flight--;
+	}
+}
+
+static gboolean
+backend_submit(gpointer data, JBackendRequest* request)
+{
+	JBackendRing* ring = data;
+	JBackendFile* file = request->data;
+	struct io_uring_sqe* sqe;
+
+	if (request->type != J_BACKEND_REQUEST_OBJECT_READ && request->type != J_BACKEND_REQUEST_OBJECT_WRITE)
+	{
+		return FALSE;
+	}
+
+	// Direct I/O requires aligned transfers, which are handled by backend_direct()
+	if (file->direct_fd != -1 || request->object.length > G_MAXUINT32)
+	{
+		return FALSE;
+	}
+
+	// The checksum lock cannot be held while a write is in flight, so these writes are performed synchronously
+	if (request->type == J_BACKEND_REQUEST_OBJECT_WRITE && file->checksum_fd != -1)
+	{
+		return FALSE;
+	}
+
+	// Keep the number of requests in flight below the size of the completion queue
+	if (ring->in_flight >= JD_BACKEND_QUEUE_DEPTH)
+	{
+		io_uring_submit(&(ring->ring));
+		backend_ring_reap(ring, TRUE);
+	}
+
+	if ((sqe = io_uring_get_sqe(&(ring->ring))) == NULL)
+	{
+		io_uring_submit(&(ring->ring));
+
+		if ((sqe = io_uring_get_sqe(&(ring->ring))) == NULL)
+		{
+			return FALSE;
+		}
+	}
+
+	j_trace_file_begin(file->path, (request->type == J_BACKEND_REQUEST_OBJECT_WRITE) ? J_TRACE_FILE_WRITE : J_TRACE_FILE_READ);
+
+	if (request->type == J_BACKEND_REQUEST_OBJECT_WRITE)
+	{
+		io_uring_prep_write(sqe, file->fd, request->object.buffer, request->object.length, request->object.offset);
+	}
+	else
+	{
+		io_uring_prep_read(sqe, file->fd, request->object.buffer, request->object.length, request->object.offset);
+	}
+
+	io_uring_sqe_set_data(sqe, request);
+	ring->in_flight++;
+
+	return TRUE;
+}
+
+static guint
+backend_poll(gpointer data, gboolean wait)
+{
+	JBackendRing* ring = data;
+	guint completed;
+
+	io_uring_submit(&(ring->ring));
+	backend_ring_reap(ring, wait && ring->completed == 0);
+
+	completed = ring->completed;
+	ring->completed = 0;
+
+	return completed;
 }
+#endif
 
 static gboolean
 backend_init(gchar const* path)
 {
-	jd_backend_path = g_strdup(path);
+	g_auto(GStrv) split = NULL;
+	guint layout = 0;
+
+	// The path has the format /path/to/storage[:option,...]
+	split = g_strsplit(path, ":", 2);
+
+	if (split[0] == NULL)
+	{
+		return FALSE;
+	}
+
+	if (split[1] != NULL)
+	{
+		g_auto(GStrv) options = NULL;
+
+		options = g_strsplit(split[1], ",", 0);
+
+		for (guint i = 0; options[i] != NULL; i++)
+		{
+			if (g_strcmp0(options[i], "io_uring") == 0)
+			{
+#ifdef HAVE_LIBURING
+				jd_backend_io_uring = TRUE;
+#else
+				g_warning("posix: io_uring is not supported, falling back to synchronous I/O.");
+#endif
+			}
+			else if (g_strcmp0(options[i], "direct") == 0)
+			{
+				jd_backend_direct = TRUE;
+			}
+			else if (g_strcmp0(options[i], "checksum") == 0)
+			{
+				jd_backend_checksum = TRUE;
+			}
+			else if (g_str_has_prefix(options[i], "scrub="))
+			{
+				jd_backend_scrub_interval = g_ascii_strtoull(options[i] + strlen("scrub="), NULL, 10);
+			}
+			else if (g_strcmp0(options[i], "layout=flat") == 0)
+			{
+				layout = JD_BACKEND_LAYOUT_FLAT;
+			}
+			else if (g_strcmp0(options[i], "layout=sharded") == 0)
+			{
+				layout = JD_BACKEND_LAYOUT_SHARDED;
+			}
+			else
+			{
+				g_warning("posix: Unknown option %s.", options[i]);
+			}
+		}
+	}
+
+	jd_backend_path = g_strdup(split[0]);
 	jd_backend_file_cache = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, NULL);
+	jd_backend_directories = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	g_mkdir_with_parents(jd_backend_path, 0700);
+
+	if (jd_backend_checksum)
+	{
+		jd_backend_checksum_path = g_build_filename(jd_backend_path, JD_BACKEND_CHECKSUM_DIR, NULL);
+		backend_crc32c_init();
+	}
+	else if (jd_backend_scrub_interval > 0)
+	{
+		g_warning("posix: Scrubbing requires the checksum option, scrubbing is disabled.");
+		jd_backend_scrub_interval = 0;
+	}
+
+	if (!backend_init_layout(layout))
+	{
+		return FALSE;
+	}
 
-	g_mkdir_with_parents(path, 0700);
+	if (jd_backend_scrub_interval > 0)
+	{
+		jd_backend_scrub_stop = FALSE;
+		jd_backend_scrub_thread = g_thread_new("posix-scrub", backend_scrub_thread, NULL);
+	}
 
 	return TRUE;
 }
@@ -374,9 +2070,28 @@ backend_init(gchar const* path)
 static void
 backend_fini(void)
 {
+	if (jd_backend_scrub_thread != NULL)
+	{
+		g_mutex_lock(&jd_backend_scrub_mutex);
+		jd_backend_scrub_stop = TRUE;
+		g_cond_signal(&jd_backend_scrub_cond);
+		g_mutex_unlock(&jd_backend_scrub_mutex);
+
+		g_thread_join(jd_backend_scrub_thread);
+		jd_backend_scrub_thread = NULL;
+	}
+
 	g_assert(g_hash_table_size(jd_backend_file_cache) == 0);
 	g_hash_table_destroy(jd_backend_file_cache);
 
+	g_hash_table_destroy(jd_backend_directories);
+
+	g_slist_free_full(jd_backend_bounce_buffers, free);
+	jd_backend_bounce_buffers = NULL;
+
+	g_free(jd_backend_checksum_path);
+	jd_backend_checksum_path = NULL;
+
 	g_free(jd_backend_path);
 }
 
@@ -390,10 +2105,20 @@ static JBackend posix_backend = {
 		.backend_delete = backend_delete,
 		.backend_open = backend_open,
 		.backend_close = backend_close,
+		.backend_delete_namespace = backend_delete_namespace,
 		.backend_status = backend_status,
 		.backend_sync = backend_sync,
 		.backend_read = backend_read,
-		.backend_write = backend_write }
+		.backend_write = backend_write,
+		.backend_readv = backend_readv,
+		.backend_writev = backend_writev,
+#ifdef HAVE_LIBURING
+		.backend_queue_new = backend_queue_new,
+		.backend_queue_free = backend_queue_free,
+		.backend_submit = backend_submit,
+		.backend_poll = backend_poll,
+#endif
+	}
 };
 
 G_MODULE_EXPORT
@@ -81,6 +81,7 @@ j_benchmark_run(gchar const* name, BenchmarkFunc benchmark_func)
 	result.elapsed_time = 0.0;
 	result.operations = 0;
 	result.bytes = 0;
+	result.ratio = 0.0;
 
 	if (!opt_machine_readable)
 	{
@@ -113,6 +114,11 @@ j_benchmark_run(gchar const* name, BenchmarkFunc benchmark_func)
 			g_print(" (%s/s)", size);
 		}
 
+		if (result.ratio != 0.0)
+		{
+			g_print(" (ratio %.2f)", result.ratio);
+		}
+
 		g_print(" [%.3f seconds]\n", elapsed);
 	}
 	else
@@ -201,6 +207,7 @@ main(int argc, char** argv)
 	// Object client
 	benchmark_distributed_object();
 	benchmark_object();
+	benchmark_dedup();
 
 	// Item client
 	benchmark_collection();
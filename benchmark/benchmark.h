@@ -26,6 +26,11 @@ struct BenchmarkResult
 	gdouble elapsed_time;
 	guint64 operations;
 	guint64 bytes;
+
+	/**
+	 * A ratio such as the deduplication ratio, 0.0 if unused.
+	 */
+	gdouble ratio;
 };
 
 typedef struct BenchmarkResult BenchmarkResult;
@@ -48,6 +53,7 @@ void benchmark_message(void);
 
 void benchmark_kv(void);
 
+void benchmark_dedup(void);
 void benchmark_distributed_object(void);
 void benchmark_object(void);
 
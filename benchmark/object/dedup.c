@@ -0,0 +1,219 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2019 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gmodule.h>
+
+#include <string.h>
+
+#include <julea.h>
+
+#include "benchmark.h"
+
+/**
+ * Returns the space used by all files below path.
+ */
+static guint64
+benchmark_dedup_disk_usage(gchar const* path)
+{
+	g_autoptr(GDir) dir = NULL;
+	gchar const* entry;
+	guint64 usage = 0;
+
+	if ((dir = g_dir_open(path, 0, NULL)) == NULL)
+	{
+		return 0;
+	}
+
+	while ((entry = g_dir_read_name(dir)) != NULL)
+	{
+		g_autofree gchar* entry_path = NULL;
+		GStatBuf buf;
+
+		entry_path = g_build_filename(path, entry, NULL);
+
+		if (g_file_test(entry_path, G_FILE_TEST_IS_DIR))
+		{
+			usage += benchmark_dedup_disk_usage(entry_path);
+		}
+		else if (g_stat(entry_path, &buf) == 0)
+		{
+			// Sparse files such as LMDB's map only use the allocated blocks
+			usage += (guint64)buf.st_blocks * 512;
+		}
+	}
+
+	return usage;
+}
+
+static void
+benchmark_dedup_remove(gchar const* path)
+{
+	g_autoptr(GDir) dir = NULL;
+	gchar const* entry;
+
+	if ((dir = g_dir_open(path, 0, NULL)) != NULL)
+	{
+		while ((entry = g_dir_read_name(dir)) != NULL)
+		{
+			g_autofree gchar* entry_path = NULL;
+
+			entry_path = g_build_filename(path, entry, NULL);
+
+			if (g_file_test(entry_path, G_FILE_TEST_IS_DIR))
+			{
+				benchmark_dedup_remove(entry_path);
+			}
+			else
+			{
+				g_unlink(entry_path);
+			}
+		}
+	}
+
+	g_rmdir(path);
+}
+
+/**
+ * Writes a series of checkpoints that differ slightly from their predecessors.
+ * Each checkpoint has a few bytes modified and a few bytes inserted, which shifts the remaining data.
+ * The dedup backend is loaded directly, so no server is required.
+ */
+static void
+benchmark_dedup_checkpoint(BenchmarkResult* result)
+{
+	guint const n = 8;
+	guint64 const size = 64 * 1024 * 1024;
+	guint64 const block_size = 4 * 1024 * 1024;
+
+	g_autoptr(GRand) rand = NULL;
+	g_autofree gchar* path = NULL;
+	g_autofree gchar* data = NULL;
+	JBackend* backend = NULL;
+	GModule* module = NULL;
+	gdouble elapsed = 0.0;
+	guint64 written = 0;
+	guint64 usage;
+	gboolean ret;
+
+	if (!j_backend_load_server("dedup", "server", J_BACKEND_TYPE_OBJECT, &module, &backend) || backend == NULL)
+	{
+		g_error("Could not load the dedup backend.");
+	}
+
+	path = g_dir_make_tmp("julea-benchmark-dedup-XXXXXX", NULL);
+	g_assert_nonnull(path);
+
+	ret = j_backend_object_init(backend, path);
+	g_assert_true(ret);
+
+	rand = g_rand_new_with_seed(42);
+	data = g_malloc(size + n * 1024);
+
+	for (guint64 i = 0; i < size; i += sizeof(guint32))
+	{
+		guint32 value = g_rand_int(rand);
+
+		memcpy(data + i, &value, sizeof(value));
+	}
+
+	for (guint i = 0; i < n; i++)
+	{
+		g_autofree gchar* name = NULL;
+		gpointer object;
+		guint64 checkpoint_size = size + i * 1024;
+
+		if (i > 0)
+		{
+			guint64 insert = g_rand_int_range(rand, 0, size);
+
+			// Modify some bytes in place
+			for (guint j = 0; j < 16; j++)
+			{
+				data[g_rand_int_range(rand, 0, size)] ^= 0xff;
+			}
+
+			// Insert some bytes, which shifts the rest of the checkpoint
+			memmove(data + insert + 1024, data + insert, checkpoint_size - 1024 - insert);
+			memset(data + insert, i, 1024);
+		}
+
+		name = g_strdup_printf("checkpoint-%u", i);
+
+		j_benchmark_timer_start();
+
+		ret = j_backend_object_create(backend, "benchmark", name, &object);
+		g_assert_true(ret);
+
+		for (guint64 offset = 0; offset < checkpoint_size; offset += block_size)
+		{
+			guint64 length = MIN(block_size, checkpoint_size - offset);
+			guint64 bytes_written;
+
+			ret = j_backend_object_write(backend, object, data + offset, length, offset, &bytes_written);
+			g_assert_true(ret);
+			g_assert_cmpuint(bytes_written, ==, length);
+		}
+
+		ret = j_backend_object_sync(backend, object);
+		g_assert_true(ret);
+
+		ret = j_backend_object_close(backend, object);
+		g_assert_true(ret);
+
+		elapsed += j_benchmark_timer_elapsed();
+		written += checkpoint_size;
+	}
+
+	usage = benchmark_dedup_disk_usage(path);
+
+	for (guint i = 0; i < n; i++)
+	{
+		g_autofree gchar* name = NULL;
+		gpointer object;
+
+		name = g_strdup_printf("checkpoint-%u", i);
+
+		ret = j_backend_object_open(backend, "benchmark", name, &object);
+		g_assert_true(ret);
+
+		ret = j_backend_object_delete(backend, object);
+		g_assert_true(ret);
+	}
+
+	j_backend_object_fini(backend);
+	g_module_close(module);
+
+	benchmark_dedup_remove(path);
+
+	result->elapsed_time = elapsed;
+	result->bytes = written;
+	result->ratio = (usage > 0) ? (gdouble)written / usage : 0.0;
+}
+
+void
+benchmark_dedup(void)
+{
+	// The dedup backend is only built if LMDB is available
+#ifdef HAVE_LMDB
+	j_benchmark_run("/object/dedup/checkpoint", benchmark_dedup_checkpoint);
+#endif
+}
@@ -30,9 +30,8 @@ jfs_write(char const* path, char const* buf, size_t size, off_t offset, struct f
 	g_autoptr(JBatch) batch = NULL;
 	g_autoptr(JKV) kv = NULL;
 	g_autoptr(JObject) object = NULL;
+	bson_t file[1];
 	guint64 bytes_written;
-	gpointer value;
-	guint32 len;
 
 	(void)fi;
 
@@ -40,39 +39,19 @@ jfs_write(char const* path, char const* buf, size_t size, off_t offset, struct f
 	kv = j_kv_new("posix", path);
 	object = j_object_new("posix", path);
 
-	j_kv_get(kv, &value, &len, batch);
+	// The size only grows, which the server can check atomically without another round trip
+	bson_init(file);
+	bson_append_int64(file, "size", -1, offset + size);
+
 	j_object_write(object, buf, size, offset, &bytes_written, batch);
+	j_kv_merge(kv, file, J_KV_MERGE_MAX, batch);
 
 	if (j_batch_execute(batch))
 	{
-		bson_t file[1];
-		bson_iter_t iter;
-		gint64 old_size = 0;
-
 		ret = bytes_written;
-
-		bson_init_static(file, value, len);
-
-		if (bson_iter_init_find(&iter, file, "size") && bson_iter_type(&iter) == BSON_TYPE_INT64)
-		{
-			old_size = bson_iter_int64(&iter);
-
-			if ((guint64)old_size < offset + size)
-			{
-				bson_iter_overwrite_int64(&iter, offset + size);
-
-				j_kv_put(kv, g_memdup(bson_get_data(file), file->len), file->len, g_free, batch);
-
-				if (!j_batch_execute(batch))
-				{
-					ret = -EIO;
-				}
-			}
-		}
-
-		bson_destroy(file);
-		g_free(value);
 	}
 
+	bson_destroy(file);
+
 	return ret;
 }
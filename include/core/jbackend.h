@@ -121,6 +121,150 @@ enum JBackendComponent
 
 typedef enum JBackendComponent JBackendComponent;
 
+/**
+ * A range of an object for vectored reads and writes.
+ **/
+struct JBackendObjectRange
+{
+	gpointer buffer;
+	guint64 length;
+	guint64 offset;
+
+	/**
+	 * The number of bytes read or written, set by the backend.
+	 **/
+	guint64 bytes;
+
+	/**
+	 * Whether reading failed because the data is corrupted, set by the backend.
+	 * bytes then contains the number of bytes before the corrupted data.
+	 **/
+	gboolean failed;
+};
+
+typedef struct JBackendObjectRange JBackendObjectRange;
+
+enum JBackendRequestType
+{
+	J_BACKEND_REQUEST_OBJECT_READ,
+	J_BACKEND_REQUEST_OBJECT_WRITE,
+	J_BACKEND_REQUEST_KV_PUT,
+	J_BACKEND_REQUEST_KV_DELETE,
+	J_BACKEND_REQUEST_KV_GET
+};
+
+typedef enum JBackendRequestType JBackendRequestType;
+
+/**
+ * A request for the asynchronous backend interface.
+ **/
+struct JBackendRequest
+{
+	JBackendRequestType type;
+
+	/**
+	 * The object for object requests, the batch for KV requests.
+	 **/
+	gpointer data;
+
+	union
+	{
+		struct
+		{
+			gpointer buffer;
+			guint64 length;
+			guint64 offset;
+
+			/**
+			 * The number of bytes read or written, set on completion.
+			 **/
+			guint64 bytes;
+
+			/**
+			 * See JBackendObjectRange.
+			 **/
+			gboolean failed;
+		} object;
+
+		struct
+		{
+			gchar const* key;
+
+			/**
+			 * The value to put or the value that has been read.
+			 * Values that have been read belong to the backend, see backend_get.
+			 **/
+			gconstpointer value;
+			guint32 length;
+		} kv;
+	};
+
+	/**
+	 * The result, set on completion.
+	 **/
+	gboolean ret;
+};
+
+typedef struct JBackendRequest JBackendRequest;
+
+enum JBackendKVUpdateType
+{
+	J_BACKEND_KV_UPDATE_CAS,
+	J_BACKEND_KV_UPDATE_INCREMENT,
+	J_BACKEND_KV_UPDATE_MERGE
+};
+
+typedef enum JBackendKVUpdateType JBackendKVUpdateType;
+
+/**
+ * An atomic read-modify-write operation, see j_backend_kv_update.
+ **/
+struct JBackendKVUpdate
+{
+	JBackendKVUpdateType type;
+	gchar const* key;
+
+	/**
+	 * CAS: The expected value, NULL if the key must not exist.
+	 **/
+	gconstpointer expected;
+	guint32 expected_len;
+
+	/**
+	 * CAS: The new value.
+	 * MERGE: The BSON document that is merged into the existing one.
+	 **/
+	gconstpointer value;
+	guint32 len;
+
+	/**
+	 * INCREMENT: The value to add to the existing 64-bit integer.
+	 **/
+	gint64 delta;
+
+	/**
+	 * MERGE: Whether integers keep the larger value instead of being replaced.
+	 **/
+	gboolean max;
+
+	/**
+	 * CAS: Whether the value has been replaced.
+	 * INCREMENT and MERGE: Whether the existing value could be updated.
+	 **/
+	gboolean ret;
+
+	/**
+	 * INCREMENT: The new value.
+	 **/
+	gint64 result;
+};
+
+typedef struct JBackendKVUpdate JBackendKVUpdate;
+
+struct JBackendQueue;
+
+typedef struct JBackendQueue JBackendQueue;
+
 struct JBackend
 {
 	JBackendType type;
@@ -139,11 +283,70 @@ struct JBackend
 			gboolean (*backend_delete)(gpointer);
 			gboolean (*backend_close)(gpointer);
 
+			/**
+			* Deletes all objects in a namespace (optional)
+			*
+			* Backends that do not implement this do not support deleting namespaces.
+			* Objects of the namespace must not be open.
+			*
+			* \param[in] namespace The namespace
+			*
+			* \return TRUE on success (also if the namespace does not exist), FALSE if an error occurred.
+			**/
+			gboolean (*backend_delete_namespace)(gchar const*);
+
 			gboolean (*backend_status)(gpointer, gint64*, guint64*);
 			gboolean (*backend_sync)(gpointer);
 
 			gboolean (*backend_read)(gpointer, gpointer, guint64, guint64, guint64*);
 			gboolean (*backend_write)(gpointer, gconstpointer, guint64, guint64, guint64*);
+
+			/**
+			* Reads multiple ranges at once (optional)
+			*
+			* Backends that do not implement this fall back to backend_read.
+			* Buffers of ranges passed to backend_writev are not modified.
+			*
+			* \param[in]     object      The object
+			* \param[in,out] ranges      The ranges, bytes is set for each range
+			* \param[in]     range_count The number of ranges
+			*
+			* \return TRUE if all ranges have been transferred completely, FALSE otherwise.
+			**/
+			gboolean (*backend_readv)(gpointer, JBackendObjectRange*, guint);
+			gboolean (*backend_writev)(gpointer, JBackendObjectRange*, guint);
+
+			/**
+			* Creates a queue for asynchronous requests (optional)
+			*
+			* Backends that implement this also have to implement backend_queue_free, backend_submit and backend_poll.
+			* Returning NULL makes JULEA execute requests synchronously.
+			* A queue is only used by one thread at a time.
+			*
+			* \return A new queue or NULL.
+			**/
+			gpointer (*backend_queue_new)(void);
+			void (*backend_queue_free)(gpointer);
+
+			/**
+			* Submits a request without waiting for its completion
+			*
+			* \param[in] queue   The queue
+			* \param[in] request The request, which must not be modified until it has been completed
+			*
+			* \return TRUE if the request has been submitted, FALSE otherwise.
+			**/
+			gboolean (*backend_submit)(gpointer, JBackendRequest*);
+
+			/**
+			* Completes submitted requests
+			*
+			* \param[in] queue The queue
+			* \param[in] wait  Whether to wait for at least one request to complete
+			*
+			* \return The number of requests that have been completed since the last call.
+			**/
+			guint (*backend_poll)(gpointer, gboolean);
 		} object;
 
 		struct
@@ -154,13 +357,101 @@ struct JBackend
 			gboolean (*backend_batch_start)(gchar const*, JSemantics*, gpointer*);
 			gboolean (*backend_batch_execute)(gpointer);
 
+			/**
+			* Starts a batch for atomic read-modify-write operations (optional)
+			*
+			* Values returned by backend_get must not be modified by other batches until the batch has been executed,
+			* for example, by starting a write transaction right away.
+			* Backends that do not implement this fall back to backend_batch_start, their updates are then only atomic with respect to each other.
+			*
+			* \param[in]  namespace The namespace
+			* \param[in]  semantics The semantics
+			* \param[out] batch     The batch, which is executed using backend_batch_execute
+			*
+			* \return TRUE on success, FALSE if an error occurred.
+			**/
+			gboolean (*backend_batch_start_update)(gchar const*, JSemantics*, gpointer*);
+
 			gboolean (*backend_put)(gpointer, gchar const*, gconstpointer, guint32);
 			gboolean (*backend_delete)(gpointer, gchar const*);
-			gboolean (*backend_get)(gpointer, gchar const*, gpointer*, guint32*);
+
+			/**
+			* Deletes all keys with a prefix (optional)
+			*
+			* Backends that do not implement this fall back to backend_get_by_prefix and backend_delete.
+			*
+			* \param[in] batch  The batch
+			* \param[in] prefix The prefix, an empty prefix deletes all keys of the batch's namespace
+			*
+			* \return TRUE on success (also if no keys have been deleted), FALSE if an error occurred.
+			**/
+			gboolean (*backend_delete_prefix)(gpointer, gchar const*);
+
+			/**
+			* Gets a value
+			*
+			* \param[in]  batch The batch
+			* \param[in]  key   The key
+			* \param[out] value The value, which belongs to the backend and stays valid until the batch is executed
+			* \param[out] len   The value's length
+			*
+			* \return TRUE if the key exists, FALSE otherwise.
+			**/
+			gboolean (*backend_get)(gpointer, gchar const*, gconstpointer*, guint32*);
+
+			/**
+			* Gets multiple values (optional)
+			*
+			* Backends that do not implement this fall back to backend_get.
+			*
+			* \param[in]  batch  The batch
+			* \param[in]  keys   The keys, sorted in ascending order (duplicates are possible)
+			* \param[in]  count  The number of keys
+			* \param[out] values The values, NULL for keys that do not exist, see backend_get
+			* \param[out] lens   The values' lengths
+			*
+			* \return TRUE on success, FALSE if an error occurred.
+			**/
+			gboolean (*backend_get_multi)(gpointer, gchar const**, guint, gconstpointer*, guint32*);
+
+			/**
+			* Puts multiple values (optional)
+			*
+			* Backends that do not implement this fall back to backend_put.
+			*
+			* \param[in] batch  The batch
+			* \param[in] keys   The keys, sorted in ascending order (duplicates are possible, the last value wins)
+			* \param[in] values The values
+			* \param[in] lens   The values' lengths
+			* \param[in] count  The number of keys
+			*
+			* \return TRUE on success, FALSE if an error occurred.
+			**/
+			gboolean (*backend_put_multi)(gpointer, gchar const**, gconstpointer*, guint32*, guint);
 
 			gboolean (*backend_get_all)(gchar const*, gpointer*);
 			gboolean (*backend_get_by_prefix)(gchar const*, gchar const*, gpointer*);
+
+			/**
+			* Gets all keys in a range, in ascending order.
+			*
+			* \param[in]  namespace The namespace
+			* \param[in]  start     The first key (inclusive), NULL to start at the first key
+			* \param[in]  end       The last key (exclusive), NULL to stop at the last key
+			* \param[in]  limit     The maximum number of keys, 0 for no limit
+			* \param[out] iterator  The iterator which can be used later for backend_iterate
+			*
+			* \return TRUE on success, FALSE if an error occurred.
+			**/
+			gboolean (*backend_get_range)(gchar const*, gchar const*, gchar const*, guint32, gpointer*);
+
 			gboolean (*backend_iterate)(gpointer, gchar const**, gconstpointer*, guint32*);
+
+			// See the object functions
+			gpointer (*backend_queue_new)(void);
+			void (*backend_queue_free)(gpointer);
+			gboolean (*backend_submit)(gpointer, JBackendRequest*);
+			guint (*backend_poll)(gpointer, gboolean);
 		} kv;
 
 		struct
@@ -391,12 +682,26 @@ gboolean j_backend_object_open(JBackend*, gchar const*, gchar const*, gpointer*)
 gboolean j_backend_object_delete(JBackend*, gpointer);
 gboolean j_backend_object_close(JBackend*, gpointer);
 
+gboolean j_backend_object_delete_namespace(JBackend*, gchar const*);
+
 gboolean j_backend_object_status(JBackend*, gpointer, gint64*, guint64*);
 gboolean j_backend_object_sync(JBackend*, gpointer);
 
 gboolean j_backend_object_read(JBackend*, gpointer, gpointer, guint64, guint64, guint64*);
 gboolean j_backend_object_write(JBackend*, gpointer, gconstpointer, guint64, guint64, guint64*);
 
+gboolean j_backend_object_readv(JBackend*, gpointer, JBackendObjectRange*, guint);
+gboolean j_backend_object_writev(JBackend*, gpointer, JBackendObjectRange*, guint);
+
+JBackendQueue* j_backend_queue_new(JBackend*);
+void j_backend_queue_free(JBackendQueue*);
+
+gboolean j_backend_queue_is_async(JBackendQueue*);
+
+gboolean j_backend_queue_submit(JBackendQueue*, JBackendRequest*);
+guint j_backend_queue_poll(JBackendQueue*);
+void j_backend_queue_wait(JBackendQueue*);
+
 gboolean j_backend_kv_init(JBackend*, gchar const*);
 void j_backend_kv_fini(JBackend*);
 
@@ -405,10 +710,18 @@ gboolean j_backend_kv_batch_execute(JBackend*, gpointer);
 
 gboolean j_backend_kv_put(JBackend*, gpointer, gchar const*, gconstpointer, guint32);
 gboolean j_backend_kv_delete(JBackend*, gpointer, gchar const*);
-gboolean j_backend_kv_get(JBackend*, gpointer, gchar const*, gpointer*, guint32*);
+gboolean j_backend_kv_get(JBackend*, gpointer, gchar const*, gconstpointer*, guint32*);
+
+gboolean j_backend_kv_get_multi(JBackend*, gpointer, gchar const**, guint, gconstpointer*, guint32*);
+gboolean j_backend_kv_put_multi(JBackend*, gpointer, gchar const**, gconstpointer*, guint32*, guint);
+
+gboolean j_backend_kv_update(JBackend*, gchar const*, JSemantics*, JBackendKVUpdate*, guint);
+
+gboolean j_backend_kv_delete_prefix(JBackend*, gchar const*, JSemantics*, gchar const*);
 
 gboolean j_backend_kv_get_all(JBackend*, gchar const*, gpointer*);
 gboolean j_backend_kv_get_by_prefix(JBackend*, gchar const*, gchar const*, gpointer*);
+gboolean j_backend_kv_get_range(JBackend*, gchar const*, gchar const*, gchar const*, guint32, gpointer*);
 gboolean j_backend_kv_iterate(JBackend*, gpointer, gchar const**, gconstpointer*, guint32*);
 
 gboolean j_backend_db_init(JBackend*, gchar const*);
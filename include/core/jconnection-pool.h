@@ -36,6 +36,7 @@ G_BEGIN_DECLS
 
 gpointer j_connection_pool_pop(JBackendType, guint);
 void j_connection_pool_push(JBackendType, guint, gpointer);
+void j_connection_pool_discard(JBackendType, guint, gpointer);
 
 G_END_DECLS
 
@@ -39,14 +39,20 @@ enum JMessageType
 	J_MESSAGE_STATISTICS,
 	J_MESSAGE_OBJECT_CREATE,
 	J_MESSAGE_OBJECT_DELETE,
+	J_MESSAGE_OBJECT_DELETE_NAMESPACE,
 	J_MESSAGE_OBJECT_READ,
 	J_MESSAGE_OBJECT_STATUS,
 	J_MESSAGE_OBJECT_WRITE,
 	J_MESSAGE_KV_PUT,
 	J_MESSAGE_KV_DELETE,
+	J_MESSAGE_KV_DELETE_PREFIX,
 	J_MESSAGE_KV_GET,
 	J_MESSAGE_KV_GET_ALL,
 	J_MESSAGE_KV_GET_BY_PREFIX,
+	J_MESSAGE_KV_GET_RANGE,
+	J_MESSAGE_KV_CAS,
+	J_MESSAGE_KV_INCREMENT,
+	J_MESSAGE_KV_MERGE,
 	J_MESSAGE_DB_SCHEMA_CREATE,
 	J_MESSAGE_DB_SCHEMA_GET,
 	J_MESSAGE_DB_SCHEMA_DELETE,
@@ -58,6 +64,11 @@ enum JMessageType
 
 typedef enum JMessageType JMessageType;
 
+/**
+ * The frame length that signals a failed read in replies to J_MESSAGE_OBJECT_READ, for example, because of corrupted data.
+ **/
+#define J_MESSAGE_OBJECT_READ_FAILED G_MAXUINT64
+
 struct JMessage;
 
 typedef struct JMessage JMessage;
@@ -40,7 +40,10 @@ enum JStatisticsType
 	J_STATISTICS_BYTES_READ,
 	J_STATISTICS_BYTES_WRITTEN,
 	J_STATISTICS_BYTES_RECEIVED,
-	J_STATISTICS_BYTES_SENT
+	J_STATISTICS_BYTES_SENT,
+	J_STATISTICS_KV_CACHE_HITS,
+	J_STATISTICS_KV_CACHE_MISSES,
+	J_STATISTICS_KV_CACHE_INVALIDATIONS
 };
 
 typedef enum JStatisticsType JStatisticsType;
@@ -55,6 +58,9 @@ void j_statistics_free(JStatistics*);
 guint64 j_statistics_get(JStatistics*, JStatisticsType);
 void j_statistics_add(JStatistics*, JStatisticsType, guint64);
 
+guint64 j_statistics_client_get(JStatisticsType);
+void j_statistics_client_add(JStatisticsType, guint64);
+
 G_END_DECLS
 
 #endif
@@ -43,6 +43,7 @@ G_BEGIN_DECLS
 
 JKVIterator* j_kv_iterator_new(gchar const*, gchar const*);
 JKVIterator* j_kv_iterator_new_for_index(guint32, gchar const*, gchar const*);
+JKVIterator* j_kv_iterator_new_range(gchar const*, gchar const*, gchar const*, guint32);
 void j_kv_iterator_free(JKVIterator*);
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(JKVIterator, j_kv_iterator_free)
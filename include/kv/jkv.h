@@ -44,6 +44,24 @@ typedef struct JKV JKV;
  */
 typedef void (*JKVGetFunc)(gpointer, guint32, gpointer);
 
+/**
+ * How j_kv_merge updates existing fields.
+ */
+enum JKVMerge
+{
+	/**
+	 * Existing fields are replaced.
+	 */
+	J_KV_MERGE_REPLACE,
+
+	/**
+	 * Existing 64-bit integers keep the larger value, other fields are replaced.
+	 */
+	J_KV_MERGE_MAX
+};
+
+typedef enum JKVMerge JKVMerge;
+
 JKV* j_kv_new(gchar const*, gchar const*);
 JKV* j_kv_new_for_index(guint32, gchar const*, gchar const*);
 JKV* j_kv_ref(JKV*);
@@ -53,10 +71,15 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC(JKV, j_kv_unref)
 
 void j_kv_put(JKV*, gpointer, guint32, GDestroyNotify, JBatch*);
 void j_kv_delete(JKV*, JBatch*);
+void j_kv_delete_prefix(gchar const*, gchar const*, JBatch*);
 
 void j_kv_get(JKV*, gpointer*, guint32*, JBatch*);
 void j_kv_get_callback(JKV*, JKVGetFunc, gpointer, JBatch*);
 
+void j_kv_cas(JKV*, gconstpointer, guint32, gpointer, guint32, GDestroyNotify, gboolean*, JBatch*);
+void j_kv_increment(JKV*, gint64, gint64*, JBatch*);
+void j_kv_merge(JKV*, bson_t const*, JKVMerge, JBatch*);
+
 G_END_DECLS
 
 #endif
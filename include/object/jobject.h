@@ -46,6 +46,7 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC(JObject, j_object_unref)
 
 void j_object_create(JObject*, JBatch*);
 void j_object_delete(JObject*, JBatch*);
+void j_object_delete_namespace(gchar const*, JBatch*);
 
 void j_object_read(JObject*, gpointer, guint64, guint64, guint64*, JBatch*);
 void j_object_write(JObject*, gconstpointer, guint64, guint64, guint64*, JBatch*);
@@ -25,6 +25,8 @@
 #include <glib.h>
 #include <gmodule.h>
 
+#include <string.h>
+
 #include <jbackend.h>
 
 #include <jtrace.h>
@@ -61,6 +63,11 @@ j_backend_sql_error_quark(void)
 	return g_quark_from_static_string("j-backend-sql-error-quark");
 }
 
+/**
+ * Serializes atomic updates of backends that do not implement backend_batch_start_update.
+ **/
+static GMutex j_backend_kv_update_mutex;
+
 static GModule*
 j_backend_load(gchar const* name, JBackendComponent component, JBackendType type, JBackend** backend)
 {
@@ -153,6 +160,15 @@ j_backend_load(gchar const* name, JBackendComponent component, JBackendType type
 		{
 			goto error;
 		}
+
+		// The asynchronous functions are optional but have to be implemented together
+		if (tmp_backend->object.backend_queue_new != NULL
+		    && (tmp_backend->object.backend_queue_free == NULL
+		        || tmp_backend->object.backend_submit == NULL
+		        || tmp_backend->object.backend_poll == NULL))
+		{
+			goto error;
+		}
 	}
 
 	if (type == J_BACKEND_TYPE_KV)
@@ -166,10 +182,19 @@ j_backend_load(gchar const* name, JBackendComponent component, JBackendType type
 		    || tmp_backend->kv.backend_get == NULL
 		    || tmp_backend->kv.backend_get_all == NULL
 		    || tmp_backend->kv.backend_get_by_prefix == NULL
+		    || tmp_backend->kv.backend_get_range == NULL
 		    || tmp_backend->kv.backend_iterate == NULL)
 		{
 			goto error;
 		}
+
+		if (tmp_backend->kv.backend_queue_new != NULL
+		    && (tmp_backend->kv.backend_queue_free == NULL
+		        || tmp_backend->kv.backend_submit == NULL
+		        || tmp_backend->kv.backend_poll == NULL))
+		{
+			goto error;
+		}
 	}
 
 	if (type == J_BACKEND_TYPE_DB)
@@ -367,6 +392,34 @@ j_backend_object_close(JBackend* backend, gpointer data)
 	return ret;
 }
 
+/**
+ * Deletes all objects in a namespace.
+ *
+ * \param backend   A backend.
+ * \param namespace A namespace.
+ *
+ * \return TRUE on success, FALSE if an error occurred or the backend does not support deleting namespaces.
+ **/
+gboolean
+j_backend_object_delete_namespace(JBackend* backend, gchar const* namespace)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = FALSE;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+
+	if (backend->object.backend_delete_namespace != NULL)
+	{
+		J_TRACE("backend_delete_namespace", "%s", namespace);
+		ret = backend->object.backend_delete_namespace(namespace);
+	}
+
+	return ret;
+}
+
 gboolean
 j_backend_object_status(JBackend* backend, gpointer data, gint64* modification_time, guint64* size)
 {
@@ -449,6 +502,69 @@ j_backend_object_write(JBackend* backend, gpointer data, gconstpointer buffer, g
 	return ret;
 }
 
+gboolean
+j_backend_object_readv(JBackend* backend, gpointer data, JBackendObjectRange* ranges, guint range_count)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = TRUE;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(ranges != NULL || range_count == 0, FALSE);
+
+	if (backend->object.backend_readv != NULL)
+	{
+		J_TRACE("backend_readv", "%p, %p, %u", data, (gpointer)ranges, range_count);
+		ret = backend->object.backend_readv(data, ranges, range_count);
+	}
+	else
+	{
+		for (guint i = 0; i < range_count; i++)
+		{
+			J_TRACE("backend_read", "%p, %p, %" G_GUINT64_FORMAT ", %" G_GUINT64_FORMAT ", %p", data, ranges[i].buffer, ranges[i].length, ranges[i].offset, (gpointer)&(ranges[i].bytes));
+
+			ranges[i].bytes = 0;
+			ranges[i].failed = FALSE;
+			ret = backend->object.backend_read(data, ranges[i].buffer, ranges[i].length, ranges[i].offset, &(ranges[i].bytes)) && ret;
+		}
+	}
+
+	return ret;
+}
+
+gboolean
+j_backend_object_writev(JBackend* backend, gpointer data, JBackendObjectRange* ranges, guint range_count)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = TRUE;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(ranges != NULL || range_count == 0, FALSE);
+
+	if (backend->object.backend_writev != NULL)
+	{
+		J_TRACE("backend_writev", "%p, %p, %u", data, (gpointer)ranges, range_count);
+		ret = backend->object.backend_writev(data, ranges, range_count);
+	}
+	else
+	{
+		for (guint i = 0; i < range_count; i++)
+		{
+			J_TRACE("backend_write", "%p, %p, %" G_GUINT64_FORMAT ", %" G_GUINT64_FORMAT ", %p", data, ranges[i].buffer, ranges[i].length, ranges[i].offset, (gpointer)&(ranges[i].bytes));
+
+			ranges[i].bytes = 0;
+			ret = backend->object.backend_write(data, ranges[i].buffer, ranges[i].length, ranges[i].offset, &(ranges[i].bytes)) && ret;
+		}
+	}
+
+	return ret;
+}
+
 gboolean
 j_backend_kv_init(JBackend* backend, gchar const* path)
 {
@@ -564,7 +680,7 @@ j_backend_kv_delete(JBackend* backend, gpointer batch, gchar const* key)
 }
 
 gboolean
-j_backend_kv_get(JBackend* backend, gpointer batch, gchar const* key, gpointer* value, guint32* value_len)
+j_backend_kv_get(JBackend* backend, gpointer batch, gchar const* key, gconstpointer* value, guint32* value_len)
 {
 	J_TRACE_FUNCTION(NULL);
 
@@ -585,6 +701,495 @@ j_backend_kv_get(JBackend* backend, gpointer batch, gchar const* key, gpointer*
 	return ret;
 }
 
+static gint
+j_backend_kv_key_compare(gconstpointer a, gconstpointer b, gpointer data)
+{
+	gchar const** keys = data;
+
+	return g_strcmp0(keys[*(guint const*)a], keys[*(guint const*)b]);
+}
+
+/**
+ * Returns the order in which keys have to be passed to backends, NULL if they are sorted already.
+ * The sort is stable, so operations on duplicate keys keep their order.
+ **/
+static guint*
+j_backend_kv_key_order(gchar const** keys, guint count)
+{
+	guint* order;
+	gboolean sorted = TRUE;
+
+	for (guint i = 1; i < count && sorted; i++)
+	{
+		sorted = (g_strcmp0(keys[i - 1], keys[i]) <= 0);
+	}
+
+	if (sorted)
+	{
+		return NULL;
+	}
+
+	order = g_new(guint, count);
+
+	for (guint i = 0; i < count; i++)
+	{
+		order[i] = i;
+	}
+
+	g_qsort_with_data(order, count, sizeof(guint), j_backend_kv_key_compare, keys);
+
+	return order;
+}
+
+gboolean
+j_backend_kv_get_multi(JBackend* backend, gpointer batch, gchar const** keys, guint count, gconstpointer* values, guint32* value_lens)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = TRUE;
+
+	g_autofree guint* order = NULL;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_KV, FALSE);
+	g_return_val_if_fail(batch != NULL, FALSE);
+	g_return_val_if_fail(keys != NULL, FALSE);
+	g_return_val_if_fail(values != NULL, FALSE);
+	g_return_val_if_fail(value_lens != NULL, FALSE);
+
+	if (backend->kv.backend_get_multi == NULL)
+	{
+		for (guint i = 0; i < count; i++)
+		{
+			if (!j_backend_kv_get(backend, batch, keys[i], &(values[i]), &(value_lens[i])))
+			{
+				values[i] = NULL;
+				value_lens[i] = 0;
+			}
+		}
+
+		return TRUE;
+	}
+
+	order = j_backend_kv_key_order(keys, count);
+
+	if (order == NULL)
+	{
+		J_TRACE("backend_get_multi", "%p, %u", batch, count);
+		ret = backend->kv.backend_get_multi(batch, keys, count, values, value_lens);
+	}
+	else
+	{
+		g_autofree gchar const** sorted_keys = NULL;
+		g_autofree gconstpointer* sorted_values = NULL;
+		g_autofree guint32* sorted_lens = NULL;
+
+		sorted_keys = g_new(gchar const*, count);
+		sorted_values = g_new(gconstpointer, count);
+		sorted_lens = g_new(guint32, count);
+
+		for (guint i = 0; i < count; i++)
+		{
+			sorted_keys[i] = keys[order[i]];
+		}
+
+		{
+			J_TRACE("backend_get_multi", "%p, %u", batch, count);
+			ret = backend->kv.backend_get_multi(batch, sorted_keys, count, sorted_values, sorted_lens);
+		}
+
+		for (guint i = 0; i < count; i++)
+		{
+			values[order[i]] = sorted_values[i];
+			value_lens[order[i]] = sorted_lens[i];
+		}
+	}
+
+	return ret;
+}
+
+gboolean
+j_backend_kv_put_multi(JBackend* backend, gpointer batch, gchar const** keys, gconstpointer* values, guint32* value_lens, guint count)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = TRUE;
+
+	g_autofree guint* order = NULL;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_KV, FALSE);
+	g_return_val_if_fail(batch != NULL, FALSE);
+	g_return_val_if_fail(keys != NULL, FALSE);
+	g_return_val_if_fail(values != NULL, FALSE);
+	g_return_val_if_fail(value_lens != NULL, FALSE);
+
+	if (backend->kv.backend_put_multi == NULL)
+	{
+		for (guint i = 0; i < count; i++)
+		{
+			ret = j_backend_kv_put(backend, batch, keys[i], values[i], value_lens[i]) && ret;
+		}
+
+		return ret;
+	}
+
+	order = j_backend_kv_key_order(keys, count);
+
+	if (order == NULL)
+	{
+		J_TRACE("backend_put_multi", "%p, %u", batch, count);
+		ret = backend->kv.backend_put_multi(batch, keys, values, value_lens, count);
+	}
+	else
+	{
+		g_autofree gchar const** sorted_keys = NULL;
+		g_autofree gconstpointer* sorted_values = NULL;
+		g_autofree guint32* sorted_lens = NULL;
+
+		sorted_keys = g_new(gchar const*, count);
+		sorted_values = g_new(gconstpointer, count);
+		sorted_lens = g_new(guint32, count);
+
+		for (guint i = 0; i < count; i++)
+		{
+			sorted_keys[i] = keys[order[i]];
+			sorted_values[i] = values[order[i]];
+			sorted_lens[i] = value_lens[order[i]];
+		}
+
+		{
+			J_TRACE("backend_put_multi", "%p, %u", batch, count);
+			ret = backend->kv.backend_put_multi(batch, sorted_keys, sorted_values, sorted_lens, count);
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * Merges update into current and appends the result to merged.
+ * Documents contained in both are merged recursively, other fields of update replace the ones of current.
+ **/
+static void
+j_backend_kv_merge(bson_t* merged, bson_t const* current, bson_t const* update, gboolean max)
+{
+	bson_iter_t iter;
+	bson_iter_t update_iter;
+
+	bson_iter_init(&iter, current);
+
+	while (bson_iter_next(&iter))
+	{
+		gchar const* key;
+
+		key = bson_iter_key(&iter);
+
+		if (!bson_iter_init_find(&update_iter, update, key))
+		{
+			bson_append_iter(merged, key, -1, &iter);
+		}
+		else if (BSON_ITER_HOLDS_DOCUMENT(&iter) && BSON_ITER_HOLDS_DOCUMENT(&update_iter))
+		{
+			bson_t current_child[1];
+			bson_t update_child[1];
+			bson_t merged_child[1];
+			guint8 const* data;
+			guint32 len;
+
+			bson_iter_document(&iter, &len, &data);
+			bson_init_static(current_child, data, len);
+			bson_iter_document(&update_iter, &len, &data);
+			bson_init_static(update_child, data, len);
+
+			bson_append_document_begin(merged, key, -1, merged_child);
+			j_backend_kv_merge(merged_child, current_child, update_child, max);
+			bson_append_document_end(merged, merged_child);
+		}
+		else if (max && BSON_ITER_HOLDS_INT64(&iter) && BSON_ITER_HOLDS_INT64(&update_iter))
+		{
+			bson_append_int64(merged, key, -1, MAX(bson_iter_int64(&iter), bson_iter_int64(&update_iter)));
+		}
+		else
+		{
+			bson_append_iter(merged, key, -1, &update_iter);
+		}
+	}
+
+	bson_iter_init(&update_iter, update);
+
+	while (bson_iter_next(&update_iter))
+	{
+		gchar const* key;
+
+		key = bson_iter_key(&update_iter);
+
+		if (!bson_iter_init_find(&iter, current, key))
+		{
+			bson_append_iter(merged, key, -1, &update_iter);
+		}
+	}
+}
+
+/**
+ * Computes the new value of an update.
+ *
+ * \return The new value, NULL if the value should not be modified.
+ **/
+static GBytes*
+j_backend_kv_update_value(JBackendKVUpdate* update, gconstpointer current, guint32 current_len)
+{
+	GBytes* value = NULL;
+
+	update->ret = FALSE;
+
+	switch (update->type)
+	{
+		case J_BACKEND_KV_UPDATE_CAS:
+			if ((update->expected == NULL && current == NULL)
+			    || (update->expected != NULL && current != NULL && update->expected_len == current_len && memcmp(update->expected, current, current_len) == 0))
+			{
+				value = g_bytes_new(update->value, update->len);
+				update->ret = TRUE;
+			}
+			break;
+		case J_BACKEND_KV_UPDATE_INCREMENT:
+			// Keys that do not exist start at 0
+			if (current == NULL || current_len == sizeof(gint64))
+			{
+				gint64 number = 0;
+
+				if (current != NULL)
+				{
+					memcpy(&number, current, sizeof(number));
+					number = GINT64_FROM_LE(number);
+				}
+
+				update->result = number + update->delta;
+				number = GINT64_TO_LE(update->result);
+
+				value = g_bytes_new(&number, sizeof(number));
+				update->ret = TRUE;
+			}
+			break;
+		case J_BACKEND_KV_UPDATE_MERGE:
+			// Merging requires an existing document
+			if (current != NULL)
+			{
+				bson_t current_document[1];
+				bson_t update_document[1];
+				bson_t* merged;
+
+				if (bson_init_static(current_document, current, current_len) && bson_init_static(update_document, update->value, update->len))
+				{
+					merged = bson_new();
+					j_backend_kv_merge(merged, current_document, update_document, update->max);
+
+					value = g_bytes_new(bson_get_data(merged), merged->len);
+					update->ret = TRUE;
+
+					bson_destroy(merged);
+				}
+			}
+			break;
+		default:
+			g_assert_not_reached();
+	}
+
+	return value;
+}
+
+/**
+ * Executes atomic read-modify-write operations.
+ * All updates are executed within one batch, updates of the same key see the results of the previous ones.
+ *
+ * \param backend   A backend.
+ * \param namespace A namespace.
+ * \param semantics A semantics object.
+ * \param updates   The updates, their results are stored in them.
+ * \param count     The number of updates.
+ *
+ * \return TRUE on success, FALSE if the batch could not be executed.
+ **/
+gboolean
+j_backend_kv_update(JBackend* backend, gchar const* namespace, JSemantics* semantics, JBackendKVUpdate* updates, guint count)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_autoptr(GHashTable) values = NULL;
+	g_autoptr(GPtrArray) produced = NULL;
+	GMutex* mutex = NULL;
+	gpointer batch;
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_KV, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+	g_return_val_if_fail(updates != NULL, FALSE);
+
+	// The backend guarantees that the values do not change until the batch has been executed
+	if (backend->kv.backend_batch_start_update != NULL)
+	{
+		J_TRACE("backend_batch_start_update", "%s, %p, %p", namespace, (gpointer)semantics, (gpointer)&batch);
+		ret = backend->kv.backend_batch_start_update(namespace, semantics, &batch);
+	}
+	else
+	{
+		mutex = &j_backend_kv_update_mutex;
+		g_mutex_lock(mutex);
+
+		{
+			J_TRACE("backend_batch_start", "%s, %p, %p", namespace, (gpointer)semantics, (gpointer)&batch);
+			ret = backend->kv.backend_batch_start(namespace, semantics, &batch);
+		}
+	}
+
+	if (!ret)
+	{
+		if (mutex != NULL)
+		{
+			g_mutex_unlock(mutex);
+		}
+
+		return FALSE;
+	}
+
+	// Backends do not have to return values that have been put in the same batch, values only maps keys to their latest value
+	values = g_hash_table_new(g_str_hash, g_str_equal);
+	produced = g_ptr_array_new_with_free_func((GDestroyNotify)g_bytes_unref);
+
+	for (guint i = 0; i < count; i++)
+	{
+		JBackendKVUpdate* update = &(updates[i]);
+		GBytes* value;
+		gpointer previous;
+		gconstpointer current = NULL;
+		guint32 current_len = 0;
+
+		if (g_hash_table_lookup_extended(values, update->key, NULL, &previous))
+		{
+			gsize size;
+
+			current = g_bytes_get_data(previous, &size);
+			current_len = size;
+		}
+		else
+		{
+			J_TRACE("backend_get", "%p, %s", batch, update->key);
+
+			if (!backend->kv.backend_get(batch, update->key, &current, &current_len))
+			{
+				current = NULL;
+				current_len = 0;
+			}
+		}
+
+		if ((value = j_backend_kv_update_value(update, current, current_len)) == NULL)
+		{
+			continue;
+		}
+
+		{
+			J_TRACE("backend_put", "%p, %s", batch, update->key);
+
+			gconstpointer data;
+			gsize size;
+
+			// Empty values do not have any data but backends require a non-NULL pointer
+			data = g_bytes_get_data(value, &size);
+			ret = backend->kv.backend_put(batch, update->key, (data != NULL) ? data : "", size) && ret;
+		}
+
+		// The value has to stay valid until the batch has been executed, even if a later update of the same key replaces it
+		g_ptr_array_add(produced, value);
+		g_hash_table_insert(values, (gpointer)(guintptr)update->key, value);
+	}
+
+	{
+		J_TRACE("backend_batch_execute", "%p", batch);
+		ret = backend->kv.backend_batch_execute(batch) && ret;
+	}
+
+	if (mutex != NULL)
+	{
+		g_mutex_unlock(mutex);
+	}
+
+	return ret;
+}
+
+/**
+ * Deletes all keys with a prefix in a batch of its own.
+ *
+ * \param backend   A backend.
+ * \param namespace A namespace.
+ * \param semantics The semantics used for the batch.
+ * \param prefix    A prefix, an empty prefix deletes all keys of the namespace.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+j_backend_kv_delete_prefix(JBackend* backend, gchar const* namespace, JSemantics* semantics, gchar const* prefix)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_autoptr(GPtrArray) keys = NULL;
+	gpointer batch;
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_KV, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+	g_return_val_if_fail(prefix != NULL, FALSE);
+
+	if (backend->kv.backend_delete_prefix == NULL)
+	{
+		gpointer iterator;
+		gchar const* key;
+		gconstpointer value;
+		guint32 len;
+
+		// The keys are collected first because backends do not have to support modifications while iterating
+		keys = g_ptr_array_new_with_free_func(g_free);
+
+		if (!j_backend_kv_get_by_prefix(backend, namespace, prefix, &iterator))
+		{
+			return FALSE;
+		}
+
+		while (j_backend_kv_iterate(backend, iterator, &key, &value, &len))
+		{
+			g_ptr_array_add(keys, g_strdup(key));
+		}
+	}
+
+	if (!j_backend_kv_batch_start(backend, namespace, semantics, &batch))
+	{
+		return FALSE;
+	}
+
+	if (keys == NULL)
+	{
+		J_TRACE("backend_delete_prefix", "%p, %s", batch, prefix);
+		ret = backend->kv.backend_delete_prefix(batch, prefix);
+	}
+	else
+	{
+		ret = TRUE;
+
+		for (guint i = 0; i < keys->len; i++)
+		{
+			ret = j_backend_kv_delete(backend, batch, g_ptr_array_index(keys, i)) && ret;
+		}
+	}
+
+	ret = j_backend_kv_batch_execute(backend, batch) && ret;
+
+	return ret;
+}
+
 gboolean
 j_backend_kv_get_all(JBackend* backend, gchar const* namespace, gpointer* iterator)
 {
@@ -625,6 +1230,27 @@ j_backend_kv_get_by_prefix(JBackend* backend, gchar const* namespace, gchar cons
 
 	return ret;
 }
+
+gboolean
+j_backend_kv_get_range(JBackend* backend, gchar const* namespace, gchar const* start, gchar const* end, guint32 limit, gpointer* iterator)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_KV, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(iterator != NULL, FALSE);
+
+	{
+		J_TRACE("backend_get_range", "%s, %s, %s, %u, %p", namespace, start, end, limit, (gpointer)iterator);
+		ret = backend->kv.backend_get_range(namespace, start, end, limit, iterator);
+	}
+
+	return ret;
+}
+
 gboolean
 j_backend_kv_iterate(JBackend* backend, gpointer iterator, gchar const** key, gconstpointer* value, guint32* value_len)
 {
@@ -647,6 +1273,225 @@ j_backend_kv_iterate(JBackend* backend, gpointer iterator, gchar const** key, gc
 	return ret;
 }
 
+/**
+ * A queue for asynchronous requests.
+ * Requests are executed synchronously when submitted if the backend does not support asynchronous requests.
+ **/
+struct JBackendQueue
+{
+	JBackend* backend;
+
+	/**
+	 * The backend's queue, NULL if requests are executed synchronously.
+	 **/
+	gpointer data;
+
+	/**
+	 * The number of requests that have been submitted but not completed.
+	 **/
+	guint in_flight;
+};
+
+static void
+j_backend_request_execute(JBackend* backend, JBackendRequest* request)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	switch (request->type)
+	{
+		case J_BACKEND_REQUEST_OBJECT_READ:
+			request->object.bytes = 0;
+			request->object.failed = FALSE;
+			request->ret = j_backend_object_read(backend, request->data, request->object.buffer, request->object.length, request->object.offset, &(request->object.bytes));
+			break;
+		case J_BACKEND_REQUEST_OBJECT_WRITE:
+			request->object.bytes = 0;
+			request->ret = j_backend_object_write(backend, request->data, request->object.buffer, request->object.length, request->object.offset, &(request->object.bytes));
+			break;
+		case J_BACKEND_REQUEST_KV_PUT:
+			request->ret = j_backend_kv_put(backend, request->data, request->kv.key, request->kv.value, request->kv.length);
+			break;
+		case J_BACKEND_REQUEST_KV_DELETE:
+			request->ret = j_backend_kv_delete(backend, request->data, request->kv.key);
+			break;
+		case J_BACKEND_REQUEST_KV_GET:
+			request->kv.value = NULL;
+			request->kv.length = 0;
+			request->ret = j_backend_kv_get(backend, request->data, request->kv.key, &(request->kv.value), &(request->kv.length));
+			break;
+		default:
+			g_warn_if_reached();
+			request->ret = FALSE;
+	}
+}
+
+JBackendQueue*
+j_backend_queue_new(JBackend* backend)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JBackendQueue* queue;
+
+	g_return_val_if_fail(backend != NULL, NULL);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT || backend->type == J_BACKEND_TYPE_KV, NULL);
+
+	queue = g_slice_new(JBackendQueue);
+	queue->backend = backend;
+	queue->data = NULL;
+	queue->in_flight = 0;
+
+	if (backend->type == J_BACKEND_TYPE_OBJECT && backend->object.backend_queue_new != NULL)
+	{
+		J_TRACE("backend_queue_new", NULL);
+		queue->data = backend->object.backend_queue_new();
+	}
+	else if (backend->type == J_BACKEND_TYPE_KV && backend->kv.backend_queue_new != NULL)
+	{
+		J_TRACE("backend_queue_new", NULL);
+		queue->data = backend->kv.backend_queue_new();
+	}
+
+	return queue;
+}
+
+void
+j_backend_queue_free(JBackendQueue* queue)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_if_fail(queue != NULL);
+
+	j_backend_queue_wait(queue);
+
+	if (queue->data != NULL)
+	{
+		J_TRACE("backend_queue_free", "%p", queue->data);
+
+		if (queue->backend->type == J_BACKEND_TYPE_OBJECT)
+		{
+			queue->backend->object.backend_queue_free(queue->data);
+		}
+		else
+		{
+			queue->backend->kv.backend_queue_free(queue->data);
+		}
+	}
+
+	g_slice_free(JBackendQueue, queue);
+}
+
+/**
+ * Returns whether requests are executed asynchronously.
+ * If not, it is usually more efficient to call the synchronous functions directly.
+ **/
+gboolean
+j_backend_queue_is_async(JBackendQueue* queue)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(queue != NULL, FALSE);
+
+	return (queue->data != NULL);
+}
+
+/**
+ * Submits a request.
+ * The request must not be modified or freed until the queue has been waited on.
+ **/
+gboolean
+j_backend_queue_submit(JBackendQueue* queue, JBackendRequest* request)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean submitted = FALSE;
+
+	g_return_val_if_fail(queue != NULL, FALSE);
+	g_return_val_if_fail(request != NULL, FALSE);
+	g_return_val_if_fail(request->data != NULL, FALSE);
+
+	if (queue->data != NULL)
+	{
+		J_TRACE("backend_submit", "%p, %p", queue->data, (gpointer)request);
+
+		if (queue->backend->type == J_BACKEND_TYPE_OBJECT)
+		{
+			submitted = queue->backend->object.backend_submit(queue->data, request);
+		}
+		else
+		{
+			submitted = queue->backend->kv.backend_submit(queue->data, request);
+		}
+	}
+
+	if (submitted)
+	{
+		queue->in_flight++;
+	}
+	else
+	{
+		// Also used when the backend's queue is full
+		// Requests that are still in flight have been submitted earlier and have to complete first
+		j_backend_queue_wait(queue);
+		j_backend_request_execute(queue->backend, request);
+	}
+
+	return TRUE;
+}
+
+/**
+ * Completes requests without waiting.
+ *
+ * \return The number of requests that are still in flight.
+ **/
+guint
+j_backend_queue_poll(JBackendQueue* queue)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(queue != NULL, 0);
+
+	if (queue->in_flight > 0)
+	{
+		J_TRACE("backend_poll", "%p, %d", queue->data, FALSE);
+
+		if (queue->backend->type == J_BACKEND_TYPE_OBJECT)
+		{
+			queue->in_flight -= queue->backend->object.backend_poll(queue->data, FALSE);
+		}
+		else
+		{
+			queue->in_flight -= queue->backend->kv.backend_poll(queue->data, FALSE);
+		}
+	}
+
+	return queue->in_flight;
+}
+
+/**
+ * Waits until all submitted requests have been completed.
+ **/
+void
+j_backend_queue_wait(JBackendQueue* queue)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_if_fail(queue != NULL);
+
+	while (queue->in_flight > 0)
+	{
+		J_TRACE("backend_poll", "%p, %d", queue->data, TRUE);
+
+		if (queue->backend->type == J_BACKEND_TYPE_OBJECT)
+		{
+			queue->in_flight -= queue->backend->object.backend_poll(queue->data, TRUE);
+		}
+		else
+		{
+			queue->in_flight -= queue->backend->kv.backend_poll(queue->data, TRUE);
+		}
+	}
+}
+
 gboolean
 j_backend_db_init(JBackend* backend, gchar const* path)
 {
@@ -142,6 +142,21 @@ struct JConfiguration
 	guint32 max_connections;
 	guint64 stripe_size;
 
+	/**
+	 * The number of stripes that can be in flight per server.
+	 */
+	guint32 stripe_window;
+
+	/**
+	 * The lease of cached key-value pairs in milliseconds, 0 disables the cache.
+	 */
+	guint32 kv_cache_lease;
+
+	/**
+	 * The maximum number of cached key-value pairs.
+	 */
+	guint32 kv_cache_size;
+
 	/**
 	 * The reference count.
 	 */
@@ -285,12 +300,18 @@ j_configuration_new_for_data(GKeyFile* key_file)
 	guint64 max_operation_size;
 	guint32 max_connections;
 	guint64 stripe_size;
+	guint32 stripe_window;
+	guint32 kv_cache_lease;
+	guint32 kv_cache_size;
 
 	g_return_val_if_fail(key_file != NULL, FALSE);
 
 	max_operation_size = g_key_file_get_uint64(key_file, "core", "max-operation-size", NULL);
 	max_connections = g_key_file_get_integer(key_file, "clients", "max-connections", NULL);
 	stripe_size = g_key_file_get_uint64(key_file, "clients", "stripe-size", NULL);
+	stripe_window = g_key_file_get_integer(key_file, "clients", "stripe-window", NULL);
+	kv_cache_lease = g_key_file_get_integer(key_file, "clients", "kv-cache-lease", NULL);
+	kv_cache_size = g_key_file_get_integer(key_file, "clients", "kv-cache-size", NULL);
 	servers_object = g_key_file_get_string_list(key_file, "servers", "object", NULL, NULL);
 	servers_kv = g_key_file_get_string_list(key_file, "servers", "kv", NULL, NULL);
 	servers_db = g_key_file_get_string_list(key_file, "servers", "db", NULL, NULL);
@@ -352,6 +373,9 @@ j_configuration_new_for_data(GKeyFile* key_file)
 	configuration->max_operation_size = max_operation_size;
 	configuration->max_connections = max_connections;
 	configuration->stripe_size = stripe_size;
+	configuration->stripe_window = stripe_window;
+	configuration->kv_cache_lease = kv_cache_lease;
+	configuration->kv_cache_size = kv_cache_size;
 	configuration->ref_count = 1;
 
 	if (configuration->max_operation_size == 0)
@@ -369,6 +393,19 @@ j_configuration_new_for_data(GKeyFile* key_file)
 		configuration->stripe_size = 4 * 1024 * 1024;
 	}
 
+	if (configuration->stripe_window == 0)
+	{
+		configuration->stripe_window = 4;
+	}
+
+	// Every stripe in flight needs its own connection
+	configuration->stripe_window = MIN(configuration->stripe_window, configuration->max_connections);
+
+	if (configuration->kv_cache_size == 0)
+	{
+		configuration->kv_cache_size = 16384;
+	}
+
 	return configuration;
 }
 
@@ -578,6 +615,36 @@ j_configuration_get_stripe_size(JConfiguration* configuration)
 	return configuration->stripe_size;
 }
 
+guint32
+j_configuration_get_stripe_window(JConfiguration* configuration)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->stripe_window;
+}
+
+guint32
+j_configuration_get_kv_cache_lease(JConfiguration* configuration)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->kv_cache_lease;
+}
+
+guint32
+j_configuration_get_kv_cache_size(JConfiguration* configuration)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->kv_cache_size;
+}
+
 /**
  * @}
  **/
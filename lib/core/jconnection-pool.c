@@ -171,77 +171,88 @@ j_connection_pool_fini(void)
 }
 
 static GSocketConnection*
-j_connection_pool_pop_internal(GAsyncQueue* queue, guint* count, gchar const* server)
+j_connection_pool_connect(gchar const* server, guint* count)
 {
 	J_TRACE_FUNCTION(NULL);
 
 	GSocketConnection* connection;
+	GError* error = NULL;
+	g_autoptr(GSocketClient) client = NULL;
 
-	g_return_val_if_fail(queue != NULL, NULL);
-	g_return_val_if_fail(count != NULL, NULL);
+	g_autoptr(JMessage) message = NULL;
+	g_autoptr(JMessage) reply = NULL;
 
-	connection = g_async_queue_try_pop(queue);
+	guint op_count;
 
-	if (connection != NULL)
+	client = g_socket_client_new();
+	connection = g_socket_client_connect_to_host(client, server, 4711, NULL, &error);
+
+	if (error != NULL)
 	{
-		return connection;
+		g_critical("%s", error->message);
+		g_error_free(error);
 	}
 
-	if ((guint)g_atomic_int_get(count) < j_connection_pool->max_count)
+	if (connection == NULL)
 	{
-		if ((guint)g_atomic_int_add(count, 1) < j_connection_pool->max_count)
-		{
-			GError* error = NULL;
-			g_autoptr(GSocketClient) client = NULL;
+		g_critical("Can not connect to %s [%d].", server, g_atomic_int_get(count));
+	}
+
+	j_helper_set_nodelay(connection, TRUE);
 
-			g_autoptr(JMessage) message = NULL;
-			g_autoptr(JMessage) reply = NULL;
+	message = j_message_new(J_MESSAGE_PING, 0);
+	j_message_send(message, connection);
 
-			guint op_count;
+	reply = j_message_new_reply(message);
+	j_message_receive(reply, connection);
 
-			client = g_socket_client_new();
-			connection = g_socket_client_connect_to_host(client, server, 4711, NULL, &error);
+	op_count = j_message_get_count(reply);
 
-			if (error != NULL)
-			{
-				g_critical("%s", error->message);
-				g_error_free(error);
-			}
+	for (guint i = 0; i < op_count; i++)
+	{
+		gchar const* backend;
 
-			if (connection == NULL)
-			{
-				g_critical("Can not connect to %s [%d].", server, g_atomic_int_get(count));
-			}
+		backend = j_message_get_string(reply);
+
+		if (g_strcmp0(backend, "object") == 0)
+		{
+			//g_print("Server has object backend.\n");
+		}
+		else if (g_strcmp0(backend, "kv") == 0)
+		{
+			//g_print("Server has kv backend.\n");
+		}
+		else if (g_strcmp0(backend, "db") == 0)
+		{
+			//g_print("Server has db backend.\n");
+		}
+	}
 
-			j_helper_set_nodelay(connection, TRUE);
+	return connection;
+}
 
-			message = j_message_new(J_MESSAGE_PING, 0);
-			j_message_send(message, connection);
+static GSocketConnection*
+j_connection_pool_pop_internal(GAsyncQueue* queue, guint* count, gchar const* server)
+{
+	J_TRACE_FUNCTION(NULL);
 
-			reply = j_message_new_reply(message);
-			j_message_receive(reply, connection);
+	GSocketConnection* connection;
 
-			op_count = j_message_get_count(reply);
+	g_return_val_if_fail(queue != NULL, NULL);
+	g_return_val_if_fail(count != NULL, NULL);
 
-			for (guint i = 0; i < op_count; i++)
-			{
-				gchar const* backend;
+	connection = g_async_queue_try_pop(queue);
 
-				backend = j_message_get_string(reply);
+	if (connection != NULL)
+	{
+		return connection;
+	}
 
-				if (g_strcmp0(backend, "object") == 0)
-				{
-					//g_print("Server has object backend.\n");
-				}
-				else if (g_strcmp0(backend, "kv") == 0)
-				{
-					//g_print("Server has kv backend.\n");
-				}
-				else if (g_strcmp0(backend, "db") == 0)
-				{
-					//g_print("Server has db backend.\n");
-				}
-			}
+	if ((guint)g_atomic_int_get(count) < j_connection_pool->max_count)
+	{
+		if ((guint)g_atomic_int_add(count, 1) < j_connection_pool->max_count)
+		{
+			connection = j_connection_pool_connect(server, count);
 		}
 		else
 		{
@@ -270,6 +281,31 @@ j_connection_pool_push_internal(GAsyncQueue* queue, GSocketConnection* connectio
 	g_async_queue_push(queue, connection);
 }
 
+static void
+j_connection_pool_discard_internal(GAsyncQueue* queue, guint* count, gchar const* server, GSocketConnection* connection)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	GSocketConnection* replacement;
+
+	g_return_if_fail(queue != NULL);
+	g_return_if_fail(count != NULL);
+	g_return_if_fail(connection != NULL);
+
+	g_io_stream_close(G_IO_STREAM(connection), NULL, NULL);
+	g_object_unref(connection);
+
+	// Other threads might already be waiting for a connection, so the pool must not shrink
+	if ((replacement = j_connection_pool_connect(server, count)) != NULL)
+	{
+		g_async_queue_push(queue, replacement);
+	}
+	else
+	{
+		g_atomic_int_add(count, -1);
+	}
+}
+
 gpointer
 j_connection_pool_pop(JBackendType backend, guint index)
 {
@@ -322,6 +358,41 @@ j_connection_pool_push(JBackendType backend, guint index, gpointer connection)
 	}
 }
 
+/**
+ * Closes a connection that can not be used anymore, for instance, because a reply has not been received completely.
+ * Use this instead of j_connection_pool_push() for such connections.
+ *
+ * \param backend    A backend type.
+ * \param index      The server's index.
+ * \param connection A connection returned by j_connection_pool_pop().
+ **/
+void
+j_connection_pool_discard(JBackendType backend, guint index, gpointer connection)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_return_if_fail(j_connection_pool != NULL);
+	g_return_if_fail(connection != NULL);
+
+	switch (backend)
+	{
+		case J_BACKEND_TYPE_OBJECT:
+			g_return_if_fail(index < j_connection_pool->object_len);
+			j_connection_pool_discard_internal(j_connection_pool->object_queues[index].queue, &(j_connection_pool->object_queues[index].count), j_configuration_get_server(j_connection_pool->configuration, J_BACKEND_TYPE_OBJECT, index), connection);
+			break;
+		case J_BACKEND_TYPE_KV:
+			g_return_if_fail(index < j_connection_pool->kv_len);
+			j_connection_pool_discard_internal(j_connection_pool->kv_queues[index].queue, &(j_connection_pool->kv_queues[index].count), j_configuration_get_server(j_connection_pool->configuration, J_BACKEND_TYPE_KV, index), connection);
+			break;
+		case J_BACKEND_TYPE_DB:
+			g_return_if_fail(index < j_connection_pool->db_len);
+			j_connection_pool_discard_internal(j_connection_pool->db_queues[index].queue, &(j_connection_pool->db_queues[index].count), j_configuration_get_server(j_connection_pool->configuration, J_BACKEND_TYPE_DB, index), connection);
+			break;
+		default:
+			g_assert_not_reached();
+	}
+}
+
 /**
  * @}
  **/
@@ -82,8 +82,30 @@ struct JStatistics
 	 * The number of sent bytes.
 	 **/
 	guint64 bytes_sent;
+
+	/**
+	 * The number of key-value lookups answered by the client cache.
+	 **/
+	guint64 kv_cache_hits;
+
+	/**
+	 * The number of key-value lookups not answered by the client cache.
+	 **/
+	guint64 kv_cache_misses;
+
+	/**
+	 * The number of client cache entries invalidated by modifications.
+	 **/
+	guint64 kv_cache_invalidations;
 };
 
+/**
+ * The statistics of the client library, shared by all threads.
+ **/
+static JStatistics* j_statistics_client_statistics = NULL;
+
+G_LOCK_DEFINE_STATIC(j_statistics_client);
+
 static gchar const*
 j_statistics_get_type_name(JStatisticsType type)
 {
@@ -107,6 +129,12 @@ j_statistics_get_type_name(JStatisticsType type)
 			return "bytes_received";
 		case J_STATISTICS_BYTES_SENT:
 			return "bytes_sent";
+		case J_STATISTICS_KV_CACHE_HITS:
+			return "kv_cache_hits";
+		case J_STATISTICS_KV_CACHE_MISSES:
+			return "kv_cache_misses";
+		case J_STATISTICS_KV_CACHE_INVALIDATIONS:
+			return "kv_cache_invalidations";
 		default:
 			g_warn_if_reached();
 			return NULL;
@@ -143,6 +171,9 @@ j_statistics_new(gboolean trace)
 	statistics->bytes_written = 0;
 	statistics->bytes_received = 0;
 	statistics->bytes_sent = 0;
+	statistics->kv_cache_hits = 0;
+	statistics->kv_cache_misses = 0;
+	statistics->kv_cache_invalidations = 0;
 
 	return statistics;
 }
@@ -202,6 +233,15 @@ j_statistics_get(JStatistics* statistics, JStatisticsType type)
 		case J_STATISTICS_BYTES_SENT:
 			value = statistics->bytes_sent;
 			break;
+		case J_STATISTICS_KV_CACHE_HITS:
+			value = statistics->kv_cache_hits;
+			break;
+		case J_STATISTICS_KV_CACHE_MISSES:
+			value = statistics->kv_cache_misses;
+			break;
+		case J_STATISTICS_KV_CACHE_INVALIDATIONS:
+			value = statistics->kv_cache_invalidations;
+			break;
 		default:
 			g_warn_if_reached();
 			break;
@@ -243,6 +283,15 @@ j_statistics_add(JStatistics* statistics, JStatisticsType type, guint64 value)
 		case J_STATISTICS_BYTES_SENT:
 			statistics->bytes_sent += value;
 			break;
+		case J_STATISTICS_KV_CACHE_HITS:
+			statistics->kv_cache_hits += value;
+			break;
+		case J_STATISTICS_KV_CACHE_MISSES:
+			statistics->kv_cache_misses += value;
+			break;
+		case J_STATISTICS_KV_CACHE_INVALIDATIONS:
+			statistics->kv_cache_invalidations += value;
+			break;
 		default:
 			g_warn_if_reached();
 			break;
@@ -254,6 +303,69 @@ j_statistics_add(JStatistics* statistics, JStatisticsType type, guint64 value)
 	}
 }
 
+/**
+ * Returns a value of the client library's statistics.
+ *
+ * \private
+ *
+ * \code
+ * guint64 hits;
+ *
+ * hits = j_statistics_client_get(J_STATISTICS_KV_CACHE_HITS);
+ * \endcode
+ *
+ * \param type A statistics type.
+ *
+ * \return The value.
+ **/
+guint64
+j_statistics_client_get(JStatisticsType type)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	guint64 value = 0;
+
+	G_LOCK(j_statistics_client);
+
+	if (j_statistics_client_statistics != NULL)
+	{
+		value = j_statistics_get(j_statistics_client_statistics, type);
+	}
+
+	G_UNLOCK(j_statistics_client);
+
+	return value;
+}
+
+/**
+ * Adds a value to the client library's statistics.
+ *
+ * \private
+ *
+ * \code
+ * j_statistics_client_add(J_STATISTICS_KV_CACHE_HITS, 1);
+ * \endcode
+ *
+ * \param type  A statistics type.
+ * \param value A value.
+ **/
+void
+j_statistics_client_add(JStatisticsType type, guint64 value)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	G_LOCK(j_statistics_client);
+
+	if (j_statistics_client_statistics == NULL)
+	{
+		j_statistics_client_statistics = j_statistics_new(TRUE);
+	}
+
+	j_statistics_add(j_statistics_client_statistics, type, value);
+
+	G_UNLOCK(j_statistics_client);
+}
+
 /**
  * @}
  **/
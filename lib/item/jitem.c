@@ -54,6 +54,22 @@ struct JItemGetData
 
 typedef struct JItemGetData JItemGetData;
 
+/**
+ * The status of an item after a write, which is applied once the write has been executed.
+ **/
+struct JItemWriteStatus
+{
+	JItem* item;
+
+	guint64* bytes_written;
+	guint64 length;
+
+	guint64 size;
+	gint64 modification_time;
+};
+
+typedef struct JItemWriteStatus JItemWriteStatus;
+
 /**
  * A JItem.
  **/
@@ -328,6 +344,47 @@ j_item_read(JItem* item, gpointer data, guint64 length, guint64 offset, guint64*
 	j_distributed_object_read(item->object, data, length, offset, bytes_read, batch);
 }
 
+static void
+j_item_write_status_free(gpointer data)
+{
+	JItemWriteStatus* status = data;
+
+	j_item_unref(status->item);
+
+	g_slice_free(JItemWriteStatus, status);
+}
+
+/**
+ * Updates the items' status after their writes have been executed.
+ * Failed writes do not modify the status.
+ **/
+static gboolean
+j_item_write_status_exec(JList* operations, JSemantics* semantics)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_autoptr(JListIterator) it = NULL;
+
+	(void)semantics;
+
+	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JItemWriteStatus* status = j_list_iterator_get(it);
+
+		if (*(status->bytes_written) < status->length)
+		{
+			continue;
+		}
+
+		j_item_set_size(status->item, MAX(status->item->status.size, status->size));
+		j_item_set_modification_time(status->item, status->modification_time);
+	}
+
+	return TRUE;
+}
+
 /**
  * Writes an item.
  *
@@ -353,8 +410,43 @@ j_item_write(JItem* item, gconstpointer data, guint64 length, guint64 offset, gu
 	g_return_if_fail(data != NULL);
 	g_return_if_fail(bytes_written != NULL);
 
-	// FIXME see j_item_write_exec
 	j_distributed_object_write(item->object, data, length, offset, bytes_written, batch);
+
+	// The status is only stored with the item if there is no concurrency, see j_item_serialize
+	if (j_semantics_get(j_batch_get_semantics(batch), J_SEMANTICS_CONCURRENCY) == J_SEMANTICS_CONCURRENCY_NONE)
+	{
+		JItemWriteStatus* status;
+		JOperation* operation;
+		bson_t b[1];
+		bson_t b_document[1];
+
+		status = g_slice_new(JItemWriteStatus);
+		status->item = j_item_ref(item);
+		status->bytes_written = bytes_written;
+		status->length = length;
+		status->size = MAX(item->status.size, offset + length);
+		status->modification_time = g_get_real_time();
+
+		// Batches are executed in order, so the operation runs after the write
+		operation = j_operation_new();
+		operation->key = item;
+		operation->data = status;
+		operation->exec_func = j_item_write_status_exec;
+		operation->free_func = j_item_write_status_free;
+
+		j_batch_add(batch, operation);
+
+		bson_init(b);
+		bson_append_document_begin(b, "status", -1, b_document);
+		bson_append_int64(b_document, "size", -1, status->size);
+		bson_append_int64(b_document, "modification_time", -1, status->modification_time);
+		bson_append_document_end(b, b_document);
+
+		// Batches executed out of order must not shrink the item
+		j_kv_merge(item->kv, b, J_KV_MERGE_MAX, batch);
+
+		bson_destroy(b);
+	}
 }
 
 /**
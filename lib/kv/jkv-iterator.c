@@ -39,6 +39,20 @@
  * @{
  **/
 
+/**
+ * The number of keys requested from a server at once.
+ **/
+#define J_KV_ITERATOR_PAGE_SIZE 1000
+
+struct JKVIteratorEntry
+{
+	gchar const* key;
+	gconstpointer value;
+	guint32 len;
+};
+
+typedef struct JKVIteratorEntry JKVIteratorEntry;
+
 struct JKVIterator
 {
 	JBackend* kv_backend;
@@ -59,72 +73,193 @@ struct JKVIterator
 	gconstpointer value;
 	guint32 len;
 
-	JMessage** replies;
-	guint32 replies_n;
-	guint32 replies_cur;
+	gchar* namespace;
+
+	/**
+	 * The range, NULL if it is not bounded.
+	 **/
+	gchar* start;
+	gchar* end;
+
+	/**
+	 * The maximum number of keys, 0 for no limit.
+	 **/
+	guint32 limit;
+
+	/**
+	 * The number of keys received so far.
+	 **/
+	guint32 received;
+
+	/**
+	 * The server of the pending request and the server to stop at.
+	 **/
+	guint32 index;
+	guint32 index_end;
+
+	/**
+	 * The pending request, which is sent before the current page has been consumed.
+	 * NULL if there are no more pages.
+	 **/
+	JMessage* message;
+	gpointer connection;
+
+	/**
+	 * The current page, its entries point into the reply.
+	 **/
+	JMessage* reply;
+	GArray* entries;
+	guint entries_cur;
 };
 
-static JMessage*
-fetch_reply(guint32 index, gchar const* namespace, gchar const* prefix)
+/**
+ * Sends the request for the next page of the current server.
+ *
+ * \param iterator A JKVIterator.
+ * \param start    The first key of the page, NULL to start at the beginning of the range.
+ **/
+static void
+j_kv_iterator_send(JKVIterator* iterator, gchar const* start)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	g_autoptr(JMessage) message = NULL;
-	JMessage* reply;
-	JMessageType message_type;
-	gpointer kv_connection;
 	gsize namespace_len;
-	gsize prefix_len;
+	gsize start_len;
+	gsize end_len;
+	guint32 limit = J_KV_ITERATOR_PAGE_SIZE;
+
+	if (iterator->limit > 0)
+	{
+		limit = MIN(limit, iterator->limit - iterator->received);
+	}
 
-	namespace_len = strlen(namespace) + 1;
+	// Empty keys mean that the range is not bounded
+	start = (start != NULL) ? start : "";
 
-	if (prefix == NULL)
+	namespace_len = strlen(iterator->namespace) + 1;
+	start_len = strlen(start) + 1;
+	end_len = (iterator->end != NULL) ? strlen(iterator->end) + 1 : 1;
+
+	iterator->message = j_message_new(J_MESSAGE_KV_GET_RANGE, namespace_len + start_len + end_len + 4);
+	j_message_append_n(iterator->message, iterator->namespace, namespace_len);
+	j_message_append_n(iterator->message, start, start_len);
+	j_message_append_string(iterator->message, (iterator->end != NULL) ? iterator->end : "");
+	j_message_append_4(iterator->message, &limit);
+
+	if (iterator->connection == NULL)
 	{
-		message_type = J_MESSAGE_KV_GET_ALL;
-		prefix_len = 0;
+		iterator->connection = j_connection_pool_pop(J_BACKEND_TYPE_KV, iterator->index);
 	}
-	else
+
+	j_message_send(iterator->message, iterator->connection);
+}
+
+/**
+ * Receives the pending page and immediately requests the following one.
+ * The next page is thus transferred while the current one is being consumed.
+ *
+ * \param iterator A JKVIterator.
+ **/
+static void
+j_kv_iterator_receive(JKVIterator* iterator)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gchar const* next;
+	gboolean done;
+	gboolean more;
+	guint32 len;
+
+	g_return_if_fail(iterator->message != NULL);
+
+	if (iterator->reply != NULL)
 	{
-		message_type = J_MESSAGE_KV_GET_BY_PREFIX;
-		prefix_len = strlen(prefix) + 1;
+		j_message_unref(iterator->reply);
 	}
 
-	message = j_message_new(message_type, namespace_len + prefix_len);
-	j_message_append_n(message, namespace, namespace_len);
+	g_array_set_size(iterator->entries, 0);
+	iterator->entries_cur = 0;
 
-	if (prefix != NULL)
+	iterator->reply = j_message_new_reply(iterator->message);
+	j_message_receive(iterator->reply, iterator->connection);
+
+	j_message_unref(iterator->message);
+	iterator->message = NULL;
+
+	while ((len = j_message_get_4(iterator->reply)) > 0)
 	{
-		j_message_append_n(message, prefix, prefix_len);
+		JKVIteratorEntry entry;
+
+		entry.len = len;
+		entry.value = j_message_get_n(iterator->reply, len);
+		entry.key = j_message_get_string(iterator->reply);
+
+		g_array_append_val(iterator->entries, entry);
 	}
 
-	kv_connection = j_connection_pool_pop(J_BACKEND_TYPE_KV, index);
-	j_message_send(message, kv_connection);
+	more = (j_message_get_1(iterator->reply) != 0);
+	next = j_message_get_string(iterator->reply);
 
-	reply = j_message_new_reply(message);
-	j_message_receive(reply, kv_connection);
+	iterator->received += iterator->entries->len;
+	done = (iterator->limit > 0 && iterator->received >= iterator->limit);
 
-	j_connection_pool_push(J_BACKEND_TYPE_KV, index, kv_connection);
+	if (more && !done)
+	{
+		// The server does not keep any state, the next page simply starts at the first key it has not returned
+		j_kv_iterator_send(iterator, next);
+		return;
+	}
+
+	j_connection_pool_push(J_BACKEND_TYPE_KV, iterator->index, iterator->connection);
+	iterator->connection = NULL;
+	iterator->index++;
 
-	return reply;
+	if (!done && iterator->index < iterator->index_end)
+	{
+		j_kv_iterator_send(iterator, iterator->start);
+	}
 }
 
 /**
- * Creates a new JKVIterator.
+ * Returns the smallest key that is larger than all keys starting with prefix.
  *
- * \param store A JStore.
+ * \param prefix A prefix.
  *
- * \return A new JKVIterator.
+ * \return The end of the prefix's range, NULL if it is not bounded.
  **/
-JKVIterator*
-j_kv_iterator_new(gchar const* namespace, gchar const* prefix)
+static gchar*
+j_kv_iterator_prefix_end(gchar const* prefix)
 {
-	J_TRACE_FUNCTION(NULL);
+	gchar* end;
+	gsize len;
 
-	JKVIterator* iterator;
+	end = g_strdup(prefix);
+	len = strlen(end);
 
-	JConfiguration* configuration = j_configuration();
+	// Keys starting with prefix are smaller than prefix with its last byte incremented
+	while (len > 0 && (guchar)end[len - 1] == 0xff)
+	{
+		len--;
+	}
 
-	g_return_val_if_fail(namespace != NULL, NULL);
+	if (len == 0)
+	{
+		g_free(end);
+		return NULL;
+	}
+
+	end[len - 1]++;
+	end[len] = '\0';
+
+	return end;
+}
+
+static JKVIterator*
+j_kv_iterator_new_internal(guint32 index, guint32 index_end, gchar const* namespace, gchar const* start, gchar const* end, guint32 limit)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JKVIterator* iterator;
 
 	/* FIXME still necessary? */
 	//j_operation_cache_flush();
@@ -135,74 +270,103 @@ j_kv_iterator_new(gchar const* namespace, gchar const* prefix)
 	iterator->key = NULL;
 	iterator->value = NULL;
 	iterator->len = 0;
-	iterator->replies_n = j_configuration_get_server_count(configuration, J_BACKEND_TYPE_KV);
-	iterator->replies = g_new0(JMessage*, iterator->replies_n);
-	iterator->replies_cur = 0;
+	iterator->namespace = g_strdup(namespace);
+	iterator->start = (start != NULL && start[0] != '\0') ? g_strdup(start) : NULL;
+	iterator->end = (end != NULL && end[0] != '\0') ? g_strdup(end) : NULL;
+	iterator->limit = limit;
+	iterator->received = 0;
+	iterator->index = index;
+	iterator->index_end = index_end;
+	iterator->message = NULL;
+	iterator->connection = NULL;
+	iterator->reply = NULL;
+	iterator->entries = g_array_new(FALSE, FALSE, sizeof(JKVIteratorEntry));
+	iterator->entries_cur = 0;
 
 	if (iterator->kv_backend != NULL)
 	{
-		if (prefix == NULL)
+		if (!j_backend_kv_get_range(iterator->kv_backend, iterator->namespace, iterator->start, iterator->end, limit, &(iterator->cursor)))
 		{
-			j_backend_kv_get_all(iterator->kv_backend, namespace, &(iterator->cursor));
-		}
-		else
-		{
-			j_backend_kv_get_by_prefix(iterator->kv_backend, namespace, prefix, &(iterator->cursor));
+			iterator->cursor = NULL;
 		}
 	}
 	else
 	{
-		for (guint32 i = 0; i < iterator->replies_n; i++)
-		{
-			iterator->replies[i] = fetch_reply(i, namespace, prefix);
-		}
+		j_kv_iterator_send(iterator, iterator->start);
 	}
 
 	return iterator;
 }
 
+/**
+ * Creates a new JKVIterator.
+ *
+ * \param namespace A namespace.
+ * \param prefix    A prefix, NULL to iterate over all keys.
+ *
+ * \return A new JKVIterator.
+ **/
 JKVIterator*
-j_kv_iterator_new_for_index(guint32 index, gchar const* namespace, gchar const* prefix)
+j_kv_iterator_new(gchar const* namespace, gchar const* prefix)
 {
 	J_TRACE_FUNCTION(NULL);
 
-	JKVIterator* iterator;
+	g_autofree gchar* end = NULL;
 
 	JConfiguration* configuration = j_configuration();
 
 	g_return_val_if_fail(namespace != NULL, NULL);
-	g_return_val_if_fail(index < j_configuration_get_server_count(configuration, J_BACKEND_TYPE_KV), NULL);
-
-	/* FIXME still necessary? */
-	//j_operation_cache_flush();
 
-	iterator = g_slice_new(JKVIterator);
-	iterator->kv_backend = j_kv_get_backend();
-	iterator->cursor = NULL;
-	iterator->key = NULL;
-	iterator->value = NULL;
-	iterator->len = 0;
-	iterator->replies_n = 1;
-	iterator->replies = g_new0(JMessage*, 1);
-	iterator->replies_cur = 0;
-
-	if (iterator->kv_backend != NULL)
+	if (prefix != NULL)
 	{
-		if (prefix == NULL)
-		{
-			j_backend_kv_get_all(iterator->kv_backend, namespace, &(iterator->cursor));
-		}
-		else
-		{
-			j_backend_kv_get_by_prefix(iterator->kv_backend, namespace, prefix, &(iterator->cursor));
-		}
+		end = j_kv_iterator_prefix_end(prefix);
 	}
-	else
+
+	return j_kv_iterator_new_internal(0, j_configuration_get_server_count(configuration, J_BACKEND_TYPE_KV), namespace, prefix, end, 0);
+}
+
+JKVIterator*
+j_kv_iterator_new_for_index(guint32 index, gchar const* namespace, gchar const* prefix)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_autofree gchar* end = NULL;
+
+	JConfiguration* configuration = j_configuration();
+
+	g_return_val_if_fail(namespace != NULL, NULL);
+	g_return_val_if_fail(index < j_configuration_get_server_count(configuration, J_BACKEND_TYPE_KV), NULL);
+
+	if (prefix != NULL)
 	{
-		iterator->replies[0] = fetch_reply(index, namespace, prefix);
+		end = j_kv_iterator_prefix_end(prefix);
 	}
 
-	return iterator;
+	return j_kv_iterator_new_internal(index, index + 1, namespace, prefix, end, 0);
+}
+
+/**
+ * Creates a new JKVIterator for a range of keys.
+ * Keys are returned in ascending order per server.
+ * The keys are fetched in pages, so large ranges do not have to fit into memory at once.
+ *
+ * \param namespace A namespace.
+ * \param start     The first key (inclusive), NULL to start at the first key.
+ * \param end       The last key (exclusive), NULL to stop at the last key.
+ * \param limit     The maximum number of keys, 0 for no limit.
+ *
+ * \return A new JKVIterator.
+ **/
+JKVIterator*
+j_kv_iterator_new_range(gchar const* namespace, gchar const* start, gchar const* end, guint32 limit)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JConfiguration* configuration = j_configuration();
+
+	g_return_val_if_fail(namespace != NULL, NULL);
+
+	return j_kv_iterator_new_internal(0, j_configuration_get_server_count(configuration, J_BACKEND_TYPE_KV), namespace, start, end, limit);
 }
 
 /**
@@ -217,15 +381,40 @@ j_kv_iterator_free(JKVIterator* iterator)
 
 	g_return_if_fail(iterator != NULL);
 
-	for (guint32 i = 0; i < iterator->replies_n; i++)
+	if (iterator->kv_backend != NULL && iterator->cursor != NULL)
 	{
-		if (iterator->replies[i] != NULL)
+		// Backends free their iterators when they have been exhausted
+		while (j_backend_kv_iterate(iterator->kv_backend, iterator->cursor, &(iterator->key), &(iterator->value), &(iterator->len)))
 		{
-			j_message_unref(iterator->replies[i]);
 		}
 	}
 
-	g_free(iterator->replies);
+	if (iterator->message != NULL)
+	{
+		g_autoptr(JMessage) reply = NULL;
+
+		// The pending reply has to be received before the connection can be reused
+		reply = j_message_new_reply(iterator->message);
+		j_message_receive(reply, iterator->connection);
+
+		j_message_unref(iterator->message);
+	}
+
+	if (iterator->connection != NULL)
+	{
+		j_connection_pool_push(J_BACKEND_TYPE_KV, iterator->index, iterator->connection);
+	}
+
+	if (iterator->reply != NULL)
+	{
+		j_message_unref(iterator->reply);
+	}
+
+	g_array_free(iterator->entries, TRUE);
+
+	g_free(iterator->namespace);
+	g_free(iterator->start);
+	g_free(iterator->end);
 
 	g_slice_free(JKVIterator, iterator);
 }
@@ -251,25 +440,34 @@ j_kv_iterator_next(JKVIterator* iterator)
 
 	if (iterator->kv_backend != NULL)
 	{
-		ret = j_backend_kv_iterate(iterator->kv_backend, iterator->cursor, &(iterator->key), &(iterator->value), &(iterator->len));
+		if (iterator->cursor != NULL)
+		{
+			ret = j_backend_kv_iterate(iterator->kv_backend, iterator->cursor, &(iterator->key), &(iterator->value), &(iterator->len));
+
+			if (!ret)
+			{
+				iterator->cursor = NULL;
+			}
+		}
 	}
 	else
 	{
-	retry:
-		iterator->len = j_message_get_4(iterator->replies[iterator->replies_cur]);
+		while (iterator->entries_cur == iterator->entries->len && iterator->message != NULL)
+		{
+			j_kv_iterator_receive(iterator);
+		}
 
-		if (iterator->len > 0)
+		if (iterator->entries_cur < iterator->entries->len)
 		{
-			iterator->value = j_message_get_n(iterator->replies[iterator->replies_cur], iterator->len);
-			iterator->key = j_message_get_string(iterator->replies[iterator->replies_cur]);
+			JKVIteratorEntry const* entry = &g_array_index(iterator->entries, JKVIteratorEntry, iterator->entries_cur);
+
+			iterator->key = entry->key;
+			iterator->value = entry->value;
+			iterator->len = entry->len;
+			iterator->entries_cur++;
 
 			ret = TRUE;
 		}
-		else if (iterator->replies_cur < iterator->replies_n - 1)
-		{
-			iterator->replies_cur++;
-			goto retry;
-		}
 	}
 
 	return ret;
@@ -59,6 +59,26 @@ struct JKVOperation
 			guint32 value_len;
 			GDestroyNotify value_destroy;
 		} put;
+
+		struct
+		{
+			JKV* kv;
+			gpointer expected;
+			guint32 expected_len;
+			gpointer value;
+			guint32 value_len;
+			GDestroyNotify value_destroy;
+			gint64 delta;
+			gboolean max;
+			gboolean* ret;
+			gint64* result;
+		} update;
+
+		struct
+		{
+			gchar* namespace;
+			gchar* prefix;
+		} delete_prefix;
 	};
 };
 
@@ -90,13 +110,53 @@ struct JKV
 	gint ref_count;
 };
 
+/**
+ * A cached value.
+ **/
+struct JKVCacheEntry
+{
+	/**
+	 * The value.
+	 **/
+	gpointer value;
+
+	/**
+	 * The value's length.
+	 **/
+	guint32 value_len;
+
+	/**
+	 * The monotonic time at which the lease expires.
+	 **/
+	gint64 expiry;
+};
+
+typedef struct JKVCacheEntry JKVCacheEntry;
+
 static JBackend* j_kv_backend = NULL;
 static GModule* j_kv_module = NULL;
 
+/**
+ * The client cache, which maps the data server index, namespace and key to a JKVCacheEntry.
+ * It is only used for lookups with eventual consistency.
+ **/
+static GHashTable* j_kv_cache = NULL;
+static GMutex j_kv_cache_mutex;
+static gint64 j_kv_cache_lease = 0;
+static guint j_kv_cache_size = 0;
+
+/**
+ * The cache's generation, which is advanced whenever a modification starts or finishes.
+ * Lookups only cache their results if no modification overlapped them.
+ **/
+static guint64 j_kv_cache_generation = 0;
+
 // FIXME copy and use GLib's G_DEFINE_CONSTRUCTOR/DESTRUCTOR
 static void __attribute__((constructor)) j_kv_init(void);
 static void __attribute__((destructor)) j_kv_fini(void);
 
+static void j_kv_cache_entry_free(gpointer);
+
 /**
  * Initializes the kv client.
  */
@@ -116,6 +176,14 @@ j_kv_init(void)
 	kv_component = j_configuration_get_backend_component(j_configuration(), J_BACKEND_TYPE_KV);
 	kv_path = j_configuration_get_backend_path(j_configuration(), J_BACKEND_TYPE_KV);
 
+	j_kv_cache_lease = j_configuration_get_kv_cache_lease(j_configuration()) * G_TIME_SPAN_MILLISECOND;
+
+	if (j_kv_cache_lease > 0)
+	{
+		j_kv_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, j_kv_cache_entry_free);
+		j_kv_cache_size = j_configuration_get_kv_cache_size(j_configuration());
+	}
+
 	if (j_backend_load_client(kv_backend, kv_component, J_BACKEND_TYPE_KV, &j_kv_module, &j_kv_backend))
 	{
 		if (j_kv_backend == NULL || !j_backend_kv_init(j_kv_backend, kv_path))
@@ -131,6 +199,18 @@ j_kv_init(void)
 static void
 j_kv_fini(void)
 {
+	if (j_kv_cache != NULL)
+	{
+		// The cache only exists in clients, so its statistics are reported here instead of by the servers
+		g_debug("kv: Client cache had %" G_GUINT64_FORMAT " hits, %" G_GUINT64_FORMAT " misses and %" G_GUINT64_FORMAT " invalidations.",
+		        j_statistics_client_get(J_STATISTICS_KV_CACHE_HITS),
+		        j_statistics_client_get(J_STATISTICS_KV_CACHE_MISSES),
+		        j_statistics_client_get(J_STATISTICS_KV_CACHE_INVALIDATIONS));
+
+		g_hash_table_destroy(j_kv_cache);
+		j_kv_cache = NULL;
+	}
+
 	if (j_kv_backend == NULL && j_kv_module == NULL)
 	{
 		return;
@@ -147,6 +227,250 @@ j_kv_fini(void)
 	}
 }
 
+static void
+j_kv_cache_entry_free(gpointer data)
+{
+	JKVCacheEntry* entry = data;
+
+	g_free(entry->value);
+
+	g_slice_free(JKVCacheEntry, entry);
+}
+
+static gchar*
+j_kv_cache_key(JKV* kv)
+{
+	// The namespace's length makes the key unambiguous
+	return g_strdup_printf("%" G_GUINT32_FORMAT ":%" G_GSIZE_FORMAT ":%s%s", kv->index, strlen(kv->namespace), kv->namespace, kv->key);
+}
+
+static gboolean
+j_kv_cache_is_expired(gpointer key, gpointer value, gpointer data)
+{
+	JKVCacheEntry* entry = value;
+	gint64 const* now = data;
+
+	(void)key;
+
+	return (entry->expiry <= *now);
+}
+
+/**
+ * Looks up a key-value pair in the client cache.
+ *
+ * \param kv        A JKV.
+ * \param value     A pointer for the value's copy.
+ * \param value_len A pointer for the value's length.
+ *
+ * \return TRUE if the key-value pair was cached and its lease has not expired, FALSE otherwise.
+ **/
+static gboolean
+j_kv_cache_lookup(JKV* kv, gpointer* value, guint32* value_len)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = FALSE;
+
+	g_autofree gchar* key = NULL;
+	JKVCacheEntry* entry;
+
+	key = j_kv_cache_key(kv);
+
+	g_mutex_lock(&j_kv_cache_mutex);
+
+	entry = g_hash_table_lookup(j_kv_cache, key);
+
+	if (entry != NULL && entry->expiry > g_get_monotonic_time())
+	{
+		*value = g_memdup(entry->value, entry->value_len);
+		*value_len = entry->value_len;
+		ret = TRUE;
+	}
+	else if (entry != NULL)
+	{
+		g_hash_table_remove(j_kv_cache, key);
+	}
+
+	g_mutex_unlock(&j_kv_cache_mutex);
+
+	j_statistics_client_add((ret) ? J_STATISTICS_KV_CACHE_HITS : J_STATISTICS_KV_CACHE_MISSES, 1);
+
+	return ret;
+}
+
+/**
+ * Returns the client cache's generation, which has to be passed to j_kv_cache_insert().
+ *
+ * \return The generation.
+ **/
+static guint64
+j_kv_cache_get_generation(void)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	guint64 generation;
+
+	g_mutex_lock(&j_kv_cache_mutex);
+	generation = j_kv_cache_generation;
+	g_mutex_unlock(&j_kv_cache_mutex);
+
+	return generation;
+}
+
+/**
+ * Marks the end of modifications, keeping lookups that overlapped them from caching their results.
+ **/
+static void
+j_kv_cache_advance(void)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	if (j_kv_cache == NULL)
+	{
+		return;
+	}
+
+	g_mutex_lock(&j_kv_cache_mutex);
+	j_kv_cache_generation++;
+	g_mutex_unlock(&j_kv_cache_mutex);
+}
+
+/**
+ * Stores a copy of a key-value pair in the client cache.
+ * The pair is not stored if a modification has started or finished since \p generation was obtained,
+ * because the value might already be outdated.
+ *
+ * \param kv         A JKV.
+ * \param value      A value.
+ * \param value_len  The value's length.
+ * \param generation The generation returned by j_kv_cache_get_generation() before the lookup was sent.
+ **/
+static void
+j_kv_cache_insert(JKV* kv, gconstpointer value, guint32 value_len, guint64 generation)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JKVCacheEntry* entry;
+	gint64 now;
+
+	now = g_get_monotonic_time();
+
+	entry = g_slice_new(JKVCacheEntry);
+	entry->value = g_memdup(value, value_len);
+	entry->value_len = value_len;
+	entry->expiry = now + j_kv_cache_lease;
+
+	g_mutex_lock(&j_kv_cache_mutex);
+
+	if (generation != j_kv_cache_generation)
+	{
+		g_mutex_unlock(&j_kv_cache_mutex);
+		j_kv_cache_entry_free(entry);
+		return;
+	}
+
+	if (g_hash_table_size(j_kv_cache) >= j_kv_cache_size)
+	{
+		g_hash_table_foreach_remove(j_kv_cache, j_kv_cache_is_expired, &now);
+	}
+
+	if (g_hash_table_size(j_kv_cache) >= j_kv_cache_size)
+	{
+		// All leases are still valid, start over instead of tracking the entries' age
+		g_hash_table_remove_all(j_kv_cache);
+	}
+
+	g_hash_table_replace(j_kv_cache, j_kv_cache_key(kv), entry);
+
+	g_mutex_unlock(&j_kv_cache_mutex);
+}
+
+/**
+ * Removes all key-value pairs with a prefix that are about to be deleted from the client cache.
+ *
+ * \param namespace A namespace.
+ * \param prefix    A prefix.
+ **/
+static void
+j_kv_cache_invalidate_prefix(gchar const* namespace, gchar const* prefix)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	GHashTableIter iter;
+	gchar const* key;
+	guint32 server_count;
+	guint invalidations = 0;
+
+	if (j_kv_cache == NULL)
+	{
+		return;
+	}
+
+	server_count = j_configuration_get_server_count(j_configuration(), J_BACKEND_TYPE_KV);
+
+	g_mutex_lock(&j_kv_cache_mutex);
+
+	j_kv_cache_generation++;
+
+	g_hash_table_iter_init(&iter, j_kv_cache);
+
+	while (g_hash_table_iter_next(&iter, (gpointer*)&key, NULL))
+	{
+		// Cache keys start with the index, so the prefix has to be checked for every server
+		for (guint32 i = 0; i < server_count; i++)
+		{
+			g_autofree gchar* cache_prefix = NULL;
+
+			cache_prefix = g_strdup_printf("%" G_GUINT32_FORMAT ":%" G_GSIZE_FORMAT ":%s%s", i, strlen(namespace), namespace, prefix);
+
+			if (g_str_has_prefix(key, cache_prefix))
+			{
+				g_hash_table_iter_remove(&iter);
+				invalidations++;
+				break;
+			}
+		}
+	}
+
+	g_mutex_unlock(&j_kv_cache_mutex);
+
+	j_statistics_client_add(J_STATISTICS_KV_CACHE_INVALIDATIONS, invalidations);
+}
+
+/**
+ * Removes a key-value pair that is about to be modified from the client cache.
+ *
+ * \param kv A JKV.
+ **/
+static void
+j_kv_cache_invalidate(JKV* kv)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	g_autofree gchar* key = NULL;
+	gboolean removed;
+
+	if (j_kv_cache == NULL)
+	{
+		return;
+	}
+
+	key = j_kv_cache_key(kv);
+
+	g_mutex_lock(&j_kv_cache_mutex);
+
+	// Lookups that are in flight must not cache the old value
+	j_kv_cache_generation++;
+	removed = g_hash_table_remove(j_kv_cache, key);
+
+	g_mutex_unlock(&j_kv_cache_mutex);
+
+	if (removed)
+	{
+		j_statistics_client_add(J_STATISTICS_KV_CACHE_INVALIDATIONS, 1);
+	}
+}
+
 static void
 j_kv_put_free(gpointer data)
 {
@@ -186,6 +510,38 @@ j_kv_get_free(gpointer data)
 	g_slice_free(JKVOperation, operation);
 }
 
+static void
+j_kv_delete_prefix_free(gpointer data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JKVOperation* operation = data;
+
+	g_free(operation->delete_prefix.namespace);
+	g_free(operation->delete_prefix.prefix);
+
+	g_slice_free(JKVOperation, operation);
+}
+
+static void
+j_kv_update_free(gpointer data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JKVOperation* operation = data;
+
+	j_kv_unref(operation->update.kv);
+
+	g_free(operation->update.expected);
+
+	if (operation->update.value_destroy != NULL && operation->update.value != NULL)
+	{
+		operation->update.value_destroy(operation->update.value);
+	}
+
+	g_slice_free(JKVOperation, operation);
+}
+
 static gboolean
 j_kv_put_exec(JList* operations, JSemantics* semantics)
 {
@@ -239,25 +595,45 @@ j_kv_put_exec(JList* operations, JSemantics* semantics)
 		j_message_append_n(message, namespace, namespace_len);
 	}
 
-	while (j_list_iterator_next(it))
+	if (kv_backend != NULL)
 	{
-		JKVOperation* kop = j_list_iterator_get(it);
-
-		if (kv_backend != NULL)
+		g_autofree gchar const** keys = NULL;
+		g_autofree gconstpointer* values = NULL;
+		g_autofree guint32* lens = NULL;
+		guint count;
+		guint i = 0;
+
+		count = j_list_length(operations);
+		keys = g_new(gchar const*, count);
+		values = g_new(gconstpointer, count);
+		lens = g_new(guint32, count);
+
+		while (j_list_iterator_next(it))
 		{
-			ret = j_backend_kv_put(kv_backend, kv_batch, kop->put.kv->key, kop->put.value, kop->put.value_len) && ret;
+			JKVOperation* kop = j_list_iterator_get(it);
+
+			keys[i] = kop->put.kv->key;
+			values[i] = kop->put.value;
+			lens[i] = kop->put.value_len;
+			i++;
 		}
-		else
-		{
-			gsize key_len;
 
-			key_len = strlen(kop->put.kv->key) + 1;
+		ret = j_backend_kv_put_multi(kv_backend, kv_batch, keys, values, lens, count) && ret;
+	}
 
-			j_message_add_operation(message, key_len + 4 + kop->put.value_len);
-			j_message_append_n(message, kop->put.kv->key, key_len);
-			j_message_append_4(message, &(kop->put.value_len));
-			j_message_append_n(message, kop->put.value, kop->put.value_len);
-		}
+	while (kv_backend == NULL && j_list_iterator_next(it))
+	{
+		JKVOperation* kop = j_list_iterator_get(it);
+		gsize key_len;
+
+		key_len = strlen(kop->put.kv->key) + 1;
+
+		j_kv_cache_invalidate(kop->put.kv);
+
+		j_message_add_operation(message, key_len + 4 + kop->put.value_len);
+		j_message_append_n(message, kop->put.kv->key, key_len);
+		j_message_append_4(message, &(kop->put.value_len));
+		j_message_append_n(message, kop->put.value, kop->put.value_len);
 	}
 
 	if (kv_backend != NULL)
@@ -282,6 +658,7 @@ j_kv_put_exec(JList* operations, JSemantics* semantics)
 		}
 
 		j_connection_pool_push(J_BACKEND_TYPE_KV, index, kv_connection);
+		j_kv_cache_advance();
 	}
 
 	return ret;
@@ -346,6 +723,8 @@ j_kv_delete_exec(JList* operations, JSemantics* semantics)
 
 			key_len = strlen(kv->key) + 1;
 
+			j_kv_cache_invalidate(kv);
+
 			j_message_add_operation(message, key_len);
 			j_message_append_n(message, kv->key, key_len);
 		}
@@ -373,6 +752,7 @@ j_kv_delete_exec(JList* operations, JSemantics* semantics)
 		}
 
 		j_connection_pool_push(J_BACKEND_TYPE_KV, index, kv_connection);
+		j_kv_cache_advance();
 	}
 
 	return ret;
@@ -386,6 +766,7 @@ j_kv_get_exec(JList* operations, JSemantics* semantics)
 	gboolean ret = TRUE;
 
 	JBackend* kv_backend;
+	g_autoptr(JList) misses = NULL;
 	g_autoptr(JListIterator) it = NULL;
 	g_autoptr(JMessage) message = NULL;
 	gchar const* namespace;
@@ -407,9 +788,48 @@ j_kv_get_exec(JList* operations, JSemantics* semantics)
 		index = kop->get.kv->index;
 	}
 
-	it = j_list_iterator_new(operations);
 	kv_backend = j_kv_get_backend();
 
+	// Eventual consistency allows answering lookups from the cache as long as the leases are valid
+	if (kv_backend == NULL && j_kv_cache != NULL && j_semantics_get(semantics, J_SEMANTICS_CONSISTENCY) == J_SEMANTICS_CONSISTENCY_EVENTUAL)
+	{
+		misses = j_list_new(NULL);
+		it = j_list_iterator_new(operations);
+
+		while (j_list_iterator_next(it))
+		{
+			JKVOperation* kop = j_list_iterator_get(it);
+			gpointer value;
+			guint32 len;
+
+			if (!j_kv_cache_lookup(kop->get.kv, &value, &len))
+			{
+				j_list_append(misses, kop);
+				continue;
+			}
+
+			if (kop->get.func != NULL)
+			{
+				kop->get.func(value, len, kop->get.data);
+			}
+			else
+			{
+				*(kop->get.value) = value;
+				*(kop->get.value_len) = len;
+			}
+		}
+
+		if (j_list_length(misses) == 0)
+		{
+			return TRUE;
+		}
+
+		j_list_iterator_free(it);
+		operations = misses;
+	}
+
+	it = j_list_iterator_new(operations);
+
 	if (kv_backend != NULL)
 	{
 		ret = j_backend_kv_batch_start(kv_backend, namespace, semantics, &kv_batch);
@@ -429,39 +849,69 @@ j_kv_get_exec(JList* operations, JSemantics* semantics)
 		j_message_append_n(message, namespace, namespace_len);
 	}
 
-	while (j_list_iterator_next(it))
+	if (kv_backend != NULL)
 	{
-		JKVOperation* kop = j_list_iterator_get(it);
+		g_autofree gchar const** keys = NULL;
+		g_autofree gconstpointer* values = NULL;
+		g_autofree guint32* lens = NULL;
+		guint count;
+		guint i = 0;
+
+		count = j_list_length(operations);
+		keys = g_new(gchar const*, count);
+		values = g_new(gconstpointer, count);
+		lens = g_new(guint32, count);
+
+		while (j_list_iterator_next(it))
+		{
+			JKVOperation* kop = j_list_iterator_get(it);
 
-		if (kv_backend != NULL)
+			keys[i] = kop->get.kv->key;
+			i++;
+		}
+
+		ret = j_backend_kv_get_multi(kv_backend, kv_batch, keys, count, values, lens) && ret;
+
+		i = 0;
+		j_list_iterator_free(it);
+		it = j_list_iterator_new(operations);
+
+		while (j_list_iterator_next(it))
 		{
-			if (kop->get.func != NULL)
-			{
-				gpointer value;
-				guint32 len;
+			JKVOperation* kop = j_list_iterator_get(it);
+			gconstpointer value = values[i];
+			guint32 len = lens[i];
 
-				ret = j_backend_kv_get(kv_backend, kv_batch, kop->get.kv->key, &value, &len) && ret;
+			i++;
 
-				if (ret)
-				{
-					// j_backend_kv_get returns a new copy, pass it along
-					kop->get.func(value, len, kop->get.data);
-				}
+			if (value == NULL)
+			{
+				ret = FALSE;
+				continue;
+			}
+
+			// value belongs to the backend, create a copy for the caller
+			if (kop->get.func != NULL)
+			{
+				kop->get.func(g_memdup(value, len), len, kop->get.data);
 			}
 			else
 			{
-				ret = j_backend_kv_get(kv_backend, kv_batch, kop->get.kv->key, kop->get.value, kop->get.value_len) && ret;
+				*(kop->get.value) = g_memdup(value, len);
+				*(kop->get.value_len) = len;
 			}
 		}
-		else
-		{
-			gsize key_len;
+	}
 
-			key_len = strlen(kop->get.kv->key) + 1;
+	while (kv_backend == NULL && j_list_iterator_next(it))
+	{
+		JKVOperation* kop = j_list_iterator_get(it);
+		gsize key_len;
 
-			j_message_add_operation(message, key_len);
-			j_message_append_n(message, kop->get.kv->key, key_len);
-		}
+		key_len = strlen(kop->get.kv->key) + 1;
+
+		j_message_add_operation(message, key_len);
+		j_message_append_n(message, kop->get.kv->key, key_len);
 	}
 
 	if (kv_backend != NULL)
@@ -472,7 +922,15 @@ j_kv_get_exec(JList* operations, JSemantics* semantics)
 	{
 		g_autoptr(JListIterator) iter = NULL;
 		g_autoptr(JMessage) reply = NULL;
+		GInputStream* input;
 		gpointer kv_connection;
+		guint64 generation = 0;
+		gboolean broken = FALSE;
+
+		if (j_kv_cache != NULL)
+		{
+			generation = j_kv_cache_get_generation();
+		}
 
 		kv_connection = j_connection_pool_pop(J_BACKEND_TYPE_KV, index);
 		j_message_send(message, kv_connection);
@@ -480,6 +938,7 @@ j_kv_get_exec(JList* operations, JSemantics* semantics)
 		reply = j_message_new_reply(message);
 		j_message_receive(reply, kv_connection);
 
+		input = g_io_stream_get_input_stream(G_IO_STREAM(kv_connection));
 		iter = j_list_iterator_new(operations);
 
 		while (j_list_iterator_next(iter))
@@ -492,32 +951,366 @@ j_kv_get_exec(JList* operations, JSemantics* semantics)
 
 			if (len > 0)
 			{
-				gconstpointer data;
+				gpointer value;
+				gsize bytes_read = 0;
 
-				data = j_message_get_n(reply, len);
+				// The values follow the reply in the order of the operations, read them into their final buffers
+				value = g_malloc(len);
 
-				if (kop->get.func != NULL)
+				if (!g_input_stream_read_all(input, value, len, &bytes_read, NULL, NULL) || bytes_read != len)
+				{
+					// The following values can not be located anymore, fail the remaining operations
+					g_free(value);
+					ret = FALSE;
+					broken = TRUE;
+					break;
+				}
+
+				if (j_kv_cache != NULL)
 				{
-					gpointer value;
+					j_kv_cache_insert(kop->get.kv, value, len, generation);
+				}
 
-					// data belongs to the message, create a copy for the callback
-					value = g_memdup(data, len);
+				if (kop->get.func != NULL)
+				{
 					kop->get.func(value, len, kop->get.data);
 				}
 				else
 				{
-					*(kop->get.value) = g_memdup(data, len);
+					*(kop->get.value) = value;
 					*(kop->get.value_len) = len;
 				}
 			}
 		}
 
+		// The rest of the reply is still pending, so the connection can not be reused
+		if (broken)
+		{
+			j_connection_pool_discard(J_BACKEND_TYPE_KV, index, kv_connection);
+		}
+		else
+		{
+			j_connection_pool_push(J_BACKEND_TYPE_KV, index, kv_connection);
+		}
+	}
+
+	return ret;
+}
+
+static gboolean
+j_kv_delete_prefix_exec(JList* operations, JSemantics* semantics)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = TRUE;
+
+	JBackend* kv_backend;
+	g_autoptr(JListIterator) it = NULL;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	it = j_list_iterator_new(operations);
+	kv_backend = j_kv_get_backend();
+
+	if (kv_backend != NULL)
+	{
+		while (j_list_iterator_next(it))
+		{
+			JKVOperation* kop = j_list_iterator_get(it);
+
+			ret = j_backend_kv_delete_prefix(kv_backend, kop->delete_prefix.namespace, semantics, kop->delete_prefix.prefix) && ret;
+		}
+	}
+	else
+	{
+		g_autoptr(JMessage) message = NULL;
+		g_autofree gpointer* kv_connections = NULL;
+		guint32 server_count;
+
+		server_count = j_configuration_get_server_count(j_configuration(), J_BACKEND_TYPE_KV);
+		kv_connections = g_new(gpointer, server_count);
+
+		message = j_message_new(J_MESSAGE_KV_DELETE_PREFIX, 0);
+		j_message_set_semantics(message, semantics);
+
+		while (j_list_iterator_next(it))
+		{
+			JKVOperation* kop = j_list_iterator_get(it);
+			gsize namespace_len;
+			gsize prefix_len;
+
+			namespace_len = strlen(kop->delete_prefix.namespace) + 1;
+			prefix_len = strlen(kop->delete_prefix.prefix) + 1;
+
+			j_kv_cache_invalidate_prefix(kop->delete_prefix.namespace, kop->delete_prefix.prefix);
+
+			j_message_add_operation(message, namespace_len + prefix_len);
+			j_message_append_n(message, kop->delete_prefix.namespace, namespace_len);
+			j_message_append_n(message, kop->delete_prefix.prefix, prefix_len);
+		}
+
+		// Keys are distributed across all servers, send the message to all of them before waiting for any reply
+		for (guint i = 0; i < server_count; i++)
+		{
+			kv_connections[i] = j_connection_pool_pop(J_BACKEND_TYPE_KV, i);
+			j_message_send(message, kv_connections[i]);
+		}
+
+		for (guint i = 0; i < server_count; i++)
+		{
+			g_autoptr(JMessage) reply = NULL;
+			guint32 operation_count;
+
+			reply = j_message_new_reply(message);
+			j_message_receive(reply, kv_connections[i]);
+
+			operation_count = j_message_get_count(reply);
+
+			for (guint j = 0; j < operation_count; j++)
+			{
+				ret = (j_message_get_4(reply) != 0) && ret;
+			}
+
+			j_connection_pool_push(J_BACKEND_TYPE_KV, i, kv_connections[i]);
+		}
+
+		j_kv_cache_advance();
+	}
+
+	return ret;
+}
+
+/**
+ * Executes atomic updates, which are always executed by the backend to avoid a round trip per update.
+ **/
+static gboolean
+j_kv_update_exec(JList* operations, JSemantics* semantics, JMessageType type)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = TRUE;
+
+	JBackend* kv_backend;
+	g_autoptr(JListIterator) it = NULL;
+	g_autoptr(JMessage) message = NULL;
+	gchar const* namespace;
+	gsize namespace_len;
+	guint32 index;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	{
+		JKVOperation* kop;
+
+		kop = j_list_get_first(operations);
+		g_assert(kop != NULL);
+
+		namespace = kop->update.kv->namespace;
+		namespace_len = strlen(namespace) + 1;
+		index = kop->update.kv->index;
+	}
+
+	it = j_list_iterator_new(operations);
+	kv_backend = j_kv_get_backend();
+
+	if (kv_backend != NULL)
+	{
+		g_autofree JBackendKVUpdate* updates = NULL;
+		guint i = 0;
+
+		updates = g_new0(JBackendKVUpdate, j_list_length(operations));
+
+		while (j_list_iterator_next(it))
+		{
+			JKVOperation* kop = j_list_iterator_get(it);
+
+			updates[i].key = kop->update.kv->key;
+			updates[i].expected = kop->update.expected;
+			updates[i].expected_len = kop->update.expected_len;
+			updates[i].value = kop->update.value;
+			updates[i].len = kop->update.value_len;
+			updates[i].delta = kop->update.delta;
+			updates[i].max = kop->update.max;
+
+			if (type == J_MESSAGE_KV_CAS)
+			{
+				updates[i].type = J_BACKEND_KV_UPDATE_CAS;
+			}
+			else if (type == J_MESSAGE_KV_INCREMENT)
+			{
+				updates[i].type = J_BACKEND_KV_UPDATE_INCREMENT;
+			}
+			else
+			{
+				updates[i].type = J_BACKEND_KV_UPDATE_MERGE;
+			}
+
+			i++;
+		}
+
+		ret = j_backend_kv_update(kv_backend, namespace, semantics, updates, i);
+
+		j_list_iterator_free(it);
+		it = j_list_iterator_new(operations);
+		i = 0;
+
+		while (j_list_iterator_next(it))
+		{
+			JKVOperation* kop = j_list_iterator_get(it);
+
+			if (kop->update.ret != NULL)
+			{
+				*(kop->update.ret) = ret && updates[i].ret;
+			}
+
+			if (kop->update.result != NULL)
+			{
+				*(kop->update.result) = updates[i].result;
+			}
+
+			// Failed comparisons are reported via the swapped argument of j_kv_cas
+			ret = (updates[i].ret || type == J_MESSAGE_KV_CAS) && ret;
+			i++;
+		}
+	}
+	else
+	{
+		g_autoptr(JMessage) reply = NULL;
+		gpointer kv_connection;
+
+		message = j_message_new(type, namespace_len);
+		j_message_set_semantics(message, semantics);
+		j_message_append_n(message, namespace, namespace_len);
+
+		while (j_list_iterator_next(it))
+		{
+			JKVOperation* kop = j_list_iterator_get(it);
+			gsize key_len;
+
+			key_len = strlen(kop->update.kv->key) + 1;
+
+			j_kv_cache_invalidate(kop->update.kv);
+
+			if (type == J_MESSAGE_KV_CAS)
+			{
+				guint32 expected_len;
+
+				// The maximum length signals that the key must not exist
+				expected_len = (kop->update.expected != NULL) ? kop->update.expected_len : G_MAXUINT32;
+
+				j_message_add_operation(message, key_len + 4 + kop->update.expected_len + 4 + kop->update.value_len);
+				j_message_append_n(message, kop->update.kv->key, key_len);
+				j_message_append_4(message, &expected_len);
+
+				if (kop->update.expected != NULL)
+				{
+					j_message_append_n(message, kop->update.expected, kop->update.expected_len);
+				}
+
+				j_message_append_4(message, &(kop->update.value_len));
+
+				if (kop->update.value_len > 0)
+				{
+					j_message_append_n(message, kop->update.value, kop->update.value_len);
+				}
+			}
+			else if (type == J_MESSAGE_KV_INCREMENT)
+			{
+				j_message_add_operation(message, key_len + 8);
+				j_message_append_n(message, kop->update.kv->key, key_len);
+				j_message_append_8(message, &(kop->update.delta));
+			}
+			else
+			{
+				gchar max;
+
+				max = (kop->update.max) ? 1 : 0;
+
+				j_message_add_operation(message, key_len + 1 + 4 + kop->update.value_len);
+				j_message_append_n(message, kop->update.kv->key, key_len);
+				j_message_append_1(message, &max);
+				j_message_append_4(message, &(kop->update.value_len));
+				j_message_append_n(message, kop->update.value, kop->update.value_len);
+			}
+		}
+
+		kv_connection = j_connection_pool_pop(J_BACKEND_TYPE_KV, index);
+		j_message_send(message, kv_connection);
+
+		reply = j_message_new_reply(message);
+		j_message_receive(reply, kv_connection);
+
+		j_list_iterator_free(it);
+		it = j_list_iterator_new(operations);
+
+		while (j_list_iterator_next(it))
+		{
+			JKVOperation* kop = j_list_iterator_get(it);
+			gboolean update_ret;
+			guint32 status;
+
+			status = j_message_get_4(reply);
+			update_ret = (status == 1);
+
+			// The maximum value signals that the backend failed
+			if (status == G_MAXUINT32)
+			{
+				ret = FALSE;
+			}
+
+			if (type == J_MESSAGE_KV_INCREMENT)
+			{
+				gint64 result;
+
+				result = j_message_get_8(reply);
+
+				if (kop->update.result != NULL)
+				{
+					*(kop->update.result) = result;
+				}
+			}
+
+			if (kop->update.ret != NULL)
+			{
+				*(kop->update.ret) = update_ret;
+			}
+
+			ret = (update_ret || type == J_MESSAGE_KV_CAS) && ret;
+		}
+
 		j_connection_pool_push(J_BACKEND_TYPE_KV, index, kv_connection);
+		j_kv_cache_advance();
 	}
 
 	return ret;
 }
 
+static gboolean
+j_kv_cas_exec(JList* operations, JSemantics* semantics)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	return j_kv_update_exec(operations, semantics, J_MESSAGE_KV_CAS);
+}
+
+static gboolean
+j_kv_increment_exec(JList* operations, JSemantics* semantics)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	return j_kv_update_exec(operations, semantics, J_MESSAGE_KV_INCREMENT);
+}
+
+static gboolean
+j_kv_merge_exec(JList* operations, JSemantics* semantics)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	return j_kv_update_exec(operations, semantics, J_MESSAGE_KV_MERGE);
+}
+
 /**
  * Creates a new key-value pair.
  *
@@ -700,6 +1493,41 @@ j_kv_delete(JKV* kv, JBatch* batch)
 	j_batch_add(batch, operation);
 }
 
+/**
+ * Deletes all key-value pairs whose keys start with a prefix.
+ * The key-value pairs are deleted by all servers in parallel, which is much cheaper than deleting them individually.
+ *
+ * \code
+ * \endcode
+ *
+ * \param namespace A namespace.
+ * \param prefix    A prefix, an empty prefix deletes all key-value pairs of the namespace.
+ * \param batch     A batch.
+ **/
+void
+j_kv_delete_prefix(gchar const* namespace, gchar const* prefix, JBatch* batch)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JKVOperation* kop;
+	JOperation* operation;
+
+	g_return_if_fail(namespace != NULL);
+	g_return_if_fail(prefix != NULL);
+
+	kop = g_slice_new(JKVOperation);
+	kop->delete_prefix.namespace = g_strdup(namespace);
+	kop->delete_prefix.prefix = g_strdup(prefix);
+
+	operation = j_operation_new();
+	operation->key = NULL;
+	operation->data = kop;
+	operation->exec_func = j_kv_delete_prefix_exec;
+	operation->free_func = j_kv_delete_prefix_free;
+
+	j_batch_add(batch, operation);
+}
+
 /**
  * Get a key-value pair.
  *
@@ -771,6 +1599,127 @@ j_kv_get_callback(JKV* kv, JKVGetFunc func, gpointer data, JBatch* batch)
 	j_batch_add(batch, operation);
 }
 
+/**
+ * Atomically replaces a value if it matches an expected value.
+ *
+ * \code
+ * \endcode
+ *
+ * \param kv            A key-value pair.
+ * \param expected      The expected value, NULL if the key must not exist.
+ * \param expected_len  The expected value's length.
+ * \param value         The new value.
+ * \param value_len     The new value's length.
+ * \param value_destroy A function to free the new value.
+ * \param swapped       Whether the value has been replaced.
+ * \param batch         A batch.
+ **/
+void
+j_kv_cas(JKV* kv, gconstpointer expected, guint32 expected_len, gpointer value, guint32 value_len, GDestroyNotify value_destroy, gboolean* swapped, JBatch* batch)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JKVOperation* kop;
+	JOperation* operation;
+
+	g_return_if_fail(kv != NULL);
+	g_return_if_fail(value != NULL || value_len == 0);
+
+	kop = g_slice_new0(JKVOperation);
+	kop->update.kv = j_kv_ref(kv);
+	// Empty expected values still need a non-NULL pointer to distinguish them from keys that must not exist
+	kop->update.expected = (expected != NULL) ? ((expected_len > 0) ? g_memdup(expected, expected_len) : g_malloc(1)) : NULL;
+	kop->update.expected_len = (expected != NULL) ? expected_len : 0;
+	kop->update.value = value;
+	kop->update.value_len = value_len;
+	kop->update.value_destroy = value_destroy;
+	kop->update.ret = swapped;
+
+	operation = j_operation_new();
+	operation->key = kv;
+	operation->data = kop;
+	operation->exec_func = j_kv_cas_exec;
+	operation->free_func = j_kv_update_free;
+
+	j_batch_add(batch, operation);
+}
+
+/**
+ * Atomically increments a 64-bit integer.
+ * Keys that do not exist are treated as 0, existing values have to be 8 bytes long.
+ *
+ * \code
+ * \endcode
+ *
+ * \param kv     A key-value pair.
+ * \param delta  The value to add.
+ * \param result The new value.
+ * \param batch  A batch.
+ **/
+void
+j_kv_increment(JKV* kv, gint64 delta, gint64* result, JBatch* batch)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JKVOperation* kop;
+	JOperation* operation;
+
+	g_return_if_fail(kv != NULL);
+
+	kop = g_slice_new0(JKVOperation);
+	kop->update.kv = j_kv_ref(kv);
+	kop->update.delta = delta;
+	kop->update.result = result;
+
+	operation = j_operation_new();
+	operation->key = kv;
+	operation->data = kop;
+	operation->exec_func = j_kv_increment_exec;
+	operation->free_func = j_kv_update_free;
+
+	j_batch_add(batch, operation);
+}
+
+/**
+ * Atomically merges a BSON document into an existing one.
+ * Fields that are documents in both are merged recursively, other fields are added or replaced.
+ * The batch fails if the key does not exist.
+ *
+ * \code
+ * \endcode
+ *
+ * \param kv       A key-value pair.
+ * \param document A BSON document.
+ * \param mode     How existing fields are updated.
+ * \param batch    A batch.
+ **/
+void
+j_kv_merge(JKV* kv, bson_t const* document, JKVMerge mode, JBatch* batch)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JKVOperation* kop;
+	JOperation* operation;
+
+	g_return_if_fail(kv != NULL);
+	g_return_if_fail(document != NULL);
+
+	kop = g_slice_new0(JKVOperation);
+	kop->update.kv = j_kv_ref(kv);
+	kop->update.value = g_memdup(bson_get_data(document), document->len);
+	kop->update.value_len = document->len;
+	kop->update.value_destroy = g_free;
+	kop->update.max = (mode == J_KV_MERGE_MAX);
+
+	operation = j_operation_new();
+	operation->key = kv;
+	operation->data = kop;
+	operation->exec_func = j_kv_merge_exec;
+	operation->free_func = j_kv_update_free;
+
+	j_batch_add(batch, operation);
+}
+
 /**
  * Returns the kv backend.
  *
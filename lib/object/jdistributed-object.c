@@ -65,6 +65,11 @@ struct JDistributedObjectBackgroundData
 			 * Contains #JDistributedObjectReadBuffer elements.
 			 */
 			JList* buffers;
+
+			/**
+			 * Set to 1 if a read failed, shared by all background operations.
+			 */
+			gint* failed;
 		} read;
 
 		/**
@@ -79,9 +84,26 @@ struct JDistributedObjectBackgroundData
 
 typedef struct JDistributedObjectBackgroundData JDistributedObjectBackgroundData;
 
+/**
+ * A pipeline of background operations for one server.
+ */
+struct JDistributedObjectPipeline
+{
+	JBackgroundOperationFunc func;
+
+	/**
+	 * The list of background data to process in order.
+	 * Contains #JDistributedObjectBackgroundData elements.
+	 */
+	JList* background_data;
+};
+
+typedef struct JDistributedObjectPipeline JDistributedObjectPipeline;
+
 struct JDistributedObjectReadBuffer
 {
 	gchar* data;
+	guint64 length;
 	guint64* bytes_read;
 };
 
@@ -304,55 +326,60 @@ j_distributed_object_read_background_operation(gpointer data)
 	g_autoptr(JListIterator) it = NULL;
 	g_autoptr(JMessage) reply = NULL;
 	gpointer object_connection;
-	guint32 operations_done;
-	guint32 operation_count;
+	GInputStream* input;
+	guint32 reply_operation_count = 0;
 
 	object_connection = j_connection_pool_pop(J_BACKEND_TYPE_OBJECT, background_data->index);
 	j_message_send(background_data->message, object_connection);
 
 	reply = j_message_new_reply(background_data->message);
-
-	operations_done = 0;
-	operation_count = j_message_get_count(background_data->message);
+	input = g_io_stream_get_input_stream(G_IO_STREAM(object_connection));
 
 	it = j_list_iterator_new(background_data->read.buffers);
 
-	/**
-	 * This extra loop is necessary because the server might send multiple
-	 * replies per message. The same reply object can be used to receive
-	 * multiple times.
-	 */
-	while (operations_done < operation_count)
+	while (j_list_iterator_next(it))
 	{
-		guint32 reply_operation_count;
-
-		j_message_receive(reply, object_connection);
+		JDistributedObjectReadBuffer* buffer = j_list_iterator_get(it);
+		gchar* read_data = buffer->data;
+		guint64* bytes_read = buffer->bytes_read;
 
-		reply_operation_count = j_message_get_count(reply);
+		guint64 bytes_done = 0;
+		guint64 nbytes;
 
-		for (guint i = 0; i < reply_operation_count && j_list_iterator_next(it); i++)
+		/**
+		 * The server streams each operation as one or more frames,
+		 * which might be spread across multiple replies.
+		 * An empty frame signals that no more data is available, a failed frame signals an error.
+		 * The same reply object can be used to receive multiple times.
+		 */
+		do
 		{
-			JDistributedObjectReadBuffer* buffer = j_list_iterator_get(it);
-			gchar* read_data = buffer->data;
-			guint64* bytes_read = buffer->bytes_read;
-
-			guint64 nbytes;
+			while (reply_operation_count == 0)
+			{
+				j_message_receive(reply, object_connection);
+				reply_operation_count = j_message_get_count(reply);
+			}
 
 			nbytes = j_message_get_8(reply);
-			j_helper_atomic_add(bytes_read, nbytes);
+			reply_operation_count--;
 
-			if (nbytes > 0)
+			if (nbytes == J_MESSAGE_OBJECT_READ_FAILED)
 			{
-				GInputStream* input;
+				g_atomic_int_set(background_data->read.failed, 1);
+				break;
+			}
 
-				input = g_io_stream_get_input_stream(G_IO_STREAM(object_connection));
-				g_input_stream_read_all(input, read_data, nbytes, NULL, NULL, NULL);
+			if (nbytes > 0)
+			{
+				g_input_stream_read_all(input, read_data + bytes_done, nbytes, NULL, NULL, NULL);
 			}
 
-			g_slice_free(JDistributedObjectReadBuffer, buffer);
-		}
+			bytes_done += nbytes;
+		} while (nbytes > 0 && bytes_done < buffer->length);
 
-		operations_done += reply_operation_count;
+		j_helper_atomic_add(bytes_read, bytes_done);
+
+		g_slice_free(JDistributedObjectReadBuffer, buffer);
 	}
 
 	j_message_unref(background_data->message);
@@ -421,6 +448,69 @@ j_distributed_object_write_background_operation(gpointer data)
 	return NULL;
 }
 
+/**
+ * Executes a pipeline of background operations.
+ *
+ * All background operations in a pipeline belong to the same server and are executed in order.
+ * Pipelines are executed in parallel, which allows multiple stripes to be in flight per server.
+ *
+ * \private
+ *
+ * \param data A pipeline.
+ *
+ * \return NULL.
+ **/
+static gpointer
+j_distributed_object_pipeline_background_operation(gpointer data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributedObjectPipeline* pipeline = data;
+
+	g_autoptr(JListIterator) it = NULL;
+
+	it = j_list_iterator_new(pipeline->background_data);
+
+	while (j_list_iterator_next(it))
+	{
+		pipeline->func(j_list_iterator_get(it));
+	}
+
+	j_list_unref(pipeline->background_data);
+
+	g_slice_free(JDistributedObjectPipeline, pipeline);
+
+	return NULL;
+}
+
+/**
+ * Appends a background operation to a pipeline.
+ *
+ * \private
+ *
+ * \param pipeline A pipeline, will be created if it is NULL.
+ * \param func     A background operation function.
+ * \param data     Background data.
+ **/
+static void
+j_distributed_object_pipeline_append(gpointer* pipeline, JBackgroundOperationFunc func, JDistributedObjectBackgroundData* data)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JDistributedObjectPipeline* new_pipeline = *pipeline;
+
+	if (new_pipeline == NULL)
+	{
+		new_pipeline = g_slice_new(JDistributedObjectPipeline);
+		new_pipeline->func = func;
+		new_pipeline->background_data = j_list_new(NULL);
+
+		*pipeline = new_pipeline;
+	}
+
+	j_list_append(new_pipeline->background_data, data);
+}
+
 /**
  * Executes status operations in a background operation.
  *
@@ -695,11 +785,17 @@ j_distributed_object_read_exec(JList* operations, JSemantics* semantics)
 	g_autofree JList** br_lists = NULL;
 	g_autoptr(JListIterator) it = NULL;
 	g_autofree JMessage** messages = NULL;
+	g_autofree guint64* message_sizes = NULL;
+	g_autofree gpointer* pipelines = NULL;
 	JDistributedObject* object = NULL;
 	gpointer object_handle;
 	gsize name_len = 0;
 	gsize namespace_len = 0;
 	guint32 server_count = 0;
+	guint32 pipeline_count = 0;
+	guint32 stripe_window = 0;
+	guint64 stripe_size = 0;
+	gint failed = 0;
 
 	// FIXME
 	//JLock* lock = NULL;
@@ -725,16 +821,24 @@ j_distributed_object_read_exec(JList* operations, JSemantics* semantics)
 	else
 	{
 		server_count = j_configuration_get_server_count(j_configuration(), J_BACKEND_TYPE_OBJECT);
-		messages = g_new(JMessage*, server_count);
-		br_lists = g_new(JList*, server_count);
+		stripe_size = j_configuration_get_stripe_size(j_configuration());
+		stripe_window = j_configuration_get_stripe_window(j_configuration());
+		pipeline_count = server_count * stripe_window;
+
+		messages = g_new(JMessage*, pipeline_count);
+		br_lists = g_new(JList*, pipeline_count);
+		message_sizes = g_new(guint64, pipeline_count);
+		pipelines = g_new(gpointer, pipeline_count);
 
 		namespace_len = strlen(object->namespace) + 1;
 		name_len = strlen(object->name) + 1;
 
-		for (guint i = 0; i < server_count; i++)
+		for (guint i = 0; i < pipeline_count; i++)
 		{
 			messages[i] = NULL;
 			br_lists[i] = NULL;
+			message_sizes[i] = 0;
+			pipelines[i] = NULL;
 		}
 	}
 
@@ -775,28 +879,6 @@ j_distributed_object_read_exec(JList* operations, JSemantics* semantics)
 
 			while (j_distribution_distribute(object->distribution, &index, &new_length, &new_offset, &block_id))
 			{
-				JDistributedObjectReadBuffer* buffer;
-
-				if (messages[index] == NULL && br_lists[index] == NULL)
-				{
-					messages[index] = j_message_new(J_MESSAGE_OBJECT_READ, namespace_len + name_len);
-					j_message_set_semantics(messages[index], semantics);
-					j_message_append_n(messages[index], object->namespace, namespace_len);
-					j_message_append_n(messages[index], object->name, name_len);
-
-					br_lists[index] = j_list_new(NULL);
-				}
-
-				j_message_add_operation(messages[index], sizeof(guint64) + sizeof(guint64));
-				j_message_append_8(messages[index], &new_length);
-				j_message_append_8(messages[index], &new_offset);
-
-				buffer = g_slice_new(JDistributedObjectReadBuffer);
-				buffer->data = new_data;
-				buffer->bytes_read = bytes_read;
-
-				j_list_append(br_lists[index], buffer);
-
 				/*
 				if (lock != NULL)
 				{
@@ -804,7 +886,62 @@ j_distributed_object_read_exec(JList* operations, JSemantics* semantics)
 				}
 				*/
 
-				new_data += new_length;
+				// Split the data into stripes, each of which is always handled by the same pipeline
+				while (new_length > 0)
+				{
+					JDistributedObjectReadBuffer* buffer;
+					guint32 pipeline;
+					guint64 stripe_length;
+
+					stripe_length = MIN(new_length, stripe_size - (new_offset % stripe_size));
+					pipeline = (index * stripe_window) + ((new_offset / stripe_size) % stripe_window);
+
+					if (messages[pipeline] != NULL && message_sizes[pipeline] + stripe_length > stripe_size)
+					{
+						JDistributedObjectBackgroundData* background_data;
+
+						background_data = g_slice_new(JDistributedObjectBackgroundData);
+						background_data->index = index;
+						background_data->message = messages[pipeline];
+						background_data->operations = NULL;
+						background_data->semantics = semantics;
+						background_data->read.buffers = br_lists[pipeline];
+						background_data->read.failed = &failed;
+
+						j_distributed_object_pipeline_append(&pipelines[pipeline], j_distributed_object_read_background_operation, background_data);
+
+						messages[pipeline] = NULL;
+						br_lists[pipeline] = NULL;
+					}
+
+					if (messages[pipeline] == NULL && br_lists[pipeline] == NULL)
+					{
+						messages[pipeline] = j_message_new(J_MESSAGE_OBJECT_READ, namespace_len + name_len);
+						j_message_set_semantics(messages[pipeline], semantics);
+						j_message_append_n(messages[pipeline], object->namespace, namespace_len);
+						j_message_append_n(messages[pipeline], object->name, name_len);
+
+						br_lists[pipeline] = j_list_new(NULL);
+						message_sizes[pipeline] = 0;
+					}
+
+					j_message_add_operation(messages[pipeline], sizeof(guint64) + sizeof(guint64));
+					j_message_append_8(messages[pipeline], &stripe_length);
+					j_message_append_8(messages[pipeline], &new_offset);
+
+					buffer = g_slice_new(JDistributedObjectReadBuffer);
+					buffer->data = new_data;
+					buffer->length = stripe_length;
+					buffer->bytes_read = bytes_read;
+
+					j_list_append(br_lists[pipeline], buffer);
+
+					message_sizes[pipeline] += stripe_length;
+
+					new_data += stripe_length;
+					new_offset += stripe_length;
+					new_length -= stripe_length;
+				}
 			}
 		}
 
@@ -817,31 +954,29 @@ j_distributed_object_read_exec(JList* operations, JSemantics* semantics)
 	}
 	else
 	{
-		g_autofree gpointer* background_data = NULL;
-
-		background_data = g_new(gpointer, server_count);
-
-		for (guint i = 0; i < server_count; i++)
+		for (guint i = 0; i < pipeline_count; i++)
 		{
 			JDistributedObjectBackgroundData* data;
 
 			if (messages[i] == NULL)
 			{
-				background_data[i] = NULL;
 				continue;
 			}
 
 			data = g_slice_new(JDistributedObjectBackgroundData);
-			data->index = i;
+			data->index = i / stripe_window;
 			data->message = messages[i];
 			data->operations = NULL;
 			data->semantics = semantics;
 			data->read.buffers = br_lists[i];
+			data->read.failed = &failed;
 
-			background_data[i] = data;
+			j_distributed_object_pipeline_append(&pipelines[i], j_distributed_object_read_background_operation, data);
 		}
 
-		j_helper_execute_parallel(j_distributed_object_read_background_operation, background_data, server_count);
+		j_helper_execute_parallel(j_distributed_object_pipeline_background_operation, pipelines, pipeline_count);
+
+		ret = (g_atomic_int_get(&failed) == 0) && ret;
 	}
 
 	/*
@@ -869,11 +1004,16 @@ j_distributed_object_write_exec(JList* operations, JSemantics* semantics)
 	g_autofree JList** bw_lists = NULL;
 	g_autoptr(JListIterator) it = NULL;
 	g_autofree JMessage** messages = NULL;
+	g_autofree guint64* message_sizes = NULL;
+	g_autofree gpointer* pipelines = NULL;
 	JDistributedObject* object = NULL;
 	gpointer object_handle;
 	gsize name_len = 0;
 	gsize namespace_len = 0;
 	guint32 server_count = 0;
+	guint32 pipeline_count = 0;
+	guint32 stripe_window = 0;
+	guint64 stripe_size = 0;
 
 	// FIXME
 	//JLock* lock = NULL;
@@ -899,16 +1039,24 @@ j_distributed_object_write_exec(JList* operations, JSemantics* semantics)
 	else
 	{
 		server_count = j_configuration_get_server_count(j_configuration(), J_BACKEND_TYPE_OBJECT);
-		messages = g_new(JMessage*, server_count);
-		bw_lists = g_new(JList*, server_count);
+		stripe_size = j_configuration_get_stripe_size(j_configuration());
+		stripe_window = j_configuration_get_stripe_window(j_configuration());
+		pipeline_count = server_count * stripe_window;
+
+		messages = g_new(JMessage*, pipeline_count);
+		bw_lists = g_new(JList*, pipeline_count);
+		message_sizes = g_new(guint64, pipeline_count);
+		pipelines = g_new(gpointer, pipeline_count);
 
 		namespace_len = strlen(object->namespace) + 1;
 		name_len = strlen(object->name) + 1;
 
-		for (guint i = 0; i < server_count; i++)
+		for (guint i = 0; i < pipeline_count; i++)
 		{
 			messages[i] = NULL;
 			bw_lists[i] = NULL;
+			message_sizes[i] = 0;
+			pipelines[i] = NULL;
 		}
 	}
 
@@ -949,23 +1097,6 @@ j_distributed_object_write_exec(JList* operations, JSemantics* semantics)
 
 			while (j_distribution_distribute(object->distribution, &index, &new_length, &new_offset, &block_id))
 			{
-				if (messages[index] == NULL && bw_lists[index] == NULL)
-				{
-					messages[index] = j_message_new(J_MESSAGE_OBJECT_WRITE, namespace_len + name_len);
-					j_message_set_semantics(messages[index], semantics);
-					j_message_append_n(messages[index], object->namespace, namespace_len);
-					j_message_append_n(messages[index], object->name, name_len);
-
-					bw_lists[index] = j_list_new(NULL);
-				}
-
-				j_message_add_operation(messages[index], sizeof(guint64) + sizeof(guint64));
-				j_message_append_8(messages[index], &new_length);
-				j_message_append_8(messages[index], &new_offset);
-				j_message_add_send(messages[index], new_data, new_length);
-
-				j_list_append(bw_lists[index], bytes_written);
-
 				/*
 				if (lock != NULL)
 				{
@@ -973,12 +1104,62 @@ j_distributed_object_write_exec(JList* operations, JSemantics* semantics)
 				}
 				*/
 
-				new_data += new_length;
-
-				// Fake bytes_written here instead of doing another loop further down
-				if (j_semantics_get(semantics, J_SEMANTICS_SAFETY) == J_SEMANTICS_SAFETY_NONE)
+				// Split the data into stripes, each of which is always handled by the same pipeline
+				// This makes sure that overlapping writes are still executed in order
+				while (new_length > 0)
 				{
-					j_helper_atomic_add(bytes_written, new_length);
+					guint32 pipeline;
+					guint64 stripe_length;
+
+					stripe_length = MIN(new_length, stripe_size - (new_offset % stripe_size));
+					pipeline = (index * stripe_window) + ((new_offset / stripe_size) % stripe_window);
+
+					if (messages[pipeline] != NULL && message_sizes[pipeline] + stripe_length > stripe_size)
+					{
+						JDistributedObjectBackgroundData* background_data;
+
+						background_data = g_slice_new(JDistributedObjectBackgroundData);
+						background_data->index = index;
+						background_data->message = messages[pipeline];
+						background_data->operations = NULL;
+						background_data->semantics = semantics;
+						background_data->write.bytes_written = bw_lists[pipeline];
+
+						j_distributed_object_pipeline_append(&pipelines[pipeline], j_distributed_object_write_background_operation, background_data);
+
+						messages[pipeline] = NULL;
+						bw_lists[pipeline] = NULL;
+					}
+
+					if (messages[pipeline] == NULL && bw_lists[pipeline] == NULL)
+					{
+						messages[pipeline] = j_message_new(J_MESSAGE_OBJECT_WRITE, namespace_len + name_len);
+						j_message_set_semantics(messages[pipeline], semantics);
+						j_message_append_n(messages[pipeline], object->namespace, namespace_len);
+						j_message_append_n(messages[pipeline], object->name, name_len);
+
+						bw_lists[pipeline] = j_list_new(NULL);
+						message_sizes[pipeline] = 0;
+					}
+
+					j_message_add_operation(messages[pipeline], sizeof(guint64) + sizeof(guint64));
+					j_message_append_8(messages[pipeline], &stripe_length);
+					j_message_append_8(messages[pipeline], &new_offset);
+					j_message_add_send(messages[pipeline], new_data, stripe_length);
+
+					j_list_append(bw_lists[pipeline], bytes_written);
+
+					message_sizes[pipeline] += stripe_length;
+
+					// Fake bytes_written here instead of doing another loop further down
+					if (j_semantics_get(semantics, J_SEMANTICS_SAFETY) == J_SEMANTICS_SAFETY_NONE)
+					{
+						j_helper_atomic_add(bytes_written, stripe_length);
+					}
+
+					new_data += stripe_length;
+					new_offset += stripe_length;
+					new_length -= stripe_length;
 				}
 			}
 		}
@@ -992,31 +1173,26 @@ j_distributed_object_write_exec(JList* operations, JSemantics* semantics)
 	}
 	else
 	{
-		g_autofree gpointer* background_data = NULL;
-
-		background_data = g_new(gpointer, server_count);
-
-		for (guint i = 0; i < server_count; i++)
+		for (guint i = 0; i < pipeline_count; i++)
 		{
 			JDistributedObjectBackgroundData* data;
 
 			if (messages[i] == NULL)
 			{
-				background_data[i] = NULL;
 				continue;
 			}
 
 			data = g_slice_new(JDistributedObjectBackgroundData);
-			data->index = i;
+			data->index = i / stripe_window;
 			data->message = messages[i];
 			data->operations = NULL;
 			data->semantics = semantics;
 			data->write.bytes_written = bw_lists[i];
 
-			background_data[i] = data;
+			j_distributed_object_pipeline_append(&pipelines[i], j_distributed_object_write_background_operation, data);
 		}
 
-		j_helper_execute_parallel(j_distributed_object_write_background_operation, background_data, server_count);
+		j_helper_execute_parallel(j_distributed_object_pipeline_background_operation, pipelines, pipeline_count);
 	}
 
 	/*
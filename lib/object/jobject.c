@@ -393,6 +393,83 @@ j_object_delete_exec(JList* operations, JSemantics* semantics)
 	return ret;
 }
 
+static gboolean
+j_object_delete_namespace_exec(JList* operations, JSemantics* semantics)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	gboolean ret = TRUE;
+
+	JBackend* object_backend;
+	g_autoptr(JListIterator) it = NULL;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	it = j_list_iterator_new(operations);
+	object_backend = j_object_get_backend();
+
+	if (object_backend != NULL)
+	{
+		while (j_list_iterator_next(it))
+		{
+			gchar const* namespace = j_list_iterator_get(it);
+
+			ret = j_backend_object_delete_namespace(object_backend, namespace) && ret;
+		}
+	}
+	else
+	{
+		g_autoptr(JMessage) message = NULL;
+		g_autofree gpointer* object_connections = NULL;
+		guint32 server_count;
+
+		server_count = j_configuration_get_server_count(j_configuration(), J_BACKEND_TYPE_OBJECT);
+		object_connections = g_new(gpointer, server_count);
+
+		message = j_message_new(J_MESSAGE_OBJECT_DELETE_NAMESPACE, 0);
+		j_message_set_semantics(message, semantics);
+
+		while (j_list_iterator_next(it))
+		{
+			gchar const* namespace = j_list_iterator_get(it);
+			gsize namespace_len;
+
+			namespace_len = strlen(namespace) + 1;
+
+			j_message_add_operation(message, namespace_len);
+			j_message_append_n(message, namespace, namespace_len);
+		}
+
+		// Objects are distributed across all servers, send the message to all of them before waiting for any reply
+		for (guint i = 0; i < server_count; i++)
+		{
+			object_connections[i] = j_connection_pool_pop(J_BACKEND_TYPE_OBJECT, i);
+			j_message_send(message, object_connections[i]);
+		}
+
+		for (guint i = 0; i < server_count; i++)
+		{
+			g_autoptr(JMessage) reply = NULL;
+			guint32 operation_count;
+
+			reply = j_message_new_reply(message);
+			j_message_receive(reply, object_connections[i]);
+
+			operation_count = j_message_get_count(reply);
+
+			for (guint j = 0; j < operation_count; j++)
+			{
+				ret = (j_message_get_4(reply) != 0) && ret;
+			}
+
+			j_connection_pool_push(J_BACKEND_TYPE_OBJECT, i, object_connections[i]);
+		}
+	}
+
+	return ret;
+}
+
 static gboolean
 j_object_read_exec(JList* operations, JSemantics* semantics)
 {
@@ -487,53 +564,59 @@ j_object_read_exec(JList* operations, JSemantics* semantics)
 	{
 		g_autoptr(JMessage) reply = NULL;
 		gpointer object_connection;
-		guint32 operations_done;
-		guint32 operation_count;
+		GInputStream* input;
+		guint32 reply_operation_count = 0;
 
 		object_connection = j_connection_pool_pop(J_BACKEND_TYPE_OBJECT, object->index);
 		j_message_send(message, object_connection);
 
 		reply = j_message_new_reply(message);
-
-		operations_done = 0;
-		operation_count = j_message_get_count(message);
+		input = g_io_stream_get_input_stream(G_IO_STREAM(object_connection));
 
 		it = j_list_iterator_new(operations);
 
-		/**
-		 * This extra loop is necessary because the server might send multiple
-		 * replies per message. The same reply object can be used to receive
-		 * multiple times.
-		 */
-		while (operations_done < operation_count)
+		while (j_list_iterator_next(it))
 		{
-			guint32 reply_operation_count;
-
-			j_message_receive(reply, object_connection);
+			JObjectOperation* operation = j_list_iterator_get(it);
+			gchar* data = operation->read.data;
+			guint64 length = operation->read.length;
+			guint64* bytes_read = operation->read.bytes_read;
 
-			reply_operation_count = j_message_get_count(reply);
+			guint64 bytes_done = 0;
+			guint64 nbytes;
 
-			for (guint i = 0; i < reply_operation_count && j_list_iterator_next(it); i++)
+			/**
+			 * The server streams each operation as one or more frames,
+			 * which might be spread across multiple replies.
+			 * An empty frame signals that no more data is available, a failed frame signals an error.
+			 * The same reply object can be used to receive multiple times.
+			 */
+			do
 			{
-				JObjectOperation* operation = j_list_iterator_get(it);
-				gpointer data = operation->read.data;
-				guint64* bytes_read = operation->read.bytes_read;
-
-				guint64 nbytes;
+				while (reply_operation_count == 0)
+				{
+					j_message_receive(reply, object_connection);
+					reply_operation_count = j_message_get_count(reply);
+				}
 
 				nbytes = j_message_get_8(reply);
-				j_helper_atomic_add(bytes_read, nbytes);
+				reply_operation_count--;
 
-				if (nbytes > 0)
+				if (nbytes == J_MESSAGE_OBJECT_READ_FAILED)
 				{
-					GInputStream* input;
+					ret = FALSE;
+					break;
+				}
 
-					input = g_io_stream_get_input_stream(G_IO_STREAM(object_connection));
-					g_input_stream_read_all(input, data, nbytes, NULL, NULL, NULL);
+				if (nbytes > 0)
+				{
+					g_input_stream_read_all(input, data + bytes_done, nbytes, NULL, NULL, NULL);
 				}
-			}
 
-			operations_done += reply_operation_count;
+				bytes_done += nbytes;
+			} while (nbytes > 0 && bytes_done < length);
+
+			j_helper_atomic_add(bytes_read, bytes_done);
 		}
 
 		j_list_iterator_free(it);
@@ -995,6 +1078,56 @@ j_object_delete(JObject* object, JBatch* batch)
 	j_batch_add(batch, operation);
 }
 
+/**
+ * Checks whether a namespace can be deleted.
+ * Backends store namespaces in directories, so names that refer to other directories must be rejected.
+ * Names starting with .julea- are reserved for the backends' own data.
+ **/
+static gboolean
+j_object_namespace_is_valid(gchar const* namespace)
+{
+	if (namespace[0] == '\0' || g_strcmp0(namespace, ".") == 0 || g_strcmp0(namespace, "..") == 0)
+	{
+		return FALSE;
+	}
+
+	if (strchr(namespace, '/') != NULL || strchr(namespace, G_DIR_SEPARATOR) != NULL)
+	{
+		return FALSE;
+	}
+
+	return !g_str_has_prefix(namespace, ".julea-");
+}
+
+/**
+ * Deletes all objects in a namespace, including the parts of distributed objects.
+ * The namespace is deleted by all servers in parallel, which is much cheaper than deleting all objects individually.
+ *
+ * \code
+ * \endcode
+ *
+ * \param namespace A namespace.
+ * \param batch     A batch.
+ **/
+void
+j_object_delete_namespace(gchar const* namespace, JBatch* batch)
+{
+	J_TRACE_FUNCTION(NULL);
+
+	JOperation* operation;
+
+	g_return_if_fail(namespace != NULL);
+	g_return_if_fail(j_object_namespace_is_valid(namespace));
+
+	operation = j_operation_new();
+	operation->key = NULL;
+	operation->data = g_strdup(namespace);
+	operation->exec_func = j_object_delete_namespace_exec;
+	operation->free_func = g_free;
+
+	j_batch_add(batch, operation);
+}
+
 /**
  * Reads an object.
  *
@@ -28,6 +28,192 @@
 
 static guint jd_thread_num = 0;
 
+static void
+jd_backend_queue_free(gpointer data)
+{
+	JBackendQueue* queue = data;
+
+	j_backend_queue_free(queue);
+}
+
+/**
+ * Per-thread queues that allow keeping multiple backend requests in flight.
+ **/
+static GPrivate jd_object_queue = G_PRIVATE_INIT(jd_backend_queue_free);
+static GPrivate jd_kv_queue = G_PRIVATE_INIT(jd_backend_queue_free);
+
+static JBackendQueue*
+jd_backend_queue_get_thread(GPrivate* private, JBackend* backend)
+{
+	JBackendQueue* queue;
+
+	queue = g_private_get(private);
+
+	if (G_UNLIKELY(queue == NULL))
+	{
+		queue = j_backend_queue_new(backend);
+		g_private_replace(private, queue);
+	}
+
+	return queue;
+}
+
+/**
+ * Transfers ranges using the backend's asynchronous interface if available.
+ **/
+static void
+jd_object_transfer_ranges(gpointer object, GArray* ranges, gboolean write)
+{
+	JBackendQueue* queue;
+	g_autofree JBackendRequest* requests = NULL;
+	// Index of the first request that has been submitted since the queue was last drained
+	guint pending = 0;
+
+	queue = jd_backend_queue_get_thread(&jd_object_queue, jd_object_backend);
+
+	if (!j_backend_queue_is_async(queue))
+	{
+		if (write)
+		{
+			j_backend_object_writev(jd_object_backend, object, &g_array_index(ranges, JBackendObjectRange, 0), ranges->len);
+		}
+		else
+		{
+			j_backend_object_readv(jd_object_backend, object, &g_array_index(ranges, JBackendObjectRange, 0), ranges->len);
+		}
+
+		return;
+	}
+
+	requests = g_new(JBackendRequest, ranges->len);
+
+	for (guint j = 0; j < ranges->len; j++)
+	{
+		JBackendObjectRange* range = &g_array_index(ranges, JBackendObjectRange, j);
+
+		requests[j].type = (write) ? J_BACKEND_REQUEST_OBJECT_WRITE : J_BACKEND_REQUEST_OBJECT_READ;
+		requests[j].data = object;
+		requests[j].object.buffer = range->buffer;
+		requests[j].object.length = range->length;
+		requests[j].object.offset = range->offset;
+		requests[j].object.bytes = 0;
+		requests[j].object.failed = FALSE;
+
+		if (write)
+		{
+			// Requests might complete in any order, so overlapping writes must not be in flight at the same time
+			for (guint k = pending; k < j; k++)
+			{
+				if (range->offset < requests[k].object.offset + requests[k].object.length && requests[k].object.offset < range->offset + range->length)
+				{
+					j_backend_queue_wait(queue);
+					pending = j;
+					break;
+				}
+			}
+		}
+
+		j_backend_queue_submit(queue, &(requests[j]));
+	}
+
+	j_backend_queue_wait(queue);
+
+	for (guint j = 0; j < ranges->len; j++)
+	{
+		g_array_index(ranges, JBackendObjectRange, j).bytes = requests[j].object.bytes;
+		g_array_index(ranges, JBackendObjectRange, j).failed = requests[j].object.failed;
+	}
+}
+
+/**
+ * Reads the collected ranges and appends them to the reply as frames.
+ *
+ * Each operation is streamed as a sequence of frames that are at most memory_chunk_size bytes large.
+ * The client stops receiving frames for an operation when all data has been received or an empty frame arrives.
+ * Therefore, an empty frame has to be sent after short reads and the remaining frames of the operation are dropped.
+ * Failed reads are signaled with a frame of length J_MESSAGE_OBJECT_READ_FAILED.
+ *
+ * \param done_operation The last operation that has been ended by a short read.
+ **/
+static void
+jd_object_read_ranges(gpointer object, GArray* ranges, GArray* range_operations, JMessage* reply, guint* done_operation, JStatistics* statistics)
+{
+	jd_object_transfer_ranges(object, ranges, FALSE);
+
+	for (guint j = 0; j < ranges->len; j++)
+	{
+		JBackendObjectRange* range = &g_array_index(ranges, JBackendObjectRange, j);
+		guint operation = g_array_index(range_operations, guint, j);
+
+		if (operation == *done_operation)
+		{
+			continue;
+		}
+
+		j_statistics_add(statistics, J_STATISTICS_BYTES_READ, range->bytes);
+
+		if (!range->failed || range->bytes > 0)
+		{
+			j_message_add_operation(reply, sizeof(guint64));
+			j_message_append_8(reply, &(range->bytes));
+		}
+
+		if (range->bytes > 0)
+		{
+			j_message_add_send(reply, range->buffer, range->bytes);
+		}
+
+		j_statistics_add(statistics, J_STATISTICS_BYTES_SENT, range->bytes);
+
+		if (range->failed)
+		{
+			guint64 const failed = J_MESSAGE_OBJECT_READ_FAILED;
+
+			// The client stops receiving frames for the operation and reports an error
+			*done_operation = operation;
+
+			j_message_add_operation(reply, sizeof(guint64));
+			j_message_append_8(reply, &failed);
+		}
+		else if (range->bytes < range->length)
+		{
+			*done_operation = operation;
+
+			if (range->bytes > 0)
+			{
+				guint64 const zero = 0;
+
+				j_message_add_operation(reply, sizeof(guint64));
+				j_message_append_8(reply, &zero);
+			}
+		}
+	}
+
+	g_array_set_size(ranges, 0);
+	g_array_set_size(range_operations, 0);
+}
+
+/**
+ * Writes the collected ranges and adds the number of bytes written to the respective operations.
+ **/
+static void
+jd_object_write_ranges(gpointer object, GArray* ranges, GArray* range_operations, guint64* bytes_written, JStatistics* statistics)
+{
+	jd_object_transfer_ranges(object, ranges, TRUE);
+
+	for (guint j = 0; j < ranges->len; j++)
+	{
+		JBackendObjectRange* range = &g_array_index(ranges, JBackendObjectRange, j);
+		guint operation = g_array_index(range_operations, guint, j);
+
+		bytes_written[operation] += range->bytes;
+		j_statistics_add(statistics, J_STATISTICS_BYTES_WRITTEN, range->bytes);
+	}
+
+	g_array_set_size(ranges, 0);
+	g_array_set_size(range_operations, 0);
+}
+
 gboolean
 jd_handle_message(JMessage* message, GSocketConnection* connection, JMemoryChunk* memory_chunk, guint64 memory_chunk_size, JStatistics* statistics)
 {
@@ -126,65 +312,94 @@ jd_handle_message(JMessage* message, GSocketConnection* connection, JMemoryChunk
 			}
 		}
 		break;
+		case J_MESSAGE_OBJECT_DELETE_NAMESPACE:
+		{
+			g_autoptr(JMessage) reply = NULL;
+
+			reply = j_message_new_reply(message);
+
+			for (i = 0; i < operation_count; i++)
+			{
+				guint32 ret;
+
+				namespace = j_message_get_string(message);
+
+				ret = (j_backend_object_delete_namespace(jd_object_backend, namespace)) ? 1 : 0;
+
+				j_message_add_operation(reply, 4);
+				j_message_append_4(reply, &ret);
+			}
+
+			j_message_send(reply, connection);
+		}
+		break;
 		case J_MESSAGE_OBJECT_READ:
 		{
 			JMessage* reply;
 			gpointer object;
+			g_autoptr(GArray) ranges = NULL;
+			g_autoptr(GArray) range_operations = NULL;
+			guint done_operation = G_MAXUINT;
 
 			namespace = j_message_get_string(message);
 			path = j_message_get_string(message);
 
 			reply = j_message_new_reply(message);
 
+			ranges = g_array_new(FALSE, FALSE, sizeof(JBackendObjectRange));
+			range_operations = g_array_new(FALSE, FALSE, sizeof(guint));
+
 			// FIXME return value
 			j_backend_object_open(jd_object_backend, namespace, path, &object);
 
 			for (i = 0; i < operation_count; i++)
 			{
-				gchar* buf;
 				guint64 length;
 				guint64 offset;
-				guint64 bytes_read = 0;
+				guint64 bytes_done = 0;
 
 				length = j_message_get_8(message);
 				offset = j_message_get_8(message);
 
-				if (length > memory_chunk_size)
+				// Operations larger than the memory chunk are split into frames, see jd_object_read_ranges()
+				do
 				{
-					// FIXME return proper error
-					j_message_add_operation(reply, sizeof(guint64));
-					j_message_append_8(reply, &bytes_read);
-					continue;
-				}
+					JBackendObjectRange range;
+					gchar* buf;
+					guint64 chunk_length;
 
-				buf = j_memory_chunk_get(memory_chunk, length);
+					chunk_length = MIN(length - bytes_done, memory_chunk_size);
+					buf = j_memory_chunk_get(memory_chunk, chunk_length);
 
-				if (buf == NULL)
-				{
-					// FIXME ugly
-					j_message_send(reply, connection);
-					j_message_unref(reply);
+					if (buf == NULL)
+					{
+						// The memory chunk is full, read the collected ranges and send them
+						jd_object_read_ranges(object, ranges, range_operations, reply, &done_operation, statistics);
 
-					reply = j_message_new_reply(message);
+						j_message_send(reply, connection);
+						j_message_unref(reply);
 
-					j_memory_chunk_reset(memory_chunk);
-					buf = j_memory_chunk_get(memory_chunk, length);
-				}
+						reply = j_message_new_reply(message);
 
-				j_backend_object_read(jd_object_backend, object, buf, length, offset, &bytes_read);
-				j_statistics_add(statistics, J_STATISTICS_BYTES_READ, bytes_read);
+						j_memory_chunk_reset(memory_chunk);
+						buf = j_memory_chunk_get(memory_chunk, chunk_length);
+					}
 
-				j_message_add_operation(reply, sizeof(guint64));
-				j_message_append_8(reply, &bytes_read);
+					range.buffer = buf;
+					range.length = chunk_length;
+					range.offset = offset + bytes_done;
+					range.bytes = 0;
+					range.failed = FALSE;
 
-				if (bytes_read > 0)
-				{
-					j_message_add_send(reply, buf, bytes_read);
-				}
+					g_array_append_val(ranges, range);
+					g_array_append_val(range_operations, i);
 
-				j_statistics_add(statistics, J_STATISTICS_BYTES_SENT, bytes_read);
+					bytes_done += chunk_length;
+				} while (bytes_done < length);
 			}
 
+			jd_object_read_ranges(object, ranges, range_operations, reply, &done_operation, statistics);
+
 			j_backend_object_close(jd_object_backend, object);
 
 			j_message_send(reply, connection);
@@ -197,6 +412,10 @@ jd_handle_message(JMessage* message, GSocketConnection* connection, JMemoryChunk
 		{
 			g_autoptr(JMessage) reply = NULL;
 			gpointer object;
+			g_autoptr(GArray) ranges = NULL;
+			g_autoptr(GArray) range_operations = NULL;
+			g_autofree guint64* bytes_written = NULL;
+			GInputStream* input;
 
 			if (safety == J_SEMANTICS_SAFETY_NETWORK || safety == J_SEMANTICS_SAFETY_STORAGE)
 			{
@@ -206,46 +425,69 @@ jd_handle_message(JMessage* message, GSocketConnection* connection, JMemoryChunk
 			namespace = j_message_get_string(message);
 			path = j_message_get_string(message);
 
+			ranges = g_array_new(FALSE, FALSE, sizeof(JBackendObjectRange));
+			range_operations = g_array_new(FALSE, FALSE, sizeof(guint));
+			bytes_written = g_new0(guint64, operation_count);
+
+			input = g_io_stream_get_input_stream(G_IO_STREAM(connection));
+
 			// FIXME return value
 			j_backend_object_open(jd_object_backend, namespace, path, &object);
 
 			for (i = 0; i < operation_count; i++)
 			{
-				GInputStream* input;
-				gchar* buf;
 				guint64 length;
 				guint64 offset;
-				guint64 bytes_written = 0;
+				guint64 bytes_done = 0;
 
 				length = j_message_get_8(message);
 				offset = j_message_get_8(message);
 
-				if (length > memory_chunk_size)
+				// Operations larger than the memory chunk are received and written in chunks
+				while (bytes_done < length)
 				{
-					// FIXME return proper error
-					j_message_add_operation(reply, sizeof(guint64));
-					j_message_append_8(reply, &bytes_written);
-					continue;
-				}
+					JBackendObjectRange range;
+					gchar* buf;
+					guint64 chunk_length;
+
+					chunk_length = MIN(length - bytes_done, memory_chunk_size);
+					buf = j_memory_chunk_get(memory_chunk, chunk_length);
 
-				// Guaranteed to work because memory_chunk is reset below
-				buf = j_memory_chunk_get(memory_chunk, length);
-				g_assert(buf != NULL);
+					if (buf == NULL)
+					{
+						// The memory chunk is full, write the collected ranges
+						jd_object_write_ranges(object, ranges, range_operations, bytes_written, statistics);
+
+						j_memory_chunk_reset(memory_chunk);
+						buf = j_memory_chunk_get(memory_chunk, chunk_length);
+					}
 
-				input = g_io_stream_get_input_stream(G_IO_STREAM(connection));
-				g_input_stream_read_all(input, buf, length, NULL, NULL, NULL);
-				j_statistics_add(statistics, J_STATISTICS_BYTES_RECEIVED, length);
+					// The data has to be received completely even if writing fails to keep the connection usable
+					g_input_stream_read_all(input, buf, chunk_length, NULL, NULL, NULL);
+					j_statistics_add(statistics, J_STATISTICS_BYTES_RECEIVED, chunk_length);
 
-				j_backend_object_write(jd_object_backend, object, buf, length, offset, &bytes_written);
-				j_statistics_add(statistics, J_STATISTICS_BYTES_WRITTEN, bytes_written);
+					range.buffer = buf;
+					range.length = chunk_length;
+					range.offset = offset + bytes_done;
+					range.bytes = 0;
+					range.failed = FALSE;
 
-				if (reply != NULL)
+					g_array_append_val(ranges, range);
+					g_array_append_val(range_operations, i);
+
+					bytes_done += chunk_length;
+				}
+			}
+
+			jd_object_write_ranges(object, ranges, range_operations, bytes_written, statistics);
+
+			if (reply != NULL)
+			{
+				for (i = 0; i < operation_count; i++)
 				{
 					j_message_add_operation(reply, sizeof(guint64));
-					j_message_append_8(reply, &bytes_written);
+					j_message_append_8(reply, &(bytes_written[i]));
 				}
-
-				j_memory_chunk_reset(memory_chunk);
 			}
 
 			if (safety == J_SEMANTICS_SAFETY_STORAGE)
@@ -372,7 +614,11 @@ jd_handle_message(JMessage* message, GSocketConnection* connection, JMemoryChunk
 		case J_MESSAGE_KV_PUT:
 		{
 			g_autoptr(JMessage) reply = NULL;
+			g_autofree gchar const** keys = NULL;
+			g_autofree gconstpointer* values = NULL;
+			g_autofree guint32* lens = NULL;
 			gpointer batch;
+			gboolean ret;
 
 			if (safety == J_SEMANTICS_SAFETY_NETWORK || safety == J_SEMANTICS_SAFETY_STORAGE)
 			{
@@ -382,19 +628,23 @@ jd_handle_message(JMessage* message, GSocketConnection* connection, JMemoryChunk
 			namespace = j_message_get_string(message);
 			j_backend_kv_batch_start(jd_kv_backend, namespace, semantics, &batch);
 
+			keys = g_new(gchar const*, operation_count);
+			values = g_new(gconstpointer, operation_count);
+			lens = g_new(guint32, operation_count);
+
+			// Values point into the message
 			for (i = 0; i < operation_count; i++)
 			{
-				gconstpointer data;
-				guint32 len;
-				gboolean ret;
-
-				key = j_message_get_string(message);
-				len = j_message_get_4(message);
-				data = j_message_get_n(message, len);
+				keys[i] = j_message_get_string(message);
+				lens[i] = j_message_get_4(message);
+				values[i] = j_message_get_n(message, lens[i]);
+			}
 
-				ret = j_backend_kv_put(jd_kv_backend, batch, key, data, len);
+			ret = j_backend_kv_put_multi(jd_kv_backend, batch, keys, values, lens, operation_count);
 
-				if (reply != NULL)
+			if (reply != NULL)
+			{
+				for (i = 0; i < operation_count; i++)
 				{
 					guint32 dummy;
 
@@ -451,42 +701,112 @@ jd_handle_message(JMessage* message, GSocketConnection* connection, JMemoryChunk
 			}
 		}
 		break;
+		case J_MESSAGE_KV_DELETE_PREFIX:
+		{
+			g_autoptr(JMessage) reply = NULL;
+
+			reply = j_message_new_reply(message);
+
+			// Every operation has its own namespace and is executed in a batch of its own
+			for (i = 0; i < operation_count; i++)
+			{
+				gchar const* prefix;
+				guint32 ret;
+
+				namespace = j_message_get_string(message);
+				prefix = j_message_get_string(message);
+
+				ret = (j_backend_kv_delete_prefix(jd_kv_backend, namespace, semantics, prefix)) ? 1 : 0;
+
+				j_message_add_operation(reply, 4);
+				j_message_append_4(reply, &ret);
+			}
+
+			j_message_send(reply, connection);
+		}
+		break;
 		case J_MESSAGE_KV_GET:
 		{
 			g_autoptr(JMessage) reply = NULL;
+			g_autofree JBackendRequest* requests = NULL;
+			JBackendQueue* queue;
 			gpointer batch;
 
 			reply = j_message_new_reply(message);
 			namespace = j_message_get_string(message);
 			j_backend_kv_batch_start(jd_kv_backend, namespace, semantics, &batch);
 
+			queue = jd_backend_queue_get_thread(&jd_kv_queue, jd_kv_backend);
+			requests = g_new(JBackendRequest, operation_count);
+
 			for (i = 0; i < operation_count; i++)
 			{
-				gpointer value;
-				guint32 len;
+				requests[i].type = J_BACKEND_REQUEST_KV_GET;
+				requests[i].data = batch;
+				requests[i].kv.key = j_message_get_string(message);
+				requests[i].kv.value = NULL;
+				requests[i].kv.length = 0;
+			}
 
-				key = j_message_get_string(message);
+			if (j_backend_queue_is_async(queue))
+			{
+				// All gets are submitted before waiting for them to keep multiple requests in flight
+				for (i = 0; i < operation_count; i++)
+				{
+					j_backend_queue_submit(queue, &(requests[i]));
+				}
+
+				j_backend_queue_wait(queue);
+			}
+			else
+			{
+				g_autofree gchar const** keys = NULL;
+				g_autofree gconstpointer* values = NULL;
+				g_autofree guint32* lens = NULL;
 
-				if (j_backend_kv_get(jd_kv_backend, batch, key, &value, &len))
+				keys = g_new(gchar const*, operation_count);
+				values = g_new(gconstpointer, operation_count);
+				lens = g_new(guint32, operation_count);
+
+				for (i = 0; i < operation_count; i++)
 				{
-					j_message_add_operation(reply, 4 + len);
-					j_message_append_4(reply, &len);
-					j_message_append_n(reply, value, len);
+					keys[i] = requests[i].kv.key;
+				}
+
+				// Backends can look up all keys at once, for example, by walking a cursor through the sorted keys
+				j_backend_kv_get_multi(jd_kv_backend, batch, keys, operation_count, values, lens);
 
-					g_free(value);
+				for (i = 0; i < operation_count; i++)
+				{
+					requests[i].kv.value = values[i];
+					requests[i].kv.length = lens[i];
+					requests[i].ret = (values[i] != NULL);
 				}
-				else
+			}
+
+			for (i = 0; i < operation_count; i++)
+			{
+				guint32 len = 0;
+
+				if (requests[i].ret)
 				{
-					guint32 zero = 0;
+					len = requests[i].kv.length;
+				}
 
-					j_message_add_operation(reply, 4);
-					j_message_append_4(reply, &zero);
+				j_message_add_operation(reply, 4);
+				j_message_append_4(reply, &len);
+
+				// Values belong to the backend and are sent directly after the reply
+				if (len > 0)
+				{
+					j_message_add_send(reply, requests[i].kv.value, len);
 				}
 			}
 
-			j_backend_kv_batch_execute(jd_kv_backend, batch);
-
+			// Values are only valid until the batch has been executed
 			j_message_send(reply, connection);
+
+			j_backend_kv_batch_execute(jd_kv_backend, batch);
 		}
 		break;
 		case J_MESSAGE_KV_GET_ALL:
@@ -553,6 +873,151 @@ jd_handle_message(JMessage* message, GSocketConnection* connection, JMemoryChunk
 			j_message_send(reply, connection);
 		}
 		break;
+		case J_MESSAGE_KV_GET_RANGE:
+		{
+			g_autoptr(JMessage) reply = NULL;
+			g_autofree gchar* next = NULL;
+			gchar const* start;
+			gchar const* end;
+			gpointer iterator;
+			gconstpointer value;
+			guint32 limit;
+			guint32 count = 0;
+			guint32 len;
+			guint32 zero = 0;
+			gchar more = 0;
+
+			reply = j_message_new_reply(message);
+			namespace = j_message_get_string(message);
+			start = j_message_get_string(message);
+			end = j_message_get_string(message);
+			limit = MIN(j_message_get_4(message), G_MAXUINT32 - 1);
+
+			// Empty keys mean that the range is not bounded
+			start = (start[0] != '\0') ? start : NULL;
+			end = (end[0] != '\0') ? end : NULL;
+
+			// The additional key only tells the client whether there are more keys, which keeps replies bounded by the page size
+			if (j_backend_kv_get_range(jd_kv_backend, namespace, start, end, (limit > 0) ? limit + 1 : 0, &iterator))
+			{
+				while (j_backend_kv_iterate(jd_kv_backend, iterator, &key, &value, &len))
+				{
+					gsize key_len;
+
+					if (limit > 0 && count == limit)
+					{
+						// The client continues with this key, so no cursor has to be kept
+						next = g_strdup(key);
+						more = 1;
+						continue;
+					}
+
+					key_len = strlen(key) + 1;
+
+					j_message_add_operation(reply, 4 + len + key_len);
+					j_message_append_4(reply, &len);
+					j_message_append_n(reply, value, len);
+					j_message_append_string(reply, key);
+
+					count++;
+				}
+			}
+
+			if (next == NULL)
+			{
+				next = g_strdup("");
+			}
+
+			j_message_add_operation(reply, 4 + 1 + strlen(next) + 1);
+			j_message_append_4(reply, &zero);
+			j_message_append_1(reply, &more);
+			j_message_append_string(reply, next);
+
+			j_message_send(reply, connection);
+		}
+		break;
+		case J_MESSAGE_KV_CAS:
+		case J_MESSAGE_KV_INCREMENT:
+		case J_MESSAGE_KV_MERGE:
+		{
+			g_autoptr(JMessage) reply = NULL;
+			g_autofree JBackendKVUpdate* updates = NULL;
+			JMessageType type;
+			gboolean failed;
+
+			type = j_message_get_type(message);
+			reply = j_message_new_reply(message);
+			namespace = j_message_get_string(message);
+
+			updates = g_new0(JBackendKVUpdate, operation_count);
+
+			// Keys and values point into the message
+			for (i = 0; i < operation_count; i++)
+			{
+				updates[i].key = j_message_get_string(message);
+
+				if (type == J_MESSAGE_KV_CAS)
+				{
+					guint32 expected_len;
+
+					updates[i].type = J_BACKEND_KV_UPDATE_CAS;
+					expected_len = j_message_get_4(message);
+
+					// The maximum length signals that the key must not exist
+					if (expected_len != G_MAXUINT32)
+					{
+						updates[i].expected = j_message_get_n(message, expected_len);
+						updates[i].expected_len = expected_len;
+					}
+
+					updates[i].len = j_message_get_4(message);
+					updates[i].value = j_message_get_n(message, updates[i].len);
+				}
+				else if (type == J_MESSAGE_KV_INCREMENT)
+				{
+					updates[i].type = J_BACKEND_KV_UPDATE_INCREMENT;
+					updates[i].delta = j_message_get_8(message);
+				}
+				else
+				{
+					updates[i].type = J_BACKEND_KV_UPDATE_MERGE;
+					updates[i].max = (j_message_get_1(message) != 0);
+					updates[i].len = j_message_get_4(message);
+					updates[i].value = j_message_get_n(message, updates[i].len);
+				}
+			}
+
+			failed = !j_backend_kv_update(jd_kv_backend, namespace, semantics, updates, operation_count);
+
+			// Clients always need the results, independent of the safety semantics
+			for (i = 0; i < operation_count; i++)
+			{
+				guint32 ret;
+
+				ret = (updates[i].ret) ? 1 : 0;
+
+				// The maximum value signals that the backend failed, which clients must not mistake for a failed comparison
+				if (failed)
+				{
+					ret = G_MAXUINT32;
+				}
+
+				if (type == J_MESSAGE_KV_INCREMENT)
+				{
+					j_message_add_operation(reply, 4 + 8);
+					j_message_append_4(reply, &ret);
+					j_message_append_8(reply, &(updates[i].result));
+				}
+				else
+				{
+					j_message_add_operation(reply, 4);
+					j_message_append_4(reply, &ret);
+				}
+			}
+
+			j_message_send(reply, connection);
+		}
+		break;
 		case J_MESSAGE_DB_SCHEMA_CREATE:
 			if (!message_matched)
 			{
@@ -88,6 +88,8 @@ test_configuration_get(void)
 	g_key_file_set_string(key_file, "db", "backend", "null3");
 	g_key_file_set_string(key_file, "db", "component", "client");
 	g_key_file_set_string(key_file, "db", "path", "NULL3");
+	g_key_file_set_integer(key_file, "clients", "max-connections", 2);
+	g_key_file_set_integer(key_file, "clients", "stripe-window", 8);
 
 	configuration = j_configuration_new_for_data(key_file);
 	g_assert_true(configuration != NULL);
@@ -115,6 +117,9 @@ test_configuration_get(void)
 	g_assert_cmpstr(j_configuration_get_backend_component(configuration, J_BACKEND_TYPE_DB), ==, "client");
 	g_assert_cmpstr(j_configuration_get_backend_path(configuration, J_BACKEND_TYPE_DB), ==, "NULL3");
 
+	g_assert_cmpuint(j_configuration_get_max_connections(configuration), ==, 2);
+	g_assert_cmpuint(j_configuration_get_stripe_window(configuration), ==, 2);
+
 	j_configuration_unref(configuration);
 
 	g_key_file_free(key_file);
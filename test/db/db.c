@@ -407,6 +407,226 @@ iterator_get(void)
 	g_assert_cmpuint(entries, ==, 1);
 }
 
+static void
+range_entry_insert(JDBSchema* schema, gchar const* file, gchar const* name, gdouble min)
+{
+	g_autoptr(GError) error = NULL;
+
+	gboolean success = TRUE;
+	g_autoptr(JDBEntry) entry = NULL;
+	g_autoptr(JBatch) batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+	entry = j_db_entry_new(schema, &error);
+	g_assert_nonnull(entry);
+	g_assert_no_error(error);
+	success = j_db_entry_set_field(entry, "file", file, strlen(file), &error);
+	g_assert_true(success);
+	g_assert_no_error(error);
+	success = j_db_entry_set_field(entry, "name", name, strlen(name), &error);
+	g_assert_true(success);
+	g_assert_no_error(error);
+	success = j_db_entry_set_field(entry, "min", &min, sizeof(min), &error);
+	g_assert_true(success);
+	g_assert_no_error(error);
+	success = j_db_entry_insert(entry, batch, &error);
+	g_assert_true(success);
+	g_assert_no_error(error);
+	success = j_batch_execute(batch);
+	g_assert_true(success);
+}
+
+static void
+range_entry_update(JDBSchema* schema, gchar const* name, gchar const* field, gconstpointer value, guint64 length)
+{
+	g_autoptr(GError) error = NULL;
+
+	gboolean success = TRUE;
+	g_autoptr(JDBSelector) selector = NULL;
+	g_autoptr(JDBEntry) entry = NULL;
+	g_autoptr(JBatch) batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+	selector = j_db_selector_new(schema, J_DB_SELECTOR_MODE_AND, &error);
+	g_assert_nonnull(selector);
+	g_assert_no_error(error);
+	success = j_db_selector_add_field(selector, "name", J_DB_SELECTOR_OPERATOR_EQ, name, strlen(name), &error);
+	g_assert_true(success);
+	g_assert_no_error(error);
+
+	entry = j_db_entry_new(schema, &error);
+	g_assert_nonnull(entry);
+	g_assert_no_error(error);
+	success = j_db_entry_set_field(entry, field, value, length, &error);
+	g_assert_true(success);
+	g_assert_no_error(error);
+	success = j_db_entry_update(entry, selector, batch, &error);
+	g_assert_true(success);
+	g_assert_no_error(error);
+	success = j_batch_execute(batch);
+	g_assert_true(success);
+}
+
+static void
+range_entry_delete(JDBSchema* schema, gchar const* field, gchar const* value)
+{
+	g_autoptr(GError) error = NULL;
+
+	gboolean success = TRUE;
+	g_autoptr(JDBSelector) selector = NULL;
+	g_autoptr(JDBEntry) entry = NULL;
+	g_autoptr(JBatch) batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+	selector = j_db_selector_new(schema, J_DB_SELECTOR_MODE_AND, &error);
+	g_assert_nonnull(selector);
+	g_assert_no_error(error);
+	success = j_db_selector_add_field(selector, field, J_DB_SELECTOR_OPERATOR_EQ, value, strlen(value), &error);
+	g_assert_true(success);
+	g_assert_no_error(error);
+
+	entry = j_db_entry_new(schema, &error);
+	g_assert_nonnull(entry);
+	g_assert_no_error(error);
+	success = j_db_entry_delete(entry, selector, batch, &error);
+	g_assert_true(success);
+	g_assert_no_error(error);
+	success = j_batch_execute(batch);
+	g_assert_true(success);
+}
+
+static gint
+range_name_compare(gconstpointer a, gconstpointer b)
+{
+	return g_strcmp0(*(gchar const* const*)a, *(gchar const* const*)b);
+}
+
+/**
+ * Returns the sorted names of all entries matching (min > 0.5 AND min <= 1.0) OR file = "other.bp", separated by commas.
+ **/
+static gchar*
+range_names(JDBSchema* schema)
+{
+	g_autoptr(GError) error = NULL;
+
+	gboolean success = TRUE;
+	g_autoptr(JDBSelector) selector = NULL;
+	g_autoptr(JDBSelector) sub_selector = NULL;
+	g_autoptr(JDBIterator) iterator = NULL;
+	g_autoptr(GPtrArray) names = NULL;
+
+	gchar const* file = "other.bp";
+	gdouble min_lower = 0.5;
+	gdouble min_upper = 1.0;
+
+	sub_selector = j_db_selector_new(schema, J_DB_SELECTOR_MODE_AND, &error);
+	g_assert_nonnull(sub_selector);
+	g_assert_no_error(error);
+	success = j_db_selector_add_field(sub_selector, "min", J_DB_SELECTOR_OPERATOR_GT, &min_lower, sizeof(min_lower), &error);
+	g_assert_true(success);
+	g_assert_no_error(error);
+	success = j_db_selector_add_field(sub_selector, "min", J_DB_SELECTOR_OPERATOR_LE, &min_upper, sizeof(min_upper), &error);
+	g_assert_true(success);
+	g_assert_no_error(error);
+
+	selector = j_db_selector_new(schema, J_DB_SELECTOR_MODE_OR, &error);
+	g_assert_nonnull(selector);
+	g_assert_no_error(error);
+	success = j_db_selector_add_selector(selector, sub_selector, &error);
+	g_assert_true(success);
+	g_assert_no_error(error);
+	success = j_db_selector_add_field(selector, "file", J_DB_SELECTOR_OPERATOR_EQ, file, strlen(file), &error);
+	g_assert_true(success);
+	g_assert_no_error(error);
+
+	iterator = j_db_iterator_new(schema, selector, &error);
+	g_assert_nonnull(iterator);
+	g_assert_no_error(error);
+
+	names = g_ptr_array_new_with_free_func(g_free);
+
+	while (j_db_iterator_next(iterator, NULL))
+	{
+		JDBType type;
+		guint64 len;
+		gchar* name = NULL;
+
+		success = j_db_iterator_get_field(iterator, "name", &type, (gpointer*)&name, &len, &error);
+		g_assert_true(success);
+		g_assert_no_error(error);
+
+		g_ptr_array_add(names, name);
+	}
+
+	g_ptr_array_sort(names, range_name_compare);
+	g_ptr_array_add(names, NULL);
+
+	return g_strjoinv(",", (gchar**)names->pdata);
+}
+
+static void
+iterator_get_range(void)
+{
+	g_autoptr(GError) error = NULL;
+
+	gboolean success = TRUE;
+	g_autoptr(JDBSchema) schema = NULL;
+	g_autoptr(JBatch) batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+	gchar const* other_file = "other.bp";
+	gchar const* range_file = "range.bp";
+	gdouble min = 0.9;
+
+	schema = j_db_schema_new("adios2", "variables", &error);
+	g_assert_nonnull(schema);
+	g_assert_no_error(error);
+	success = j_db_schema_get(schema, batch, &error);
+	g_assert_true(success);
+	g_assert_no_error(error);
+	success = j_batch_execute(batch);
+	g_assert_true(success);
+
+	// temperature (min = 1.0) only matches the range
+	range_entry_insert(schema, other_file, "pressure", 5.0);
+	range_entry_insert(schema, range_file, "density", 0.75);
+	range_entry_insert(schema, range_file, "velocity", 0.5);
+	range_entry_insert(schema, range_file, "energy", 2.0);
+
+	{
+		g_autofree gchar* names = range_names(schema);
+		g_assert_cmpstr(names, ==, "density,pressure,temperature");
+	}
+
+	// Updates of indexed columns have to move entries into and out of the result
+	range_entry_update(schema, "velocity", "min", &min, sizeof(min));
+	range_entry_update(schema, "pressure", "file", range_file, strlen(range_file));
+
+	{
+		g_autofree gchar* names = range_names(schema);
+		g_assert_cmpstr(names, ==, "density,temperature,velocity");
+	}
+
+	range_entry_delete(schema, "name", "density");
+
+	{
+		g_autofree gchar* names = range_names(schema);
+		g_assert_cmpstr(names, ==, "temperature,velocity");
+	}
+
+	// Entries inserted after a deletion must not show up as the deleted entry
+	range_entry_insert(schema, other_file, "humidity", 3.0);
+
+	{
+		g_autofree gchar* names = range_names(schema);
+		g_assert_cmpstr(names, ==, "humidity,temperature,velocity");
+	}
+
+	range_entry_delete(schema, "file", range_file);
+	range_entry_delete(schema, "file", other_file);
+
+	{
+		g_autofree gchar* names = range_names(schema);
+		g_assert_cmpstr(names, ==, "temperature");
+	}
+}
+
 static void
 entry_update(void)
 {
@@ -528,6 +748,7 @@ test_db_all(void)
 	schema_create();
 	entry_insert();
 	iterator_get();
+	iterator_get_range();
 	entry_update();
 	entry_delete();
 	schema_delete();
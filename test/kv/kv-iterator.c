@@ -94,9 +94,88 @@ test_kv_iterator_next_get(void)
 	g_assert_cmpuint(kvs, ==, n);
 }
 
+static void
+test_kv_iterator_range(void)
+{
+	// More keys than fit into one page
+	guint const n = 2500;
+
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JBatch) delete_batch = NULL;
+	gboolean ret;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	delete_batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+	for (guint i = 0; i < n; i++)
+	{
+		g_autoptr(JKV) kv = NULL;
+
+		g_autofree gchar* key = NULL;
+		gchar* value = NULL;
+
+		key = g_strdup_printf("test-key-%04d", i);
+		value = g_strdup_printf("test-value-%04d", i);
+		kv = j_kv_new("test-ns-range", key);
+		j_kv_put(kv, value, strlen(value) + 1, g_free, batch);
+		j_kv_delete(kv, delete_batch);
+	}
+
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+
+	{
+		g_autoptr(JKVIterator) kv_iterator = NULL;
+		guint kvs = 0;
+
+		kv_iterator = j_kv_iterator_new_range("test-ns-range", "test-key-0100", "test-key-2200", 0);
+
+		while (j_kv_iterator_next(kv_iterator))
+		{
+			gchar const* key;
+			gconstpointer value;
+			guint32 len;
+
+			key = j_kv_iterator_get(kv_iterator, &value, &len);
+			g_assert_cmpstr(key, >=, "test-key-0100");
+			g_assert_cmpstr(key, <, "test-key-2200");
+			g_assert_cmpstr(key + strlen("test-key-"), ==, (gchar const*)value + strlen("test-value-"));
+			kvs++;
+		}
+
+		g_assert_cmpuint(kvs, ==, 2100);
+	}
+
+	{
+		g_autoptr(JKVIterator) kv_iterator = NULL;
+		guint kvs = 0;
+
+		kv_iterator = j_kv_iterator_new_range("test-ns-range", NULL, NULL, 1500);
+
+		while (j_kv_iterator_next(kv_iterator))
+		{
+			kvs++;
+		}
+
+		g_assert_cmpuint(kvs, ==, 1500);
+	}
+
+	{
+		g_autoptr(JKVIterator) kv_iterator = NULL;
+
+		// Freeing an iterator that has not been consumed must not leave replies behind
+		kv_iterator = j_kv_iterator_new_range("test-ns-range", NULL, NULL, 0);
+		g_assert_true(j_kv_iterator_next(kv_iterator));
+	}
+
+	ret = j_batch_execute(delete_batch);
+	g_assert_true(ret);
+}
+
 void
 test_kv_iterator(void)
 {
 	g_test_add_func("/kv/kv-iterator/new_free", test_kv_iterator_new_free);
 	g_test_add_func("/kv/kv-iterator/next_get", test_kv_iterator_next_get);
+	g_test_add_func("/kv/kv-iterator/range", test_kv_iterator_range);
 }
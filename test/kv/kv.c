@@ -19,6 +19,7 @@
 #include <julea-config.h>
 
 #include <glib.h>
+#include <glib/gstdio.h>
 
 #include <julea.h>
 #include <julea-kv.h>
@@ -120,6 +121,153 @@ test_kv_get(void)
 	g_assert_true(ret);
 }
 
+/**
+ * Writes a copy of the current configuration with the client cache enabled to a temporary file.
+ * The configuration is searched for in the same way as by j_configuration().
+ **/
+static gchar*
+write_configuration_with_cache(void)
+{
+	g_autoptr(GKeyFile) key_file = NULL;
+	g_autofree gchar* config_name = NULL;
+	gchar const* env_path;
+	gchar const* const* dirs;
+	gchar* path = NULL;
+	gboolean loaded = FALSE;
+	gint fd;
+
+	key_file = g_key_file_new();
+	env_path = g_getenv("JULEA_CONFIG");
+
+	if (env_path != NULL && g_path_is_absolute(env_path))
+	{
+		loaded = g_key_file_load_from_file(key_file, env_path, G_KEY_FILE_NONE, NULL);
+	}
+	else
+	{
+		config_name = (env_path != NULL) ? g_path_get_basename(env_path) : g_strdup("julea");
+		path = g_build_filename(g_get_user_config_dir(), "julea", config_name, NULL);
+		loaded = g_key_file_load_from_file(key_file, path, G_KEY_FILE_NONE, NULL);
+		g_free(path);
+
+		dirs = g_get_system_config_dirs();
+
+		for (guint i = 0; !loaded && dirs[i] != NULL; i++)
+		{
+			path = g_build_filename(dirs[i], "julea", config_name, NULL);
+			loaded = g_key_file_load_from_file(key_file, path, G_KEY_FILE_NONE, NULL);
+			g_free(path);
+		}
+	}
+
+	g_assert_true(loaded);
+
+	g_key_file_set_integer(key_file, "clients", "kv-cache-lease", 60000);
+	g_key_file_set_integer(key_file, "clients", "kv-cache-size", 1024);
+
+	fd = g_file_open_tmp("julea-test-kv-XXXXXX", &path, NULL);
+	g_assert_cmpint(fd, !=, -1);
+	g_close(fd, NULL);
+
+	g_assert_true(g_key_file_save_to_file(key_file, path, NULL));
+
+	return path;
+}
+
+static void
+test_kv_get_modified(void)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JKV) kv = NULL;
+	g_autofree gchar* value = NULL;
+	g_autofree gchar* new_value = NULL;
+	gboolean ret;
+
+	// The client cache is set up when the library is loaded, run the test in a subprocess that has it enabled
+	if (!g_test_subprocess())
+	{
+		g_autofree gchar* config_path = NULL;
+		g_autofree gchar* old_config = NULL;
+
+		old_config = g_strdup(g_getenv("JULEA_CONFIG"));
+		config_path = write_configuration_with_cache();
+
+		g_setenv("JULEA_CONFIG", config_path, TRUE);
+		g_test_trap_subprocess(NULL, 0, 0);
+
+		if (old_config != NULL)
+		{
+			g_setenv("JULEA_CONFIG", old_config, TRUE);
+		}
+		else
+		{
+			g_unsetenv("JULEA_CONFIG");
+		}
+
+		g_unlink(config_path);
+		g_test_trap_assert_passed();
+
+		return;
+	}
+
+	g_assert_cmpuint(j_configuration_get_kv_cache_lease(j_configuration()), >, 0);
+
+	// The default semantics use eventual consistency, which allows lookups to be answered by the client cache
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	value = g_strdup("kv-value");
+	new_value = g_strdup("kv-new-value");
+
+	kv = j_kv_new("test", "test-kv");
+	g_assert_true(kv != NULL);
+
+	j_kv_put(kv, value, strlen(value) + 1, NULL, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+
+	for (guint i = 0; i < 2; i++)
+	{
+		g_autofree gchar* get_value = NULL;
+		guint32 get_len;
+
+		j_kv_get(kv, (gpointer)&get_value, &get_len, batch);
+		ret = j_batch_execute(batch);
+		g_assert_true(ret);
+
+		g_assert_cmpstr(value, ==, get_value);
+		g_assert_cmpuint(strlen(value) + 1, ==, get_len);
+	}
+
+	// Modifications by the same client must never return stale values
+	j_kv_put(kv, new_value, strlen(new_value) + 1, NULL, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+
+	{
+		g_autofree gchar* get_value = NULL;
+		guint32 get_len;
+
+		j_kv_get(kv, (gpointer)&get_value, &get_len, batch);
+		ret = j_batch_execute(batch);
+		g_assert_true(ret);
+
+		g_assert_cmpstr(new_value, ==, get_value);
+		g_assert_cmpuint(strlen(new_value) + 1, ==, get_len);
+	}
+
+	j_kv_delete(kv, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+
+	{
+		g_autofree gchar* get_value = NULL;
+		guint32 get_len;
+
+		j_kv_get(kv, (gpointer)&get_value, &get_len, batch);
+		ret = j_batch_execute(batch);
+		g_assert_false(ret);
+	}
+}
+
 static void
 get_callback(gpointer value, guint32 length, gpointer data)
 {
@@ -157,6 +305,225 @@ test_kv_get_callback(void)
 	g_assert_true(ret);
 }
 
+static void
+test_kv_cas(void)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JKV) kv = NULL;
+	g_autofree gchar* get_value = NULL;
+	guint32 get_len;
+	gboolean swapped;
+	gboolean ret;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+	kv = j_kv_new("test", "test-kv-cas");
+	g_assert_true(kv != NULL);
+
+	j_kv_cas(kv, NULL, 0, g_strdup("kv-value"), strlen("kv-value") + 1, g_free, &swapped, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+	g_assert_true(swapped);
+
+	// The key exists now
+	j_kv_cas(kv, NULL, 0, g_strdup("kv-other"), strlen("kv-other") + 1, g_free, &swapped, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+	g_assert_false(swapped);
+
+	j_kv_cas(kv, "kv-other", strlen("kv-other") + 1, g_strdup("kv-new"), strlen("kv-new") + 1, g_free, &swapped, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+	g_assert_false(swapped);
+
+	j_kv_cas(kv, "kv-value", strlen("kv-value") + 1, g_strdup("kv-new"), strlen("kv-new") + 1, g_free, &swapped, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+	g_assert_true(swapped);
+
+	j_kv_get(kv, (gpointer)&get_value, &get_len, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+	g_assert_cmpstr(get_value, ==, "kv-new");
+
+	// Empty values can be swapped in and out
+	j_kv_cas(kv, "kv-new", strlen("kv-new") + 1, NULL, 0, NULL, &swapped, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+	g_assert_true(swapped);
+
+	j_kv_cas(kv, "", 0, g_strdup("kv-value"), strlen("kv-value") + 1, g_free, &swapped, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+	g_assert_true(swapped);
+
+	j_kv_delete(kv, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+}
+
+static void
+test_kv_increment(void)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JKV) kv = NULL;
+	gint64 result[3];
+	gboolean ret;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+	kv = j_kv_new("test", "test-kv-increment");
+	g_assert_true(kv != NULL);
+
+	// Increments of the same key within one batch have to see each other
+	j_kv_increment(kv, 1, &(result[0]), batch);
+	j_kv_increment(kv, 41, &(result[1]), batch);
+	j_kv_increment(kv, -2, &(result[2]), batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+
+	g_assert_cmpint(result[0], ==, 1);
+	g_assert_cmpint(result[1], ==, 42);
+	g_assert_cmpint(result[2], ==, 40);
+
+	j_kv_delete(kv, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+}
+
+static void
+test_kv_merge(void)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JKV) kv = NULL;
+	g_autofree gpointer get_value = NULL;
+	bson_t* document;
+	bson_t b[1];
+	bson_t b_child[1];
+	bson_iter_t iter;
+	bson_iter_t child_iter;
+	gpointer value;
+	guint32 get_len;
+	guint32 len;
+	gboolean ret;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+	kv = j_kv_new("test", "test-kv-merge");
+	g_assert_true(kv != NULL);
+
+	// Merging requires an existing document
+	bson_init(b);
+	bson_append_int64(b, "size", -1, 1);
+	j_kv_merge(kv, b, J_KV_MERGE_MAX, batch);
+	ret = j_batch_execute(batch);
+	g_assert_false(ret);
+	bson_destroy(b);
+
+	document = bson_new();
+	bson_append_utf8(document, "name", -1, "kv-merge", -1);
+	bson_append_int64(document, "size", -1, 10);
+	bson_append_document_begin(document, "status", -1, b_child);
+	bson_append_int64(b_child, "time", -1, 5);
+	bson_append_document_end(document, b_child);
+	value = bson_destroy_with_steal(document, TRUE, &len);
+
+	j_kv_put(kv, value, len, bson_free, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+
+	bson_init(b);
+	bson_append_int64(b, "size", -1, 5);
+	bson_append_document_begin(b, "status", -1, b_child);
+	bson_append_int64(b_child, "time", -1, 7);
+	bson_append_document_end(b, b_child);
+	bson_append_bool(b, "file", -1, TRUE);
+	j_kv_merge(kv, b, J_KV_MERGE_MAX, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+	bson_destroy(b);
+
+	j_kv_get(kv, &get_value, &get_len, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+
+	bson_init_static(b, get_value, get_len);
+	g_assert_true(bson_iter_init_find(&iter, b, "name"));
+	g_assert_cmpstr(bson_iter_utf8(&iter, NULL), ==, "kv-merge");
+	g_assert_true(bson_iter_init_find(&iter, b, "size"));
+	g_assert_cmpint(bson_iter_int64(&iter), ==, 10);
+	g_assert_true(bson_iter_init_find(&iter, b, "file"));
+	g_assert_true(bson_iter_bool(&iter));
+	g_assert_true(bson_iter_init(&iter, b) && bson_iter_find_descendant(&iter, "status.time", &child_iter));
+	g_assert_cmpint(bson_iter_int64(&child_iter), ==, 7);
+	bson_destroy(b);
+
+	j_kv_delete(kv, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+}
+
+static void
+test_kv_delete_prefix(void)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JKV) kv_other = NULL;
+	g_autofree gchar* value = NULL;
+	gboolean ret;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	value = g_strdup("kv-value");
+
+	for (guint i = 0; i < 10; i++)
+	{
+		g_autoptr(JKV) kv = NULL;
+		g_autofree gchar* name = NULL;
+
+		name = g_strdup_printf("test-kv-prefix-%u", i);
+		kv = j_kv_new("test", name);
+		j_kv_put(kv, g_strdup(value), strlen(value) + 1, g_free, batch);
+	}
+
+	kv_other = j_kv_new("test", "test-kv-other");
+	j_kv_put(kv_other, g_strdup(value), strlen(value) + 1, g_free, batch);
+
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+
+	j_kv_delete_prefix("test", "test-kv-prefix-", batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+
+	for (guint i = 0; i < 10; i++)
+	{
+		g_autoptr(JKV) kv = NULL;
+		g_autofree gchar* name = NULL;
+		g_autofree gchar* get_value = NULL;
+		guint32 get_len;
+
+		name = g_strdup_printf("test-kv-prefix-%u", i);
+		kv = j_kv_new("test", name);
+		j_kv_get(kv, (gpointer)&get_value, &get_len, batch);
+		ret = j_batch_execute(batch);
+		g_assert_false(ret);
+	}
+
+	// Keys outside of the prefix must not be touched
+	{
+		g_autofree gchar* get_value = NULL;
+		guint32 get_len;
+
+		j_kv_get(kv_other, (gpointer)&get_value, &get_len, batch);
+		ret = j_batch_execute(batch);
+		g_assert_true(ret);
+		g_assert_cmpstr(value, ==, get_value);
+	}
+
+	j_kv_delete(kv_other, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+}
+
 void
 test_kv_kv(void)
 {
@@ -164,5 +531,10 @@ test_kv_kv(void)
 	g_test_add_func("/kv/kv/ref_unref", test_kv_ref_unref);
 	g_test_add_func("/kv/kv/put_delete", test_kv_put_delete);
 	g_test_add_func("/kv/kv/get", test_kv_get);
+	g_test_add_func("/kv/kv/get_modified", test_kv_get_modified);
 	g_test_add_func("/kv/kv/get_callback", test_kv_get_callback);
+	g_test_add_func("/kv/kv/cas", test_kv_cas);
+	g_test_add_func("/kv/kv/increment", test_kv_increment);
+	g_test_add_func("/kv/kv/merge", test_kv_merge);
+	g_test_add_func("/kv/kv/delete_prefix", test_kv_delete_prefix);
 }
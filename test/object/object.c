@@ -79,7 +79,7 @@ test_object_read_write(void)
 	max_operation_size = j_configuration_get_max_operation_size(j_configuration());
 
 	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
-	buffer = g_malloc0(max_operation_size + 1);
+	buffer = g_malloc0(2 * max_operation_size);
 
 	object = j_object_new("test", "test-object-rw");
 	g_assert_true(object != NULL);
@@ -137,6 +137,13 @@ test_object_read_write(void)
 	g_assert_true(ret);
 	g_assert_cmpuint(nbytes, ==, 3 * max_operation_size);
 
+	// Short read that spans multiple chunks on the server
+	j_object_read(object, buffer, 2 * max_operation_size, 0, &nbytes, batch);
+	j_object_read(object, buffer, 1, 0, &nbytes, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+	g_assert_cmpuint(nbytes, ==, max_operation_size + 2);
+
 	j_object_delete(object, batch);
 	ret = j_batch_execute(batch);
 	g_assert_true(ret);
@@ -179,6 +186,87 @@ test_object_status(void)
 	g_assert_true(ret);
 }
 
+static void
+test_object_delete_namespace(void)
+{
+	guint const n = 10;
+
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JObject) other = NULL;
+	gint64 modification_time;
+	guint64 size;
+	gboolean ret;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+	for (guint i = 0; i < n; i++)
+	{
+		g_autoptr(JObject) object = NULL;
+		g_autofree gchar* name = NULL;
+
+		name = g_strdup_printf("test-object-%u", i);
+		object = j_object_new("test-delete-namespace", name);
+		g_assert_true(object != NULL);
+
+		j_object_create(object, batch);
+	}
+
+	other = j_object_new("test", "test-object-delete-namespace");
+	g_assert_true(other != NULL);
+
+	j_object_create(other, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+
+	j_object_delete_namespace("test-delete-namespace", batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+
+	for (guint i = 0; i < n; i++)
+	{
+		g_autoptr(JObject) object = NULL;
+		g_autofree gchar* name = NULL;
+
+		name = g_strdup_printf("test-object-%u", i);
+		object = j_object_new("test-delete-namespace", name);
+		g_assert_true(object != NULL);
+
+		j_object_status(object, &modification_time, &size, batch);
+		ret = j_batch_execute(batch);
+		g_assert_false(ret);
+	}
+
+	// Objects in other namespaces are not affected
+	j_object_status(other, &modification_time, &size, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+
+	// Namespaces that refer to other directories are rejected
+	g_test_expect_message("JULEA", G_LOG_LEVEL_CRITICAL, "*j_object_namespace_is_valid*");
+	j_object_delete_namespace("", batch);
+	g_test_assert_expected_messages();
+
+	g_test_expect_message("JULEA", G_LOG_LEVEL_CRITICAL, "*j_object_namespace_is_valid*");
+	j_object_delete_namespace("..", batch);
+	g_test_assert_expected_messages();
+
+	g_test_expect_message("JULEA", G_LOG_LEVEL_CRITICAL, "*j_object_namespace_is_valid*");
+	j_object_delete_namespace("test/../..", batch);
+	g_test_assert_expected_messages();
+
+	g_test_expect_message("JULEA", G_LOG_LEVEL_CRITICAL, "*j_object_namespace_is_valid*");
+	j_object_delete_namespace(".julea-checksums", batch);
+	g_test_assert_expected_messages();
+
+	j_object_status(other, &modification_time, &size, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+
+	j_object_delete(other, batch);
+	ret = j_batch_execute(batch);
+	g_assert_true(ret);
+}
+
 void
 test_object_object(void)
 {
@@ -186,4 +274,5 @@ test_object_object(void)
 	g_test_add_func("/object/object/create_delete", test_object_create_delete);
 	g_test_add_func("/object/object/read_write", test_object_read_write);
 	g_test_add_func("/object/object/status", test_object_status);
+	g_test_add_func("/object/object/delete_namespace", test_object_delete_namespace);
 }
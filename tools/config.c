@@ -43,6 +43,9 @@ static gchar const* opt_db_path = NULL;
 static gint64 opt_max_operation_size = 0;
 static gint opt_max_connections = 0;
 static gint64 opt_stripe_size = 0;
+static gint opt_stripe_window = 0;
+static gint opt_kv_cache_lease = 0;
+static gint opt_kv_cache_size = 0;
 
 static gchar**
 string_split(gchar const* string)
@@ -106,6 +109,9 @@ write_config(gchar* path)
 	g_key_file_set_int64(key_file, "core", "max-operation-size", opt_stripe_size);
 	g_key_file_set_integer(key_file, "clients", "max-connections", opt_max_connections);
 	g_key_file_set_int64(key_file, "clients", "stripe-size", opt_stripe_size);
+	g_key_file_set_integer(key_file, "clients", "stripe-window", opt_stripe_window);
+	g_key_file_set_integer(key_file, "clients", "kv-cache-lease", opt_kv_cache_lease);
+	g_key_file_set_integer(key_file, "clients", "kv-cache-size", opt_kv_cache_size);
 	g_key_file_set_string_list(key_file, "servers", "object", (gchar const* const*)servers_object, g_strv_length(servers_object));
 	g_key_file_set_string_list(key_file, "servers", "kv", (gchar const* const*)servers_kv, g_strv_length(servers_kv));
 	g_key_file_set_string_list(key_file, "servers", "db", (gchar const* const*)servers_db, g_strv_length(servers_db));
@@ -166,6 +172,9 @@ main(gint argc, gchar** argv)
 		{ "max-operation-size", 0, 0, G_OPTION_ARG_INT64, &opt_max_operation_size, "Maximum size of an operation", "0" },
 		{ "max-connections", 0, 0, G_OPTION_ARG_INT, &opt_max_connections, "Maximum number of connections", "0" },
 		{ "stripe-size", 0, 0, G_OPTION_ARG_INT64, &opt_stripe_size, "Default stripe size", "0" },
+		{ "stripe-window", 0, 0, G_OPTION_ARG_INT, &opt_stripe_window, "Maximum number of stripes in flight per server", "0" },
+		{ "kv-cache-lease", 0, 0, G_OPTION_ARG_INT, &opt_kv_cache_lease, "Lease of cached key-value pairs in milliseconds", "0" },
+		{ "kv-cache-size", 0, 0, G_OPTION_ARG_INT, &opt_kv_cache_size, "Maximum number of cached key-value pairs", "0" },
 		{ NULL, 0, 0, 0, NULL, NULL, NULL }
 	};
 
@@ -189,7 +198,10 @@ main(gint argc, gchar** argv)
 	    || (!opt_read && (opt_servers_object == NULL || opt_servers_kv == NULL || opt_servers_db == NULL || opt_object_backend == NULL || opt_object_component == NULL || opt_object_path == NULL || opt_kv_backend == NULL || opt_kv_component == NULL || opt_kv_path == NULL || opt_db_backend == NULL || opt_db_component == NULL || opt_db_path == NULL))
 	    || opt_max_operation_size < 0
 	    || opt_max_connections < 0
-	    || opt_stripe_size < 0)
+	    || opt_stripe_size < 0
+	    || opt_stripe_window < 0
+	    || opt_kv_cache_lease < 0
+	    || opt_kv_cache_size < 0)
 	{
 		g_autofree gchar* help = NULL;
 
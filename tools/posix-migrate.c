@@ -0,0 +1,375 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2019 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Converts the storage of the posix object backend between directory layouts.
+ * The server must not be running while the storage is converted.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <string.h>
+
+// Must match backend/object/posix.c
+#define LAYOUT_FILE ".julea-layout"
+#define LAYOUT_FLAT 1
+#define LAYOUT_SHARDED 2
+#define CHECKSUM_DIR ".julea-checksums"
+
+#define STAGING_DIR ".julea-migrate"
+
+static gchar const* opt_path = NULL;
+static gchar const* opt_layout = NULL;
+
+struct MigrateObject
+{
+	gchar* namespace;
+	gchar* name;
+	gchar* path;
+	gchar* staging_path;
+	gchar* checksum_path;
+	gchar* checksum_staging_path;
+};
+
+typedef struct MigrateObject MigrateObject;
+
+static void
+migrate_object_free(gpointer data)
+{
+	MigrateObject* object = data;
+
+	g_free(object->namespace);
+	g_free(object->name);
+	g_free(object->path);
+	g_free(object->staging_path);
+	g_free(object->checksum_path);
+	g_free(object->checksum_staging_path);
+	g_slice_free(MigrateObject, object);
+}
+
+// Must match backend_build_path() in backend/object/posix.c
+static gchar*
+build_path(gchar const* base, guint layout, gchar const* namespace, gchar const* name)
+{
+	if (layout == LAYOUT_SHARDED)
+	{
+		gchar shard[2][3];
+		guint32 hash = 2166136261U;
+
+		for (gchar const* c = name; *c != '\0'; c++)
+		{
+			hash ^= (guchar)*c;
+			hash *= 16777619U;
+		}
+
+		g_snprintf(shard[0], sizeof(shard[0]), "%02x", (hash >> 8) & 0xff);
+		g_snprintf(shard[1], sizeof(shard[1]), "%02x", hash & 0xff);
+
+		return g_build_filename(base, namespace, shard[0], shard[1], name, NULL);
+	}
+
+	return g_build_filename(base, namespace, name, NULL);
+}
+
+static guint
+get_layout(void)
+{
+	g_autofree gchar* layout_path = NULL;
+	g_autofree gchar* contents = NULL;
+
+	layout_path = g_build_filename(opt_path, LAYOUT_FILE, NULL);
+
+	if (g_file_get_contents(layout_path, &contents, NULL, NULL))
+	{
+		return g_ascii_strtoull(contents, NULL, 10);
+	}
+
+	// Storage created before the layout was versioned
+	return LAYOUT_FLAT;
+}
+
+/**
+ * Collects all objects below dir_path.
+ *
+ * \param relative The path relative to the namespace directory.
+ **/
+static void
+collect_objects(GPtrArray* objects, guint layout, gchar const* namespace, gchar const* dir_path, gchar const* relative, guint depth)
+{
+	g_autoptr(GDir) dir = NULL;
+	gchar const* entry;
+
+	if ((dir = g_dir_open(dir_path, 0, NULL)) == NULL)
+	{
+		return;
+	}
+
+	while ((entry = g_dir_read_name(dir)) != NULL)
+	{
+		g_autofree gchar* entry_path = NULL;
+		g_autofree gchar* entry_relative = NULL;
+
+		entry_path = g_build_filename(dir_path, entry, NULL);
+		entry_relative = (relative != NULL) ? g_build_filename(relative, entry, NULL) : g_strdup(entry);
+
+		if (g_file_test(entry_path, G_FILE_TEST_IS_DIR))
+		{
+			collect_objects(objects, layout, namespace, entry_path, entry_relative, depth + 1);
+		}
+		else
+		{
+			MigrateObject* object;
+			gchar const* name = entry_relative;
+
+			if (layout == LAYOUT_SHARDED)
+			{
+				// Skip the two shard directories
+				if (depth < 2)
+				{
+					g_printerr("Skipping %s, which is not inside a shard directory.\n", entry_path);
+					continue;
+				}
+
+				name = strchr(strchr(name, G_DIR_SEPARATOR) + 1, G_DIR_SEPARATOR) + 1;
+			}
+
+			object = g_slice_new(MigrateObject);
+			object->namespace = g_strdup(namespace);
+			object->name = g_strdup(name);
+			object->path = g_strdup(entry_path);
+			object->staging_path = g_build_filename(opt_path, STAGING_DIR, namespace, entry_relative, NULL);
+			// Checksums are only maintained if the backend uses the checksum option
+			object->checksum_path = g_build_filename(opt_path, CHECKSUM_DIR, namespace, entry_relative, NULL);
+			object->checksum_staging_path = g_build_filename(opt_path, STAGING_DIR, CHECKSUM_DIR, namespace, entry_relative, NULL);
+
+			g_ptr_array_add(objects, object);
+		}
+	}
+}
+
+/**
+ * Removes all empty directories below dir_path.
+ **/
+static void
+remove_empty_directories(gchar const* dir_path)
+{
+	g_autoptr(GDir) dir = NULL;
+	gchar const* entry;
+
+	if ((dir = g_dir_open(dir_path, 0, NULL)) == NULL)
+	{
+		return;
+	}
+
+	while ((entry = g_dir_read_name(dir)) != NULL)
+	{
+		g_autofree gchar* entry_path = NULL;
+
+		entry_path = g_build_filename(dir_path, entry, NULL);
+
+		if (g_file_test(entry_path, G_FILE_TEST_IS_DIR))
+		{
+			remove_empty_directories(entry_path);
+			// Fails for directories that are not empty
+			g_rmdir(entry_path);
+		}
+	}
+}
+
+static gboolean
+move_file(gchar const* from, gchar const* to)
+{
+	g_autofree gchar* parent = NULL;
+
+	parent = g_path_get_dirname(to);
+	g_mkdir_with_parents(parent, 0700);
+
+	if (g_rename(from, to) != 0)
+	{
+		g_printerr("Could not move %s to %s.\n", from, to);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+migrate(guint from, guint to)
+{
+	g_autoptr(GPtrArray) objects = NULL;
+	g_autoptr(GDir) dir = NULL;
+	g_autofree gchar* layout_path = NULL;
+	g_autofree gchar* staging_path = NULL;
+	g_autofree gchar* version = NULL;
+	gchar const* entry;
+
+	if ((dir = g_dir_open(opt_path, 0, NULL)) == NULL)
+	{
+		g_printerr("Could not open %s.\n", opt_path);
+		return FALSE;
+	}
+
+	objects = g_ptr_array_new_with_free_func(migrate_object_free);
+	staging_path = g_build_filename(opt_path, STAGING_DIR, NULL);
+
+	if (g_file_test(staging_path, G_FILE_TEST_EXISTS))
+	{
+		g_printerr("%s exists, a previous migration might have been interrupted.\n", staging_path);
+		return FALSE;
+	}
+
+	while ((entry = g_dir_read_name(dir)) != NULL)
+	{
+		g_autofree gchar* namespace_path = NULL;
+
+		namespace_path = g_build_filename(opt_path, entry, NULL);
+
+		// Skip the backend's own directories, such as the checksums
+		if (!g_file_test(namespace_path, G_FILE_TEST_IS_DIR) || g_str_has_prefix(entry, ".julea-"))
+		{
+			continue;
+		}
+
+		collect_objects(objects, from, entry, namespace_path, NULL, 0);
+	}
+
+	// Objects are moved to a staging directory first because names in one layout might clash with directories in the other
+	for (guint i = 0; i < objects->len; i++)
+	{
+		MigrateObject* object = g_ptr_array_index(objects, i);
+
+		if (!move_file(object->path, object->staging_path))
+		{
+			return FALSE;
+		}
+
+		if (g_file_test(object->checksum_path, G_FILE_TEST_EXISTS) && !move_file(object->checksum_path, object->checksum_staging_path))
+		{
+			return FALSE;
+		}
+	}
+
+	remove_empty_directories(opt_path);
+
+	for (guint i = 0; i < objects->len; i++)
+	{
+		MigrateObject* object = g_ptr_array_index(objects, i);
+		g_autofree gchar* path = NULL;
+		g_autofree gchar* checksum_base = NULL;
+		g_autofree gchar* checksum_path = NULL;
+
+		path = build_path(opt_path, to, object->namespace, object->name);
+
+		if (!move_file(object->staging_path, path))
+		{
+			return FALSE;
+		}
+
+		if (!g_file_test(object->checksum_staging_path, G_FILE_TEST_EXISTS))
+		{
+			continue;
+		}
+
+		checksum_base = g_build_filename(opt_path, CHECKSUM_DIR, NULL);
+		checksum_path = build_path(checksum_base, to, object->namespace, object->name);
+
+		if (!move_file(object->checksum_staging_path, checksum_path))
+		{
+			return FALSE;
+		}
+	}
+
+	remove_empty_directories(staging_path);
+	g_rmdir(staging_path);
+
+	layout_path = g_build_filename(opt_path, LAYOUT_FILE, NULL);
+	version = g_strdup_printf("%u\n", to);
+
+	if (!g_file_set_contents(layout_path, version, -1, NULL))
+	{
+		g_printerr("Could not write layout file %s.\n", layout_path);
+		return FALSE;
+	}
+
+	g_print("Migrated %u objects.\n", objects->len);
+
+	return TRUE;
+}
+
+gint
+main(gint argc, gchar** argv)
+{
+	GError* error = NULL;
+	g_autoptr(GOptionContext) context = NULL;
+	guint from;
+	guint to;
+
+	GOptionEntry entries[] = {
+		{ "path", 0, 0, G_OPTION_ARG_STRING, &opt_path, "Path of the posix object backend", "/path/to/storage" },
+		{ "layout", 0, 0, G_OPTION_ARG_STRING, &opt_layout, "Layout to convert to", "flat|sharded" },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL }
+	};
+
+	context = g_option_context_new(NULL);
+	g_option_context_add_main_entries(context, entries, NULL);
+
+	if (!g_option_context_parse(context, &argc, &argv, &error))
+	{
+		if (error)
+		{
+			g_printerr("%s\n", error->message);
+			g_error_free(error);
+		}
+
+		return 1;
+	}
+
+	if (opt_path == NULL
+	    || (g_strcmp0(opt_layout, "flat") != 0 && g_strcmp0(opt_layout, "sharded") != 0))
+	{
+		g_autofree gchar* help = NULL;
+
+		help = g_option_context_get_help(context, TRUE, NULL);
+
+		g_print("%s", help);
+
+		return 1;
+	}
+
+	from = get_layout();
+	to = (g_strcmp0(opt_layout, "sharded") == 0) ? LAYOUT_SHARDED : LAYOUT_FLAT;
+
+	if (from != LAYOUT_FLAT && from != LAYOUT_SHARDED)
+	{
+		g_printerr("Unknown layout %u.\n", from);
+		return 1;
+	}
+
+	if (from == to)
+	{
+		g_print("Storage already uses layout %s.\n", opt_layout);
+		return 0;
+	}
+
+	return (migrate(from, to)) ? 0 : 1;
+}